@@ -1,5 +1,16 @@
 #!/bin/sh
-# Usage: ./embed.sh <input-file> <output-dir>
+# Usage: ./embed.sh [--raw [--color-key RRGGBB] | --gzip] [--align BYTES] <embed-dir> <assets-dir> <asset-file>
+#
+# The blob goes into its own read-only section, .rodata.embed.<name>, aligned to --align bytes (a power of two, 64 by
+# default, 4096 for a page), so loaders can hand it to SDL or read it with aligned vector loads in place, and the
+# pages are shared between processes running the same binary.
+#
+# --raw embeds the image pre-decoded by raw_image_gen (path in $RAW_IMAGE_GEN, default bin/raw_image_gen) instead of
+# the file itself, see src/raw_image.h. Outputs and symbols get a .raw suffix: earth_background.png.raw.o/.h and
+# _embed_earth_background_png_raw_start. --color-key makes matching pixels transparent at build time.
+#
+# --gzip embeds the file compressed with gzip -9. Outputs and symbols keep their names, open_embedded_rwops()
+# (src/embed_rwops.h) recognizes the gzip header and inflates while the loader reads.
 
 set -e
 
@@ -7,8 +18,71 @@ set -e
 ### Step 1 - Validate arguments
 ################################################################
 
+RAW_MODE=0
+GZIP_MODE=0
+COLOR_KEY=""
+ALIGNMENT=64
+RAW_IMAGE_GEN="${RAW_IMAGE_GEN:-bin/raw_image_gen}"
+
+while [ $# -gt 0 ]; do
+    case "$1" in
+        --raw)
+            RAW_MODE=1
+            shift
+            ;;
+        --gzip)
+            GZIP_MODE=1
+            shift
+            ;;
+        --color-key)
+            if [ $# -lt 2 ]; then
+                echo "Error: --color-key needs a RRGGBB value" >&2
+                exit 1
+            fi
+            COLOR_KEY="$2"
+            shift 2
+            ;;
+        --align)
+            if [ $# -lt 2 ]; then
+                echo "Error: --align needs a byte count" >&2
+                exit 1
+            fi
+            ALIGNMENT="$2"
+            shift 2
+            ;;
+        -*)
+            echo "Error: Unknown option $1" >&2
+            exit 1
+            ;;
+        *)
+            break
+            ;;
+    esac
+done
+
 if [ $# -ne 3 ]; then
-    echo "Usage: $0 <embed-dir> <assets-dir> <asset-file> " >&2
+    echo "Usage: $0 [--raw [--color-key RRGGBB] | --gzip] [--align BYTES] <embed-dir> <assets-dir> <asset-file> " >&2
+    exit 1
+fi
+
+if [ -n "$COLOR_KEY" ] && [ "$RAW_MODE" -ne 1 ]; then
+    echo "Error: --color-key requires --raw" >&2
+    exit 1
+fi
+
+case "$ALIGNMENT" in
+    ''|*[!0-9]*)
+        echo "Error: --align must be a number of bytes, got [$ALIGNMENT]" >&2
+        exit 1
+        ;;
+esac
+if [ "$ALIGNMENT" -lt 64 ] || [ $((ALIGNMENT & (ALIGNMENT - 1))) -ne 0 ]; then
+    echo "Error: --align must be a power of two of at least 64, got [$ALIGNMENT]" >&2
+    exit 1
+fi
+
+if [ "$RAW_MODE" -eq 1 ] && [ "$GZIP_MODE" -eq 1 ]; then
+    echo "Error: --raw and --gzip cannot be combined" >&2
     exit 1
 fi
 
@@ -19,6 +93,10 @@ INPUT_FILE="$3"
 echo "Embed dir.........[$EMBED_DIR]"
 echo "Assets dir........[$ASSETS_DIR]"
 echo "Input file........[$INPUT_FILE]"
+echo "Raw mode..........[$RAW_MODE]"
+echo "Color key.........[$COLOR_KEY]"
+echo "Gzip mode.........[$GZIP_MODE]"
+echo "Alignment.........[$ALIGNMENT]"
 echo ""
 
 if [ ! -f "$INPUT_FILE" ]; then
@@ -44,6 +122,9 @@ esac
 
 # Derive relative path within assets tree
 RELATIVE_PATH="${INPUT_FILE#${ASSETS_DIR_NOPSLASH}/}"
+if [ "$RAW_MODE" -eq 1 ]; then
+    RELATIVE_PATH="${RELATIVE_PATH}.raw"
+fi
 FILENAME="$(basename "$RELATIVE_PATH")"
 DIR_PART="$(dirname "$RELATIVE_PATH")"
 
@@ -56,9 +137,19 @@ fi
 OBJECT_PATH="$DESTINATION_DIR/${FILENAME}.o"
 HEADER_PATH="$DESTINATION_DIR/${FILENAME}.h"
 
+# File handed to ld, the pre-decoded blob in raw mode, the compressed copy in gzip mode
+if [ "$RAW_MODE" -eq 1 ]; then
+    BLOB_FILE="$DESTINATION_DIR/${FILENAME}"
+elif [ "$GZIP_MODE" -eq 1 ]; then
+    BLOB_FILE="$DESTINATION_DIR/${FILENAME}.gz"
+else
+    BLOB_FILE="$INPUT_FILE"
+fi
+
 echo "Destination dir...[$DESTINATION_DIR]"
 echo "Object path.......[$OBJECT_PATH]"
 echo "Header path.......[$HEADER_PATH]"
+echo "Blob path.........[$BLOB_FILE]"
 echo ""
 
 
@@ -69,7 +160,16 @@ echo ""
 echo "Linking binary blob..."
 
 mkdir -vp "$DESTINATION_DIR"
-ld -r -b binary -o "$OBJECT_PATH" "$INPUT_FILE"
+if [ "$RAW_MODE" -eq 1 ]; then
+    echo "Decoding image with $RAW_IMAGE_GEN..."
+    # shellcheck disable=SC2086 # COLOR_KEY is empty or a single RRGGBB word
+    "$RAW_IMAGE_GEN" "$INPUT_FILE" "$BLOB_FILE" $COLOR_KEY
+elif [ "$GZIP_MODE" -eq 1 ]; then
+    echo "Compressing with gzip..."
+    # -n keeps name and timestamp out of the header, so rebuilds produce the same blob
+    gzip -9 -n -c "$INPUT_FILE" > "$BLOB_FILE"
+fi
+ld -r -b binary -o "$OBJECT_PATH" "$BLOB_FILE"
 
 nm "$OBJECT_PATH"
 echo ""
@@ -81,7 +181,7 @@ echo ""
 echo "Renaming symbols..."
 
 # Original ld symbols are based on the *exact* input path we passed to ld
-ORIG_BASE="$(printf '%s' "$INPUT_FILE" | sed 's/[^A-Za-z0-9_]/_/g')"
+ORIG_BASE="$(printf '%s' "$BLOB_FILE" | sed 's/[^A-Za-z0-9_]/_/g')"
 ORIG_PREFIX="_binary_${ORIG_BASE}"
 
 # New short prefix based on the relative path (assets/ stripped)
@@ -101,21 +201,40 @@ nm "$OBJECT_PATH"
 echo ""
 
 ################################################################
-### Step 5 - Mark stack as non-executable
+### Step 5 - Move blob to an aligned read-only section
+################################################################
+
+# ld -r -b binary emits a writable, byte-aligned .data section; the section name is per blob so the linker script
+# merges it into .rodata without padding unrelated constants
+SECTION_NAME=".rodata.embed.${REL_BASE}"
+
+echo "Section...........[$SECTION_NAME]"
+
+objcopy \
+  --set-section-alignment .data="$ALIGNMENT" \
+  --rename-section .data="$SECTION_NAME",alloc,load,readonly,data,contents \
+  "$OBJECT_PATH"
+
+objdump -h "$OBJECT_PATH"
+echo ""
+
+################################################################
+### Step 6 - Mark stack as non-executable
 ################################################################
 
 objcopy --add-section .note.GNU-stack=/dev/null \
         --set-section-flags .note.GNU-stack=readonly "$OBJECT_PATH"
 
 ################################################################
-### Step 6 - Generate header file
+### Step 7 - Generate header file
 ################################################################
 
 echo "Generating header file..."
 
 # ----------- Header guard from file name -----------
 # Map letters to upper, and map '/', '.', '-' to '_' (put '-' at end to avoid tr range warning)
-GUARD_NAME=$(echo "$FILENAME" | tr '[:lower:]/.-' '[:upper:]___')_H
+# EMBED_ prefix keeps the guard a valid identifier for names starting with a digit (02_image_on_screen.pack)
+GUARD_NAME=EMBED_$(echo "$FILENAME" | tr '[:lower:]/.-' '[:upper:]___')_H
 
 # ----------- Write header -----------
 cat > "$HEADER_PATH" <<EOF
@@ -126,7 +245,8 @@ cat > "$HEADER_PATH" <<EOF
 
 #include <stdint.h>
 
-extern const uint8_t ${RENAMED_PREFIX}_start[];
+// Start is aligned to $ALIGNMENT bytes, in read-only memory
+extern _Alignas($ALIGNMENT) const uint8_t ${RENAMED_PREFIX}_start[];
 extern const uint8_t ${RENAMED_PREFIX}_end[];
 //extern const uint64_t ${RENAMED_PREFIX}_size[];
 
@@ -6,6 +6,8 @@
 #include <time.h>
 
 #include "assert.h"
+#include "bench.h"
+#include "frame_loop.h"
 #include "trace.h"
 
 int main(int argc, char** argv) {
@@ -16,15 +18,23 @@ int main(int argc, char** argv) {
     const int SCREEN_HEIGHT = 480;
     SDL_Event event_buffer;
     bool quit = false;
+    struct frame_loop loop;
 
     TRACE("start");
 
     // Command line
     TRACE("argc=[%d]", argc);
     for (int i = 0; i < argc; i++) {
-        TRACE("argv[%d]=[%s]", i, argv[i]);
+        TRACE_DEBUG("argv[%d]=[%s]", i, argv[i]);
     }
 
+    // Benchmark mode, see bench.h
+    return_code = parse_bench_arguments(argc, argv);
+    ASSERT(return_code == 0, return -1;, "parse_bench_arguments error");
+
+    return_code = set_bench_hints();
+    ASSERT(return_code == 0, return -1;, "set_bench_hints error");
+
     TRACE("Initializing SDL");
     return_code = SDL_Init(SDL_INIT_VIDEO);
     ASSERT(return_code == 0, return -1;, "SDL_Init() error=[%s]", SDL_GetError());
@@ -44,8 +54,17 @@ int main(int argc, char** argv) {
     ASSERT(return_code == 0, SDL_DestroyWindow(window); SDL_Quit(); return -1;
            , "SDL_FillRect() error=[%s]", SDL_GetError());
 
+    return_code = start_bench();
+    ASSERT(return_code == 0, SDL_DestroyWindow(window); SDL_Quit(); return -1;, "start_bench error");
+
+    return_code = start_frame_loop(&loop, 60);
+    ASSERT(return_code == 0, SDL_DestroyWindow(window); SDL_Quit(); return -1;, "start_frame_loop error");
+
     TRACE("Main loop start");
     while (quit == false) {
+        return_code = begin_loop_frame(&loop);
+        ASSERT(return_code == 0, SDL_DestroyWindow(window); SDL_Quit(); return -1;, "begin_loop_frame error");
+
         // Update the surface
         return_code = SDL_UpdateWindowSurface(window);
         ASSERT(return_code == 0, SDL_DestroyWindow(window); SDL_Quit(); return -1;
@@ -60,9 +79,15 @@ int main(int argc, char** argv) {
             }
         } while (return_code == 1);
 
-        // sleep
-        nanosleep(&(struct timespec){.tv_sec = 0, .tv_nsec = (1000000000 / 60)}, NULL);
+        // Benchmark frame time, quits after the requested number of frames
+        return_code = record_bench_frame(&quit);
+        ASSERT(return_code == 0, SDL_DestroyWindow(window); SDL_Quit(); return -1;, "record_bench_frame error");
+
+        // Wait for the next frame deadline, skipped in benchmark mode
+        return_code = end_loop_frame(&loop);
+        ASSERT(return_code == 0, SDL_DestroyWindow(window); SDL_Quit(); return -1;, "end_loop_frame error");
     }
+    trace_frame_pacer(&loop.pacer);
 
     TRACE("Destroying window");
     SDL_DestroyWindow(window);
@@ -70,6 +95,9 @@ int main(int argc, char** argv) {
     TRACE("Quitting SDL");
     SDL_Quit();
 
+    return_code = write_bench_report();
+    ASSERT(return_code == 0, NO_ACTION, "write_bench_report error");
+
     TRACE("end");
     return 0;
 }
@@ -5,8 +5,12 @@
 #include <stdio.h>
 #include <time.h>
 
+#include "asset_pack.h"
 #include "assert.h"
-#include "embed/hello_world.bmp.h"
+#include "bench.h"
+#include "embed/02_image_on_screen.pack.h"
+#include "embed_rwops.h"
+#include "frame_loop.h"
 #include "trace.h"
 
 struct sdl_system {
@@ -15,6 +19,7 @@ struct sdl_system {
 };
 
 struct sdl_data {
+    struct asset_pack pack;
     SDL_Surface* image_hello_world;
 };
 
@@ -72,14 +77,22 @@ void close_SDL(struct sdl_system* system) {
 int load_media(struct sdl_data* data) {
     int return_code = 0;
     SDL_RWops* image_RWops = NULL;
+    struct asset asset;
 
     ASSERT(data != NULL, return -1;, "Argument data must not be NULL");
     ASSERT(data->image_hello_world == NULL, return -1;
            , "Argument data->image_hello_world must be NULL before load_media");
 
+    TRACE("Opening asset pack");
+    return_code =
+        load_asset_pack(&(data->pack), _embed_02_image_on_screen_pack_start, _embed_02_image_on_screen_pack_size);
+    ASSERT(return_code == 0, return -1;, "load_asset_pack error");
+
     TRACE("Opening stream to embedded hello_world.bmp");
-    image_RWops = SDL_RWFromConstMem(_embed_hello_world_bmp_start, (int)_embed_hello_world_bmp_size);
-    ASSERT(image_RWops != NULL, return -1;, "SDL_RWFromConstMem error=[%s]", SDL_GetError());
+    return_code = find_asset(&(data->pack), "hello_world.bmp", &asset);
+    ASSERT(return_code == 0, return -1;, "find_asset error");
+    image_RWops = open_embedded_rwops(asset.data, asset.size);
+    ASSERT(image_RWops != NULL, return -1;, "open_embedded_rwops error");
 
     TRACE("Loading surface image_hello_world");
     data->image_hello_world = SDL_LoadBMP_RW(image_RWops, 0);
@@ -104,6 +117,9 @@ void free_media(struct sdl_data* data) {
         data->image_hello_world = NULL;
     }
 
+    TRACE("Closing asset pack");
+    close_asset_pack(&(data->pack));
+
     return;
 }
 
@@ -113,15 +129,23 @@ int main(int argc, char** argv) {
     struct sdl_data data = {0};
     SDL_Event event_buffer;
     bool quit = false;
+    struct frame_loop loop;
 
     TRACE("start");
 
     // Command line
     TRACE("argc=[%d]", argc);
     for (int i = 0; i < argc; i++) {
-        TRACE("argv[%d]=[%s]", i, argv[i]);
+        TRACE_DEBUG("argv[%d]=[%s]", i, argv[i]);
     }
 
+    // Benchmark mode, see bench.h
+    return_code = parse_bench_arguments(argc, argv);
+    ASSERT(return_code == 0, return -1;, "parse_bench_arguments error");
+
+    return_code = set_bench_hints();
+    ASSERT(return_code == 0, return -1;, "set_bench_hints error");
+
     TRACE("Initializing");
     return_code = init_SDL(&system);
     ASSERT(return_code == 0, close_SDL(&system); return -1;, "init_SDL error");
@@ -135,8 +159,17 @@ int main(int argc, char** argv) {
     ASSERT(return_code == 0, free_media(&data); close_SDL(&system); return -1;
            , "SDL_BlitSurface error=[%s]", SDL_GetError());
 
+    return_code = start_bench();
+    ASSERT(return_code == 0, free_media(&data); close_SDL(&system); return -1;, "start_bench error");
+
+    return_code = start_frame_loop(&loop, 60);
+    ASSERT(return_code == 0, free_media(&data); close_SDL(&system); return -1;, "start_frame_loop error");
+
     TRACE("Main loop start");
     while (quit == false) {
+        return_code = begin_loop_frame(&loop);
+        ASSERT(return_code == 0, free_media(&data); close_SDL(&system); return -1;, "begin_loop_frame error");
+
         // Update the surface
         return_code = SDL_UpdateWindowSurface(system.window);
         ASSERT(return_code == 0, free_media(&data); close_SDL(&system); return -1;
@@ -151,9 +184,15 @@ int main(int argc, char** argv) {
             }
         } while (return_code == 1);
 
-        // sleep
-        nanosleep(&(struct timespec){.tv_sec = 0, .tv_nsec = (1000000000 / 60)}, NULL);
+        // Benchmark frame time, quits after the requested number of frames
+        return_code = record_bench_frame(&quit);
+        ASSERT(return_code == 0, free_media(&data); close_SDL(&system); return -1;, "record_bench_frame error");
+
+        // Wait for the next frame deadline, skipped in benchmark mode
+        return_code = end_loop_frame(&loop);
+        ASSERT(return_code == 0, free_media(&data); close_SDL(&system); return -1;, "end_loop_frame error");
     }
+    trace_frame_pacer(&loop.pacer);
 
     TRACE("Freeing media");
     free_media(&data);
@@ -161,6 +200,9 @@ int main(int argc, char** argv) {
     TRACE("Closing");
     close_SDL(&system);
 
+    return_code = write_bench_report();
+    ASSERT(return_code == 0, NO_ACTION, "write_bench_report error");
+
     TRACE("end");
     return 0;
 }
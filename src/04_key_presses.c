@@ -4,15 +4,17 @@
 #include <limits.h>
 #include <stdbool.h>
 #include <stdio.h>
+#include <stdlib.h>
 #include <string.h>
 #include <time.h>
 
+#include "asset_pack.h"
 #include "assert.h"
-#include "embed/press_default.bmp.h"
-#include "embed/press_down.bmp.h"
-#include "embed/press_left.bmp.h"
-#include "embed/press_right.bmp.h"
-#include "embed/press_up.bmp.h"
+#include "bench.h"
+#include "embed/key_presses.atlas.h"
+#include "embed/04_key_presses.pack.h"
+#include "embed_rwops.h"
+#include "frame_loop.h"
 #include "trace.h"
 
 enum key_press_surfaces {
@@ -29,8 +31,11 @@ struct sdl_system {
     SDL_Surface* screen_surface;
 };
 
+// All key press images live in one atlas surface, see atlas_pack.c
 struct sdl_data {
-    SDL_Surface* key_press_surface[KEY_PRESS_TOTAL];
+    struct asset_pack pack;
+    SDL_Surface* key_presses;
+    SDL_Rect key_press_clip[KEY_PRESS_TOTAL];
 };
 
 int init_SDL(struct sdl_system* system);
@@ -97,8 +102,8 @@ SDL_Surface* load_bmp_embedded(const void* bmp_data, const size_t size) {
     ASSERT(size <= INT_MAX, return NULL;, "Argument size must not exceed maximum allowed");
 
     TRACE("Opening stream to embedded");
-    rwops = SDL_RWFromConstMem(bmp_data, (int)size);
-    ASSERT(rwops != NULL, return NULL;, "SDL_RWFromConstMem error=[%s]", SDL_GetError());
+    rwops = open_embedded_rwops(bmp_data, size);
+    ASSERT(rwops != NULL, return NULL;, "open_embedded_rwops error");
 
     TRACE("Loading surface");
     return_surface = SDL_LoadBMP_RW(rwops, 1);
@@ -109,79 +114,85 @@ SDL_Surface* load_bmp_embedded(const void* bmp_data, const size_t size) {
 }
 
 int load_media(struct sdl_data* data) {
+    struct asset asset;
+    int return_code = 0;
+
     ASSERT(data != NULL, return -1;, "Argument data must not be NULL");
 
-    TRACE("Loading surface press_default");
-    ASSERT(data->key_press_surface[KEY_PRESS_DEFAULT] == NULL, return -1;
-           , "Surface must be NULL before calling load_media");
-    data->key_press_surface[KEY_PRESS_DEFAULT] =
-        load_bmp_embedded(_embed_press_default_bmp_start, _embed_press_default_bmp_size);
-    ASSERT(data->key_press_surface[KEY_PRESS_DEFAULT] != NULL, return -1;, "load_bmp_embedded error");
-
-    TRACE("Loading surface press_up");
-    ASSERT(data->key_press_surface[KEY_PRESS_UP] == NULL, return -1;, "Surface must be NULL before calling load_media");
-    data->key_press_surface[KEY_PRESS_UP] = load_bmp_embedded(_embed_press_up_bmp_start, _embed_press_up_bmp_size);
-    ASSERT(data->key_press_surface[KEY_PRESS_UP] != NULL, return -1;, "load_bmp_embedded error");
-
-    TRACE("Loading surface press_down");
-    ASSERT(data->key_press_surface[KEY_PRESS_DOWN] == NULL, return -1;
-           , "Surface must be NULL before calling load_media");
-    data->key_press_surface[KEY_PRESS_DOWN] =
-        load_bmp_embedded(_embed_press_down_bmp_start, _embed_press_down_bmp_size);
-    ASSERT(data->key_press_surface[KEY_PRESS_DOWN] != NULL, return -1;, "load_bmp_embedded error");
-
-    TRACE("Loading surface press_left");
-    ASSERT(data->key_press_surface[KEY_PRESS_LEFT] == NULL, return -1;
-           , "Surface must be NULL before calling load_media");
-    data->key_press_surface[KEY_PRESS_LEFT] =
-        load_bmp_embedded(_embed_press_left_bmp_start, _embed_press_left_bmp_size);
-    ASSERT(data->key_press_surface[KEY_PRESS_LEFT] != NULL, return -1;, "load_bmp_embedded error");
-
-    TRACE("Loading surface press_right");
-    ASSERT(data->key_press_surface[KEY_PRESS_RIGHT] == NULL, return -1;
-           , "Surface must be NULL before calling load_media");
-    data->key_press_surface[KEY_PRESS_RIGHT] =
-        load_bmp_embedded(_embed_press_right_bmp_start, _embed_press_right_bmp_size);
-    ASSERT(data->key_press_surface[KEY_PRESS_RIGHT] != NULL, return -1;, "load_bmp_embedded error");
+    TRACE("Opening asset pack");
+    return_code = load_asset_pack(&(data->pack), _embed_04_key_presses_pack_start, _embed_04_key_presses_pack_size);
+    ASSERT(return_code == 0, return -1;, "load_asset_pack error");
+
+    TRACE("Loading surface key_presses");
+    ASSERT(data->key_presses == NULL, return -1;, "Surface must be NULL before calling load_media");
+    return_code = find_asset(&(data->pack), "key_presses.bmp", &asset);
+    ASSERT(return_code == 0, return -1;, "find_asset error");
+    data->key_presses = load_bmp_embedded(asset.data, asset.size);
+    ASSERT(data->key_presses != NULL, return -1;, "load_bmp_embedded error");
+    ASSERT(data->key_presses->w == ATLAS_KEY_PRESSES_WIDTH && data->key_presses->h == ATLAS_KEY_PRESSES_HEIGHT,
+           return -1;, "Atlas size mismatch width=[%d] height=[%d]", data->key_presses->w, data->key_presses->h);
+
+    data->key_press_clip[KEY_PRESS_DEFAULT] = ATLAS_KEY_PRESSES_PRESS_DEFAULT;
+    data->key_press_clip[KEY_PRESS_UP] = ATLAS_KEY_PRESSES_PRESS_UP;
+    data->key_press_clip[KEY_PRESS_DOWN] = ATLAS_KEY_PRESSES_PRESS_DOWN;
+    data->key_press_clip[KEY_PRESS_LEFT] = ATLAS_KEY_PRESSES_PRESS_LEFT;
+    data->key_press_clip[KEY_PRESS_RIGHT] = ATLAS_KEY_PRESSES_PRESS_RIGHT;
 
     return 0;
 }
 
 void free_media(struct sdl_data* data) {
-    int counter = 0;
     ASSERT(data != NULL, return;, "Argument data must not be NULL");
 
-    for (counter = 0; counter < KEY_PRESS_TOTAL; counter++) {
-        if (data->key_press_surface[counter] != NULL) {
-            TRACE("Freeing surface %d", counter);
-            SDL_FreeSurface(data->key_press_surface[counter]);
-            data->key_press_surface[counter] = NULL;
-        }
+    if (data->key_presses != NULL) {
+        TRACE("Freeing surface key_presses");
+        SDL_FreeSurface(data->key_presses);
+        data->key_presses = NULL;
     }
 
+    TRACE("Closing asset pack");
+    close_asset_pack(&(data->pack));
+
     return;
 }
 
 int main_loop(struct sdl_system system, struct sdl_data data) {
+    TRACE_SPAN("main_loop");
+    struct trace_span present_span;
     int return_code = 0;
     SDL_Event event_buffer;
     bool quit = false;
+    struct frame_loop loop;
     int last_surface = KEY_PRESS_TOTAL;
     int current_surface = KEY_PRESS_DEFAULT;
 
+    return_code = start_bench();
+    ASSERT(return_code == 0, return -1;, "start_bench error");
+
+    return_code = start_frame_loop(&loop, 60);
+    ASSERT(return_code == 0, return -1;, "start_frame_loop error");
+
     TRACE("Main loop start");
     while (quit == false) {
+        TRACE_SPAN("frame");
+
+        return_code = begin_loop_frame(&loop);
+        ASSERT(return_code == 0, return -1;, "begin_loop_frame error");
+
         // Update current image shown on screen
         if (current_surface != last_surface) {
-            TRACE("Blitting surface %d to window", current_surface);
-            ASSERT(data.key_press_surface[current_surface] != NULL, return -1;, "Surface missing");
-            return_code = SDL_BlitSurface(data.key_press_surface[current_surface], NULL, system.screen_surface, NULL);
+            TRACE_DEBUG("Blitting clip %d to window", current_surface);
+            ASSERT(data.key_presses != NULL, return -1;, "Surface missing");
+            return_code =
+                SDL_BlitSurface(data.key_presses, &data.key_press_clip[current_surface], system.screen_surface, NULL);
             ASSERT(return_code == 0, return -1;, "SDL_BlitSurface error=[%s]", SDL_GetError());
             last_surface = current_surface;
         }
 
         // Update the window surface
+        TRACE_SPAN_BEGIN(present_span, "SDL_UpdateWindowSurface");
         return_code = SDL_UpdateWindowSurface(system.window);
+        TRACE_SPAN_END(present_span);
         ASSERT(return_code == 0, return -1;, "SDL_UpdateWindowSurface error=[%s]", SDL_GetError());
 
         // Poll for currently pending events
@@ -235,14 +246,21 @@ int main_loop(struct sdl_system system, struct sdl_data data) {
             }
         } while (return_code == 1);
 
-        // sleep
-        nanosleep(&(struct timespec){.tv_sec = 0, .tv_nsec = (1000000000 / 60)}, NULL);
+        // Benchmark frame time, quits after the requested number of frames
+        return_code = record_bench_frame(&quit);
+        ASSERT(return_code == 0, return -1;, "record_bench_frame error");
+
+        // Wait for the next frame deadline, skipped in benchmark mode
+        return_code = end_loop_frame(&loop);
+        ASSERT(return_code == 0, return -1;, "end_loop_frame error");
     }
+    trace_frame_pacer(&loop.pacer);
     return 0;
 }
 
 int main(int argc, char** argv) {
     int return_code = 0;
+    const char* spans_path = NULL;
     struct sdl_system system = {0};
     struct sdl_data data = {0};
 
@@ -251,7 +269,21 @@ int main(int argc, char** argv) {
     // Command line
     TRACE("argc=[%d]", argc);
     for (int i = 0; i < argc; i++) {
-        TRACE("argv[%d]=[%s]", i, argv[i]);
+        TRACE_DEBUG("argv[%d]=[%s]", i, argv[i]);
+    }
+
+    // Benchmark mode, see bench.h
+    return_code = parse_bench_arguments(argc, argv);
+    ASSERT(return_code == 0, return -1;, "parse_bench_arguments error");
+
+    return_code = set_bench_hints();
+    ASSERT(return_code == 0, return -1;, "set_bench_hints error");
+
+    // Timeline spans, saved as Chrome trace-event JSON when TRACE_SPANS names an output file
+    spans_path = getenv("TRACE_SPANS");
+    if (spans_path != NULL) {
+        return_code = start_trace_spans();
+        ASSERT(return_code == 0, return -1;, "start_trace_spans error");
     }
 
     TRACE("Initializing");
@@ -271,6 +303,16 @@ int main(int argc, char** argv) {
     TRACE("Closing");
     close_SDL(&system);
 
+    return_code = write_bench_report();
+    ASSERT(return_code == 0, NO_ACTION, "write_bench_report error");
+
+    if (spans_path != NULL) {
+        TRACE("Writing spans to \"%s\"", spans_path);
+        stop_trace_spans();
+        return_code = write_trace_spans(spans_path);
+        ASSERT(return_code == 0, NO_ACTION, "write_trace_spans error");
+    }
+
     TRACE("end");
     return 0;
 }
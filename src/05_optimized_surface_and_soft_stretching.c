@@ -1,16 +1,19 @@
 #define _DEFAULT_SOURCE
 
 #include <SDL2/SDL.h>
-#include <errno.h>
 #include <limits.h>
 #include <math.h>
 #include <stdbool.h>
 #include <stdio.h>
+#include <stdlib.h>
 #include <string.h>
-#include <time.h>
 
+#include "asset_pack.h"
 #include "assert.h"
-#include "embed/stretching_to_window.bmp.h"
+#include "bench.h"
+#include "embed/05_optimized_surface_and_soft_stretching.pack.h"
+#include "embed_rwops.h"
+#include "frame_loop.h"
 #include "trace.h"
 
 struct sdl_system {
@@ -19,6 +22,7 @@ struct sdl_system {
 };
 
 struct sdl_data {
+    struct asset_pack pack;
     SDL_Surface* stretch_surface;
 };
 
@@ -89,8 +93,8 @@ SDL_Surface* load_bmp_embedded(const void* bmp_data, const size_t size, SDL_Surf
     ASSERT(screen_surface != NULL, return NULL;, "Argument screen_surface must not be NULL");
 
     TRACE("Opening stream to embedded");
-    rwops = SDL_RWFromConstMem(bmp_data, (int)size);
-    ASSERT(rwops != NULL, return NULL;, "SDL_RWFromConstMem error=[%s]", SDL_GetError());
+    rwops = open_embedded_rwops(bmp_data, size);
+    ASSERT(rwops != NULL, return NULL;, "open_embedded_rwops error");
 
     TRACE("Loading surface");
     surface = SDL_LoadBMP_RW(rwops, 1);
@@ -108,13 +112,22 @@ SDL_Surface* load_bmp_embedded(const void* bmp_data, const size_t size, SDL_Surf
 }
 
 int load_media(struct sdl_data* data, SDL_Surface* screen_surface) {
+    struct asset asset;
+    int return_code = 0;
+
     ASSERT(data != NULL, return -1;, "Argument data must not be NULL");
     ASSERT(screen_surface != NULL, return -1;, "Argument screen_surface must not be NULL");
 
+    TRACE("Opening asset pack");
+    return_code = load_asset_pack(&(data->pack), _embed_05_optimized_surface_and_soft_stretching_pack_start,
+                                  _embed_05_optimized_surface_and_soft_stretching_pack_size);
+    ASSERT(return_code == 0, return -1;, "load_asset_pack error");
+
     TRACE("Loading surface stretch_surface");
     ASSERT(data->stretch_surface == NULL, return -1;, "Surface must be NULL before calling load_media");
-    data->stretch_surface =
-        load_bmp_embedded(_embed_stretching_to_window_bmp_start, _embed_stretching_to_window_bmp_size, screen_surface);
+    return_code = find_asset(&(data->pack), "stretching_to_window.bmp", &asset);
+    ASSERT(return_code == 0, return -1;, "find_asset error");
+    data->stretch_surface = load_bmp_embedded(asset.data, asset.size, screen_surface);
     ASSERT(data->stretch_surface != NULL, return -1;, "load_bmp_embedded error");
 
     return 0;
@@ -129,61 +142,74 @@ void free_media(struct sdl_data* data) {
         data->stretch_surface = NULL;
     }
 
+    TRACE("Closing asset pack");
+    close_asset_pack(&(data->pack));
+
     return;
 }
 
 int main_loop(const struct sdl_system system, const struct sdl_data data) {
+    TRACE_SPAN("main_loop");
+    struct trace_span present_span;
     int return_code = 0;
-    int error_num = 0;
     SDL_Event event_buffer;
     bool quit = false;
+    struct frame_loop loop;
+    SDL_Rect previous_rect = {256, 192, 128, 96};
+    SDL_Rect current_rect = {256, 192, 128, 96};
     SDL_Rect stretch_rect = {0, 0, 640, 480};
-    struct timespec start_time, current_time;
 
-    return_code = clock_gettime(CLOCK_MONOTONIC, &start_time);
-    error_num = errno;
-    ASSERT(return_code == 0, return -1;, "clock_gettime error=[%s]", strerror(error_num));
+    return_code = start_bench();
+    ASSERT(return_code == 0, return -1;, "start_bench error");
+
+    return_code = start_frame_loop(&loop, 60);
+    ASSERT(return_code == 0, return -1;, "start_frame_loop error");
 
     TRACE("Main loop start");
     while (quit == false) {
+        TRACE_SPAN("frame");
         double seconds = 0;
-
-        // Calculate rect size based on time
-        return_code = clock_gettime(CLOCK_MONOTONIC, &current_time);
-        error_num = errno;
-        ASSERT(return_code == 0, return -1;, "clock_gettime error=[%s]", strerror(error_num));
-
-        seconds = (double)(current_time.tv_sec - start_time.tv_sec) +
-                  ((double)(current_time.tv_nsec - start_time.tv_nsec) / 1000000000.0);
-        if (seconds < 1.0) {
-            stretch_rect.x = 256;
-            stretch_rect.y = 192;
-            stretch_rect.w = 128;
-            stretch_rect.h = 96;
-        } else if (seconds < 6.0) {
-            seconds = seconds - 1.0;
-            stretch_rect.x = (int)lround(0.0 * (seconds / 5.0) + 256.0 * (1.0 - (seconds / 5.0)));
-            stretch_rect.y = (int)lround(0.0 * (seconds / 5.0) + 192.0 * (1.0 - (seconds / 5.0)));
-            stretch_rect.w = (int)lround(640.0 * (seconds / 5.0) + 128.0 * (1.0 - (seconds / 5.0)));
-            stretch_rect.h = (int)lround(480.0 * (seconds / 5.0) + 96.0 * (1.0 - (seconds / 5.0)));
-        } else if (seconds < 7.0) {
-            stretch_rect.x = 0;
-            stretch_rect.y = 0;
-            stretch_rect.w = 640;
-            stretch_rect.h = 480;
-        } else if (seconds < 12.0) {
-            seconds = seconds - 7.0;
-            stretch_rect.x = (int)lround(256.0 * (seconds / 5.0) + 0.0 * (1.0 - (seconds / 5.0)));
-            stretch_rect.y = (int)lround(192.0 * (seconds / 5.0) + 0.0 * (1.0 - (seconds / 5.0)));
-            stretch_rect.w = (int)lround(128.0 * (seconds / 5.0) + 640.0 * (1.0 - (seconds / 5.0)));
-            stretch_rect.h = (int)lround(96.0 * (seconds / 5.0) + 480.0 * (1.0 - (seconds / 5.0)));
-        } else {
-            return_code = clock_gettime(CLOCK_MONOTONIC, &start_time);
-            error_num = errno;
-            ASSERT(return_code == 0, return -1;, "clock_gettime error=[%s]", strerror(error_num));
-            continue;
+        double alpha = 0;
+
+        return_code = begin_loop_frame(&loop);
+        ASSERT(return_code == 0, return -1;, "begin_loop_frame error");
+
+        // Each update moves the rect one step along its animation, keeping the previous rect to blend from
+        while (next_loop_update(&loop) == true) {
+            previous_rect = current_rect;
+            seconds = (double)(loop.time_ns % 12000000000LL) / 1000000000.0;
+            if (seconds < 1.0) {
+                current_rect.x = 256;
+                current_rect.y = 192;
+                current_rect.w = 128;
+                current_rect.h = 96;
+            } else if (seconds < 6.0) {
+                seconds = seconds - 1.0;
+                current_rect.x = (int)lround(0.0 * (seconds / 5.0) + 256.0 * (1.0 - (seconds / 5.0)));
+                current_rect.y = (int)lround(0.0 * (seconds / 5.0) + 192.0 * (1.0 - (seconds / 5.0)));
+                current_rect.w = (int)lround(640.0 * (seconds / 5.0) + 128.0 * (1.0 - (seconds / 5.0)));
+                current_rect.h = (int)lround(480.0 * (seconds / 5.0) + 96.0 * (1.0 - (seconds / 5.0)));
+            } else if (seconds < 7.0) {
+                current_rect.x = 0;
+                current_rect.y = 0;
+                current_rect.w = 640;
+                current_rect.h = 480;
+            } else {
+                seconds = seconds - 7.0;
+                current_rect.x = (int)lround(256.0 * (seconds / 5.0) + 0.0 * (1.0 - (seconds / 5.0)));
+                current_rect.y = (int)lround(192.0 * (seconds / 5.0) + 0.0 * (1.0 - (seconds / 5.0)));
+                current_rect.w = (int)lround(128.0 * (seconds / 5.0) + 640.0 * (1.0 - (seconds / 5.0)));
+                current_rect.h = (int)lround(96.0 * (seconds / 5.0) + 480.0 * (1.0 - (seconds / 5.0)));
+            }
         }
 
+        // Draw between the last two updates
+        alpha = get_loop_alpha(&loop);
+        stretch_rect.x = (int)lround(previous_rect.x + alpha * (current_rect.x - previous_rect.x));
+        stretch_rect.y = (int)lround(previous_rect.y + alpha * (current_rect.y - previous_rect.y));
+        stretch_rect.w = (int)lround(previous_rect.w + alpha * (current_rect.w - previous_rect.w));
+        stretch_rect.h = (int)lround(previous_rect.h + alpha * (current_rect.h - previous_rect.h));
+
         // Fill the surface with color
         return_code =
             SDL_FillRect(system.screen_surface, NULL, SDL_MapRGB(system.screen_surface->format, 0x00, 0x80, 0x80));
@@ -194,7 +220,9 @@ int main_loop(const struct sdl_system system, const struct sdl_data data) {
         ASSERT(return_code == 0, return -1;, "SDL_BlitScaled error=[%s]", SDL_GetError());
 
         // Update the window surface
+        TRACE_SPAN_BEGIN(present_span, "SDL_UpdateWindowSurface");
         return_code = SDL_UpdateWindowSurface(system.window);
+        TRACE_SPAN_END(present_span);
         ASSERT(return_code == 0, return -1;, "SDL_UpdateWindowSurface error=[%s]", SDL_GetError());
 
         // Poll for currently pending events
@@ -215,14 +243,21 @@ int main_loop(const struct sdl_system system, const struct sdl_data data) {
             }
         } while (return_code == 1);
 
-        // sleep
-        nanosleep(&(struct timespec){.tv_sec = 0, .tv_nsec = (1000000000 / 60)}, NULL);
+        // Benchmark frame time, quits after the requested number of frames
+        return_code = record_bench_frame(&quit);
+        ASSERT(return_code == 0, return -1;, "record_bench_frame error");
+
+        // Wait for the next frame deadline, skipped in benchmark mode
+        return_code = end_loop_frame(&loop);
+        ASSERT(return_code == 0, return -1;, "end_loop_frame error");
     }
+    trace_frame_pacer(&loop.pacer);
     return 0;
 }
 
 int main(int argc, char** argv) {
     int return_code = 0;
+    const char* spans_path = NULL;
     struct sdl_system system = {0};
     struct sdl_data data = {0};
 
@@ -231,7 +266,21 @@ int main(int argc, char** argv) {
     // Command line
     TRACE("argc=[%d]", argc);
     for (int i = 0; i < argc; i++) {
-        TRACE("argv[%d]=[%s]", i, argv[i]);
+        TRACE_DEBUG("argv[%d]=[%s]", i, argv[i]);
+    }
+
+    // Benchmark mode, see bench.h
+    return_code = parse_bench_arguments(argc, argv);
+    ASSERT(return_code == 0, return -1;, "parse_bench_arguments error");
+
+    return_code = set_bench_hints();
+    ASSERT(return_code == 0, return -1;, "set_bench_hints error");
+
+    // Timeline spans, saved as Chrome trace-event JSON when TRACE_SPANS names an output file
+    spans_path = getenv("TRACE_SPANS");
+    if (spans_path != NULL) {
+        return_code = start_trace_spans();
+        ASSERT(return_code == 0, return -1;, "start_trace_spans error");
     }
 
     TRACE("Initializing");
@@ -251,6 +300,16 @@ int main(int argc, char** argv) {
     TRACE("Closing");
     close_SDL(&system);
 
+    return_code = write_bench_report();
+    ASSERT(return_code == 0, NO_ACTION, "write_bench_report error");
+
+    if (spans_path != NULL) {
+        TRACE("Writing spans to \"%s\"", spans_path);
+        stop_trace_spans();
+        return_code = write_trace_spans(spans_path);
+        ASSERT(return_code == 0, NO_ACTION, "write_trace_spans error");
+    }
+
     TRACE("end");
     return 0;
 }
@@ -2,14 +2,17 @@
 
 #include <SDL2/SDL.h>
 #include <SDL2/SDL_image.h>
-#include <errno.h>
 #include <limits.h>
 #include <math.h>
 #include <stdbool.h>
-#include <time.h>
+#include <stdlib.h>
 
+#include "asset_pack.h"
 #include "assert.h"
-#include "embed/png_loaded.png.h"
+#include "bench.h"
+#include "embed/06_extension_libraries.pack.h"
+#include "embed_rwops.h"
+#include "frame_loop.h"
 #include "trace.h"
 
 struct sdl_system {
@@ -18,6 +21,7 @@ struct sdl_system {
 };
 
 struct sdl_data {
+    struct asset_pack pack;
     SDL_Surface* png_image;
 };
 
@@ -97,8 +101,8 @@ SDL_Surface* load_img_embedded(const void* img_data, const size_t size) {
     ASSERT(size <= INT_MAX, return NULL;, "Argument size must not exceed maximum allowed");
 
     TRACE("Opening stream to embedded");
-    rwops = SDL_RWFromConstMem(img_data, (int)size);
-    ASSERT(rwops != NULL, return NULL;, "SDL_RWFromConstMem error=[%s]", SDL_GetError());
+    rwops = open_embedded_rwops(img_data, size);
+    ASSERT(rwops != NULL, return NULL;, "open_embedded_rwops error");
 
     TRACE("Loading surface");
     surface = IMG_Load_RW(rwops, 1);
@@ -122,11 +126,21 @@ SDL_Surface* load_img_embedded(const void* img_data, const size_t size) {
 }
 
 int load_media(struct sdl_data* data) {
+    struct asset asset;
+    int return_code = 0;
+
     ASSERT(data != NULL, return -1;, "Argument data must not be NULL");
 
+    TRACE("Opening asset pack");
+    return_code = load_asset_pack(&(data->pack), _embed_06_extension_libraries_pack_start,
+                                  _embed_06_extension_libraries_pack_size);
+    ASSERT(return_code == 0, return -1;, "load_asset_pack error");
+
     TRACE("Loading surface png_image");
     ASSERT(data->png_image == NULL, return -1;, "Surface must be NULL before calling load_media");
-    data->png_image = load_img_embedded(_embed_png_loaded_png_start, _embed_png_loaded_png_size);
+    return_code = find_asset(&(data->pack), "png_loaded.png", &asset);
+    ASSERT(return_code == 0, return -1;, "find_asset error");
+    data->png_image = load_img_embedded(asset.data, asset.size);
     ASSERT(data->png_image != NULL, return -1;, "load_img_embedded error");
 
     return 0;
@@ -141,51 +155,64 @@ void free_media(struct sdl_data* data) {
         data->png_image = NULL;
     }
 
+    TRACE("Closing asset pack");
+    close_asset_pack(&(data->pack));
+
     return;
 }
 
 int main_loop(const struct sdl_system system, const struct sdl_data data) {
+    TRACE_SPAN("main_loop");
+    struct trace_span present_span;
     int return_code = 0;
-    int error_num = 0;
     SDL_Event event_buffer;
     bool quit = false;
+    struct frame_loop loop;
+    SDL_Rect previous_rect = {80, 60, 480, 360};
+    SDL_Rect current_rect = {80, 60, 480, 360};
     SDL_Rect stretch_rect = {0, 0, 640, 480};
-    struct timespec start_time, current_time;
 
-    return_code = clock_gettime(CLOCK_MONOTONIC, &start_time);
-    error_num = errno;
-    ASSERT(return_code == 0, return -1;, "clock_gettime error=[%s]", strerror(error_num));
+    return_code = start_bench();
+    ASSERT(return_code == 0, return -1;, "start_bench error");
+
+    return_code = start_frame_loop(&loop, 60);
+    ASSERT(return_code == 0, return -1;, "start_frame_loop error");
 
     TRACE("Main loop start");
     while (quit == false) {
+        TRACE_SPAN("frame");
         double seconds = 0;
-
-        // Calculate rect size based on time
-        return_code = clock_gettime(CLOCK_MONOTONIC, &current_time);
-        error_num = errno;
-        ASSERT(return_code == 0, return -1;, "clock_gettime error=[%s]", strerror(error_num));
-
-        seconds = (double)(current_time.tv_sec - start_time.tv_sec) +
-                  ((double)(current_time.tv_nsec - start_time.tv_nsec) / 1000000000.0);
-        if (seconds < 0.5) {
-            double t = (seconds / 0.5);
-            stretch_rect.x = (int)lround(0.0 * t + 80.0 * (1.0 - t));
-            stretch_rect.y = (int)lround(0.0 * t + 60.0 * (1.0 - t));
-            stretch_rect.w = (int)lround(640.0 * t + 480.0 * (1.0 - t));
-            stretch_rect.h = (int)lround(480.0 * t + 360.0 * (1.0 - t));
-        } else if (seconds < 1.0) {
-            double t = ((seconds - 0.5) / 0.5);
-            stretch_rect.x = (int)lround(80.0 * t + 0.0 * (1.0 - t));
-            stretch_rect.y = (int)lround(60.0 * t + 0.0 * (1.0 - t));
-            stretch_rect.w = (int)lround(480.0 * t + 640.0 * (1.0 - t));
-            stretch_rect.h = (int)lround(360.0 * t + 480.0 * (1.0 - t));
-        } else {
-            return_code = clock_gettime(CLOCK_MONOTONIC, &start_time);
-            error_num = errno;
-            ASSERT(return_code == 0, return -1;, "clock_gettime error=[%s]", strerror(error_num));
-            continue;
+        double alpha = 0;
+
+        return_code = begin_loop_frame(&loop);
+        ASSERT(return_code == 0, return -1;, "begin_loop_frame error");
+
+        // Each update moves the rect one step along its animation, keeping the previous rect to blend from
+        while (next_loop_update(&loop) == true) {
+            previous_rect = current_rect;
+            seconds = (double)(loop.time_ns % 1000000000LL) / 1000000000.0;
+            if (seconds < 0.5) {
+                double t = (seconds / 0.5);
+                current_rect.x = (int)lround(0.0 * t + 80.0 * (1.0 - t));
+                current_rect.y = (int)lround(0.0 * t + 60.0 * (1.0 - t));
+                current_rect.w = (int)lround(640.0 * t + 480.0 * (1.0 - t));
+                current_rect.h = (int)lround(480.0 * t + 360.0 * (1.0 - t));
+            } else {
+                double t = ((seconds - 0.5) / 0.5);
+                current_rect.x = (int)lround(80.0 * t + 0.0 * (1.0 - t));
+                current_rect.y = (int)lround(60.0 * t + 0.0 * (1.0 - t));
+                current_rect.w = (int)lround(480.0 * t + 640.0 * (1.0 - t));
+                current_rect.h = (int)lround(360.0 * t + 480.0 * (1.0 - t));
+            }
         }
 
+        // Draw between the last two updates
+        alpha = get_loop_alpha(&loop);
+        stretch_rect.x = (int)lround(previous_rect.x + alpha * (current_rect.x - previous_rect.x));
+        stretch_rect.y = (int)lround(previous_rect.y + alpha * (current_rect.y - previous_rect.y));
+        stretch_rect.w = (int)lround(previous_rect.w + alpha * (current_rect.w - previous_rect.w));
+        stretch_rect.h = (int)lround(previous_rect.h + alpha * (current_rect.h - previous_rect.h));
+
         // Fill the surface with color
         return_code =
             SDL_FillRect(system.screen_surface, NULL, SDL_MapRGB(system.screen_surface->format, 0x00, 0x80, 0x80));
@@ -196,7 +223,9 @@ int main_loop(const struct sdl_system system, const struct sdl_data data) {
         ASSERT(return_code == 0, return -1;, "SDL_BlitScaled error=[%s]", SDL_GetError());
 
         // Update the window surface
+        TRACE_SPAN_BEGIN(present_span, "SDL_UpdateWindowSurface");
         return_code = SDL_UpdateWindowSurface(system.window);
+        TRACE_SPAN_END(present_span);
         ASSERT(return_code == 0, return -1;, "SDL_UpdateWindowSurface error=[%s]", SDL_GetError());
 
         // Poll for currently pending events
@@ -217,14 +246,21 @@ int main_loop(const struct sdl_system system, const struct sdl_data data) {
             }
         } while (return_code == 1);
 
-        // sleep
-        nanosleep(&(struct timespec){.tv_sec = 0, .tv_nsec = (1000000000 / 60)}, NULL);
+        // Benchmark frame time, quits after the requested number of frames
+        return_code = record_bench_frame(&quit);
+        ASSERT(return_code == 0, return -1;, "record_bench_frame error");
+
+        // Wait for the next frame deadline, skipped in benchmark mode
+        return_code = end_loop_frame(&loop);
+        ASSERT(return_code == 0, return -1;, "end_loop_frame error");
     }
+    trace_frame_pacer(&loop.pacer);
     return 0;
 }
 
 int main(int argc, char** argv) {
     int return_code = 0;
+    const char* spans_path = NULL;
     struct sdl_system system = {0};
     struct sdl_data data = {0};
 
@@ -233,7 +269,21 @@ int main(int argc, char** argv) {
     // Command line
     TRACE("argc=[%d]", argc);
     for (int i = 0; i < argc; i++) {
-        TRACE("argv[%d]=[%s]", i, argv[i]);
+        TRACE_DEBUG("argv[%d]=[%s]", i, argv[i]);
+    }
+
+    // Benchmark mode, see bench.h
+    return_code = parse_bench_arguments(argc, argv);
+    ASSERT(return_code == 0, return -1;, "parse_bench_arguments error");
+
+    return_code = set_bench_hints();
+    ASSERT(return_code == 0, return -1;, "set_bench_hints error");
+
+    // Timeline spans, saved as Chrome trace-event JSON when TRACE_SPANS names an output file
+    spans_path = getenv("TRACE_SPANS");
+    if (spans_path != NULL) {
+        return_code = start_trace_spans();
+        ASSERT(return_code == 0, return -1;, "start_trace_spans error");
     }
 
     TRACE("Initializing");
@@ -253,6 +303,16 @@ int main(int argc, char** argv) {
     TRACE("Closing");
     close_SDL(&system);
 
+    return_code = write_bench_report();
+    ASSERT(return_code == 0, NO_ACTION, "write_bench_report error");
+
+    if (spans_path != NULL) {
+        TRACE("Writing spans to \"%s\"", spans_path);
+        stop_trace_spans();
+        return_code = write_trace_spans(spans_path);
+        ASSERT(return_code == 0, NO_ACTION, "write_trace_spans error");
+    }
+
     TRACE("end");
     return 0;
 }
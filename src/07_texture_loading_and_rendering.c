@@ -2,16 +2,19 @@
 
 #include <SDL2/SDL.h>
 #include <SDL2/SDL_image.h>
-#include <errno.h>
 #include <limits.h>
 #include <math.h>
 #include <stdbool.h>
 #include <stdio.h>
+#include <stdlib.h>
 #include <string.h>
-#include <time.h>
 
+#include "asset_pack.h"
 #include "assert.h"
-#include "embed/rendering_texture.png.h"
+#include "bench.h"
+#include "embed/07_texture_loading_and_rendering.pack.h"
+#include "embed_rwops.h"
+#include "frame_loop.h"
 #include "trace.h"
 
 struct sdl_system {
@@ -20,6 +23,7 @@ struct sdl_system {
 };
 
 struct sdl_data {
+    struct asset_pack pack;
     SDL_Texture* display_texture;
 };
 
@@ -99,8 +103,8 @@ SDL_Texture* load_texture_embedded(const void* img_data, const size_t size, SDL_
     ASSERT(renderer != NULL, return NULL;, "Argument renderer must not be NULL");
 
     TRACE("Opening stream to embedded image data");
-    rwops = SDL_RWFromConstMem(img_data, (int)size);
-    ASSERT(rwops != NULL, return NULL;, "SDL_RWFromConstMem error=[%s]", SDL_GetError());
+    rwops = open_embedded_rwops(img_data, size);
+    ASSERT(rwops != NULL, return NULL;, "open_embedded_rwops error");
 
     TRACE("Loading surface");
     surface = IMG_Load_RW(rwops, 1);
@@ -127,13 +131,22 @@ SDL_Texture* load_texture_embedded(const void* img_data, const size_t size, SDL_
 }
 
 int load_media(struct sdl_data* data, SDL_Renderer* renderer) {
+    struct asset asset;
+    int return_code = 0;
+
     ASSERT(data != NULL, return -1;, "Argument data must not be NULL");
     ASSERT(renderer != NULL, return -1;, "Argument renderer must not be NULL");
 
+    TRACE("Opening asset pack");
+    return_code = load_asset_pack(&(data->pack), _embed_07_texture_loading_and_rendering_pack_start,
+                                  _embed_07_texture_loading_and_rendering_pack_size);
+    ASSERT(return_code == 0, return -1;, "load_asset_pack error");
+
     TRACE("Loading texture rendering_texture");
     ASSERT(data->display_texture == NULL, return -1;, "Surface must be NULL before calling load_media");
-    data->display_texture =
-        load_texture_embedded(_embed_rendering_texture_png_start, _embed_rendering_texture_png_size, renderer);
+    return_code = find_asset(&(data->pack), "rendering_texture.png", &asset);
+    ASSERT(return_code == 0, return -1;, "find_asset error");
+    data->display_texture = load_texture_embedded(asset.data, asset.size, renderer);
     ASSERT(data->display_texture != NULL, return -1;, "load_texture_embedded error");
 
     return 0;
@@ -147,59 +160,71 @@ void free_media(struct sdl_data* data) {
         SDL_DestroyTexture(data->display_texture);
         data->display_texture = NULL;
     }
+
+    TRACE("Closing asset pack");
+    close_asset_pack(&(data->pack));
     return;
 }
 
 int main_loop(struct sdl_system system, struct sdl_data data) {
+    TRACE_SPAN("main_loop");
+    struct trace_span present_span;
     int return_code = 0;
-    int error_num = 0;
     SDL_Event event_buffer;
     bool quit = false;
+    struct frame_loop loop;
+    SDL_Rect previous_rect = {80, 60, 480, 360};
+    SDL_Rect current_rect = {80, 60, 480, 360};
     SDL_Rect stretch_rect = {0, 0, 640, 480};
-    struct timespec start_time, current_time;
 
     ASSERT(system.renderer != NULL, return -1;, "Argument system.renderer must not be NULL");
     ASSERT(data.display_texture != NULL, return -1;, "Argument data.display_texture must not be NULL");
 
-    return_code = clock_gettime(CLOCK_MONOTONIC, &start_time);
-    error_num = errno;
-    ASSERT(return_code == 0, return -1;, "clock_gettime error=[%s]", strerror(error_num));
-
     // Set renderer color
     return_code = SDL_SetRenderDrawColor(system.renderer, 0x00, 0x80, 0x80, 0xFF);
     ASSERT(return_code == 0, return -1;, "SDL_SetRenderDrawColor error=[%s]", SDL_GetError());
 
+    return_code = start_bench();
+    ASSERT(return_code == 0, return -1;, "start_bench error");
+
+    return_code = start_frame_loop(&loop, 60);
+    ASSERT(return_code == 0, return -1;, "start_frame_loop error");
+
     TRACE("Main loop start");
     while (quit == false) {
+        TRACE_SPAN("frame");
         double seconds = 0;
-
-        // Calculate rect size based on time
-        return_code = clock_gettime(CLOCK_MONOTONIC, &current_time);
-        error_num = errno;
-        ASSERT(return_code == 0, return -1;, "clock_gettime error=[%s]", strerror(error_num));
-
-        seconds = (double)(current_time.tv_sec - start_time.tv_sec) +
-                  ((double)(current_time.tv_nsec - start_time.tv_nsec) / 1000000000.0);
-        if (seconds < 0.5) {
-            double t = (seconds / 0.5);
-            stretch_rect.x = (int)lround(0.0 * t + 80.0 * (1.0 - t));
-            stretch_rect.y = (int)lround(0.0 * t + 60.0 * (1.0 - t));
-            stretch_rect.w = (int)lround(640.0 * t + 480.0 * (1.0 - t));
-            stretch_rect.h = (int)lround(480.0 * t + 360.0 * (1.0 - t));
-        } else if (seconds < 1.0) {
-            double t = ((seconds - 0.5) / 0.5);
-            stretch_rect.x = (int)lround(80.0 * t + 0.0 * (1.0 - t));
-            stretch_rect.y = (int)lround(60.0 * t + 0.0 * (1.0 - t));
-            stretch_rect.w = (int)lround(480.0 * t + 640.0 * (1.0 - t));
-            stretch_rect.h = (int)lround(360.0 * t + 480.0 * (1.0 - t));
-        } else {
-            return_code = clock_gettime(CLOCK_MONOTONIC, &start_time);
-            error_num = errno;
-            ASSERT(return_code == 0, return -1;, "clock_gettime error=[%s]", strerror(error_num));
-
-            continue;
+        double alpha = 0;
+
+        return_code = begin_loop_frame(&loop);
+        ASSERT(return_code == 0, return -1;, "begin_loop_frame error");
+
+        // Each update moves the rect one step along its animation, keeping the previous rect to blend from
+        while (next_loop_update(&loop) == true) {
+            previous_rect = current_rect;
+            seconds = (double)(loop.time_ns % 1000000000LL) / 1000000000.0;
+            if (seconds < 0.5) {
+                double t = (seconds / 0.5);
+                current_rect.x = (int)lround(0.0 * t + 80.0 * (1.0 - t));
+                current_rect.y = (int)lround(0.0 * t + 60.0 * (1.0 - t));
+                current_rect.w = (int)lround(640.0 * t + 480.0 * (1.0 - t));
+                current_rect.h = (int)lround(480.0 * t + 360.0 * (1.0 - t));
+            } else {
+                double t = ((seconds - 0.5) / 0.5);
+                current_rect.x = (int)lround(80.0 * t + 0.0 * (1.0 - t));
+                current_rect.y = (int)lround(60.0 * t + 0.0 * (1.0 - t));
+                current_rect.w = (int)lround(480.0 * t + 640.0 * (1.0 - t));
+                current_rect.h = (int)lround(360.0 * t + 480.0 * (1.0 - t));
+            }
         }
 
+        // Draw between the last two updates
+        alpha = get_loop_alpha(&loop);
+        stretch_rect.x = (int)lround(previous_rect.x + alpha * (current_rect.x - previous_rect.x));
+        stretch_rect.y = (int)lround(previous_rect.y + alpha * (current_rect.y - previous_rect.y));
+        stretch_rect.w = (int)lround(previous_rect.w + alpha * (current_rect.w - previous_rect.w));
+        stretch_rect.h = (int)lround(previous_rect.h + alpha * (current_rect.h - previous_rect.h));
+
         // Clear screen
         return_code = SDL_RenderClear(system.renderer);
         ASSERT(return_code == 0, return -1;, "SDL_RenderClear error=[%s]", SDL_GetError());
@@ -209,7 +234,9 @@ int main_loop(struct sdl_system system, struct sdl_data data) {
         ASSERT(return_code == 0, return -1;, "SDL_RenderCopy error=[%s]", SDL_GetError());
 
         // Update screen
+        TRACE_SPAN_BEGIN(present_span, "SDL_RenderPresent");
         SDL_RenderPresent(system.renderer);
+        TRACE_SPAN_END(present_span);
 
         // Poll for currently pending events
         do {
@@ -231,14 +258,21 @@ int main_loop(struct sdl_system system, struct sdl_data data) {
             }
         } while (return_code == 1);
 
-        // sleep
-        nanosleep(&(struct timespec){.tv_sec = 0, .tv_nsec = (1000000000 / 60)}, NULL);
+        // Benchmark frame time, quits after the requested number of frames
+        return_code = record_bench_frame(&quit);
+        ASSERT(return_code == 0, return -1;, "record_bench_frame error");
+
+        // Wait for the next frame deadline, skipped in benchmark mode
+        return_code = end_loop_frame(&loop);
+        ASSERT(return_code == 0, return -1;, "end_loop_frame error");
     }
+    trace_frame_pacer(&loop.pacer);
     return 0;
 }
 
 int main(int argc, char** argv) {
     int return_code = 0;
+    const char* spans_path = NULL;
     struct sdl_system system = {0};
     struct sdl_data data = {0};
 
@@ -247,7 +281,21 @@ int main(int argc, char** argv) {
     // Command line
     TRACE("argc=[%d]", argc);
     for (int i = 0; i < argc; i++) {
-        TRACE("argv[%d]=[%s]", i, argv[i]);
+        TRACE_DEBUG("argv[%d]=[%s]", i, argv[i]);
+    }
+
+    // Benchmark mode, see bench.h
+    return_code = parse_bench_arguments(argc, argv);
+    ASSERT(return_code == 0, return -1;, "parse_bench_arguments error");
+
+    return_code = set_bench_hints();
+    ASSERT(return_code == 0, return -1;, "set_bench_hints error");
+
+    // Timeline spans, saved as Chrome trace-event JSON when TRACE_SPANS names an output file
+    spans_path = getenv("TRACE_SPANS");
+    if (spans_path != NULL) {
+        return_code = start_trace_spans();
+        ASSERT(return_code == 0, return -1;, "start_trace_spans error");
     }
 
     TRACE("Initializing");
@@ -267,6 +315,16 @@ int main(int argc, char** argv) {
     TRACE("Closing");
     close_SDL(&system);
 
+    return_code = write_bench_report();
+    ASSERT(return_code == 0, NO_ACTION, "write_bench_report error");
+
+    if (spans_path != NULL) {
+        TRACE("Writing spans to \"%s\"", spans_path);
+        stop_trace_spans();
+        return_code = write_trace_spans(spans_path);
+        ASSERT(return_code == 0, NO_ACTION, "write_trace_spans error");
+    }
+
     TRACE("end");
     return 0;
 }
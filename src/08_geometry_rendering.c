@@ -4,9 +4,12 @@
 #include <math.h>
 #include <stdbool.h>
 #include <stdio.h>
+#include <stdlib.h>
 #include <time.h>
 
 #include "assert.h"
+#include "bench.h"
+#include "frame_loop.h"
 #include "trace.h"
 
 #ifndef M_PI
@@ -70,9 +73,12 @@ void close_SDL(struct sdl_system* system) {
 }
 
 int main_loop(struct sdl_system system) {
+    TRACE_SPAN("main_loop");
+    struct trace_span present_span;
     int return_code = 0;
     SDL_Event event_buffer;
     bool quit = false;
+    struct frame_loop loop;
     const int SCREEN_WIDTH = 640;
     const int SCREEN_HEIGHT = 480;
     SDL_Rect fill_rect = {SCREEN_WIDTH / 4, SCREEN_HEIGHT / 4, SCREEN_WIDTH / 2, SCREEN_HEIGHT / 2};
@@ -86,8 +92,19 @@ int main_loop(struct sdl_system system) {
 
     ASSERT(system.renderer != NULL, return -1;, "Argument system.renderer must not be NULL");
 
+    return_code = start_bench();
+    ASSERT(return_code == 0, return -1;, "start_bench error");
+
+    return_code = start_frame_loop(&loop, 60);
+    ASSERT(return_code == 0, return -1;, "start_frame_loop error");
+
     TRACE("Main loop start");
     while (quit == false) {
+        TRACE_SPAN("frame");
+
+        return_code = begin_loop_frame(&loop);
+        ASSERT(return_code == 0, return -1;, "begin_loop_frame error");
+
         // Set renderer color
         return_code = SDL_SetRenderDrawColor(system.renderer, 0x00, 0x80, 0x80, 0xFF);
         ASSERT(return_code == 0, return -1;, "SDL_SetRenderDrawColor error=[%s]", SDL_GetError());
@@ -151,7 +168,9 @@ int main_loop(struct sdl_system system) {
         }
 
         // Update screen
+        TRACE_SPAN_BEGIN(present_span, "SDL_RenderPresent");
         SDL_RenderPresent(system.renderer);
+        TRACE_SPAN_END(present_span);
 
         // Poll for currently pending events
         do {
@@ -173,14 +192,21 @@ int main_loop(struct sdl_system system) {
             }
         } while (return_code == 1);
 
-        // sleep
-        nanosleep(&(struct timespec){.tv_sec = 0, .tv_nsec = (1000000000 / 60)}, NULL);
+        // Benchmark frame time, quits after the requested number of frames
+        return_code = record_bench_frame(&quit);
+        ASSERT(return_code == 0, return -1;, "record_bench_frame error");
+
+        // Wait for the next frame deadline, skipped in benchmark mode
+        return_code = end_loop_frame(&loop);
+        ASSERT(return_code == 0, return -1;, "end_loop_frame error");
     }
+    trace_frame_pacer(&loop.pacer);
     return 0;
 }
 
 int main(int argc, char** argv) {
     int return_code = 0;
+    const char* spans_path = NULL;
     struct sdl_system system = {0};
 
     TRACE("start");
@@ -188,7 +214,21 @@ int main(int argc, char** argv) {
     // Command line
     TRACE("argc=[%d]", argc);
     for (int i = 0; i < argc; i++) {
-        TRACE("argv[%d]=[%s]", i, argv[i]);
+        TRACE_DEBUG("argv[%d]=[%s]", i, argv[i]);
+    }
+
+    // Benchmark mode, see bench.h
+    return_code = parse_bench_arguments(argc, argv);
+    ASSERT(return_code == 0, return -1;, "parse_bench_arguments error");
+
+    return_code = set_bench_hints();
+    ASSERT(return_code == 0, return -1;, "set_bench_hints error");
+
+    // Timeline spans, saved as Chrome trace-event JSON when TRACE_SPANS names an output file
+    spans_path = getenv("TRACE_SPANS");
+    if (spans_path != NULL) {
+        return_code = start_trace_spans();
+        ASSERT(return_code == 0, return -1;, "start_trace_spans error");
     }
 
     TRACE("Initializing");
@@ -201,6 +241,16 @@ int main(int argc, char** argv) {
     TRACE("Closing");
     close_SDL(&system);
 
+    return_code = write_bench_report();
+    ASSERT(return_code == 0, NO_ACTION, "write_bench_report error");
+
+    if (spans_path != NULL) {
+        TRACE("Writing spans to \"%s\"", spans_path);
+        stop_trace_spans();
+        return_code = write_trace_spans(spans_path);
+        ASSERT(return_code == 0, NO_ACTION, "write_trace_spans error");
+    }
+
     TRACE("end");
     return 0;
 }
@@ -5,10 +5,15 @@
 #include <limits.h>
 #include <stdbool.h>
 #include <stdio.h>
+#include <stdlib.h>
 #include <time.h>
 
+#include "asset_pack.h"
 #include "assert.h"
-#include "embed/viewport.png.h"
+#include "bench.h"
+#include "embed/09_the_viewport.pack.h"
+#include "embed_rwops.h"
+#include "frame_loop.h"
 #include "trace.h"
 
 struct sdl_system {
@@ -17,6 +22,7 @@ struct sdl_system {
 };
 
 struct sdl_data {
+    struct asset_pack pack;
     SDL_Texture* viewport_texture;
     SDL_Rect top_left_viewport;
     SDL_Rect top_right_viewport;
@@ -99,8 +105,8 @@ SDL_Texture* load_texture_embedded(const void* img_data, const size_t size, SDL_
     ASSERT(renderer != NULL, return NULL;, "Argument renderer must not be NULL");
 
     TRACE("Opening stream to embedded image data");
-    rwops = SDL_RWFromConstMem(img_data, (int)size);
-    ASSERT(rwops != NULL, return NULL;, "SDL_RWFromConstMem error=[%s]", SDL_GetError());
+    rwops = open_embedded_rwops(img_data, size);
+    ASSERT(rwops != NULL, return NULL;, "open_embedded_rwops error");
 
     TRACE("Loading surface");
     surface = IMG_Load_RW(rwops, 1);
@@ -129,13 +135,21 @@ SDL_Texture* load_texture_embedded(const void* img_data, const size_t size, SDL_
 int load_media(struct sdl_data* data, SDL_Renderer* renderer) {
     const int SCREEN_WIDTH = 640;
     const int SCREEN_HEIGHT = 480;
+    struct asset asset;
+    int return_code = 0;
 
     ASSERT(data != NULL, return -1;, "Argument data must not be NULL");
     ASSERT(renderer != NULL, return -1;, "Argument renderer must not be NULL");
 
+    TRACE("Opening asset pack");
+    return_code = load_asset_pack(&(data->pack), _embed_09_the_viewport_pack_start, _embed_09_the_viewport_pack_size);
+    ASSERT(return_code == 0, return -1;, "load_asset_pack error");
+
     TRACE("Loading texture viewport");
     ASSERT(data->viewport_texture == NULL, return -1;, "Surface must be NULL before calling load_media");
-    data->viewport_texture = load_texture_embedded(_embed_viewport_png_start, _embed_viewport_png_size, renderer);
+    return_code = find_asset(&(data->pack), "viewport.png", &asset);
+    ASSERT(return_code == 0, return -1;, "find_asset error");
+    data->viewport_texture = load_texture_embedded(asset.data, asset.size, renderer);
     ASSERT(data->viewport_texture != NULL, return -1;, "load_texture_embedded error");
 
     // Top left corner viewport
@@ -167,13 +181,19 @@ void free_media(struct sdl_data* data) {
         SDL_DestroyTexture(data->viewport_texture);
         data->viewport_texture = NULL;
     }
+
+    TRACE("Closing asset pack");
+    close_asset_pack(&(data->pack));
     return;
 }
 
 int main_loop(const struct sdl_system system, const struct sdl_data data) {
+    TRACE_SPAN("main_loop");
+    struct trace_span present_span;
     int return_code = 0;
     SDL_Event event_buffer;
     bool quit = false;
+    struct frame_loop loop;
 
     ASSERT(system.renderer != NULL, return -1;, "Argument system.renderer must not be NULL");
     ASSERT(data.viewport_texture != NULL, return -1;, "Argument data.viewport_texture must not be NULL");
@@ -182,8 +202,19 @@ int main_loop(const struct sdl_system system, const struct sdl_data data) {
     return_code = SDL_SetRenderDrawColor(system.renderer, 0x00, 0x80, 0x80, 0xFF);
     ASSERT(return_code == 0, return -1;, "SDL_SetRenderDrawColor error=[%s]", SDL_GetError());
 
+    return_code = start_bench();
+    ASSERT(return_code == 0, return -1;, "start_bench error");
+
+    return_code = start_frame_loop(&loop, 60);
+    ASSERT(return_code == 0, return -1;, "start_frame_loop error");
+
     TRACE("Main loop start");
     while (quit == false) {
+        TRACE_SPAN("frame");
+
+        return_code = begin_loop_frame(&loop);
+        ASSERT(return_code == 0, return -1;, "begin_loop_frame error");
+
         // Clear screen
         return_code = SDL_RenderClear(system.renderer);
         ASSERT(return_code == 0, return -1;, "SDL_RenderClear error=[%s]", SDL_GetError());
@@ -213,7 +244,9 @@ int main_loop(const struct sdl_system system, const struct sdl_data data) {
         ASSERT(return_code == 0, return -1;, "SDL_RenderCopy error=[%s]", SDL_GetError());
 
         // Update screen
+        TRACE_SPAN_BEGIN(present_span, "SDL_RenderPresent");
         SDL_RenderPresent(system.renderer);
+        TRACE_SPAN_END(present_span);
 
         // Poll for currently pending events
         do {
@@ -235,14 +268,21 @@ int main_loop(const struct sdl_system system, const struct sdl_data data) {
             }
         } while (return_code == 1);
 
-        // sleep
-        nanosleep(&(struct timespec){.tv_sec = 0, .tv_nsec = (1000000000 / 60)}, NULL);
+        // Benchmark frame time, quits after the requested number of frames
+        return_code = record_bench_frame(&quit);
+        ASSERT(return_code == 0, return -1;, "record_bench_frame error");
+
+        // Wait for the next frame deadline, skipped in benchmark mode
+        return_code = end_loop_frame(&loop);
+        ASSERT(return_code == 0, return -1;, "end_loop_frame error");
     }
+    trace_frame_pacer(&loop.pacer);
     return 0;
 }
 
 int main(int argc, char** argv) {
     int return_code = 0;
+    const char* spans_path = NULL;
     struct sdl_system system = {0};
     struct sdl_data data = {0};
 
@@ -251,7 +291,21 @@ int main(int argc, char** argv) {
     // Command line
     TRACE("argc=[%d]", argc);
     for (int i = 0; i < argc; i++) {
-        TRACE("argv[%d]=[%s]", i, argv[i]);
+        TRACE_DEBUG("argv[%d]=[%s]", i, argv[i]);
+    }
+
+    // Benchmark mode, see bench.h
+    return_code = parse_bench_arguments(argc, argv);
+    ASSERT(return_code == 0, return -1;, "parse_bench_arguments error");
+
+    return_code = set_bench_hints();
+    ASSERT(return_code == 0, return -1;, "set_bench_hints error");
+
+    // Timeline spans, saved as Chrome trace-event JSON when TRACE_SPANS names an output file
+    spans_path = getenv("TRACE_SPANS");
+    if (spans_path != NULL) {
+        return_code = start_trace_spans();
+        ASSERT(return_code == 0, return -1;, "start_trace_spans error");
     }
 
     TRACE("Initializing");
@@ -271,6 +325,16 @@ int main(int argc, char** argv) {
     TRACE("Closing");
     close_SDL(&system);
 
+    return_code = write_bench_report();
+    ASSERT(return_code == 0, NO_ACTION, "write_bench_report error");
+
+    if (spans_path != NULL) {
+        TRACE("Writing spans to \"%s\"", spans_path);
+        stop_trace_spans();
+        return_code = write_trace_spans(spans_path);
+        ASSERT(return_code == 0, NO_ACTION, "write_trace_spans error");
+    }
+
     TRACE("end");
     return 0;
 }
@@ -1,292 +1,83 @@
 #define _DEFAULT_SOURCE
 
 #include <SDL2/SDL.h>
-#include <SDL2/SDL_image.h>
-#include <errno.h>
-#include <limits.h>
 #include <math.h>
 #include <stdbool.h>
 #include <stdint.h>
+#include <stdlib.h>
 #include <strings.h>
-#include <time.h>
 
+#include "asset_loader.h"
+#include "asset_pack.h"
 #include "assert.h"
-#include "embed/SNES_F-Zero_Racers.png.h"
+#include "bench.h"
+#include "embed/14_animated_sprites.pack.h"
+#include "embed/SNES_F-Zero_Racers.sheet.h"
+#include "frame_loop.h"
+#include "sdl_common.h"
+#include "texture_cache.h"
 #include "trace.h"
 
-struct sdl_texture {
-    SDL_Texture* texture;
-    int width;
-    int height;
-};
-
-struct sdl_system {
-    SDL_Window* window;
-    SDL_Renderer* renderer;
-};
+#define TEXTURE_CACHE_CAPACITY 4
+#define TEXTURE_CACHE_BUDGET (16 * 1024 * 1024)
 
 struct sdl_data {
+    struct asset_pack pack;
+    struct texture_cache cache;
     struct sdl_texture snes_fzero_racers;
-    SDL_Rect blue_falcon_clips[13];
-    SDL_Rect golden_fox_clips[13];
-    SDL_Rect wild_goose_clips[13];
-    SDL_Rect fire_stingray_clips[13];
-    SDL_Rect snail_clips[13];
+    // Constant clip tables generated from SNES_F-Zero_Racers.sheet, 13 frames each
+    const SDL_Rect* blue_falcon_clips;
+    const SDL_Rect* golden_fox_clips;
+    const SDL_Rect* wild_goose_clips;
+    const SDL_Rect* fire_stingray_clips;
+    const SDL_Rect* snail_clips;
 };
 
-int init_SDL(struct sdl_system* system);
-void close_SDL(struct sdl_system* system);
-
-int load_texture_embedded(struct sdl_texture* texture, const void* img_data, const size_t size, SDL_Renderer* renderer,
-                          const SDL_Color* color_key);
-void free_texture(struct sdl_texture* texture);
-int render_texture(const struct sdl_texture texture, SDL_Renderer* renderer, int x, int y, const SDL_Rect* clip);
-
 int load_media(struct sdl_data* data, SDL_Renderer* renderer);
 void free_media(struct sdl_data* data);
 
-int get_animation_state(struct timespec* start_time, int* index);
+int get_animation_state(const double loop_time, int* index);
 
-int handle_events(bool* quit);
 int main_loop(const struct sdl_system system, const struct sdl_data data);
 int main(int argc, char** argv);
 
-int init_SDL(struct sdl_system* system) {
-    int return_code = 0;
-    const int SCREEN_WIDTH = 640;
-    const int SCREEN_HEIGHT = 480;
-    const int img_flags = IMG_INIT_PNG;
-
-    ASSERT(system != NULL, return -1;, "Argument system must not be NULL");
-    ASSERT(system->window == NULL, return -1;, "Argument system->window must be NULL before initialization");
-    ASSERT(system->renderer == NULL, return -1;, "Argument system->renderer must be NULL before initialization");
-
-    TRACE("Initializing SDL");
-    return_code = SDL_Init(SDL_INIT_VIDEO);
-    ASSERT(return_code == 0, return -1;, "SDL_Init error=[%s]", SDL_GetError());
-
-    TRACE("Initializing SDL_image");
-    return_code = IMG_Init(img_flags);
-    ASSERT((return_code & img_flags) == img_flags, IMG_Quit(); SDL_Quit(); return -1;
-           , "IMG_Init error=[%s]", IMG_GetError());
-
-    TRACE("Creating window");
-    system->window = SDL_CreateWindow("SDL Tutorial 14 - Animated Sprites and VSync", SDL_WINDOWPOS_UNDEFINED,
-                                      SDL_WINDOWPOS_UNDEFINED, SCREEN_WIDTH, SCREEN_HEIGHT, SDL_WINDOW_SHOWN);
-    ASSERT(system->window != NULL, IMG_Quit(); SDL_Quit(); return -1;, "SDL_CreateWindow error=[%s]", SDL_GetError());
-
-    TRACE("Creating renderer for window");
-    system->renderer = SDL_CreateRenderer(system->window, -1, SDL_RENDERER_ACCELERATED | SDL_RENDERER_PRESENTVSYNC);
-    ASSERT(system->renderer != NULL, close_SDL(system); return -1;, "SDL_CreateRenderer error=[%s]", SDL_GetError());
-
-    return 0;
-}
-
-void close_SDL(struct sdl_system* system) {
-    ASSERT(system != NULL, return;, "Argument system must not be NULL");
-
-    if (system->renderer != NULL) {
-        TRACE("Destroying renderer");
-        SDL_DestroyRenderer(system->renderer);
-        system->renderer = NULL;
-    }
-
-    if (system->window != NULL) {
-        TRACE("Destroying window");
-        SDL_DestroyWindow(system->window);
-        system->window = NULL;
-    }
-
-    TRACE("Quitting SDL_image");
-    IMG_Quit();
-
-    TRACE("Quitting SDL");
-    SDL_Quit();
-    return;
-}
-
-int load_texture_embedded(struct sdl_texture* texture, const void* img_data, const size_t size, SDL_Renderer* renderer,
-                          const SDL_Color* color_key) {
-    SDL_RWops* rwops = NULL;
-    SDL_Surface* loaded_surface = NULL;
-    SDL_Texture* loaded_texture = NULL;
-    int width = 0;
-    int height = 0;
-    int return_code = 0;
-
-    ASSERT(texture != NULL, return -1;, "Argument texture must not be NULL");
-    ASSERT(img_data != NULL, return -1;, "Argument img_data must not be NULL");
-    ASSERT(size > 0, return -1;, "Argument size must be larger than 0");
-    ASSERT(size <= INT_MAX, return -1;, "Argument size must not exceed maximum allowed");
-    ASSERT(renderer != NULL, return -1;, "Argument renderer must not be NULL");
-
-    TRACE("Opening stream to embedded image data");
-    rwops = SDL_RWFromConstMem(img_data, (int)size);
-    ASSERT(rwops != NULL, return -1;, "SDL_RWFromConstMem error=[%s]", SDL_GetError());
-
-    TRACE("Loading surface");
-    loaded_surface = IMG_Load_RW(rwops, 1);
-    ASSERT(loaded_surface != NULL, return -1;, "IMG_Load_RW error=[%s]", IMG_GetError());
-
-    width = loaded_surface->w;
-    height = loaded_surface->h;
-    TRACE("Image width=[%d] height=[%d]", width, height);
-
-    // Color key image with cyan
-    if (color_key != NULL) {
-        TRACE("Setting surface color_key=[%02X%02X%02X]", color_key->r, color_key->g, color_key->b);
-        return_code = SDL_SetColorKey(loaded_surface, SDL_TRUE,
-                                      SDL_MapRGB(loaded_surface->format, color_key->r, color_key->g, color_key->b));
-        ASSERT(return_code == 0, SDL_FreeSurface(loaded_surface); return -1;
-               , "SDL_SetColorKey error=[%s]", SDL_GetError());
-    }
-
-    TRACE("Creating texture from surface");
-    loaded_texture = SDL_CreateTextureFromSurface(renderer, loaded_surface);
-    ASSERT(loaded_texture != NULL, SDL_FreeSurface(loaded_surface); return -1;
-           , "SDL_CreateTextureFromSurface error=[%s]", SDL_GetError());
-
-    SDL_FreeSurface(loaded_surface);
-
-    return_code = SDL_SetTextureScaleMode(loaded_texture, SDL_ScaleModeBest);
-    ASSERT(return_code == 0, SDL_DestroyTexture(loaded_texture); return -1;
-           , "SDL_SetTextureScaleMode error=[%s]", SDL_GetError());
-
-    return_code = SDL_SetTextureBlendMode(loaded_texture, SDL_BLENDMODE_BLEND);
-    ASSERT(return_code == 0, SDL_DestroyTexture(loaded_texture); return -1;
-           , "SDL_SetTextureBlendMode error=[%s]", SDL_GetError());
-
-    // Fill return texture
-    if (texture->texture != NULL) {
-        free_texture(texture);
-    }
-    texture->texture = loaded_texture;
-    texture->width = width;
-    texture->height = height;
-    return 0;
-}
-
-void free_texture(struct sdl_texture* texture) {
-    ASSERT(texture != NULL, return;, "Argument texture must not be NULL");
-
-    if (texture->texture != NULL) {
-        TRACE("Destroying texture");
-        SDL_DestroyTexture(texture->texture);
-        texture->texture = NULL;
-    }
-    texture->width = 0;
-    texture->height = 0;
-
-    return;
-}
-
-int render_texture(const struct sdl_texture texture, SDL_Renderer* renderer, int x, int y, const SDL_Rect* clip) {
-    int return_code = 0;
-    SDL_Rect source_rect;
-    SDL_Rect destination_rect;
-
-    ASSERT(texture.texture != NULL, return -1;, "Argument texture.texture must not be NULL");
-    ASSERT(renderer != NULL, return -1;, "Argument renderer must not be NULL");
-
-    source_rect = (SDL_Rect){0, 0, texture.width, texture.height};
-    destination_rect = (SDL_Rect){x, y, texture.width, texture.height};
-
-    if (clip != NULL) {
-        source_rect.x = clip->x;
-        source_rect.y = clip->y;
-        source_rect.w = clip->w;
-        source_rect.h = clip->h;
-        destination_rect.w = clip->w;
-        destination_rect.h = clip->h;
-    }
-
-    return_code = SDL_RenderCopy(renderer, texture.texture, &source_rect, &destination_rect);
-    ASSERT(return_code == 0, return -1;, "SDL_RenderCopy error=[%s]", SDL_GetError());
-
-    return 0;
-}
-
 int load_media(struct sdl_data* data, SDL_Renderer* renderer) {
     int return_code = 0;
-    SDL_Color color_key = {.r = 0x93, .g = 0xBB, .b = 0xEC, .a = 0};  // colorkey #93bbec
-
+    struct asset asset;
+    struct asset_loader loader;
     ASSERT(data != NULL, return -1;, "Argument data must not be NULL");
     ASSERT(renderer != NULL, return -1;, "Argument renderer must not be NULL");
 
-    TRACE("Loading texture SNES_F-Zero_Racers");
-    return_code = load_texture_embedded(&(data->snes_fzero_racers), _embed_SNES_F_Zero_Racers_png_start,
-                                        _embed_SNES_F_Zero_Racers_png_size, renderer, &color_key);
-    ASSERT(return_code == 0, return -1;, "load_texture_embedded error");
-
-    data->blue_falcon_clips[0] = (SDL_Rect){.x = 1, .y = 18, .w = 48, .h = 32};
-    data->blue_falcon_clips[1] = (SDL_Rect){.x = 50, .y = 18, .w = 48, .h = 32};
-    data->blue_falcon_clips[2] = (SDL_Rect){.x = 99, .y = 18, .w = 48, .h = 32};
-    data->blue_falcon_clips[3] = (SDL_Rect){.x = 148, .y = 18, .w = 48, .h = 32};
-    data->blue_falcon_clips[4] = (SDL_Rect){.x = 197, .y = 18, .w = 48, .h = 32};
-    data->blue_falcon_clips[5] = (SDL_Rect){.x = 246, .y = 18, .w = 48, .h = 32};
-    data->blue_falcon_clips[6] = (SDL_Rect){.x = 295, .y = 18, .w = 48, .h = 32};
-    data->blue_falcon_clips[7] = (SDL_Rect){.x = 344, .y = 18, .w = 48, .h = 32};
-    data->blue_falcon_clips[8] = (SDL_Rect){.x = 393, .y = 18, .w = 48, .h = 32};
-    data->blue_falcon_clips[9] = (SDL_Rect){.x = 442, .y = 18, .w = 48, .h = 32};
-    data->blue_falcon_clips[10] = (SDL_Rect){.x = 491, .y = 18, .w = 48, .h = 32};
-    data->blue_falcon_clips[11] = (SDL_Rect){.x = 540, .y = 18, .w = 48, .h = 32};
-    data->blue_falcon_clips[12] = (SDL_Rect){.x = 589, .y = 18, .w = 48, .h = 32};
-
-    data->golden_fox_clips[0] = (SDL_Rect){.x = 1, .y = 324, .w = 48, .h = 32};
-    data->golden_fox_clips[1] = (SDL_Rect){.x = 50, .y = 324, .w = 48, .h = 32};
-    data->golden_fox_clips[2] = (SDL_Rect){.x = 99, .y = 324, .w = 48, .h = 32};
-    data->golden_fox_clips[3] = (SDL_Rect){.x = 148, .y = 324, .w = 48, .h = 32};
-    data->golden_fox_clips[4] = (SDL_Rect){.x = 197, .y = 324, .w = 48, .h = 32};
-    data->golden_fox_clips[5] = (SDL_Rect){.x = 246, .y = 324, .w = 48, .h = 32};
-    data->golden_fox_clips[6] = (SDL_Rect){.x = 295, .y = 324, .w = 48, .h = 32};
-    data->golden_fox_clips[7] = (SDL_Rect){.x = 344, .y = 324, .w = 48, .h = 32};
-    data->golden_fox_clips[8] = (SDL_Rect){.x = 393, .y = 324, .w = 48, .h = 32};
-    data->golden_fox_clips[9] = (SDL_Rect){.x = 442, .y = 324, .w = 48, .h = 32};
-    data->golden_fox_clips[10] = (SDL_Rect){.x = 491, .y = 324, .w = 48, .h = 32};
-    data->golden_fox_clips[11] = (SDL_Rect){.x = 540, .y = 324, .w = 48, .h = 32};
-    data->golden_fox_clips[12] = (SDL_Rect){.x = 589, .y = 324, .w = 48, .h = 32};
-
-    data->wild_goose_clips[0] = (SDL_Rect){.x = 1, .y = 642, .w = 48, .h = 32};
-    data->wild_goose_clips[1] = (SDL_Rect){.x = 50, .y = 642, .w = 48, .h = 32};
-    data->wild_goose_clips[2] = (SDL_Rect){.x = 99, .y = 642, .w = 48, .h = 32};
-    data->wild_goose_clips[3] = (SDL_Rect){.x = 148, .y = 642, .w = 48, .h = 32};
-    data->wild_goose_clips[4] = (SDL_Rect){.x = 197, .y = 642, .w = 48, .h = 32};
-    data->wild_goose_clips[5] = (SDL_Rect){.x = 246, .y = 642, .w = 48, .h = 32};
-    data->wild_goose_clips[6] = (SDL_Rect){.x = 295, .y = 642, .w = 48, .h = 32};
-    data->wild_goose_clips[7] = (SDL_Rect){.x = 344, .y = 642, .w = 48, .h = 32};
-    data->wild_goose_clips[8] = (SDL_Rect){.x = 393, .y = 642, .w = 48, .h = 32};
-    data->wild_goose_clips[9] = (SDL_Rect){.x = 442, .y = 642, .w = 48, .h = 32};
-    data->wild_goose_clips[10] = (SDL_Rect){.x = 491, .y = 642, .w = 48, .h = 32};
-    data->wild_goose_clips[11] = (SDL_Rect){.x = 540, .y = 642, .w = 48, .h = 32};
-    data->wild_goose_clips[12] = (SDL_Rect){.x = 589, .y = 642, .w = 48, .h = 32};
-
-    data->fire_stingray_clips[0] = (SDL_Rect){.x = 1, .y = 945, .w = 48, .h = 32};
-    data->fire_stingray_clips[1] = (SDL_Rect){.x = 50, .y = 945, .w = 48, .h = 32};
-    data->fire_stingray_clips[2] = (SDL_Rect){.x = 99, .y = 945, .w = 48, .h = 32};
-    data->fire_stingray_clips[3] = (SDL_Rect){.x = 148, .y = 945, .w = 48, .h = 32};
-    data->fire_stingray_clips[4] = (SDL_Rect){.x = 197, .y = 945, .w = 48, .h = 32};
-    data->fire_stingray_clips[5] = (SDL_Rect){.x = 246, .y = 945, .w = 48, .h = 32};
-    data->fire_stingray_clips[6] = (SDL_Rect){.x = 295, .y = 945, .w = 48, .h = 32};
-    data->fire_stingray_clips[7] = (SDL_Rect){.x = 344, .y = 945, .w = 48, .h = 32};
-    data->fire_stingray_clips[8] = (SDL_Rect){.x = 393, .y = 945, .w = 48, .h = 32};
-    data->fire_stingray_clips[9] = (SDL_Rect){.x = 442, .y = 945, .w = 48, .h = 32};
-    data->fire_stingray_clips[10] = (SDL_Rect){.x = 491, .y = 945, .w = 48, .h = 32};
-    data->fire_stingray_clips[11] = (SDL_Rect){.x = 540, .y = 945, .w = 48, .h = 32};
-    data->fire_stingray_clips[12] = (SDL_Rect){.x = 589, .y = 945, .w = 48, .h = 32};
-
-    data->snail_clips[0] = (SDL_Rect){.x = 1, .y = 1247, .w = 48, .h = 32};
-    data->snail_clips[1] = (SDL_Rect){.x = 50, .y = 1247, .w = 48, .h = 32};
-    data->snail_clips[2] = (SDL_Rect){.x = 99, .y = 1247, .w = 48, .h = 32};
-    data->snail_clips[3] = (SDL_Rect){.x = 148, .y = 1247, .w = 48, .h = 32};
-    data->snail_clips[4] = (SDL_Rect){.x = 197, .y = 1247, .w = 48, .h = 32};
-    data->snail_clips[5] = (SDL_Rect){.x = 246, .y = 1247, .w = 48, .h = 32};
-    data->snail_clips[6] = (SDL_Rect){.x = 295, .y = 1247, .w = 48, .h = 32};
-    data->snail_clips[7] = (SDL_Rect){.x = 344, .y = 1247, .w = 48, .h = 32};
-    data->snail_clips[8] = (SDL_Rect){.x = 393, .y = 1247, .w = 48, .h = 32};
-    data->snail_clips[9] = (SDL_Rect){.x = 442, .y = 1247, .w = 48, .h = 32};
-    data->snail_clips[10] = (SDL_Rect){.x = 491, .y = 1247, .w = 48, .h = 32};
-    data->snail_clips[11] = (SDL_Rect){.x = 540, .y = 1247, .w = 48, .h = 32};
-    data->snail_clips[12] = (SDL_Rect){.x = 589, .y = 1247, .w = 48, .h = 32};
+    TRACE("Opening asset pack");
+    return_code =
+        load_asset_pack(&(data->pack), _embed_14_animated_sprites_pack_start, _embed_14_animated_sprites_pack_size);
+    ASSERT(return_code == 0, return -1;, "load_asset_pack error");
+
+    // Textures go through the cache, so loading the sheet again is a lookup, see texture_cache.h
+    return_code = create_texture_cache(&(data->cache), renderer, TEXTURE_CACHE_CAPACITY, TEXTURE_CACHE_BUDGET);
+    ASSERT(return_code == 0, return -1;, "create_texture_cache error");
+
+    // Decode on worker threads while a loading screen is presented, see asset_loader.h
+    return_code = create_asset_loader(&loader, 0);
+    ASSERT(return_code == 0, return -1;, "create_asset_loader error");
+    set_asset_loader_cache(&loader, &(data->cache));
+
+    TRACE("Queueing texture SNES_F-Zero_Racers");
+    return_code = find_asset(&(data->pack), "SNES_F-Zero_Racers.png.raw", &asset);
+    ASSERT(return_code == 0, destroy_asset_loader(&loader); return -1;, "find_asset error");
+    // Color key #93bbec was made transparent at build time, see RAW_COLOR_KEY in the makefile
+    return_code = queue_texture_raw(&loader, &(data->snes_fzero_racers), asset.data, asset.size);
+    ASSERT(return_code == 0, destroy_asset_loader(&loader); return -1;, "queue_texture_raw error");
+
+    return_code = run_loading_screen(&loader, renderer);
+    ASSERT(return_code == 0, destroy_asset_loader(&loader); return -1;, "run_loading_screen error");
+    destroy_asset_loader(&loader);
+
+    data->blue_falcon_clips = _sheet_SNES_F_Zero_Racers_blue_falcon;
+    data->golden_fox_clips = _sheet_SNES_F_Zero_Racers_golden_fox;
+    data->wild_goose_clips = _sheet_SNES_F_Zero_Racers_wild_goose;
+    data->fire_stingray_clips = _sheet_SNES_F_Zero_Racers_fire_stingray;
+    data->snail_clips = _sheet_SNES_F_Zero_Racers_snail;
 
     return 0;
 }
@@ -294,36 +85,32 @@ int load_media(struct sdl_data* data, SDL_Renderer* renderer) {
 void free_media(struct sdl_data* data) {
     ASSERT(data != NULL, return;, "Argument data must not be NULL");
 
-    TRACE("Destroying texture SNES_F-Zero_Racers");
-    free_texture(&(data->snes_fzero_racers));
+    TRACE("Releasing texture SNES_F-Zero_Racers");
+    if (data->cache.entries != NULL) {
+        release_texture(&(data->cache), &(data->snes_fzero_racers));
+    }
+    destroy_texture_cache(&(data->cache));
+
+    data->blue_falcon_clips = NULL;
+    data->golden_fox_clips = NULL;
+    data->wild_goose_clips = NULL;
+    data->fire_stingray_clips = NULL;
+    data->snail_clips = NULL;
 
-    memset(data->blue_falcon_clips, 0, sizeof(data->blue_falcon_clips));
-    memset(data->golden_fox_clips, 0, sizeof(data->golden_fox_clips));
-    memset(data->wild_goose_clips, 0, sizeof(data->wild_goose_clips));
-    memset(data->fire_stingray_clips, 0, sizeof(data->fire_stingray_clips));
-    memset(data->snail_clips, 0, sizeof(data->snail_clips));
+    TRACE("Closing asset pack");
+    close_asset_pack(&(data->pack));
 
     return;
 }
 
-int get_animation_state(struct timespec* start_time, int* index) {
-    int return_code = 0;
-    int error_num = 0;
-    struct timespec current_time;
+int get_animation_state(const double loop_time, int* index) {
+    TRACE_SPAN("get_animation_state");
     double seconds = 0;
     const double duration = 2.0;
 
-    ASSERT(start_time != NULL, return -1;, "Argument start_time must not be NULL");
     ASSERT(index != NULL, return -1;, "Argument index must not be NULL");
 
-    // Get current time
-    return_code = clock_gettime(CLOCK_MONOTONIC, &current_time);
-    error_num = errno;
-    ASSERT(return_code == 0, return -1;, "clock_gettime error=[%s]", strerror(error_num));
-
-    seconds = (double)(current_time.tv_sec - start_time->tv_sec) +
-              ((double)(current_time.tv_nsec - start_time->tv_nsec) / 1000000000.0);
-    seconds = fmod(seconds, duration);
+    seconds = fmod(loop_time, duration);
 
     if (seconds < (duration / 2)) {
         // sprites from index 0 to 12
@@ -341,95 +128,89 @@ int get_animation_state(struct timespec* start_time, int* index) {
     return 0;
 }
 
-int handle_events(bool* quit) {
-    SDL_Event event_buffer;
-    int return_code = 0;
-
-    ASSERT(quit != NULL, return -1;, "Argument quit must not be NULL");
-
-    do {
-        return_code = SDL_PollEvent(&event_buffer);
-        ASSERT(return_code >= 0, return -1;, "SDL_PollEvent error=[%s]", SDL_GetError());
-
-        if (return_code == 0) {
-            break;
-        }
-        switch (event_buffer.type) {
-            case SDL_QUIT: {
-                TRACE("Quit");
-                *quit = true;
-                break;
-            }
-            case SDL_KEYDOWN: {
-                break;
-            }
-            default: {
-                break;
-            }
-        }
-    } while (return_code == 1);
-
-    return 0;
-}
-
 int main_loop(const struct sdl_system system, const struct sdl_data data) {
+    TRACE_SPAN("main_loop");
+    struct trace_span present_span;
     int return_code = 0;
     bool quit = false;
-    struct timespec start_time;
-    int error_num = 0;
+    struct frame_loop loop;
+    int previous_index = 0;
+    int current_index = 0;
     int index = 0;
 
     ASSERT(system.renderer != NULL, return -1;, "Argument system.renderer must not be NULL");
 
-    return_code = clock_gettime(CLOCK_MONOTONIC, &start_time);
-    error_num = errno;
-    ASSERT(return_code == 0, return -1;, "clock_gettime error=[%s]", strerror(error_num));
-
     // Set renderer color
     return_code = SDL_SetRenderDrawColor(system.renderer, 0x00, 0x80, 0x80, 0xFF);
     ASSERT(return_code == 0, return -1;, "SDL_SetRenderDrawColor error=[%s]", SDL_GetError());
 
+    return_code = start_bench();
+    ASSERT(return_code == 0, return -1;, "start_bench error");
+
+    return_code = start_frame_loop(&loop, 60);
+    ASSERT(return_code == 0, return -1;, "start_frame_loop error");
+
     TRACE("Main loop start");
     while (quit == false) {
+        TRACE_SPAN("frame");
+
+        return_code = begin_loop_frame(&loop);
+        ASSERT(return_code == 0, return -1;, "begin_loop_frame error");
+
+        // Each update advances the sprite frame, keeping the previous one to draw between them
+        while (next_loop_update(&loop) == true) {
+            previous_index = current_index;
+            return_code = get_animation_state((double)loop.time_ns / 1000000000.0, &current_index);
+            ASSERT(return_code == 0, return -1;, "get_animation_state error");
+        }
+
         // Clear screen
         return_code = SDL_RenderClear(system.renderer);
         ASSERT(return_code == 0, return -1;, "SDL_RenderClear error=[%s]", SDL_GetError());
 
-        return_code = get_animation_state(&start_time, &index);
-        ASSERT(return_code == 0, return -1;, "get_animation_state error");
+        // A sprite frame cannot be blended, the nearer of the last two updates is drawn
+        index = (get_loop_alpha(&loop) < 0.5) ? previous_index : current_index;
 
         // Render textures
-        return_code = render_texture(data.snes_fzero_racers, system.renderer, 296, 384, &data.blue_falcon_clips[index]);
+        return_code = render_texture(data.snes_fzero_racers, system.renderer, 296, 384, &data.blue_falcon_clips[index],
+                                     0.0, NULL, SDL_FLIP_NONE);
         ASSERT(return_code == 0, return -1;, "render_texture error");
 
-        return_code = render_texture(data.snes_fzero_racers, system.renderer, 448, 273, &data.golden_fox_clips[index]);
+        return_code = render_texture(data.snes_fzero_racers, system.renderer, 448, 273, &data.golden_fox_clips[index],
+                                     0.0, NULL, SDL_FLIP_NONE);
         ASSERT(return_code == 0, return -1;, "render_texture error");
 
-        return_code = render_texture(data.snes_fzero_racers, system.renderer, 390, 95, &data.wild_goose_clips[index]);
+        return_code = render_texture(data.snes_fzero_racers, system.renderer, 390, 95, &data.wild_goose_clips[index],
+                                     0.0, NULL, SDL_FLIP_NONE);
         ASSERT(return_code == 0, return -1;, "render_texture error");
 
-        return_code =
-            render_texture(data.snes_fzero_racers, system.renderer, 202, 95, &data.fire_stingray_clips[index]);
+        return_code = render_texture(data.snes_fzero_racers, system.renderer, 202, 95, &data.fire_stingray_clips[index],
+                                     0.0, NULL, SDL_FLIP_NONE);
         ASSERT(return_code == 0, return -1;, "render_texture error");
 
-        return_code = render_texture(data.snes_fzero_racers, system.renderer, 144, 273, &data.snail_clips[index]);
+        return_code = render_texture(data.snes_fzero_racers, system.renderer, 144, 273, &data.snail_clips[index], 0.0,
+                                     NULL, SDL_FLIP_NONE);
         ASSERT(return_code == 0, return -1;, "render_texture error");
 
         // Update screen
+        TRACE_SPAN_BEGIN(present_span, "SDL_RenderPresent");
         SDL_RenderPresent(system.renderer);
+        TRACE_SPAN_END(present_span);
 
         // Poll for currently pending events
-        return_code = handle_events(&quit);
+        return_code = handle_events(&quit, NULL, NULL);
         ASSERT(return_code == 0, return -1;, "handle_events error");
 
-        // sleep
-        // nanosleep(&(struct timespec){.tv_sec = 0, .tv_nsec = (1000000000 / 60)}, NULL);
+        // Benchmark frame time, quits after the requested number of frames
+        return_code = record_bench_frame(&quit);
+        ASSERT(return_code == 0, return -1;, "record_bench_frame error");
     }
     return 0;
 }
 
 int main(int argc, char** argv) {
     int return_code = 0;
+    const char* spans_path = NULL;
     struct sdl_system system = {0};
     struct sdl_data data = {0};
 
@@ -438,11 +219,23 @@ int main(int argc, char** argv) {
     // Command line
     TRACE("argc=[%d]", argc);
     for (int i = 0; i < argc; i++) {
-        TRACE("argv[%d]=[%s]", i, argv[i]);
+        TRACE_DEBUG("argv[%d]=[%s]", i, argv[i]);
+    }
+
+    // Benchmark mode, see bench.h
+    return_code = parse_bench_arguments(argc, argv);
+    ASSERT(return_code == 0, return -1;, "parse_bench_arguments error");
+
+    // Timeline spans, saved as Chrome trace-event JSON when TRACE_SPANS names an output file
+    spans_path = getenv("TRACE_SPANS");
+    if (spans_path != NULL) {
+        return_code = start_trace_spans();
+        ASSERT(return_code == 0, return -1;, "start_trace_spans error");
     }
 
     TRACE("Initializing");
-    return_code = init_SDL(&system);
+    return_code = init_SDL(&system, "SDL Tutorial 14 - Animated Sprites and VSync",
+                           SDL_RENDERER_ACCELERATED | SDL_RENDERER_PRESENTVSYNC);
     ASSERT(return_code == 0, close_SDL(&system); return -1;, "init_SDL error");
 
     TRACE("Loading media");
@@ -458,6 +251,16 @@ int main(int argc, char** argv) {
     TRACE("Closing");
     close_SDL(&system);
 
+    return_code = write_bench_report();
+    ASSERT(return_code == 0, NO_ACTION, "write_bench_report error");
+
+    if (spans_path != NULL) {
+        TRACE("Writing spans to \"%s\"", spans_path);
+        stop_trace_spans();
+        return_code = write_trace_spans(spans_path);
+        ASSERT(return_code == 0, NO_ACTION, "write_trace_spans error");
+    }
+
     TRACE("end");
     return 0;
 }
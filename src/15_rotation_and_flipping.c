@@ -1,41 +1,43 @@
 #define _DEFAULT_SOURCE
 
 #include <SDL2/SDL.h>
-#include <SDL2/SDL_image.h>
 #include <errno.h>
-#include <limits.h>
 #include <math.h>
 #include <stdbool.h>
 #include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
 #include <strings.h>
-#include <time.h>
 
+#include "asset_loader.h"
+#include "asset_pack.h"
 #include "assert.h"
-#include "embed/SNES_F-Zero_Racers.png.h"
+#include "bench.h"
+#include "embed/15_rotation_and_flipping.pack.h"
+#include "embed/SNES_F-Zero_Racers.sheet.h"
+#include "frame_loop.h"
+#include "sdl_common.h"
+#include "sprite_batch.h"
+#include "texture_cache.h"
 #include "trace.h"
 
 #ifndef M_PI
 #define M_PI 3.14159265358979323846
 #endif
 
-struct sdl_texture {
-    SDL_Texture* texture;
-    int width;
-    int height;
-};
-
-struct sdl_system {
-    SDL_Window* window;
-    SDL_Renderer* renderer;
-};
+#define TEXTURE_CACHE_CAPACITY 4
+#define TEXTURE_CACHE_BUDGET (16 * 1024 * 1024)
 
 struct sdl_data {
+    struct asset_pack pack;
+    struct texture_cache cache;
     struct sdl_texture snes_fzero_racers;
-    SDL_Rect blue_falcon_clips[13];
-    SDL_Rect golden_fox_clips[13];
-    SDL_Rect wild_goose_clips[13];
-    SDL_Rect fire_stingray_clips[13];
-    SDL_Rect snail_clips[13];
+    // Constant clip tables generated from SNES_F-Zero_Racers.sheet, 13 frames each
+    const SDL_Rect* blue_falcon_clips;
+    const SDL_Rect* golden_fox_clips;
+    const SDL_Rect* wild_goose_clips;
+    const SDL_Rect* fire_stingray_clips;
+    const SDL_Rect* snail_clips;
 };
 
 struct car_state {
@@ -44,264 +46,72 @@ struct car_state {
     int sprite_index[5];
     SDL_RendererFlip flip[5];
     double angle;
+    double t;  // lap progress 0..1
 };
 
-int init_SDL(struct sdl_system* system);
-void close_SDL(struct sdl_system* system);
+// Stress mode: --racers N draws N racers per frame instead of the demo scene, through the sprite batch unless
+// --unbatched asks for one render_texture call per racer
+struct stress_mode {
+    int racers;
+    bool unbatched;
+};
 
-int load_texture_embedded(struct sdl_texture* texture, const void* img_data, const size_t size, SDL_Renderer* renderer,
-                          const SDL_Color* color_key);
-void free_texture(struct sdl_texture* texture);
-int render_texture(const struct sdl_texture texture, SDL_Renderer* renderer, int x, int y, const SDL_Rect* clip,
-                   const double angle, const SDL_Point* center, const SDL_RendererFlip flip);
+#define STRESS_MIN_RACERS 10000
+#define STRESS_MAX_RACERS 100000
 
 int load_media(struct sdl_data* data, SDL_Renderer* renderer);
 void free_media(struct sdl_data* data);
 
 int get_car_heading_index(const double heading_angle, int* index, SDL_RendererFlip* flip);
-int get_animation_state(const struct timespec* start_time, struct car_state* car_state);
-
-int handle_events(bool* quit);
-int main_loop(const struct sdl_system system, const struct sdl_data data);
-int main(int argc, char** argv);
-
-int init_SDL(struct sdl_system* system) {
-    int return_code = 0;
-    const int SCREEN_WIDTH = 640;
-    const int SCREEN_HEIGHT = 480;
-    const int img_flags = IMG_INIT_PNG;
-
-    ASSERT(system != NULL, return -1;, "Argument system must not be NULL");
-    ASSERT(system->window == NULL, return -1;, "Argument system->window must be NULL before initialization");
-    ASSERT(system->renderer == NULL, return -1;, "Argument system->renderer must be NULL before initialization");
-
-    TRACE("Initializing SDL");
-    return_code = SDL_Init(SDL_INIT_VIDEO);
-    ASSERT(return_code == 0, return -1;, "SDL_Init error=[%s]", SDL_GetError());
-
-    TRACE("Initializing SDL_image");
-    return_code = IMG_Init(img_flags);
-    ASSERT((return_code & img_flags) == img_flags, IMG_Quit(); SDL_Quit(); return -1;
-           , "IMG_Init error=[%s]", IMG_GetError());
-
-    TRACE("Creating window");
-    system->window = SDL_CreateWindow("SDL Tutorial 15 - Rotation and Flipping", SDL_WINDOWPOS_UNDEFINED,
-                                      SDL_WINDOWPOS_UNDEFINED, SCREEN_WIDTH, SCREEN_HEIGHT, SDL_WINDOW_SHOWN);
-    ASSERT(system->window != NULL, IMG_Quit(); SDL_Quit(); return -1;, "SDL_CreateWindow error=[%s]", SDL_GetError());
-
-    TRACE("Creating renderer for window");
-    system->renderer = SDL_CreateRenderer(system->window, -1, SDL_RENDERER_ACCELERATED | SDL_RENDERER_PRESENTVSYNC);
-    ASSERT(system->renderer != NULL, close_SDL(system); return -1;, "SDL_CreateRenderer error=[%s]", SDL_GetError());
-
-    return 0;
-}
-
-void close_SDL(struct sdl_system* system) {
-    ASSERT(system != NULL, return;, "Argument system must not be NULL");
-
-    if (system->renderer != NULL) {
-        TRACE("Destroying renderer");
-        SDL_DestroyRenderer(system->renderer);
-        system->renderer = NULL;
-    }
-
-    if (system->window != NULL) {
-        TRACE("Destroying window");
-        SDL_DestroyWindow(system->window);
-        system->window = NULL;
-    }
-
-    TRACE("Quitting SDL_image");
-    IMG_Quit();
-
-    TRACE("Quitting SDL");
-    SDL_Quit();
-    return;
-}
-
-int load_texture_embedded(struct sdl_texture* texture, const void* img_data, const size_t size, SDL_Renderer* renderer,
-                          const SDL_Color* color_key) {
-    SDL_RWops* rwops = NULL;
-    SDL_Surface* loaded_surface = NULL;
-    SDL_Texture* loaded_texture = NULL;
-    int width = 0;
-    int height = 0;
-    int return_code = 0;
-
-    ASSERT(texture != NULL, return -1;, "Argument texture must not be NULL");
-    ASSERT(img_data != NULL, return -1;, "Argument img_data must not be NULL");
-    ASSERT(size > 0, return -1;, "Argument size must be larger than 0");
-    ASSERT(size <= INT_MAX, return -1;, "Argument size must not exceed maximum allowed");
-    ASSERT(renderer != NULL, return -1;, "Argument renderer must not be NULL");
-
-    TRACE("Opening stream to embedded image data");
-    rwops = SDL_RWFromConstMem(img_data, (int)size);
-    ASSERT(rwops != NULL, return -1;, "SDL_RWFromConstMem error=[%s]", SDL_GetError());
-
-    TRACE("Loading surface");
-    loaded_surface = IMG_Load_RW(rwops, 1);
-    ASSERT(loaded_surface != NULL, return -1;, "IMG_Load_RW error=[%s]", IMG_GetError());
-
-    width = loaded_surface->w;
-    height = loaded_surface->h;
-    TRACE("Image width=[%d] height=[%d]", width, height);
-
-    // Color key image with cyan
-    if (color_key != NULL) {
-        TRACE("Setting surface color_key=[%02X%02X%02X]", color_key->r, color_key->g, color_key->b);
-        return_code = SDL_SetColorKey(loaded_surface, SDL_TRUE,
-                                      SDL_MapRGB(loaded_surface->format, color_key->r, color_key->g, color_key->b));
-        ASSERT(return_code == 0, SDL_FreeSurface(loaded_surface); return -1;
-               , "SDL_SetColorKey error=[%s]", SDL_GetError());
-    }
-
-    TRACE("Creating texture from surface");
-    loaded_texture = SDL_CreateTextureFromSurface(renderer, loaded_surface);
-    ASSERT(loaded_texture != NULL, SDL_FreeSurface(loaded_surface); return -1;
-           , "SDL_CreateTextureFromSurface error=[%s]", SDL_GetError());
-
-    SDL_FreeSurface(loaded_surface);
-
-    return_code = SDL_SetTextureScaleMode(loaded_texture, SDL_ScaleModeBest);
-    ASSERT(return_code == 0, SDL_DestroyTexture(loaded_texture); return -1;
-           , "SDL_SetTextureScaleMode error=[%s]", SDL_GetError());
-
-    return_code = SDL_SetTextureBlendMode(loaded_texture, SDL_BLENDMODE_BLEND);
-    ASSERT(return_code == 0, SDL_DestroyTexture(loaded_texture); return -1;
-           , "SDL_SetTextureBlendMode error=[%s]", SDL_GetError());
-
-    // Fill return texture
-    if (texture->texture != NULL) {
-        free_texture(texture);
-    }
-    texture->texture = loaded_texture;
-    texture->width = width;
-    texture->height = height;
-    return 0;
-}
-
-void free_texture(struct sdl_texture* texture) {
-    ASSERT(texture != NULL, return;, "Argument texture must not be NULL");
-
-    if (texture->texture != NULL) {
-        TRACE("Destroying texture");
-        SDL_DestroyTexture(texture->texture);
-        texture->texture = NULL;
-    }
-    texture->width = 0;
-    texture->height = 0;
+int get_car_pose(const double t, const double angle_offset, const double radius, int* pos_x, int* pos_y,
+                 int* sprite_index, SDL_RendererFlip* flip);
+int get_animation_state(const double t, struct car_state* car_state);
 
-    return;
-}
-
-int render_texture(const struct sdl_texture texture, SDL_Renderer* renderer, int x, int y, const SDL_Rect* clip,
-                   const double angle, const SDL_Point* center, const SDL_RendererFlip flip) {
-    int return_code = 0;
-    SDL_Rect source_rect;
-    SDL_Rect destination_rect;
-
-    ASSERT(texture.texture != NULL, return -1;, "Argument texture.texture must not be NULL");
-    ASSERT(renderer != NULL, return -1;, "Argument renderer must not be NULL");
-
-    source_rect = (SDL_Rect){0, 0, texture.width, texture.height};
-    destination_rect = (SDL_Rect){x, y, texture.width, texture.height};
+int parse_stress_arguments(int argc, char** argv, struct stress_mode* stress);
+int render_stress_racers(const struct sdl_system system, const struct sdl_data data, const struct stress_mode stress,
+                         const double t, struct sprite_batch* batch);
 
-    if (clip != NULL) {
-        source_rect.x = clip->x;
-        source_rect.y = clip->y;
-        source_rect.w = clip->w;
-        source_rect.h = clip->h;
-        destination_rect.w = clip->w;
-        destination_rect.h = clip->h;
-    }
-
-    return_code = SDL_RenderCopyEx(renderer, texture.texture, &source_rect, &destination_rect, angle, center, flip);
-    ASSERT(return_code == 0, return -1;, "SDL_RenderCopyEx error=[%s]", SDL_GetError());
-
-    return 0;
-}
+int main_loop(const struct sdl_system system, const struct sdl_data data, const struct stress_mode stress,
+              struct sprite_batch* batch);
+int main(int argc, char** argv);
 
 int load_media(struct sdl_data* data, SDL_Renderer* renderer) {
     int return_code = 0;
-    SDL_Color color_key = {.r = 0x93, .g = 0xBB, .b = 0xEC, .a = 0};  // colorkey #93bbec
-
+    struct asset asset;
+    struct asset_loader loader;
     ASSERT(data != NULL, return -1;, "Argument data must not be NULL");
     ASSERT(renderer != NULL, return -1;, "Argument renderer must not be NULL");
 
-    TRACE("Loading texture SNES_F-Zero_Racers");
-    return_code = load_texture_embedded(&(data->snes_fzero_racers), _embed_SNES_F_Zero_Racers_png_start,
-                                        _embed_SNES_F_Zero_Racers_png_size, renderer, &color_key);
-    ASSERT(return_code == 0, return -1;, "load_texture_embedded error");
-
-    data->blue_falcon_clips[0] = (SDL_Rect){.x = 1, .y = 18, .w = 48, .h = 32};
-    data->blue_falcon_clips[1] = (SDL_Rect){.x = 50, .y = 18, .w = 48, .h = 32};
-    data->blue_falcon_clips[2] = (SDL_Rect){.x = 99, .y = 18, .w = 48, .h = 32};
-    data->blue_falcon_clips[3] = (SDL_Rect){.x = 148, .y = 18, .w = 48, .h = 32};
-    data->blue_falcon_clips[4] = (SDL_Rect){.x = 197, .y = 18, .w = 48, .h = 32};
-    data->blue_falcon_clips[5] = (SDL_Rect){.x = 246, .y = 18, .w = 48, .h = 32};
-    data->blue_falcon_clips[6] = (SDL_Rect){.x = 295, .y = 18, .w = 48, .h = 32};
-    data->blue_falcon_clips[7] = (SDL_Rect){.x = 344, .y = 18, .w = 48, .h = 32};
-    data->blue_falcon_clips[8] = (SDL_Rect){.x = 393, .y = 18, .w = 48, .h = 32};
-    data->blue_falcon_clips[9] = (SDL_Rect){.x = 442, .y = 18, .w = 48, .h = 32};
-    data->blue_falcon_clips[10] = (SDL_Rect){.x = 491, .y = 18, .w = 48, .h = 32};
-    data->blue_falcon_clips[11] = (SDL_Rect){.x = 540, .y = 18, .w = 48, .h = 32};
-    data->blue_falcon_clips[12] = (SDL_Rect){.x = 589, .y = 18, .w = 48, .h = 32};
-
-    data->golden_fox_clips[0] = (SDL_Rect){.x = 1, .y = 324, .w = 48, .h = 32};
-    data->golden_fox_clips[1] = (SDL_Rect){.x = 50, .y = 324, .w = 48, .h = 32};
-    data->golden_fox_clips[2] = (SDL_Rect){.x = 99, .y = 324, .w = 48, .h = 32};
-    data->golden_fox_clips[3] = (SDL_Rect){.x = 148, .y = 324, .w = 48, .h = 32};
-    data->golden_fox_clips[4] = (SDL_Rect){.x = 197, .y = 324, .w = 48, .h = 32};
-    data->golden_fox_clips[5] = (SDL_Rect){.x = 246, .y = 324, .w = 48, .h = 32};
-    data->golden_fox_clips[6] = (SDL_Rect){.x = 295, .y = 324, .w = 48, .h = 32};
-    data->golden_fox_clips[7] = (SDL_Rect){.x = 344, .y = 324, .w = 48, .h = 32};
-    data->golden_fox_clips[8] = (SDL_Rect){.x = 393, .y = 324, .w = 48, .h = 32};
-    data->golden_fox_clips[9] = (SDL_Rect){.x = 442, .y = 324, .w = 48, .h = 32};
-    data->golden_fox_clips[10] = (SDL_Rect){.x = 491, .y = 324, .w = 48, .h = 32};
-    data->golden_fox_clips[11] = (SDL_Rect){.x = 540, .y = 324, .w = 48, .h = 32};
-    data->golden_fox_clips[12] = (SDL_Rect){.x = 589, .y = 324, .w = 48, .h = 32};
-
-    data->wild_goose_clips[0] = (SDL_Rect){.x = 1, .y = 642, .w = 48, .h = 32};
-    data->wild_goose_clips[1] = (SDL_Rect){.x = 50, .y = 642, .w = 48, .h = 32};
-    data->wild_goose_clips[2] = (SDL_Rect){.x = 99, .y = 642, .w = 48, .h = 32};
-    data->wild_goose_clips[3] = (SDL_Rect){.x = 148, .y = 642, .w = 48, .h = 32};
-    data->wild_goose_clips[4] = (SDL_Rect){.x = 197, .y = 642, .w = 48, .h = 32};
-    data->wild_goose_clips[5] = (SDL_Rect){.x = 246, .y = 642, .w = 48, .h = 32};
-    data->wild_goose_clips[6] = (SDL_Rect){.x = 295, .y = 642, .w = 48, .h = 32};
-    data->wild_goose_clips[7] = (SDL_Rect){.x = 344, .y = 642, .w = 48, .h = 32};
-    data->wild_goose_clips[8] = (SDL_Rect){.x = 393, .y = 642, .w = 48, .h = 32};
-    data->wild_goose_clips[9] = (SDL_Rect){.x = 442, .y = 642, .w = 48, .h = 32};
-    data->wild_goose_clips[10] = (SDL_Rect){.x = 491, .y = 642, .w = 48, .h = 32};
-    data->wild_goose_clips[11] = (SDL_Rect){.x = 540, .y = 642, .w = 48, .h = 32};
-    data->wild_goose_clips[12] = (SDL_Rect){.x = 589, .y = 642, .w = 48, .h = 32};
-
-    data->fire_stingray_clips[0] = (SDL_Rect){.x = 1, .y = 945, .w = 48, .h = 32};
-    data->fire_stingray_clips[1] = (SDL_Rect){.x = 50, .y = 945, .w = 48, .h = 32};
-    data->fire_stingray_clips[2] = (SDL_Rect){.x = 99, .y = 945, .w = 48, .h = 32};
-    data->fire_stingray_clips[3] = (SDL_Rect){.x = 148, .y = 945, .w = 48, .h = 32};
-    data->fire_stingray_clips[4] = (SDL_Rect){.x = 197, .y = 945, .w = 48, .h = 32};
-    data->fire_stingray_clips[5] = (SDL_Rect){.x = 246, .y = 945, .w = 48, .h = 32};
-    data->fire_stingray_clips[6] = (SDL_Rect){.x = 295, .y = 945, .w = 48, .h = 32};
-    data->fire_stingray_clips[7] = (SDL_Rect){.x = 344, .y = 945, .w = 48, .h = 32};
-    data->fire_stingray_clips[8] = (SDL_Rect){.x = 393, .y = 945, .w = 48, .h = 32};
-    data->fire_stingray_clips[9] = (SDL_Rect){.x = 442, .y = 945, .w = 48, .h = 32};
-    data->fire_stingray_clips[10] = (SDL_Rect){.x = 491, .y = 945, .w = 48, .h = 32};
-    data->fire_stingray_clips[11] = (SDL_Rect){.x = 540, .y = 945, .w = 48, .h = 32};
-    data->fire_stingray_clips[12] = (SDL_Rect){.x = 589, .y = 945, .w = 48, .h = 32};
-
-    data->snail_clips[0] = (SDL_Rect){.x = 1, .y = 1247, .w = 48, .h = 32};
-    data->snail_clips[1] = (SDL_Rect){.x = 50, .y = 1247, .w = 48, .h = 32};
-    data->snail_clips[2] = (SDL_Rect){.x = 99, .y = 1247, .w = 48, .h = 32};
-    data->snail_clips[3] = (SDL_Rect){.x = 148, .y = 1247, .w = 48, .h = 32};
-    data->snail_clips[4] = (SDL_Rect){.x = 197, .y = 1247, .w = 48, .h = 32};
-    data->snail_clips[5] = (SDL_Rect){.x = 246, .y = 1247, .w = 48, .h = 32};
-    data->snail_clips[6] = (SDL_Rect){.x = 295, .y = 1247, .w = 48, .h = 32};
-    data->snail_clips[7] = (SDL_Rect){.x = 344, .y = 1247, .w = 48, .h = 32};
-    data->snail_clips[8] = (SDL_Rect){.x = 393, .y = 1247, .w = 48, .h = 32};
-    data->snail_clips[9] = (SDL_Rect){.x = 442, .y = 1247, .w = 48, .h = 32};
-    data->snail_clips[10] = (SDL_Rect){.x = 491, .y = 1247, .w = 48, .h = 32};
-    data->snail_clips[11] = (SDL_Rect){.x = 540, .y = 1247, .w = 48, .h = 32};
-    data->snail_clips[12] = (SDL_Rect){.x = 589, .y = 1247, .w = 48, .h = 32};
+    TRACE("Opening asset pack");
+    return_code = load_asset_pack(&(data->pack), _embed_15_rotation_and_flipping_pack_start,
+                                  _embed_15_rotation_and_flipping_pack_size);
+    ASSERT(return_code == 0, return -1;, "load_asset_pack error");
+
+    // Textures go through the cache, so loading the sheet again is a lookup, see texture_cache.h
+    return_code = create_texture_cache(&(data->cache), renderer, TEXTURE_CACHE_CAPACITY, TEXTURE_CACHE_BUDGET);
+    ASSERT(return_code == 0, return -1;, "create_texture_cache error");
+
+    // Decode on worker threads while a loading screen is presented, see asset_loader.h
+    return_code = create_asset_loader(&loader, 0);
+    ASSERT(return_code == 0, return -1;, "create_asset_loader error");
+    set_asset_loader_cache(&loader, &(data->cache));
+
+    TRACE("Queueing texture SNES_F-Zero_Racers");
+    return_code = find_asset(&(data->pack), "SNES_F-Zero_Racers.png.raw", &asset);
+    ASSERT(return_code == 0, destroy_asset_loader(&loader); return -1;, "find_asset error");
+    // Color key #93bbec was made transparent at build time, see RAW_COLOR_KEY in the makefile
+    return_code = queue_texture_raw(&loader, &(data->snes_fzero_racers), asset.data, asset.size);
+    ASSERT(return_code == 0, destroy_asset_loader(&loader); return -1;, "queue_texture_raw error");
+
+    return_code = run_loading_screen(&loader, renderer);
+    ASSERT(return_code == 0, destroy_asset_loader(&loader); return -1;, "run_loading_screen error");
+    destroy_asset_loader(&loader);
+
+    data->blue_falcon_clips = _sheet_SNES_F_Zero_Racers_blue_falcon;
+    data->golden_fox_clips = _sheet_SNES_F_Zero_Racers_golden_fox;
+    data->wild_goose_clips = _sheet_SNES_F_Zero_Racers_wild_goose;
+    data->fire_stingray_clips = _sheet_SNES_F_Zero_Racers_fire_stingray;
+    data->snail_clips = _sheet_SNES_F_Zero_Racers_snail;
 
     return 0;
 }
@@ -309,14 +119,20 @@ int load_media(struct sdl_data* data, SDL_Renderer* renderer) {
 void free_media(struct sdl_data* data) {
     ASSERT(data != NULL, return;, "Argument data must not be NULL");
 
-    TRACE("Destroying texture SNES_F-Zero_Racers");
-    free_texture(&(data->snes_fzero_racers));
+    TRACE("Releasing texture SNES_F-Zero_Racers");
+    if (data->cache.entries != NULL) {
+        release_texture(&(data->cache), &(data->snes_fzero_racers));
+    }
+    destroy_texture_cache(&(data->cache));
+
+    data->blue_falcon_clips = NULL;
+    data->golden_fox_clips = NULL;
+    data->wild_goose_clips = NULL;
+    data->fire_stingray_clips = NULL;
+    data->snail_clips = NULL;
 
-    memset(data->blue_falcon_clips, 0, sizeof(data->blue_falcon_clips));
-    memset(data->golden_fox_clips, 0, sizeof(data->golden_fox_clips));
-    memset(data->wild_goose_clips, 0, sizeof(data->wild_goose_clips));
-    memset(data->fire_stingray_clips, 0, sizeof(data->fire_stingray_clips));
-    memset(data->snail_clips, 0, sizeof(data->snail_clips));
+    TRACE("Closing asset pack");
+    close_asset_pack(&(data->pack));
 
     return;
 }
@@ -381,185 +197,292 @@ int get_car_heading_index(const double heading_angle, int* index, SDL_RendererFl
     return 0;
 }
 
-int get_animation_state(const struct timespec* start_time, struct car_state* car_state) {
+int get_car_pose(const double t, const double angle_offset, const double radius, int* pos_x, int* pos_y,
+                 int* sprite_index, SDL_RendererFlip* flip) {
     int return_code = 0;
-    int error_num = 0;
+    double heading_x;
+    double heading_y;
+    double heading_angle;
 
-    const double duration = 6.0;
-    const double radius = 160.0;
     const int center_x = 320;
     const int center_y = 240;
     const int sprite_offset_x = 24;
     const int sprite_offset_y = 16;
 
-    struct timespec current_time;
-    double seconds = 0;
-    double t = 0;
-    int counter = 0;
+    ASSERT(pos_x != NULL, return -1;, "Argument pos_x must not be NULL");
+    ASSERT(pos_y != NULL, return -1;, "Argument pos_y must not be NULL");
+    ASSERT(sprite_index != NULL, return -1;, "Argument sprite_index must not be NULL");
+    ASSERT(flip != NULL, return -1;, "Argument flip must not be NULL");
 
-    ASSERT(start_time != NULL, return -1;, "Argument start_time must not be NULL");
-    ASSERT(car_state != NULL, return -1;, "Argument car_state must not be NULL");
+    // car position
+    *pos_x = (int)lround(radius * cos(t * 2.0 * M_PI + angle_offset) + center_x - sprite_offset_x);
+    *pos_y = (int)lround(radius * sin(t * 2.0 * M_PI + angle_offset) + center_y - sprite_offset_y);
+
+    // car velocity heading (derivatives)
+    heading_x = -sin(t * 2.0 * M_PI + angle_offset);
+    heading_y = cos(t * 2.0 * M_PI + angle_offset);
+
+    // heading angle (velocity direction)
+    // math coordinates Y+ goes up, SDL coordinates Y+ goes down.
+    heading_angle = atan2(-heading_y, heading_x) * (180.0 / M_PI);
+
+    return_code = get_car_heading_index(heading_angle, sprite_index, flip);
+    ASSERT(return_code == 0, return -1;, "get_car_heading_index error");
+
+    return 0;
+}
+
+int get_animation_state(const double t, struct car_state* car_state) {
+    TRACE_SPAN("get_animation_state");
+    int return_code = 0;
 
-    // Get current time
-    return_code = clock_gettime(CLOCK_MONOTONIC, &current_time);
-    error_num = errno;
-    ASSERT(return_code == 0, return -1;, "clock_gettime error=[%s]", strerror(error_num));
+    const double radius = 160.0;
 
-    seconds = (double)(current_time.tv_sec - start_time->tv_sec) +
-              ((double)(current_time.tv_nsec - start_time->tv_nsec) / 1000000000.0);
-    seconds = fmod(seconds, duration);
-    t = seconds / duration;
+    int counter = 0;
+
+    ASSERT(car_state != NULL, return -1;, "Argument car_state must not be NULL");
+    ASSERT(t >= 0.0 && t < 1.0, return -1;, "Argument t=[%f] must be between 0 and 1", t);
 
     for (counter = 0; counter < 5; counter++) {
-        double angle_offset = ((double)counter * 2.0 * M_PI) / 5.0;
-        double heading_x;
-        double heading_y;
-        double heading_angle;
-
-        // car position
-        car_state->pos_x[counter] =
-            (int)lround(radius * cos(t * 2.0 * M_PI + angle_offset) + center_x - sprite_offset_x);
-        car_state->pos_y[counter] =
-            (int)lround(radius * sin(t * 2.0 * M_PI + angle_offset) + center_y - sprite_offset_y);
-
-        // car velocity heading (derivatives)
-        heading_x = -sin(t * 2.0 * M_PI + angle_offset);
-        heading_y = cos(t * 2.0 * M_PI + angle_offset);
-
-        // heading angle (velocity direction)
-        // math coordinates Y+ goes up, SDL coordinates Y+ goes down.
-        heading_angle = atan2(-heading_y, heading_x) * (180.0 / M_PI);
-
-        return_code =
-            get_car_heading_index(heading_angle, &car_state->sprite_index[counter], &car_state->flip[counter]);
-        ASSERT(return_code == 0, return -1;, "get_car_heading_index error");
+        const double angle_offset = ((double)counter * 2.0 * M_PI) / 5.0;
+
+        return_code = get_car_pose(t, angle_offset, radius, &car_state->pos_x[counter], &car_state->pos_y[counter],
+                                   &car_state->sprite_index[counter], &car_state->flip[counter]);
+        ASSERT(return_code == 0, return -1;, "get_car_pose error");
     }
     car_state->angle = t * 360.0;
+    car_state->t = t;
+
+    return 0;
+}
 
+int parse_stress_arguments(int argc, char** argv, struct stress_mode* stress) {
+    int index = 0;
+
+    ASSERT(argv != NULL, return -1;, "Argument argv must not be NULL");
+    ASSERT(stress != NULL, return -1;, "Argument stress must not be NULL");
+
+    stress->racers = 0;
+    stress->unbatched = false;
+
+    for (index = 1; index < argc; index++) {
+        if (strcmp(argv[index], "--unbatched") == 0) {
+            stress->unbatched = true;
+        } else if (strcmp(argv[index], "--racers") == 0) {
+            char* end = NULL;
+            long racers = 0;
+
+            ASSERT(index + 1 < argc, return -1;, "Usage: %s --racers <count> [--unbatched]", argv[0]);
+            index++;
+            errno = 0;
+            racers = strtol(argv[index], &end, 10);
+            ASSERT(errno == 0 && end != argv[index] && *end == '\0', return -1;
+                   , "Invalid racer count=[%s]", argv[index]);
+            ASSERT(racers >= STRESS_MIN_RACERS && racers <= STRESS_MAX_RACERS, return -1;
+                   , "Racer count=[%ld] must be between %d and %d", racers, STRESS_MIN_RACERS, STRESS_MAX_RACERS);
+            stress->racers = (int)racers;
+        }
+    }
+
+    ASSERT(stress->unbatched == false || stress->racers > 0, return -1;, "--unbatched requires --racers <count>");
+
+    if (stress->racers > 0) {
+        TRACE("Stress mode racers=[%d] unbatched=[%d]", stress->racers, (int)stress->unbatched);
+    }
     return 0;
 }
 
-int handle_events(bool* quit) {
-    SDL_Event event_buffer;
+int render_stress_racers(const struct sdl_system system, const struct sdl_data data, const struct stress_mode stress,
+                         const double t, struct sprite_batch* batch) {
+    TRACE_SPAN("render_stress_racers");
     int return_code = 0;
+    int racer = 0;
+    const SDL_Rect* clips[5] = {data.blue_falcon_clips, data.golden_fox_clips, data.wild_goose_clips,
+                                data.fire_stingray_clips, data.snail_clips};
 
-    ASSERT(quit != NULL, return -1;, "Argument quit must not be NULL");
+    ASSERT(batch != NULL, return -1;, "Argument batch must not be NULL");
+    ASSERT(stress.racers > 0, return -1;, "Argument stress.racers must be larger than 0");
 
-    do {
-        return_code = SDL_PollEvent(&event_buffer);
-        ASSERT(return_code >= 0, return -1;, "SDL_PollEvent error=[%s]", SDL_GetError());
+    if (stress.unbatched == false) {
+        return_code = begin_sprite_batch(batch, system.renderer, data.snes_fzero_racers);
+        ASSERT(return_code == 0, return -1;, "begin_sprite_batch error");
+    }
 
-        if (return_code == 0) {
-            break;
+    // Racers spread over concentric laps, each one a little ahead of the previous
+    for (racer = 0; racer < stress.racers; racer++) {
+        const double angle_offset = ((double)racer * 2.0 * M_PI) / (double)stress.racers;
+        const double radius = 20.0 + (double)((racer * 37) % 200);
+        const SDL_Rect* clip = NULL;
+        int pos_x = 0;
+        int pos_y = 0;
+        int sprite_index = 0;
+        SDL_RendererFlip flip = SDL_FLIP_NONE;
+
+        return_code = get_car_pose(t, angle_offset, radius, &pos_x, &pos_y, &sprite_index, &flip);
+        ASSERT(return_code == 0, return -1;, "get_car_pose error");
+
+        clip = &clips[racer % 5][sprite_index];
+        if (stress.unbatched == true) {
+            return_code = render_texture(data.snes_fzero_racers, system.renderer, pos_x, pos_y, clip, 0.0, NULL, flip);
+            ASSERT(return_code == 0, return -1;, "render_texture error");
+        } else {
+            return_code = add_sprite(batch, clip, &(SDL_Rect){pos_x, pos_y, clip->w, clip->h}, 0.0, NULL, flip);
+            ASSERT(return_code == 0, return -1;, "add_sprite error");
         }
-        switch (event_buffer.type) {
-            case SDL_QUIT: {
-                TRACE("Quit");
-                *quit = true;
-                break;
-            }
-            case SDL_KEYDOWN: {
-                break;
-            }
-            default: {
-                break;
-            }
-        }
-    } while (return_code == 1);
+    }
+
+    return_code = flush_sprite_batch(batch);
+    ASSERT(return_code == 0, return -1;, "flush_sprite_batch error");
 
     return 0;
 }
 
-int main_loop(const struct sdl_system system, const struct sdl_data data) {
+int main_loop(const struct sdl_system system, const struct sdl_data data, const struct stress_mode stress,
+              struct sprite_batch* batch) {
+    TRACE_SPAN("main_loop");
+    struct trace_span present_span;
     int return_code = 0;
-    int error_num = 0;
     bool quit = false;
+    struct frame_loop loop;
 
-    struct timespec start_time;
     struct car_state car_state = {0};
+    const int64_t lap_ns = 6000000000LL;
+    double previous_t = 0;
+    double current_t = 0;
+    double t = 0;
     const SDL_Point sprite_center = {.x = 24, .y = 16};
+    const SDL_Rect* clips[5] = {data.blue_falcon_clips, data.golden_fox_clips, data.wild_goose_clips,
+                                data.fire_stingray_clips, data.snail_clips};
 
     ASSERT(system.renderer != NULL, return -1;, "Argument system.renderer must not be NULL");
-
-    return_code = clock_gettime(CLOCK_MONOTONIC, &start_time);
-    error_num = errno;
-    ASSERT(return_code == 0, return -1;, "clock_gettime error=[%s]", strerror(error_num));
+    ASSERT(batch != NULL, return -1;, "Argument batch must not be NULL");
 
     // Set renderer color
     return_code = SDL_SetRenderDrawColor(system.renderer, 0x00, 0x80, 0x80, 0xFF);
     ASSERT(return_code == 0, return -1;, "SDL_SetRenderDrawColor error=[%s]", SDL_GetError());
 
+    return_code = start_bench();
+    ASSERT(return_code == 0, return -1;, "start_bench error");
+
+    return_code = start_frame_loop(&loop, 60);
+    ASSERT(return_code == 0, return -1;, "start_frame_loop error");
+
     TRACE("Main loop start");
     while (quit == false) {
+        TRACE_SPAN("frame");
+
+        return_code = begin_loop_frame(&loop);
+        ASSERT(return_code == 0, return -1;, "begin_loop_frame error");
+
+        // Each update moves the racers one step along the lap, keeping the previous progress to blend from
+        while (next_loop_update(&loop) == true) {
+            previous_t = current_t;
+            current_t = (double)(loop.time_ns % lap_ns) / (double)lap_ns;
+        }
+
         // Clear screen
         return_code = SDL_RenderClear(system.renderer);
         ASSERT(return_code == 0, return -1;, "SDL_RenderClear error=[%s]", SDL_GetError());
 
-        return_code = get_animation_state(&start_time, &car_state);
+        // Draw between the last two updates, across the start line when the lap wrapped
+        t = current_t - previous_t;
+        if (t < 0.0) {
+            t += 1.0;
+        }
+        t = fmod(previous_t + get_loop_alpha(&loop) * t, 1.0);
+        return_code = get_animation_state(t, &car_state);
         ASSERT(return_code == 0, return -1;, "get_animation_state error");
 
-        // Render textures
-        return_code = render_texture(data.snes_fzero_racers, system.renderer, car_state.pos_x[0], car_state.pos_y[0],
-                                     &data.blue_falcon_clips[car_state.sprite_index[0]], 0.0, NULL, car_state.flip[0]);
-        ASSERT(return_code == 0, return -1;, "render_texture error");
+        if (stress.racers > 0) {
+            return_code = render_stress_racers(system, data, stress, car_state.t, batch);
+            ASSERT(return_code == 0, return -1;, "render_stress_racers error");
+        } else {
+            // Render textures, all six sprites sample the same texture and go out in one batch
+            return_code = begin_sprite_batch(batch, system.renderer, data.snes_fzero_racers);
+            ASSERT(return_code == 0, return -1;, "begin_sprite_batch error");
 
-        return_code = render_texture(data.snes_fzero_racers, system.renderer, car_state.pos_x[1], car_state.pos_y[1],
-                                     &data.golden_fox_clips[car_state.sprite_index[1]], 0.0, NULL, car_state.flip[1]);
-        ASSERT(return_code == 0, return -1;, "render_texture error");
+            for (int car = 0; car < 5; car++) {
+                const SDL_Rect* clip = &clips[car][car_state.sprite_index[car]];
+                const SDL_Rect destination = {car_state.pos_x[car], car_state.pos_y[car], clip->w, clip->h};
 
-        return_code = render_texture(data.snes_fzero_racers, system.renderer, car_state.pos_x[2], car_state.pos_y[2],
-                                     &data.wild_goose_clips[car_state.sprite_index[2]], 0.0, NULL, car_state.flip[2]);
-        ASSERT(return_code == 0, return -1;, "render_texture error");
-
-        return_code =
-            render_texture(data.snes_fzero_racers, system.renderer, car_state.pos_x[3], car_state.pos_y[3],
-                           &data.fire_stingray_clips[car_state.sprite_index[3]], 0.0, NULL, car_state.flip[3]);
-        ASSERT(return_code == 0, return -1;, "render_texture error");
+                return_code = add_sprite(batch, clip, &destination, 0.0, NULL, car_state.flip[car]);
+                ASSERT(return_code == 0, return -1;, "add_sprite error");
+            }
 
-        return_code = render_texture(data.snes_fzero_racers, system.renderer, car_state.pos_x[4], car_state.pos_y[4],
-                                     &data.snail_clips[car_state.sprite_index[4]], 0.0, NULL, car_state.flip[4]);
-        ASSERT(return_code == 0, return -1;, "render_texture error");
+            return_code = add_sprite(batch, &data.blue_falcon_clips[0], &(SDL_Rect){296, 224, 48, 32},
+                                     car_state.angle, &sprite_center, SDL_FLIP_NONE);
+            ASSERT(return_code == 0, return -1;, "add_sprite error");
 
-        return_code = render_texture(data.snes_fzero_racers, system.renderer, 296, 224, &data.blue_falcon_clips[0],
-                                     car_state.angle, &sprite_center, 0);
-        ASSERT(return_code == 0, return -1;, "render_texture error");
+            return_code = flush_sprite_batch(batch);
+            ASSERT(return_code == 0, return -1;, "flush_sprite_batch error");
+        }
 
         // Update screen
+        TRACE_SPAN_BEGIN(present_span, "SDL_RenderPresent");
         SDL_RenderPresent(system.renderer);
+        TRACE_SPAN_END(present_span);
 
         // Poll for currently pending events
-        return_code = handle_events(&quit);
+        return_code = handle_events(&quit, NULL, NULL);
         ASSERT(return_code == 0, return -1;, "handle_events error");
 
-        // sleep
-        // nanosleep(&(struct timespec){.tv_sec = 0, .tv_nsec = (1000000000 / 60)}, NULL);
+        // Benchmark frame time, quits after the requested number of frames
+        return_code = record_bench_frame(&quit);
+        ASSERT(return_code == 0, return -1;, "record_bench_frame error");
     }
     return 0;
 }
 
 int main(int argc, char** argv) {
     int return_code = 0;
+    const char* spans_path = NULL;
     struct sdl_system system = {0};
     struct sdl_data data = {0};
+    struct stress_mode stress = {0};
+    struct sprite_batch batch = {0};
 
     TRACE("start");
 
     // Command line
     TRACE("argc=[%d]", argc);
     for (int i = 0; i < argc; i++) {
-        TRACE("argv[%d]=[%s]", i, argv[i]);
+        TRACE_DEBUG("argv[%d]=[%s]", i, argv[i]);
+    }
+
+    // Benchmark mode, see bench.h
+    return_code = parse_bench_arguments(argc, argv);
+    ASSERT(return_code == 0, return -1;, "parse_bench_arguments error");
+
+    // Stress mode, see struct stress_mode
+    return_code = parse_stress_arguments(argc, argv, &stress);
+    ASSERT(return_code == 0, return -1;, "parse_stress_arguments error");
+
+    // Timeline spans, saved as Chrome trace-event JSON when TRACE_SPANS names an output file
+    spans_path = getenv("TRACE_SPANS");
+    if (spans_path != NULL) {
+        return_code = start_trace_spans();
+        ASSERT(return_code == 0, return -1;, "start_trace_spans error");
     }
 
     TRACE("Initializing");
-    return_code = init_SDL(&system);
+    return_code = init_SDL(&system, "SDL Tutorial 15 - Rotation and Flipping",
+                           SDL_RENDERER_ACCELERATED | SDL_RENDERER_PRESENTVSYNC);
     ASSERT(return_code == 0, close_SDL(&system); return -1;, "init_SDL error");
 
     TRACE("Loading media");
     return_code = load_media(&data, system.renderer);
     ASSERT(return_code == 0, free_media(&data); close_SDL(&system); return -1;, "load_media error");
 
-    return_code = main_loop(system, data);
-    ASSERT(return_code == 0, free_media(&data); close_SDL(&system); return -1;, "main_loop error");
+    // Six sprites for the demo scene, every racer in one draw call for the stress mode
+    return_code = create_sprite_batch(&batch, (stress.racers > 0) ? stress.racers : 6);
+    ASSERT(return_code == 0, free_media(&data); close_SDL(&system); return -1;, "create_sprite_batch error");
+
+    return_code = main_loop(system, data, stress, &batch);
+    ASSERT(return_code == 0, destroy_sprite_batch(&batch); free_media(&data); close_SDL(&system); return -1;
+           , "main_loop error");
+
+    TRACE("Freeing sprite batch");
+    destroy_sprite_batch(&batch);
 
     TRACE("Freeing media");
     free_media(&data);
@@ -567,6 +490,16 @@ int main(int argc, char** argv) {
     TRACE("Closing");
     close_SDL(&system);
 
+    return_code = write_bench_report();
+    ASSERT(return_code == 0, NO_ACTION, "write_bench_report error");
+
+    if (spans_path != NULL) {
+        TRACE("Writing spans to \"%s\"", spans_path);
+        stop_trace_spans();
+        return_code = write_trace_spans(spans_path);
+        ASSERT(return_code == 0, NO_ACTION, "write_trace_spans error");
+    }
+
     TRACE("end");
     return 0;
 }
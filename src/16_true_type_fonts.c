@@ -1,397 +1,210 @@
 #define _DEFAULT_SOURCE
 
 #include <SDL2/SDL.h>
-#include <SDL2/SDL_image.h>
 #include <SDL2/SDL_ttf.h>
-#include <limits.h>
 #include <math.h>
 #include <stdbool.h>
 #include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
 #include <strings.h>
-#include <time.h>
 
+#include "asset_loader.h"
+#include "asset_pack.h"
 #include "assert.h"
-#include "embed/fonts/NotoSans-Regular.ttf.h"
+#include "bench.h"
+#include "embed/16_true_type_fonts.pack.h"
+#include "frame_loop.h"
+#include "glyph_atlas.h"
+#include "sdf_font.h"
+#include "sdl_common.h"
+#include "sdl_font.h"
+#include "sprite_batch.h"
 #include "trace.h"
 
 #ifndef M_PI
     #define M_PI 3.14159265358979323846
 #endif
 
-struct sdl_texture {
-    SDL_Texture* texture;
-    int width;
-    int height;
-};
-
-struct sdl_system {
-    SDL_Window* window;
-    SDL_Renderer* renderer;
-};
+// Glyph atlas text needs a font per size; --sdf draws every size and angle from one 48 point distance field instead
+#define SDF_BASE_PTSIZE 48
 
 struct sdl_data {
+    struct asset_pack pack;
     TTF_Font* notosans_regular;
-    struct sdl_texture hello_world_texture;
+    TTF_Font* notosans_small;  // not loaded with --sdf
 };
 
-int init_SDL(struct sdl_system* system);
-void close_SDL(struct sdl_system* system);
-
-int load_texture_embedded(struct sdl_texture* texture, const void* img_data, const size_t size, SDL_Renderer* renderer,
-                          const SDL_Color* color_key);
-void free_texture(struct sdl_texture* texture);
-int render_texture(const struct sdl_texture texture, SDL_Renderer* renderer, int x, int y, const SDL_Rect* clip,
-                   const double angle, const SDL_Point* center, const SDL_RendererFlip flip);
+int parse_text_arguments(int argc, char** argv, bool* sdf_mode);
 
-int load_font_embedded(TTF_Font** font, const int ptsize, const void* ttf_data, const size_t size);
-void free_font(TTF_Font** font);
-
-int create_text_texture(struct sdl_texture* texture, const char* text, TTF_Font* font, const SDL_Color color,
-                        SDL_Renderer* renderer);
-
-int load_media(struct sdl_data* data, SDL_Renderer* renderer);
+int load_media(struct sdl_data* data, SDL_Renderer* renderer, const bool sdf_mode);
 void free_media(struct sdl_data* data);
 
-int handle_events(bool* quit);
-int main_loop(const struct sdl_system system, const struct sdl_data data);
+int render_glyph_text(const struct sdl_data data, struct glyph_atlas* atlas, struct sprite_batch* batch,
+                      const SDL_Rect draw_rect, const char* frame_text);
+int render_sdf_text(struct sdf_font* sdf, struct sprite_batch* batch, const double phase, const char* frame_text);
+int main_loop(const struct sdl_system system, const struct sdl_data data, struct glyph_atlas* atlas,
+              struct sdf_font* sdf, struct sprite_batch* batch);
 int main(int argc, char** argv);
 
-int init_SDL(struct sdl_system* system) {
-    int return_code = 0;
-    const int SCREEN_WIDTH = 640;
-    const int SCREEN_HEIGHT = 480;
-    const int img_flags = IMG_INIT_PNG;
-
-    ASSERT(system != NULL, return -1;, "Argument system must not be NULL");
-    ASSERT(system->window == NULL, return -1;, "Argument system->window must be NULL before initialization");
-    ASSERT(system->renderer == NULL, return -1;, "Argument system->renderer must be NULL before initialization");
-
-    TRACE("Initializing SDL");
-    return_code = SDL_Init(SDL_INIT_VIDEO);
-    ASSERT(return_code == 0, return -1;, "SDL_Init error=[%s]", SDL_GetError());
-
-    TRACE("Initializing SDL_image");
-    return_code = IMG_Init(img_flags);
-    ASSERT((return_code & img_flags) == img_flags, IMG_Quit(); SDL_Quit(); return -1;
-           , "IMG_Init error=[%s]", IMG_GetError());
-
-    TRACE("Initializing SDL_ttf");
-    return_code = TTF_Init();
-    ASSERT(return_code == 0, TTF_Quit(); IMG_Quit(); SDL_Quit(); return -1;, "TTF_Init error=[%s]", TTF_GetError());
-
-    TRACE("Creating window");
-    system->window = SDL_CreateWindow("SDL Tutorial 16 - True Type Fonts", SDL_WINDOWPOS_UNDEFINED,
-                                      SDL_WINDOWPOS_UNDEFINED, SCREEN_WIDTH, SCREEN_HEIGHT, SDL_WINDOW_SHOWN);
-    ASSERT(system->window != NULL, TTF_Quit(); IMG_Quit(); SDL_Quit(); return -1;
-           , "SDL_CreateWindow error=[%s]", SDL_GetError());
-
-    TRACE("Creating renderer for window");
-    system->renderer = SDL_CreateRenderer(system->window, -1, SDL_RENDERER_ACCELERATED | SDL_RENDERER_PRESENTVSYNC);
-    ASSERT(system->renderer != NULL, close_SDL(system); return -1;, "SDL_CreateRenderer error=[%s]", SDL_GetError());
-
-    return 0;
-}
-
-void close_SDL(struct sdl_system* system) {
-    ASSERT(system != NULL, return;, "Argument system must not be NULL");
-
-    if (system->renderer != NULL) {
-        TRACE("Destroying renderer");
-        SDL_DestroyRenderer(system->renderer);
-        system->renderer = NULL;
-    }
-
-    if (system->window != NULL) {
-        TRACE("Destroying window");
-        SDL_DestroyWindow(system->window);
-        system->window = NULL;
-    }
-
-    TRACE("Quitting SDL_ttf");
-    TTF_Quit();
-
-    TRACE("Quitting SDL_image");
-    IMG_Quit();
-
-    TRACE("Quitting SDL");
-    SDL_Quit();
-    return;
-}
-
-int load_texture_embedded(struct sdl_texture* texture, const void* img_data, const size_t size, SDL_Renderer* renderer,
-                          const SDL_Color* color_key) {
-    SDL_RWops* rwops = NULL;
-    SDL_Surface* loaded_surface = NULL;
-    SDL_Texture* loaded_texture = NULL;
-    int width = 0;
-    int height = 0;
-    int return_code = 0;
+int parse_text_arguments(int argc, char** argv, bool* sdf_mode) {
+    int index = 0;
 
-    ASSERT(texture != NULL, return -1;, "Argument texture must not be NULL");
-    ASSERT(img_data != NULL, return -1;, "Argument img_data must not be NULL");
-    ASSERT(size > 0, return -1;, "Argument size must be larger than 0");
-    ASSERT(size <= INT_MAX, return -1;, "Argument size must not exceed maximum allowed");
-    ASSERT(renderer != NULL, return -1;, "Argument renderer must not be NULL");
+    ASSERT(argv != NULL, return -1;, "Argument argv must not be NULL");
+    ASSERT(sdf_mode != NULL, return -1;, "Argument sdf_mode must not be NULL");
 
-    TRACE("Opening stream to embedded image data");
-    rwops = SDL_RWFromConstMem(img_data, (int)size);
-    ASSERT(rwops != NULL, return -1;, "SDL_RWFromConstMem error=[%s]", SDL_GetError());
-
-    TRACE("Loading surface");
-    loaded_surface = IMG_Load_RW(rwops, 1);
-    ASSERT(loaded_surface != NULL, return -1;, "IMG_Load_RW error=[%s]", IMG_GetError());
-
-    width = loaded_surface->w;
-    height = loaded_surface->h;
-    TRACE("Image width=[%d] height=[%d]", width, height);
-
-    // Color key image with cyan
-    if (color_key != NULL) {
-        TRACE("Setting surface color_key=[%02X%02X%02X]", color_key->r, color_key->g, color_key->b);
-        return_code = SDL_SetColorKey(loaded_surface, SDL_TRUE,
-                                      SDL_MapRGB(loaded_surface->format, color_key->r, color_key->g, color_key->b));
-        ASSERT(return_code == 0, SDL_FreeSurface(loaded_surface); return -1;
-               , "SDL_SetColorKey error=[%s]", SDL_GetError());
+    *sdf_mode = false;
+    for (index = 1; index < argc; index++) {
+        if (strcmp(argv[index], "--sdf") == 0) {
+            *sdf_mode = true;
+        }
     }
 
-    TRACE("Creating texture from surface");
-    loaded_texture = SDL_CreateTextureFromSurface(renderer, loaded_surface);
-    ASSERT(loaded_texture != NULL, SDL_FreeSurface(loaded_surface); return -1;
-           , "SDL_CreateTextureFromSurface error=[%s]", SDL_GetError());
-
-    SDL_FreeSurface(loaded_surface);
-
-    return_code = SDL_SetTextureScaleMode(loaded_texture, SDL_ScaleModeBest);
-    ASSERT(return_code == 0, SDL_DestroyTexture(loaded_texture); return -1;
-           , "SDL_SetTextureScaleMode error=[%s]", SDL_GetError());
-
-    return_code = SDL_SetTextureBlendMode(loaded_texture, SDL_BLENDMODE_BLEND);
-    ASSERT(return_code == 0, SDL_DestroyTexture(loaded_texture); return -1;
-           , "SDL_SetTextureBlendMode error=[%s]", SDL_GetError());
-
-    // Fill return texture
-    if (texture->texture != NULL) {
-        free_texture(texture);
+    if (*sdf_mode == true) {
+        TRACE("Distance field text base_ptsize=[%d]", SDF_BASE_PTSIZE);
     }
-    texture->texture = loaded_texture;
-    texture->width = width;
-    texture->height = height;
     return 0;
 }
 
-void free_texture(struct sdl_texture* texture) {
-    ASSERT(texture != NULL, return;, "Argument texture must not be NULL");
-
-    if (texture->texture != NULL) {
-        TRACE("Destroying texture");
-        SDL_DestroyTexture(texture->texture);
-        texture->texture = NULL;
-    }
-    texture->width = 0;
-    texture->height = 0;
-
-    return;
-}
-
-int render_texture(const struct sdl_texture texture, SDL_Renderer* renderer, int x, int y, const SDL_Rect* clip,
-                   const double angle, const SDL_Point* center, const SDL_RendererFlip flip) {
+int load_media(struct sdl_data* data, SDL_Renderer* renderer, const bool sdf_mode) {
     int return_code = 0;
-    SDL_Rect source_rect;
-    SDL_Rect destination_rect;
+    struct asset asset;
+    struct asset_loader loader;
 
-    ASSERT(texture.texture != NULL, return -1;, "Argument texture.texture must not be NULL");
+    ASSERT(data != NULL, return -1;, "Argument data must not be NULL");
     ASSERT(renderer != NULL, return -1;, "Argument renderer must not be NULL");
-    ASSERT(texture.width > 0, return -1;, "Argument texture.width must be greater than 0");
-    ASSERT(texture.height > 0, return -1;, "Argument texture.height must be greater than 0");
-
-    source_rect = (SDL_Rect){0, 0, texture.width, texture.height};
-    destination_rect = (SDL_Rect){x, y, texture.width, texture.height};
-
-    if (clip != NULL) {
-        source_rect.x = clip->x;
-        source_rect.y = clip->y;
-        source_rect.w = clip->w;
-        source_rect.h = clip->h;
-        destination_rect.w = clip->w;
-        destination_rect.h = clip->h;
+
+    TRACE("Opening asset pack");
+    return_code =
+        load_asset_pack(&(data->pack), _embed_16_true_type_fonts_pack_start, _embed_16_true_type_fonts_pack_size);
+    ASSERT(return_code == 0, return -1;, "load_asset_pack error");
+
+    // Inflate and open the font on a worker thread while a loading screen is presented, see asset_loader.h
+    return_code = create_asset_loader(&loader, 0);
+    ASSERT(return_code == 0, return -1;, "create_asset_loader error");
+
+    TRACE("Queueing font NotoSans-Regular");
+    return_code = find_asset(&(data->pack), "fonts/NotoSans-Regular.ttf", &asset);
+    ASSERT(return_code == 0, destroy_asset_loader(&loader); return -1;, "find_asset error");
+    return_code = queue_font_embedded(&loader, &(data->notosans_regular), (sdf_mode == true) ? SDF_BASE_PTSIZE : 96,
+                                      asset.data, asset.size);
+    ASSERT(return_code == 0, destroy_asset_loader(&loader); return -1;, "queue_font_embedded error");
+    if (sdf_mode == false) {
+        return_code = queue_font_embedded(&loader, &(data->notosans_small), 24, asset.data, asset.size);
+        ASSERT(return_code == 0, destroy_asset_loader(&loader); return -1;, "queue_font_embedded error");
     }
 
-    return_code = SDL_RenderCopyEx(renderer, texture.texture, &source_rect, &destination_rect, angle, center, flip);
-    ASSERT(return_code == 0, return -1;, "SDL_RenderCopyEx error=[%s]", SDL_GetError());
+    return_code = run_loading_screen(&loader, renderer);
+    ASSERT(return_code == 0, destroy_asset_loader(&loader); return -1;, "run_loading_screen error");
+    destroy_asset_loader(&loader);
 
     return 0;
 }
 
-int load_font_embedded(TTF_Font** font, const int ptsize, const void* ttf_data, const size_t size) {
-    SDL_RWops* rwops = NULL;
-    TTF_Font* loaded_font = NULL;
-    // int return_code = 0;
-
-    ASSERT(font != NULL, return -1;, "Argument font must not be NULL");
-    ASSERT(ptsize > 0, return -1;, "Argument ptsize must be larger than 0");
-    ASSERT(ttf_data != NULL, return -1;, "Argument ttf_data must not be NULL");
-    ASSERT(size > 0, return -1;, "Argument size must be larger than 0");
-    ASSERT(size <= INT_MAX, return -1;, "Argument size must not exceed maximum allowed");
-
-    TRACE("Opening stream to embedded font data");
-    rwops = SDL_RWFromConstMem(ttf_data, (int)size);
-    ASSERT(rwops != NULL, return -1;, "SDL_RWFromConstMem error=[%s]", SDL_GetError());
-
-    TRACE("Loading font");
-    loaded_font = TTF_OpenFontRW(rwops, 1, ptsize);
-    ASSERT(loaded_font != NULL, return -1;, "TTF_OpenFontRW error=[%s]", TTF_GetError());
-
-    // Fill return font
-    if (*font != NULL) {
-        free_font(font);
-    }
-    *font = loaded_font;
+void free_media(struct sdl_data* data) {
+    ASSERT(data != NULL, return;, "Argument data must not be NULL");
 
-    return 0;
-}
+    TRACE("Destroying font notosans_regular");
+    free_font(&(data->notosans_regular));
 
-void free_font(TTF_Font** font) {
-    ASSERT(font != NULL, return;, "Argument font must not be NULL");
+    TRACE("Destroying font notosans_small");
+    free_font(&(data->notosans_small));
 
-    if (*font != NULL) {
-        TRACE("Destroying font");
-        TTF_CloseFont(*font);
-        *font = NULL;
-    }
+    TRACE("Closing asset pack");
+    close_asset_pack(&(data->pack));
 
     return;
 }
 
-int create_text_texture(struct sdl_texture* texture, const char* text, TTF_Font* font, const SDL_Color color,
-                        SDL_Renderer* renderer) {
-    SDL_Surface* loaded_surface = NULL;
-    SDL_Texture* loaded_texture = NULL;
-    int width = 0;
-    int height = 0;
+int render_glyph_text(const struct sdl_data data, struct glyph_atlas* atlas, struct sprite_batch* batch,
+                      const SDL_Rect draw_rect, const char* frame_text) {
     int return_code = 0;
 
-    ASSERT(texture != NULL, return -1;, "Argument texture must not be NULL");
-    ASSERT(text != NULL, return -1;, "Argument text must not be NULL");
-    ASSERT(font != NULL, return -1;, "Argument font must not be NULL");
-    ASSERT(renderer != NULL, return -1;, "Argument renderer must not be NULL");
-
-    TRACE("Loading surface");
-    loaded_surface = TTF_RenderText_Blended(font, text, color);
-    ASSERT(loaded_surface != NULL, return -1;, "TTF_RenderText_Blended error=[%s]", TTF_GetError());
-
-    width = loaded_surface->w;
-    height = loaded_surface->h;
-    TRACE("Image width=[%d] height=[%d]", width, height);
-
-    TRACE("Creating texture from surface");
-    loaded_texture = SDL_CreateTextureFromSurface(renderer, loaded_surface);
-    ASSERT(loaded_texture != NULL, SDL_FreeSurface(loaded_surface); return -1;
-           , "SDL_CreateTextureFromSurface error=[%s]", SDL_GetError());
-
-    SDL_FreeSurface(loaded_surface);
-
-    return_code = SDL_SetTextureScaleMode(loaded_texture, SDL_ScaleModeBest);
-    ASSERT(return_code == 0, SDL_DestroyTexture(loaded_texture); return -1;
-           , "SDL_SetTextureScaleMode error=[%s]", SDL_GetError());
-
-    return_code = SDL_SetTextureBlendMode(loaded_texture, SDL_BLENDMODE_BLEND);
-    ASSERT(return_code == 0, SDL_DestroyTexture(loaded_texture); return -1;
-           , "SDL_SetTextureBlendMode error=[%s]", SDL_GetError());
+    ASSERT(data.notosans_small != NULL, return -1;, "Argument data.notosans_small must not be NULL");
+    ASSERT(atlas != NULL, return -1;, "Argument atlas must not be NULL");
 
-    // Fill return texture
-    if (texture->texture != NULL) {
-        free_texture(texture);
-    }
-    texture->texture = loaded_texture;
-    texture->width = width;
-    texture->height = height;
+    return_code = draw_glyph_text(atlas, batch, data.notosans_regular, "Hello, World!", draw_rect.x, draw_rect.y,
+                                  (SDL_Color){0x00, 0x00, 0x00, 0xFF});
+    ASSERT(return_code == 0, return -1;, "draw_glyph_text error");
+    return_code = draw_glyph_text(atlas, batch, data.notosans_small, frame_text, 8, 8,
+                                  (SDL_Color){0xFF, 0xFF, 0xFF, 0xFF});
+    ASSERT(return_code == 0, return -1;, "draw_glyph_text error");
 
     return 0;
 }
 
-int load_media(struct sdl_data* data, SDL_Renderer* renderer) {
+int render_sdf_text(struct sdf_font* sdf, struct sprite_batch* batch, const double phase, const char* frame_text) {
+    const double angle = fmod(phase * 30.0, 360.0);
+    const float scale = 1.5f + 0.5f * (float)sin(phase * (M_PI / 2.0));
+    float width = 0.0f;
+    float height = 0.0f;
     int return_code = 0;
 
-    ASSERT(data != NULL, return -1;, "Argument data must not be NULL");
-    ASSERT(renderer != NULL, return -1;, "Argument renderer must not be NULL");
-
-    TRACE("Loading font NotoSans-Regular");
-    return_code = load_font_embedded(&(data->notosans_regular), 96, _embed_fonts_NotoSans_Regular_ttf_start,
-                                     _embed_fonts_NotoSans_Regular_ttf_size);
-    ASSERT(return_code == 0, return -1;, "load_font_embedded error");
+    ASSERT(sdf != NULL, return -1;, "Argument sdf must not be NULL");
 
-    return_code = create_text_texture(&(data->hello_world_texture), "Hello, World!", data->notosans_regular,
-                                      (SDL_Color){0x00, 0x00, 0x00, 0xFF}, renderer);
-    ASSERT(return_code == 0, return -1;, "create_text_texture error");
+    // Swings between one and two times the base size around its top left corner, left of the middle of the screen
+    return_code = measure_sdf_text(sdf, "Hello, World!", scale, &width, &height);
+    ASSERT(return_code == 0, return -1;, "measure_sdf_text error");
+    return_code = draw_sdf_text(sdf, batch, "Hello, World!", 320.0f - width / 2.0f, 240.0f - height / 2.0f, scale,
+                                angle, (SDL_Color){0x00, 0x00, 0x00, 0xFF});
+    ASSERT(return_code == 0, return -1;, "draw_sdf_text error");
+    return_code = draw_sdf_text(sdf, batch, frame_text, 8.0f, 8.0f, 0.5f, 0.0, (SDL_Color){0xFF, 0xFF, 0xFF, 0xFF});
+    ASSERT(return_code == 0, return -1;, "draw_sdf_text error");
 
     return 0;
 }
 
-void free_media(struct sdl_data* data) {
-    ASSERT(data != NULL, return;, "Argument data must not be NULL");
-
-    TRACE("Destroying texture hello_world_texture");
-    free_texture(&(data->hello_world_texture));
-
-    TRACE("Destroying font notosans_regular");
-    free_font(&(data->notosans_regular));
-
-    return;
-}
-
-int handle_events(bool* quit) {
-    SDL_Event event_buffer;
-    int return_code = 0;
-
-    ASSERT(quit != NULL, return -1;, "Argument quit must not be NULL");
-
-    do {
-        return_code = SDL_PollEvent(&event_buffer);
-        ASSERT(return_code >= 0, return -1;, "SDL_PollEvent error=[%s]", SDL_GetError());
-
-        if (return_code == 0) {
-            break;
-        }
-        switch (event_buffer.type) {
-            case SDL_QUIT: {
-                TRACE("Quit");
-                *quit = true;
-                break;
-            }
-            case SDL_KEYDOWN: {
-                break;
-            }
-            default: {
-                break;
-            }
-        }
-    } while (return_code == 1);
-
-    return 0;
-}
-
-int main_loop(const struct sdl_system system, const struct sdl_data data) {
+int main_loop(const struct sdl_system system, const struct sdl_data data, struct glyph_atlas* atlas,
+              struct sdf_font* sdf, struct sprite_batch* batch) {
+    TRACE_SPAN("main_loop");
+    struct trace_span present_span;
     int return_code = 0;
     bool quit = false;
+    struct frame_loop loop;
     const int SCREEN_WIDTH = 640;
     const int SCREEN_HEIGHT = 480;
-    SDL_Rect draw_rect;
+    SDL_Rect draw_rect = {0};
+    unsigned long frame = 0;
+    char frame_text[32];
+    double previous_phase = 0;
+    double current_phase = 0;
+    double phase = 0;
 
     ASSERT(system.renderer != NULL, return -1;, "Argument system.renderer must not be NULL");
-    ASSERT(data.hello_world_texture.texture != NULL, return -1;
-           , "Argument data.hello_world_texture.texture must not be NULL");
-    ASSERT(data.hello_world_texture.width > 0, return -1;
-           , "Argument data.hello_world_texture.width must be greater than 0");
-    ASSERT(data.hello_world_texture.height > 0, return -1;
-           , "Argument data.hello_world_texture.height must be greater than 0");
-
-    draw_rect.x = (SCREEN_WIDTH / 2) - (data.hello_world_texture.width / 2);
-    draw_rect.y = (SCREEN_HEIGHT / 2) - (data.hello_world_texture.height / 2);
-    draw_rect.w = data.hello_world_texture.width;
-    draw_rect.h = data.hello_world_texture.height;
+    ASSERT(data.notosans_regular != NULL, return -1;, "Argument data.notosans_regular must not be NULL");
+    ASSERT(atlas != NULL || sdf != NULL, return -1;, "Argument atlas or sdf must not be NULL");
+    ASSERT(batch != NULL, return -1;, "Argument batch must not be NULL");
+
+    // Measuring rasterizes the glyphs into the atlas, drawing them later only generates vertices
+    if (sdf == NULL) {
+        return_code =
+            measure_glyph_text(atlas, data.notosans_regular, "Hello, World!", &(draw_rect.w), &(draw_rect.h));
+        ASSERT(return_code == 0, return -1;, "measure_glyph_text error");
+        draw_rect.x = (SCREEN_WIDTH / 2) - (draw_rect.w / 2);
+        draw_rect.y = (SCREEN_HEIGHT / 2) - (draw_rect.h / 2);
+    }
+
+    return_code = start_bench();
+    ASSERT(return_code == 0, return -1;, "start_bench error");
+
+    return_code = start_frame_loop(&loop, 60);
+    ASSERT(return_code == 0, return -1;, "start_frame_loop error");
 
     TRACE("Main loop start");
     while (quit == false) {
+        TRACE_SPAN("frame");
+
+        return_code = begin_loop_frame(&loop);
+        ASSERT(return_code == 0, return -1;, "begin_loop_frame error");
+
+        // Each update turns the text one step, keeping the previous phase to blend from. A turn takes 12 s and a
+        // swing 4 s, so the phase wraps every 12 s without a jump
+        while (next_loop_update(&loop) == true) {
+            previous_phase = current_phase;
+            current_phase = (double)(loop.time_ns % 12000000000LL) / 1000000000.0;
+        }
+
         // Set renderer color
         return_code = SDL_SetRenderDrawColor(system.renderer, 0x00, 0x80, 0x80, 0xFF);
         ASSERT(return_code == 0, return -1;, "SDL_SetRenderDrawColor error=[%s]", SDL_GetError());
@@ -401,59 +214,135 @@ int main_loop(const struct sdl_system system, const struct sdl_data data) {
         ASSERT(return_code == 0, return -1;, "SDL_RenderClear error=[%s]", SDL_GetError());
 
         // Render green rectangle
-        return_code = SDL_SetRenderDrawColor(system.renderer, 0x00, 0xFF, 0x00, 0xFF);
-        ASSERT(return_code == 0, return -1;, "SDL_SetRenderDrawColor error=[%s]", SDL_GetError());
-        return_code = SDL_RenderDrawRect(system.renderer, &draw_rect);
-        ASSERT(return_code == 0, return -1;, "SDL_RenderDrawRect error=[%s]", SDL_GetError());
+        if (sdf == NULL) {
+            return_code = SDL_SetRenderDrawColor(system.renderer, 0x00, 0xFF, 0x00, 0xFF);
+            ASSERT(return_code == 0, return -1;, "SDL_SetRenderDrawColor error=[%s]", SDL_GetError());
+            return_code = SDL_RenderDrawRect(system.renderer, &draw_rect);
+            ASSERT(return_code == 0, return -1;, "SDL_RenderDrawRect error=[%s]", SDL_GetError());
+        }
 
-        // Render textures
-        return_code = render_texture(data.hello_world_texture, system.renderer, draw_rect.x, draw_rect.y, NULL, 0.0,
-                                     NULL, SDL_FLIP_NONE);
-        ASSERT(return_code == 0, return -1;, "render_texture error");
+        // Render text, a frame counter changes every frame and still costs no rasterization or upload
+        snprintf(frame_text, sizeof(frame_text), "Frame %lu", frame);
+        if (sdf == NULL) {
+            return_code = render_glyph_text(data, atlas, batch, draw_rect, frame_text);
+            ASSERT(return_code == 0, return -1;, "render_glyph_text error");
+        } else {
+            // Draw between the last two updates, across the end of the cycle when it wrapped
+            phase = current_phase - previous_phase;
+            if (phase < 0.0) {
+                phase += 12.0;
+            }
+            phase = fmod(previous_phase + get_loop_alpha(&loop) * phase, 12.0);
+            return_code = render_sdf_text(sdf, batch, phase, frame_text);
+            ASSERT(return_code == 0, return -1;, "render_sdf_text error");
+        }
+        return_code = flush_sprite_batch(batch);
+        ASSERT(return_code == 0, return -1;, "flush_sprite_batch error");
+        frame++;
 
         // Update screen
+        TRACE_SPAN_BEGIN(present_span, "SDL_RenderPresent");
         SDL_RenderPresent(system.renderer);
+        TRACE_SPAN_END(present_span);
 
         // Poll for currently pending events
-        return_code = handle_events(&quit);
+        return_code = handle_events(&quit, NULL, NULL);
         ASSERT(return_code == 0, return -1;, "handle_events error");
 
-        // sleep
-        // nanosleep(&(struct timespec){.tv_sec = 0, .tv_nsec = (1000000000 / 60)}, NULL);
+        // Benchmark frame time, quits after the requested number of frames
+        return_code = record_bench_frame(&quit);
+        ASSERT(return_code == 0, return -1;, "record_bench_frame error");
     }
     return 0;
 }
 
 int main(int argc, char** argv) {
     int return_code = 0;
+    const char* spans_path = NULL;
     struct sdl_system system = {0};
     struct sdl_data data = {0};
+    struct glyph_atlas atlas = {0};
+    struct sdf_font sdf = {0};
+    struct sprite_batch batch = {0};
+    bool sdf_mode = false;
 
     TRACE("start");
 
     // Command line
     TRACE("argc=[%d]", argc);
     for (int i = 0; i < argc; i++) {
-        TRACE("argv[%d]=[%s]", i, argv[i]);
+        TRACE_DEBUG("argv[%d]=[%s]", i, argv[i]);
+    }
+
+    // Benchmark mode, see bench.h
+    return_code = parse_bench_arguments(argc, argv);
+    ASSERT(return_code == 0, return -1;, "parse_bench_arguments error");
+
+    return_code = parse_text_arguments(argc, argv, &sdf_mode);
+    ASSERT(return_code == 0, return -1;, "parse_text_arguments error");
+
+    // Timeline spans, saved as Chrome trace-event JSON when TRACE_SPANS names an output file
+    spans_path = getenv("TRACE_SPANS");
+    if (spans_path != NULL) {
+        return_code = start_trace_spans();
+        ASSERT(return_code == 0, return -1;, "start_trace_spans error");
     }
 
     TRACE("Initializing");
-    return_code = init_SDL(&system);
-    ASSERT(return_code == 0, return -1;, "init_SDL error");
+    return_code = init_SDL(&system, "SDL Tutorial 16 - True Type Fonts",
+                           SDL_RENDERER_ACCELERATED | SDL_RENDERER_PRESENTVSYNC);
+    ASSERT(return_code == 0, close_SDL(&system); return -1;, "init_SDL error");
+
+    return_code = init_TTF();
+    ASSERT(return_code == 0, close_SDL(&system); return -1;, "init_TTF error");
 
     TRACE("Loading media");
-    return_code = load_media(&data, system.renderer);
-    ASSERT(return_code == 0, free_media(&data); close_SDL(&system); return -1;, "load_media error");
+    return_code = load_media(&data, system.renderer, sdf_mode);
+    ASSERT(return_code == 0, free_media(&data); close_TTF(); close_SDL(&system); return -1;, "load_media error");
+
+    if (sdf_mode == true) {
+        // Crisp outlines up to twice the base size, the largest the text swings to
+        return_code = create_sdf_font(&sdf, system.renderer, data.notosans_regular, NULL, 1024, 1024);
+        ASSERT(return_code == 0, free_media(&data); close_TTF(); close_SDL(&system); return -1;
+               , "create_sdf_font error");
+        return_code = set_sdf_font_edge(&sdf, 2.0f);
+        ASSERT(return_code == 0, destroy_sdf_font(&sdf); free_media(&data); close_TTF(); close_SDL(&system);
+               return -1;, "set_sdf_font_edge error");
+    } else {
+        return_code = create_glyph_atlas(&atlas, system.renderer, 1024, 1024, 512);
+        ASSERT(return_code == 0, free_media(&data); close_TTF(); close_SDL(&system); return -1;
+               , "create_glyph_atlas error");
+    }
+
+    return_code = create_sprite_batch(&batch, 64);
+    ASSERT(return_code == 0, destroy_sdf_font(&sdf); destroy_glyph_atlas(&atlas); free_media(&data); close_TTF();
+           close_SDL(&system); return -1;, "create_sprite_batch error");
 
-    return_code = main_loop(system, data);
-    ASSERT(return_code == 0, free_media(&data); close_SDL(&system); return -1;, "main_loop error");
+    return_code = main_loop(system, data, (sdf_mode == true) ? NULL : &atlas, (sdf_mode == true) ? &sdf : NULL,
+                            &batch);
+    ASSERT(return_code == 0, destroy_sprite_batch(&batch); destroy_sdf_font(&sdf); destroy_glyph_atlas(&atlas);
+           free_media(&data); close_TTF(); close_SDL(&system); return -1;, "main_loop error");
 
     TRACE("Freeing media");
+    destroy_sprite_batch(&batch);
+    destroy_sdf_font(&sdf);
+    destroy_glyph_atlas(&atlas);
     free_media(&data);
 
     TRACE("Closing");
+    close_TTF();
     close_SDL(&system);
 
+    return_code = write_bench_report();
+    ASSERT(return_code == 0, NO_ACTION, "write_bench_report error");
+
+    if (spans_path != NULL) {
+        TRACE("Writing spans to \"%s\"", spans_path);
+        stop_trace_spans();
+        return_code = write_trace_spans(spans_path);
+        ASSERT(return_code == 0, NO_ACTION, "write_trace_spans error");
+    }
+
     TRACE("end");
     return 0;
 }
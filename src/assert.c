@@ -11,47 +11,58 @@
 #define SET_COLOR_RED "\x1b[31m"
 #define RESET_ALL_MODES "\x1b[0m"
 
-int _trace_assert_failed(const char *file, int line, const char *function, const char *expression,
-                         const char *reason_format, ...) {
+int _trace_assert_failed(struct trace_limit *limit, unsigned int per_second, const char *file, int line,
+                         const char *function, const char *expression, const char *reason_format, ...) {
     int return_code = 0;
-    char format[1024];
+    char reason[1024];
     va_list arguments;
 
+    if (limit == NULL) {
+        TRACE_ERROR("Argument limit should not be NULL");
+        return -1;
+    }
     if (file == NULL) {
-        TRACE("Argument file should not be NULL");
+        TRACE_ERROR("Argument file should not be NULL");
         return -1;
     }
     if (function == NULL) {
-        TRACE("Argument function should not be NULL");
+        TRACE_ERROR("Argument function should not be NULL");
         return -1;
     }
     if (expression == NULL) {
-        TRACE("Argument expression should not be NULL");
+        TRACE_ERROR("Argument expression should not be NULL");
         return -1;
     }
     if (reason_format == NULL) {
-        TRACE("Argument reason_format should not be NULL");
+        TRACE_ERROR("Argument reason_format should not be NULL");
         return -1;
     }
 
-    return_code =
-        snprintf(format, sizeof(format), SET_BOLD_MODE SET_COLOR_RED "Assertion failed" RESET_ALL_MODES ": (%s) - %s",
-                 expression, reason_format);
-    if (return_code < 0) {
-        int error_num = errno;
-        TRACE("snprintf error=[%s]", strerror(error_num));
-        return -1;
+    // Assertion failures are logged at error level, the caller's action runs regardless
+    if (TRACE_LEVEL_ERROR < trace_level || TRACE_LEVEL_ERROR < TRACE_MIN_LEVEL) {
+        return 0;
     }
-    if ((size_t)return_code >= sizeof(format)) {
-        TRACE("return_code=[%d] exceeds size of format=[%zu]", return_code, sizeof(format));
-        return -1;
+
+    // Checked after the level so filtered-out failures are not counted as suppressed
+    if (_trace_limit_per_second(limit, per_second, file, line, function) == 0) {
+        return 0;
     }
 
+    // Format the reason here so the trace format stays a literal, as required by the async trace writer
     va_start(arguments, reason_format);
-    return_code = _trace_va(file, line, function, format, arguments);
+    return_code = vsnprintf(reason, sizeof(reason), reason_format, arguments);
     va_end(arguments);
     if (return_code < 0) {
-        fprintf(stderr, "%s:%d - %s - _trace_va error\n", __FILE__, __LINE__, __func__);
+        int error_num = errno;
+        TRACE_ERROR("vsnprintf error=[%s]", strerror(error_num));
+        return -1;
+    }
+
+    return_code = _trace(file, line, function,
+                         SET_BOLD_MODE SET_COLOR_RED "Assertion failed" RESET_ALL_MODES ": (%s) - %s", expression,
+                         reason);
+    if (return_code < 0) {
+        fprintf(stderr, "%s:%d - %s - _trace error\n", __FILE__, __LINE__, __func__);
         return -1;
     }
 
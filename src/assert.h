@@ -21,11 +21,23 @@
     precise call-site context (file, line, function), and explicit failure handling.
 
     ASSERT logs failures through the TRACE subsystem and then executes the caller-provided action block. The action is
-    fully controlled by the caller and may be NO_ACTION when no recovery is needed.
+    fully controlled by the caller and may be NO_ACTION when no recovery is needed. Failures are logged at
+    TRACE_LEVEL_ERROR; when that level is filtered out only the message is skipped, the action still runs.
+
+    Each ASSERT keeps a static per-call-site limiter (see TRACE_LIMIT in trace.h): a site logs at most
+    ASSERT_LIMIT_PER_SECOND failures per second, further failures are counted and reported as "Suppressed K messages"
+    by the first failure of that site in a new second. The action runs on every failure. Define
+    ASSERT_LIMIT_PER_SECOND before including this header to change the limit for a translation unit, 0 disables it.
 */
 
 #include <stdbool.h>
 
+#include "trace.h"
+
+#ifndef ASSERT_LIMIT_PER_SECOND
+    #define ASSERT_LIMIT_PER_SECOND 10
+#endif
+
 #define NO_ACTION \
     do {          \
     } while (0);
@@ -38,15 +50,18 @@
     #define UNLIKELY(condition) (condition)
 #endif
 
-int _trace_assert_failed(const char *file, int line, const char *function, const char *expression,
-                         const char *reason_format, ...) __attribute__((format(printf, 5, 6)));
+int _trace_assert_failed(struct trace_limit *limit, unsigned int per_second, const char *file, int line,
+                         const char *function, const char *expression, const char *reason_format, ...)
+    __attribute__((format(printf, 7, 8)));
 
-#define ASSERT(expression, action, ...)                                                   \
-    do {                                                                                  \
-        if (UNLIKELY((expression) == false)) {                                            \
-            _trace_assert_failed(__FILE__, __LINE__, __func__, #expression, __VA_ARGS__); \
-            { action; }                                                                   \
-        }                                                                                 \
+#define ASSERT(expression, action, ...)                                                                 \
+    do {                                                                                                \
+        if (UNLIKELY((expression) == false)) {                                                          \
+            static struct trace_limit _assert_limit;                                                    \
+            _trace_assert_failed(&_assert_limit, ASSERT_LIMIT_PER_SECOND, __FILE__, __LINE__, __func__, \
+                                 #expression, __VA_ARGS__);                                             \
+            { action; }                                                                                 \
+        }                                                                                               \
     } while (0);
 
 #endif  // ASSERTX_H
@@ -0,0 +1,439 @@
+#define _DEFAULT_SOURCE
+
+#include "asset_loader.h"
+
+#include <SDL2/SDL.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include <string.h>
+
+#include "assert.h"
+#include "sdl_common.h"
+#include "texture_cache.h"
+#include "trace.h"
+
+// Loading screen progress bar, centered
+#define LOADING_BAR_WIDTH 320
+#define LOADING_BAR_HEIGHT 24
+
+static int decode_texture_embedded(struct asset_job* job) {
+    int return_code = 0;
+
+    return_code = decode_surface_embedded(&(job->surface), job->data, job->size,
+                                          (job->color_keyed == true) ? &(job->color_key) : NULL);
+    ASSERT(return_code == 0, return -1;, "decode_surface_embedded error");
+
+    return 0;
+}
+
+static int cache_texture(struct asset_job* job) {
+    int return_code = 0;
+
+    if (job->cache == NULL) {
+        return 0;
+    }
+    return_code = insert_cached_texture(job->cache, &(job->key), job->target);
+    ASSERT(return_code == 0, free_texture(job->target); return -1;, "insert_cached_texture error");
+
+    return 0;
+}
+
+static int upload_texture_embedded(struct asset_job* job, SDL_Renderer* renderer) {
+    int return_code = 0;
+
+    return_code = create_texture_from_surface(job->target, job->surface, renderer);
+    ASSERT(return_code == 0, return -1;, "create_texture_from_surface error");
+
+    return_code = cache_texture(job);
+    ASSERT(return_code == 0, return -1;, "cache_texture error");
+
+    return 0;
+}
+
+static int decode_texture_raw(struct asset_job* job) {
+    int return_code = 0;
+
+    return_code = check_raw_image(job->data, job->size);
+    ASSERT(return_code == 0, return -1;, "check_raw_image error");
+
+    return 0;
+}
+
+static int upload_texture_raw(struct asset_job* job, SDL_Renderer* renderer) {
+    int return_code = 0;
+
+    return_code = load_texture_raw(job->target, job->data, job->size, renderer);
+    ASSERT(return_code == 0, return -1;, "load_texture_raw error");
+
+    return_code = cache_texture(job);
+    ASSERT(return_code == 0, return -1;, "cache_texture error");
+
+    return 0;
+}
+
+// An upload step that hands result over to its target clears it, so only what nobody took is released
+static void release_job(struct asset_job* job) {
+    if (job->release != NULL && job->result != NULL) {
+        job->release(job);
+        job->result = NULL;
+    }
+    if (job->surface != NULL) {
+        SDL_FreeSurface(job->surface);
+        job->surface = NULL;
+    }
+}
+
+static bool has_decoded_job(const struct asset_loader* loader) {
+    int index = 0;
+
+    for (index = 0; index < loader->job_count; index++) {
+        if (loader->jobs[index].state == ASSET_JOB_DECODED || loader->jobs[index].state == ASSET_JOB_FAILED) {
+            return true;
+        }
+    }
+    return false;
+}
+
+static int asset_worker(void* context) {
+    struct asset_loader* loader = context;
+    struct asset_job* job = NULL;
+    int return_code = 0;
+
+    SDL_LockMutex(loader->mutex);
+    while (loader->stopping == false) {
+        if (loader->next_job == loader->job_count) {
+            SDL_CondWait(loader->queued, loader->mutex);
+            continue;
+        }
+        job = &(loader->jobs[loader->next_job]);
+        loader->next_job++;
+        job->state = ASSET_JOB_DECODING;
+        SDL_UnlockMutex(loader->mutex);
+
+        // The job is owned by this worker until its state says decoded
+        if (job->exclusive == true) {
+            SDL_LockMutex(loader->exclusive);
+        }
+        return_code = job->decode(job);
+        if (job->exclusive == true) {
+            SDL_UnlockMutex(loader->exclusive);
+        }
+        ASSERT(return_code == 0, NO_ACTION, "Asset decode error job=[%d]", (int)(job - loader->jobs));
+
+        SDL_LockMutex(loader->mutex);
+        job->state = (return_code == 0) ? ASSET_JOB_DECODED : ASSET_JOB_FAILED;
+        SDL_CondBroadcast(loader->decoded);
+    }
+    SDL_UnlockMutex(loader->mutex);
+
+    return 0;
+}
+
+int create_asset_loader(struct asset_loader* loader, const int thread_count) {
+    int count = thread_count;
+
+    ASSERT(loader != NULL, return -1;, "Argument loader must not be NULL");
+
+    memset(loader, 0, sizeof(*loader));
+    if (count <= 0) {
+        count = SDL_GetCPUCount();
+    }
+    if (count < 1) {
+        count = 1;
+    }
+    if (count > ASSET_LOADER_MAX_THREADS) {
+        count = ASSET_LOADER_MAX_THREADS;
+    }
+
+    loader->mutex = SDL_CreateMutex();
+    ASSERT(loader->mutex != NULL, return -1;, "SDL_CreateMutex error=[%s]", SDL_GetError());
+    loader->exclusive = SDL_CreateMutex();
+    ASSERT(loader->exclusive != NULL, destroy_asset_loader(loader); return -1;
+           , "SDL_CreateMutex error=[%s]", SDL_GetError());
+    loader->queued = SDL_CreateCond();
+    ASSERT(loader->queued != NULL, destroy_asset_loader(loader); return -1;
+           , "SDL_CreateCond error=[%s]", SDL_GetError());
+    loader->decoded = SDL_CreateCond();
+    ASSERT(loader->decoded != NULL, destroy_asset_loader(loader); return -1;
+           , "SDL_CreateCond error=[%s]", SDL_GetError());
+
+    TRACE("Starting asset loader threads=[%d]", count);
+    for (loader->thread_count = 0; loader->thread_count < count; loader->thread_count++) {
+        loader->threads[loader->thread_count] = SDL_CreateThread(asset_worker, "asset_loader", loader);
+        ASSERT(loader->threads[loader->thread_count] != NULL, destroy_asset_loader(loader); return -1;
+               , "SDL_CreateThread error=[%s]", SDL_GetError());
+    }
+
+    return 0;
+}
+
+void destroy_asset_loader(struct asset_loader* loader) {
+    int index = 0;
+
+    ASSERT(loader != NULL, return;, "Argument loader must not be NULL");
+
+    if (loader->mutex != NULL && loader->queued != NULL) {
+        SDL_LockMutex(loader->mutex);
+        loader->stopping = true;
+        SDL_CondBroadcast(loader->queued);
+        SDL_UnlockMutex(loader->mutex);
+    }
+    for (index = 0; index < loader->thread_count; index++) {
+        SDL_WaitThread(loader->threads[index], NULL);
+        loader->threads[index] = NULL;
+    }
+    TRACE("Stopped asset loader threads=[%d] jobs=[%d] done=[%d]", loader->thread_count, loader->job_count,
+          loader->done);
+    loader->thread_count = 0;
+
+    // No worker is left, whatever was decoded and not uploaded belongs to nobody else
+    for (index = 0; index < loader->job_count; index++) {
+        release_job(&(loader->jobs[index]));
+    }
+    loader->job_count = 0;
+    loader->next_job = 0;
+
+    if (loader->decoded != NULL) {
+        SDL_DestroyCond(loader->decoded);
+        loader->decoded = NULL;
+    }
+    if (loader->queued != NULL) {
+        SDL_DestroyCond(loader->queued);
+        loader->queued = NULL;
+    }
+    if (loader->exclusive != NULL) {
+        SDL_DestroyMutex(loader->exclusive);
+        loader->exclusive = NULL;
+    }
+    if (loader->mutex != NULL) {
+        SDL_DestroyMutex(loader->mutex);
+        loader->mutex = NULL;
+    }
+
+    return;
+}
+
+void set_asset_loader_cache(struct asset_loader* loader, struct texture_cache* cache) {
+    ASSERT(loader != NULL, return;, "Argument loader must not be NULL");
+
+    loader->cache = cache;
+    return;
+}
+
+// Returns 1 when the texture came from the cache and nothing is left to queue
+static int find_in_cache(struct asset_loader* loader, struct asset_job* job) {
+    int return_code = 0;
+
+    if (loader->cache == NULL) {
+        return 0;
+    }
+    make_texture_key(&(job->key), job->data, (job->color_keyed == true) ? &(job->color_key) : NULL,
+                     SDL_ScaleModeBest, SDL_BLENDMODE_BLEND);
+    job->cache = loader->cache;
+
+    return_code = find_cached_texture(loader->cache, &(job->key), job->target);
+    ASSERT(return_code >= 0, return -1;, "find_cached_texture error");
+
+    return return_code;
+}
+
+int queue_asset_job(struct asset_loader* loader, const struct asset_job* job) {
+    ASSERT(loader != NULL, return -1;, "Argument loader must not be NULL");
+    ASSERT(loader->mutex != NULL, return -1;, "Argument loader must be created");
+    ASSERT(job != NULL, return -1;, "Argument job must not be NULL");
+    ASSERT(job->decode != NULL, return -1;, "Argument job->decode must not be NULL");
+    ASSERT(job->upload != NULL, return -1;, "Argument job->upload must not be NULL");
+    ASSERT(job->target != NULL, return -1;, "Argument job->target must not be NULL");
+
+    SDL_LockMutex(loader->mutex);
+    ASSERT(loader->job_count < ASSET_LOADER_MAX_JOBS, SDL_UnlockMutex(loader->mutex); return -1;
+           , "Too many asset jobs max=[%d]", ASSET_LOADER_MAX_JOBS);
+
+    loader->jobs[loader->job_count] = *job;
+    loader->jobs[loader->job_count].surface = NULL;
+    loader->jobs[loader->job_count].result = NULL;
+    loader->jobs[loader->job_count].state = ASSET_JOB_QUEUED;
+    loader->job_count++;
+    SDL_CondSignal(loader->queued);
+    SDL_UnlockMutex(loader->mutex);
+
+    return 0;
+}
+
+int queue_texture_embedded(struct asset_loader* loader, struct sdl_texture* texture, const void* img_data,
+                           const size_t size, const SDL_Color* color_key) {
+    struct asset_job job;
+    int return_code = 0;
+
+    ASSERT(loader != NULL, return -1;, "Argument loader must not be NULL");
+    ASSERT(texture != NULL, return -1;, "Argument texture must not be NULL");
+    ASSERT(img_data != NULL, return -1;, "Argument img_data must not be NULL");
+
+    memset(&job, 0, sizeof(job));
+    job.decode = decode_texture_embedded;
+    job.upload = upload_texture_embedded;
+    job.data = img_data;
+    job.size = size;
+    job.target = texture;
+    if (color_key != NULL) {
+        job.color_key = *color_key;
+        job.color_keyed = true;
+    }
+
+    return_code = find_in_cache(loader, &job);
+    ASSERT(return_code >= 0, return -1;, "find_in_cache error");
+    if (return_code == 1) {
+        return 0;
+    }
+
+    return_code = queue_asset_job(loader, &job);
+    ASSERT(return_code == 0, return -1;, "queue_asset_job error");
+
+    return 0;
+}
+
+int queue_texture_raw(struct asset_loader* loader, struct sdl_texture* texture, const void* raw_data,
+                      const size_t size) {
+    struct asset_job job;
+    int return_code = 0;
+
+    ASSERT(loader != NULL, return -1;, "Argument loader must not be NULL");
+    ASSERT(texture != NULL, return -1;, "Argument texture must not be NULL");
+    ASSERT(raw_data != NULL, return -1;, "Argument raw_data must not be NULL");
+
+    memset(&job, 0, sizeof(job));
+    job.decode = decode_texture_raw;
+    job.upload = upload_texture_raw;
+    job.data = raw_data;
+    job.size = size;
+    job.target = texture;
+
+    return_code = find_in_cache(loader, &job);
+    ASSERT(return_code >= 0, return -1;, "find_in_cache error");
+    if (return_code == 1) {
+        return 0;
+    }
+
+    return_code = queue_asset_job(loader, &job);
+    ASSERT(return_code == 0, return -1;, "queue_asset_job error");
+
+    return 0;
+}
+
+int upload_assets(struct asset_loader* loader, SDL_Renderer* renderer) {
+    TRACE_SPAN("upload_assets");
+    enum asset_job_state state = ASSET_JOB_QUEUED;
+    int index = 0;
+    int job_count = 0;
+    int return_code = 0;
+
+    ASSERT(loader != NULL, return -1;, "Argument loader must not be NULL");
+    ASSERT(loader->mutex != NULL, return -1;, "Argument loader must be created");
+    ASSERT(renderer != NULL, return -1;, "Argument renderer must not be NULL");
+
+    SDL_LockMutex(loader->mutex);
+    job_count = loader->job_count;
+    SDL_UnlockMutex(loader->mutex);
+
+    for (index = 0; index < job_count; index++) {
+        struct asset_job* job = &(loader->jobs[index]);
+
+        SDL_LockMutex(loader->mutex);
+        state = job->state;
+        SDL_UnlockMutex(loader->mutex);
+        ASSERT(state != ASSET_JOB_FAILED, return -1;, "Asset job=[%d] failed to decode", index);
+        if (state != ASSET_JOB_DECODED) {
+            continue;
+        }
+
+        // Decoded jobs are only touched by the render thread
+        return_code = job->upload(job, renderer);
+        release_job(job);
+        SDL_LockMutex(loader->mutex);
+        job->state = (return_code == 0) ? ASSET_JOB_DONE : ASSET_JOB_FAILED;
+        loader->done += (return_code == 0) ? 1 : 0;
+        SDL_UnlockMutex(loader->mutex);
+        ASSERT(return_code == 0, return -1;, "Asset job=[%d] failed to upload", index);
+    }
+
+    return 0;
+}
+
+void get_asset_progress(struct asset_loader* loader, int* done, int* total) {
+    ASSERT(loader != NULL, return;, "Argument loader must not be NULL");
+    ASSERT(loader->mutex != NULL, return;, "Argument loader must be created");
+    ASSERT(done != NULL, return;, "Argument done must not be NULL");
+    ASSERT(total != NULL, return;, "Argument total must not be NULL");
+
+    SDL_LockMutex(loader->mutex);
+    *done = loader->done;
+    *total = loader->job_count;
+    SDL_UnlockMutex(loader->mutex);
+
+    return;
+}
+
+static int render_loading_screen(SDL_Renderer* renderer, const int done, const int total) {
+    SDL_Rect bar;
+    int width = 0;
+    int height = 0;
+    int return_code = 0;
+
+    return_code = SDL_GetRendererOutputSize(renderer, &width, &height);
+    ASSERT(return_code == 0, return -1;, "SDL_GetRendererOutputSize error=[%s]", SDL_GetError());
+
+    return_code = SDL_SetRenderDrawColor(renderer, 0x20, 0x20, 0x20, 0xFF);
+    ASSERT(return_code == 0, return -1;, "SDL_SetRenderDrawColor error=[%s]", SDL_GetError());
+    return_code = SDL_RenderClear(renderer);
+    ASSERT(return_code == 0, return -1;, "SDL_RenderClear error=[%s]", SDL_GetError());
+
+    bar = (SDL_Rect){(width - LOADING_BAR_WIDTH) / 2, (height - LOADING_BAR_HEIGHT) / 2, LOADING_BAR_WIDTH,
+                     LOADING_BAR_HEIGHT};
+    return_code = SDL_SetRenderDrawColor(renderer, 0xFF, 0xFF, 0xFF, 0xFF);
+    ASSERT(return_code == 0, return -1;, "SDL_SetRenderDrawColor error=[%s]", SDL_GetError());
+    return_code = SDL_RenderDrawRect(renderer, &bar);
+    ASSERT(return_code == 0, return -1;, "SDL_RenderDrawRect error=[%s]", SDL_GetError());
+
+    bar.w = (total > 0) ? LOADING_BAR_WIDTH * done / total : 0;
+    return_code = SDL_RenderFillRect(renderer, &bar);
+    ASSERT(return_code == 0, return -1;, "SDL_RenderFillRect error=[%s]", SDL_GetError());
+
+    SDL_RenderPresent(renderer);
+    return 0;
+}
+
+int run_loading_screen(struct asset_loader* loader, SDL_Renderer* renderer) {
+    TRACE_SPAN("run_loading_screen");
+    int done = 0;
+    int total = 0;
+    int frames = 0;
+    int return_code = 0;
+
+    ASSERT(loader != NULL, return -1;, "Argument loader must not be NULL");
+    ASSERT(loader->mutex != NULL, return -1;, "Argument loader must be created");
+    ASSERT(renderer != NULL, return -1;, "Argument renderer must not be NULL");
+
+    get_asset_progress(loader, &done, &total);
+    while (done < total) {
+        return_code = upload_assets(loader, renderer);
+        ASSERT(return_code == 0, return -1;, "upload_assets error");
+
+        get_asset_progress(loader, &done, &total);
+        return_code = render_loading_screen(renderer, done, total);
+        ASSERT(return_code == 0, return -1;, "render_loading_screen error");
+        frames++;
+
+        // Keep the window responsive, the events themselves are left for the main loop
+        SDL_PumpEvents();
+
+        // Sleep until a worker finishes a job, a frame at most; jobs already decoded are uploaded right away
+        SDL_LockMutex(loader->mutex);
+        if (has_decoded_job(loader) == false) {
+            SDL_CondWaitTimeout(loader->decoded, loader->mutex, ASSET_LOADER_FRAME_MS);
+        }
+        SDL_UnlockMutex(loader->mutex);
+    }
+
+    TRACE("Assets loaded jobs=[%d] frames=[%d]", total, frames);
+    return 0;
+}
@@ -0,0 +1,114 @@
+#ifndef ASSET_LOADER_H
+#define ASSET_LOADER_H
+
+/*  Asynchronous asset loader
+
+    Decodes assets on a pool of worker threads while the render thread keeps presenting frames, and leaves the render
+    thread only the work that needs the renderer: SDL_CreateTextureFromSurface() or SDL_UpdateTexture(). Part of
+    build/libsdlcommon.a.
+
+        create_asset_loader(&loader, 0);                                    // one worker per CPU core
+        queue_texture_raw(&loader, &(data->sprite_sheet), asset.data, asset.size);
+        queue_font_embedded(&loader, &(data->font), 96, asset.data, asset.size);   // sdl_font.h
+        run_loading_screen(&loader, renderer);                              // returns once everything is uploaded
+        destroy_asset_loader(&loader);
+
+    A job is a decode step run on a worker, then an upload step run by upload_assets() on the render thread, which
+    also writes the result to the job's target; targets must therefore stay valid, and untouched by the caller, until
+    the job is done. Jobs are decoded in queue order by whichever worker is free, so several images decode at once.
+    queue_texture_embedded() decodes an image with decode_surface_embedded() (inflating it first when it is stored
+    compressed) and uploads it with create_texture_from_surface(). queue_texture_raw() runs check_raw_image() on a
+    worker, which faults in the pages of the pre-decoded rows, and uploads them with load_texture_raw(), still without
+    a surface. Other job kinds fill a struct asset_job and call queue_asset_job(); a job flagged exclusive never
+    decodes alongside another exclusive job, for libraries that are not thread safe (SDL_ttf shares one FreeType
+    library between all fonts). release frees a decode result that was never uploaded, surfaces are freed without it.
+
+    get_asset_progress() is the progress counter: jobs done (uploaded) and jobs queued. run_loading_screen() presents a
+    progress bar every frame until every job is done, uploading whatever finished decoding in between and sleeping on
+    the loader until a worker finishes something or ASSET_LOADER_FRAME_MS pass. It only pumps events, so a quit
+    request made during loading is still queued when the main loop starts. A failed decode or upload fails both
+    upload_assets() and run_loading_screen(). destroy_asset_loader() stops the workers once their current job is
+    decoded, joins them and frees what was decoded but not uploaded; it is safe on a partially created loader.
+
+    With a texture cache set (set_asset_loader_cache(), texture_cache.h), queue_texture_embedded() and
+    queue_texture_raw() look the asset up first: a hit hands out the cached texture at once and queues nothing, a miss
+    is decoded as usual and inserted into the cache on upload. The textures are then given back with release_texture()
+    instead of free_texture(), and the queue functions must be called from the render thread, which owns the cache.
+
+    Jobs live in a fixed array of ASSET_LOADER_MAX_JOBS, nothing is allocated per job. The pool is capped at
+    ASSET_LOADER_MAX_THREADS workers.
+*/
+
+#include <SDL2/SDL.h>
+#include <stdbool.h>
+#include <stddef.h>
+
+#include "sdl_common.h"
+#include "texture_cache.h"
+
+#define ASSET_LOADER_MAX_JOBS 64
+#define ASSET_LOADER_MAX_THREADS 8
+#define ASSET_LOADER_FRAME_MS 16
+
+struct asset_job;
+
+typedef int (*asset_decode_function)(struct asset_job* job);
+typedef int (*asset_upload_function)(struct asset_job* job, SDL_Renderer* renderer);
+typedef void (*asset_release_function)(struct asset_job* job);
+
+enum asset_job_state {
+    ASSET_JOB_QUEUED = 0,
+    ASSET_JOB_DECODING,
+    ASSET_JOB_DECODED,
+    ASSET_JOB_DONE,
+    ASSET_JOB_FAILED,
+};
+
+struct asset_job {
+    asset_decode_function decode;    // worker thread
+    asset_upload_function upload;    // render thread, writes target
+    asset_release_function release;  // NULL: only surface is freed
+    const void* data;
+    size_t size;
+    void* target;  // struct sdl_texture*, TTF_Font**, ...
+    SDL_Color color_key;
+    bool color_keyed;
+    bool exclusive;
+    int ptsize;
+    struct texture_cache* cache;  // NULL: texture not cached
+    struct texture_key key;
+    SDL_Surface* surface;  // decode result
+    void* result;          // decode result that is not a surface
+    enum asset_job_state state;
+};
+
+struct asset_loader {
+    SDL_mutex* mutex;      // guards everything below but the threads
+    SDL_cond* queued;      // a job was queued or the loader is stopping
+    SDL_cond* decoded;     // a job finished decoding
+    SDL_mutex* exclusive;  // held while an exclusive job decodes
+    SDL_Thread* threads[ASSET_LOADER_MAX_THREADS];
+    int thread_count;
+    struct asset_job jobs[ASSET_LOADER_MAX_JOBS];
+    int job_count;
+    int next_job;  // first job not claimed by a worker yet
+    int done;      // jobs uploaded
+    bool stopping;
+    struct texture_cache* cache;  // render thread only
+};
+
+int create_asset_loader(struct asset_loader* loader, const int thread_count);
+void destroy_asset_loader(struct asset_loader* loader);
+void set_asset_loader_cache(struct asset_loader* loader, struct texture_cache* cache);
+
+int queue_asset_job(struct asset_loader* loader, const struct asset_job* job);
+int queue_texture_embedded(struct asset_loader* loader, struct sdl_texture* texture, const void* img_data,
+                           const size_t size, const SDL_Color* color_key);
+int queue_texture_raw(struct asset_loader* loader, struct sdl_texture* texture, const void* raw_data,
+                      const size_t size);
+
+int upload_assets(struct asset_loader* loader, SDL_Renderer* renderer);
+void get_asset_progress(struct asset_loader* loader, int* done, int* total);
+int run_loading_screen(struct asset_loader* loader, SDL_Renderer* renderer);
+
+#endif  // ASSET_LOADER_H
@@ -0,0 +1,214 @@
+#define _DEFAULT_SOURCE
+
+#include "asset_pack.h"
+
+#include <errno.h>
+#include <fcntl.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include "assert.h"
+#include "trace.h"
+
+#define FNV_OFFSET_BASIS 0xCBF29CE484222325ull
+#define FNV_PRIME 0x100000001B3ull
+
+static bool is_power_of_two(const uint32_t value) {
+    return value != 0 && (value & (value - 1)) == 0;
+}
+
+static void read_slot(const struct asset_pack* pack, const uint32_t slot, uint32_t* index) {
+    memcpy(index, pack->base + sizeof(struct asset_pack_header) + (size_t)slot * sizeof(*index), sizeof(*index));
+}
+
+static void read_entry(const struct asset_pack* pack, const uint32_t index, struct asset_pack_entry* entry) {
+    memcpy(entry, pack->base + pack->header.entries_offset + (size_t)index * sizeof(*entry), sizeof(*entry));
+}
+
+static int check_entries(const struct asset_pack* pack) {
+    const struct asset_pack_header* header = &(pack->header);
+    const char* names = (const char*)pack->base + header->names_offset;
+    const size_t names_size = header->data_offset - header->names_offset;
+    struct asset_pack_entry entry;
+    uint32_t slot = 0;
+    uint32_t index = 0;
+    uint32_t used = 0;
+
+    for (index = 0; index < header->entry_count; index++) {
+        read_entry(pack, index, &entry);
+        ASSERT(entry.name_offset < names_size && memchr(names + entry.name_offset, '\0',
+                                                        names_size - entry.name_offset) != NULL,
+               return -1;, "Entry index=[%u] name outside of the name table", index);
+        ASSERT(entry.offset >= header->data_offset && entry.offset <= header->size &&
+                   entry.size <= header->size - entry.offset,
+               return -1;, "Entry name=[%s] offset=[%llu] size=[%llu] outside of the pack", names + entry.name_offset,
+               (unsigned long long)entry.offset, (unsigned long long)entry.size);
+    }
+
+    for (slot = 0; slot < header->slot_count; slot++) {
+        read_slot(pack, slot, &index);
+        ASSERT(index <= header->entry_count, return -1;, "Slot=[%u] index=[%u] out of range", slot, index);
+        used += (index != 0) ? 1 : 0;
+    }
+    ASSERT(used == header->entry_count, return -1;, "Slots used=[%u] entries=[%u]", used, header->entry_count);
+
+    return 0;
+}
+
+uint64_t asset_pack_hash(const void* data, const size_t size) {
+    const uint8_t* bytes = data;
+    uint64_t hash = FNV_OFFSET_BASIS;
+    size_t index = 0;
+
+    for (index = 0; index < size; index++) {
+        hash ^= bytes[index];
+        hash *= FNV_PRIME;
+    }
+    return hash;
+}
+
+int open_asset_pack(struct asset_pack* pack, const void* data, const size_t size) {
+    struct asset_pack_header* header = NULL;
+    size_t slots_end = 0;
+    int return_code = 0;
+
+    ASSERT(pack != NULL, return -1;, "Argument pack must not be NULL");
+    ASSERT(data != NULL, return -1;, "Argument data must not be NULL");
+    ASSERT(size >= sizeof(*header), return -1;, "Pack size=[%zu] smaller than its header", size);
+
+    header = &(pack->header);
+    memcpy(header, data, sizeof(*header));
+    ASSERT(memcmp(header->magic, ASSET_PACK_MAGIC, sizeof(header->magic)) == 0, return -1;, "Not an asset pack");
+    ASSERT(header->version == ASSET_PACK_VERSION, return -1;, "Unsupported version=[%u]", header->version);
+    ASSERT(header->size == size, return -1;, "Pack size=[%llu] expected=[%zu]", (unsigned long long)header->size,
+           size);
+    ASSERT(header->entry_count <= ASSET_PACK_MAX_ENTRIES, return -1;, "Too many entries=[%u]", header->entry_count);
+    ASSERT(is_power_of_two(header->slot_count) && header->slot_count > header->entry_count, return -1;
+           , "Invalid slot_count=[%u] entry_count=[%u]", header->slot_count, header->entry_count);
+
+    slots_end = sizeof(*header) + (size_t)header->slot_count * sizeof(uint32_t);
+    ASSERT(header->entries_offset >= slots_end &&
+               header->names_offset >= header->entries_offset + header->entry_count * sizeof(struct asset_pack_entry) &&
+               header->data_offset >= header->names_offset && header->data_offset <= header->size,
+           return -1;, "Invalid section offsets");
+
+    pack->base = data;
+    pack->size = size;
+    pack->mapping = NULL;
+
+    return_code = check_entries(pack);
+    ASSERT(return_code == 0, pack->base = NULL; return -1;, "check_entries error");
+
+    TRACE("Opened asset pack entries=[%u] slots=[%u] size=[%zu]", header->entry_count, header->slot_count, size);
+    return 0;
+}
+
+int map_asset_pack(struct asset_pack* pack, const char* path) {
+    struct stat status;
+    void* mapping = NULL;
+    int descriptor = -1;
+    int error_num = 0;
+    int return_code = 0;
+
+    ASSERT(pack != NULL, return -1;, "Argument pack must not be NULL");
+    ASSERT(path != NULL, return -1;, "Argument path must not be NULL");
+
+    descriptor = open(path, O_RDONLY | O_CLOEXEC);
+    error_num = errno;
+    ASSERT(descriptor >= 0, return -1;, "open error path=[%s] error=[%s]", path, strerror(error_num));
+
+    return_code = fstat(descriptor, &status);
+    error_num = errno;
+    ASSERT(return_code == 0, close(descriptor); return -1;, "fstat error path=[%s] error=[%s]", path,
+           strerror(error_num));
+    ASSERT(status.st_size > 0, close(descriptor); return -1;, "Empty pack path=[%s]", path);
+
+    // The mapping keeps the file referenced, the descriptor is not needed past this point
+    mapping = mmap(NULL, (size_t)status.st_size, PROT_READ, MAP_PRIVATE, descriptor, 0);
+    error_num = errno;
+    close(descriptor);
+    ASSERT(mapping != MAP_FAILED, return -1;, "mmap error path=[%s] error=[%s]", path, strerror(error_num));
+
+    return_code = open_asset_pack(pack, mapping, (size_t)status.st_size);
+    ASSERT(return_code == 0, munmap(mapping, (size_t)status.st_size); return -1;, "open_asset_pack error path=[%s]",
+           path);
+
+    pack->mapping = mapping;
+    TRACE("Mapped asset pack path=[%s]", path);
+    return 0;
+}
+
+int load_asset_pack(struct asset_pack* pack, const void* data, const size_t size) {
+    const char* path = NULL;
+    int return_code = 0;
+
+    ASSERT(pack != NULL, return -1;, "Argument pack must not be NULL");
+
+    path = getenv(ASSET_PACK_ENV);
+    if (path != NULL && path[0] != '\0') {
+        return_code = map_asset_pack(pack, path);
+        ASSERT(return_code == 0, return -1;, "map_asset_pack error");
+        return 0;
+    }
+
+    return_code = open_asset_pack(pack, data, size);
+    ASSERT(return_code == 0, return -1;, "open_asset_pack error");
+    return 0;
+}
+
+void close_asset_pack(struct asset_pack* pack) {
+    ASSERT(pack != NULL, return;, "Argument pack must not be NULL");
+
+    if (pack->mapping != NULL) {
+        TRACE("Unmapping asset pack size=[%zu]", pack->size);
+        munmap(pack->mapping, pack->size);
+        pack->mapping = NULL;
+    }
+    pack->base = NULL;
+    pack->size = 0;
+    return;
+}
+
+int find_asset(const struct asset_pack* pack, const char* name, struct asset* asset) {
+    struct asset_pack_entry entry;
+    uint64_t name_hash = 0;
+    uint32_t mask = 0;
+    uint32_t probe = 0;
+    uint32_t index = 0;
+
+    ASSERT(pack != NULL, return -1;, "Argument pack must not be NULL");
+    ASSERT(pack->base != NULL, return -1;, "Argument pack must be open");
+    ASSERT(name != NULL, return -1;, "Argument name must not be NULL");
+    ASSERT(asset != NULL, return -1;, "Argument asset must not be NULL");
+
+    name_hash = asset_pack_hash(name, strlen(name));
+    mask = pack->header.slot_count - 1;
+
+    // slot_count > entry_count, so a probe sequence always ends on a free slot
+    for (probe = 0; probe < pack->header.slot_count; probe++) {
+        read_slot(pack, (uint32_t)(name_hash + probe) & mask, &index);
+        if (index == 0) {
+            break;
+        }
+
+        read_entry(pack, index - 1, &entry);
+        if (entry.name_hash == name_hash &&
+            strcmp((const char*)pack->base + pack->header.names_offset + entry.name_offset, name) == 0) {
+            asset->name = (const char*)pack->base + pack->header.names_offset + entry.name_offset;
+            asset->data = pack->base + entry.offset;
+            asset->size = (size_t)entry.size;
+            asset->format = (enum asset_format)entry.format;
+            asset->hash = entry.hash;
+            TRACE_DEBUG("Found asset name=[%s] size=[%zu] probes=[%u]", name, asset->size, probe + 1);
+            return 0;
+        }
+    }
+
+    TRACE_ERROR("Asset not found name=[%s]", name);
+    return -1;
+}
@@ -0,0 +1,98 @@
+#ifndef ASSET_PACK_H
+#define ASSET_PACK_H
+
+/*  Asset pack
+
+    One blob per program holding all of its assets behind a hash index, written by pack_gen at build time and embedded
+    with embed.sh as a single object:
+
+        header | slots[slot_count] | entries[entry_count] | names | padding | data
+
+    slots is an open addressing table of slot_count (a power of two, at least twice entry_count) entry indices plus
+    one, 0 marks a free slot. A name is hashed with asset_pack_hash() (64-bit FNV-1a); its home slot is the hash
+    masked with slot_count - 1 and collisions probe linearly, so find_asset() touches one or two slots and compares a
+    single name. Entries point into names (NUL terminated) and into data, which starts on an ASSET_PACK_PAGE_SIZE
+    boundary; every asset in it starts on an ASSET_PACK_ALIGNMENT boundary, offsets being relative to the start of
+    the pack. Fields are in host byte order.
+
+    Entry names are the asset paths relative to their source directory, with a trailing .gz dropped since
+    open_embedded_rwops() (embed_rwops.h) inflates those transparently: "fonts/NotoSans-Regular.ttf",
+    "earth_background.png.raw". format tells how the bytes are stored, hash is the asset_pack_hash() of them.
+    pack_gen stores equal contents once, so several entries may point at the same data.
+
+    open_asset_pack() checks a pack in memory, normally the embedded one, and keeps pointers into it. map_asset_pack()
+    mmaps a pack file read-only instead, so assets can be rebuilt and picked up by the next run without relinking;
+    load_asset_pack() does the latter when the ASSET_PACK environment variable names a file and the former otherwise.
+    A struct asset_pack must stay open while anything still reads from its assets (TTF_Font streams keep doing so),
+    close_asset_pack() unmaps a mapped pack.
+
+    Embedded packs are placed on a page boundary in .rodata (embed.sh --align 4096) and mapped packs start on one as
+    well, so every asset is aligned in memory as it is in the pack and is handed to its loader in place. A pack in
+    other memory may start anywhere, fixed-size records are therefore read with memcpy.
+*/
+
+#include <stddef.h>
+#include <stdint.h>
+
+#define ASSET_PACK_MAGIC "APAK"
+#define ASSET_PACK_VERSION 1
+#define ASSET_PACK_ALIGNMENT 64
+#define ASSET_PACK_PAGE_SIZE 4096
+#define ASSET_PACK_MAX_ENTRIES 4096
+#define ASSET_PACK_ENV "ASSET_PACK"
+
+enum asset_format {
+    ASSET_FORMAT_BINARY = 0,
+    ASSET_FORMAT_TEXT,
+    ASSET_FORMAT_BMP,
+    ASSET_FORMAT_PNG,
+    ASSET_FORMAT_TTF,
+    ASSET_FORMAT_RAW_IMAGE,  // raw_image.h
+    ASSET_FORMAT_GZIP,
+};
+
+struct asset_pack_header {
+    char magic[4];  // ASSET_PACK_MAGIC, no terminator
+    uint32_t version;
+    uint32_t entry_count;
+    uint32_t slot_count;
+    uint64_t entries_offset;
+    uint64_t names_offset;
+    uint64_t data_offset;
+    uint64_t size;  // whole pack, data included
+};
+
+struct asset_pack_entry {
+    uint64_t name_hash;
+    uint64_t hash;    // of the stored bytes
+    uint64_t offset;  // from the start of the pack
+    uint64_t size;
+    uint32_t name_offset;  // from names_offset
+    uint32_t format;       // enum asset_format
+};
+
+struct asset {
+    const char* name;
+    const void* data;
+    size_t size;
+    enum asset_format format;
+    uint64_t hash;
+};
+
+struct asset_pack {
+    const uint8_t* base;
+    size_t size;
+    struct asset_pack_header header;
+    void* mapping;  // mmap of a pack file, NULL for a pack in memory
+};
+
+uint64_t asset_pack_hash(const void* data, const size_t size);
+
+int open_asset_pack(struct asset_pack* pack, const void* data, const size_t size);
+int map_asset_pack(struct asset_pack* pack, const char* path);
+int load_asset_pack(struct asset_pack* pack, const void* data, const size_t size);
+void close_asset_pack(struct asset_pack* pack);
+
+int find_asset(const struct asset_pack* pack, const char* name, struct asset* asset);
+
+#endif  // ASSET_PACK_H
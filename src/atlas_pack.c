@@ -0,0 +1,442 @@
+#define _DEFAULT_SOURCE
+
+#include <SDL2/SDL.h>
+#include <SDL2/SDL_image.h>
+#include <ctype.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "assert.h"
+#include "trace.h"
+
+/*  atlas_pack
+
+    Build-time texture atlas packer. Combines the images of one program into a single atlas image and writes a header
+    of named clips into it:
+
+        bin/atlas_pack <name> <atlas-image> <clip-header> <image>...
+
+    The atlas image is saved as BMP when its path ends in .bmp and as PNG otherwise, so a surface-only program can keep
+    loading BMP without SDL_image. It is then embedded like any asset through embed.sh. The clip header defines the
+    atlas size and one SDL_Rect compound literal per image, named after the file without its extension:
+
+        #define ATLAS_BLENDING_WIDTH 640
+        #define ATLAS_BLENDING_HEIGHT 961
+        #define ATLAS_BLENDING_BLENDING_PRESS_W ((SDL_Rect){.x = 0, .y = 0, .w = 640, .h = 480})
+
+    Images are packed with the skyline bottom-left heuristic, tallest first, with ATLAS_PADDING transparent pixels
+    between them so linear filtering never samples a neighbour. Every power-of-two width from the widest image up to
+    ATLAS_MAX_SIZE is tried, the one giving the smallest atlas area wins. Pixels are copied verbatim, alpha included.
+*/
+
+#define ATLAS_MAX_IMAGES 64
+#define ATLAS_MAX_SIZE 4096
+#define ATLAS_PADDING 1
+#define ATLAS_NAME_SIZE 64
+
+struct atlas_image {
+    const char* path;
+    char name[ATLAS_NAME_SIZE];  // upper case, [A-Z0-9_] only
+    SDL_Surface* surface;
+    SDL_Rect rect;
+};
+
+struct skyline_node {
+    int x;
+    int y;
+    int width;
+};
+
+struct skyline {
+    struct skyline_node nodes[ATLAS_MAX_IMAGES * 2 + 1];
+    int count;
+    int width;
+};
+
+int make_clip_name(char* name, const size_t size, const char* path);
+int compare_image_height(const void* left, const void* right);
+
+int fit_skyline(const struct skyline* skyline, const int index, const int width, int* y);
+int insert_skyline(struct skyline* skyline, const int index, const int x, const int y, const int width,
+                   const int height);
+int pack_images(struct atlas_image** order, const int count, const int width, int* height);
+
+int load_images(struct atlas_image* images, const int count, char** paths);
+void free_images(struct atlas_image* images, const int count);
+int used_width(const struct atlas_image* images, const int count);
+int pack_atlas(struct atlas_image* images, const int count, int* width, int* height);
+
+int write_clip_header(const char* path, const char* name, const char* atlas_path, struct atlas_image* images,
+                      const int count, const int width, const int height);
+int write_atlas_image(const char* path, struct atlas_image* images, const int count, const int width,
+                      const int height);
+int main(int argc, char** argv);
+
+int make_clip_name(char* name, const size_t size, const char* path) {
+    const char* base = NULL;
+    const char* extension = NULL;
+    size_t length = 0;
+    size_t index = 0;
+
+    ASSERT(name != NULL, return -1;, "Argument name must not be NULL");
+    ASSERT(path != NULL, return -1;, "Argument path must not be NULL");
+
+    base = (strrchr(path, '/') != NULL) ? strrchr(path, '/') + 1 : path;
+    extension = strrchr(base, '.');
+    length = (extension != NULL) ? (size_t)(extension - base) : strlen(base);
+    ASSERT(length > 0 && length < size, return -1;, "Invalid clip name length=[%zu] path=[%s]", length, path);
+
+    for (index = 0; index < length; index++) {
+        const unsigned char character = (unsigned char)base[index];
+        name[index] = (isalnum(character) != 0) ? (char)toupper(character) : '_';
+    }
+    name[length] = '\0';
+
+    return 0;
+}
+
+int compare_image_height(const void* left, const void* right) {
+    const struct atlas_image* a = *(struct atlas_image* const*)left;
+    const struct atlas_image* b = *(struct atlas_image* const*)right;
+
+    // Tallest first, widest first among equal heights
+    if (a->rect.h != b->rect.h) {
+        return (a->rect.h < b->rect.h) ? 1 : -1;
+    }
+    return (a->rect.w < b->rect.w) - (a->rect.w > b->rect.w);
+}
+
+int fit_skyline(const struct skyline* skyline, const int index, const int width, int* y) {
+    int remaining = width;
+    int node = index;
+    int top = 0;
+
+    ASSERT(skyline != NULL, return -1;, "Argument skyline must not be NULL");
+    ASSERT(y != NULL, return -1;, "Argument y must not be NULL");
+
+    if (skyline->nodes[index].x + width > skyline->width) {
+        return 1;
+    }
+
+    // The rect rests on the highest node it spans
+    while (remaining > 0) {
+        ASSERT(node < skyline->count, return -1;, "Skyline does not cover the atlas width");
+        if (skyline->nodes[node].y > top) {
+            top = skyline->nodes[node].y;
+        }
+        remaining -= skyline->nodes[node].width;
+        node++;
+    }
+
+    *y = top;
+    return 0;
+}
+
+int insert_skyline(struct skyline* skyline, const int index, const int x, const int y, const int width,
+                   const int height) {
+    int node = 0;
+
+    ASSERT(skyline != NULL, return -1;, "Argument skyline must not be NULL");
+    ASSERT(skyline->count < (int)(sizeof(skyline->nodes) / sizeof(skyline->nodes[0])), return -1;
+           , "Skyline node table full");
+
+    memmove(&skyline->nodes[index + 1], &skyline->nodes[index],
+            (size_t)(skyline->count - index) * sizeof(skyline->nodes[0]));
+    skyline->nodes[index] = (struct skyline_node){.x = x, .y = y + height, .width = width};
+    skyline->count++;
+
+    // Shrink or drop the nodes now hidden under the new one
+    node = index + 1;
+    while (node < skyline->count) {
+        const int end = skyline->nodes[node - 1].x + skyline->nodes[node - 1].width;
+        const int shrink = end - skyline->nodes[node].x;
+
+        if (shrink <= 0) {
+            break;
+        }
+        skyline->nodes[node].x += shrink;
+        skyline->nodes[node].width -= shrink;
+        if (skyline->nodes[node].width > 0) {
+            break;
+        }
+        memmove(&skyline->nodes[node], &skyline->nodes[node + 1],
+                (size_t)(skyline->count - node - 1) * sizeof(skyline->nodes[0]));
+        skyline->count--;
+    }
+
+    // Merge neighbours of equal height
+    node = 0;
+    while (node < skyline->count - 1) {
+        if (skyline->nodes[node].y == skyline->nodes[node + 1].y) {
+            skyline->nodes[node].width += skyline->nodes[node + 1].width;
+            memmove(&skyline->nodes[node + 1], &skyline->nodes[node + 2],
+                    (size_t)(skyline->count - node - 2) * sizeof(skyline->nodes[0]));
+            skyline->count--;
+        } else {
+            node++;
+        }
+    }
+
+    return 0;
+}
+
+int pack_images(struct atlas_image** order, const int count, const int width, int* height) {
+    struct skyline skyline;
+    int image = 0;
+    int return_code = 0;
+
+    ASSERT(order != NULL, return -1;, "Argument order must not be NULL");
+    ASSERT(height != NULL, return -1;, "Argument height must not be NULL");
+
+    skyline.nodes[0] = (struct skyline_node){.x = 0, .y = 0, .width = width};
+    skyline.count = 1;
+    skyline.width = width;
+    *height = 0;
+
+    for (image = 0; image < count; image++) {
+        const int padded_width = order[image]->rect.w + ATLAS_PADDING;
+        const int padded_height = order[image]->rect.h + ATLAS_PADDING;
+        int best_index = -1;
+        int best_top = 0;
+        int best_y = 0;
+        int node = 0;
+
+        // Bottom-left: lowest resulting top edge, leftmost among equals
+        for (node = 0; node < skyline.count; node++) {
+            int y = 0;
+
+            return_code = fit_skyline(&skyline, node, padded_width, &y);
+            ASSERT(return_code >= 0, return -1;, "fit_skyline error");
+            if (return_code == 0 && (best_index < 0 || y + padded_height < best_top)) {
+                best_index = node;
+                best_top = y + padded_height;
+                best_y = y;
+            }
+        }
+        if (best_index < 0 || best_top - ATLAS_PADDING > ATLAS_MAX_SIZE) {
+            return 1;
+        }
+
+        order[image]->rect.x = skyline.nodes[best_index].x;
+        order[image]->rect.y = best_y;
+        return_code =
+            insert_skyline(&skyline, best_index, skyline.nodes[best_index].x, best_y, padded_width, padded_height);
+        ASSERT(return_code == 0, return -1;, "insert_skyline error");
+
+        if (best_top - ATLAS_PADDING > *height) {
+            *height = best_top - ATLAS_PADDING;
+        }
+    }
+
+    return 0;
+}
+
+int write_clip_header(const char* path, const char* name, const char* atlas_path, struct atlas_image* images,
+                      const int count, const int width, const int height) {
+    FILE* header = NULL;
+    char prefix[ATLAS_NAME_SIZE];
+    int image = 0;
+    int return_code = 0;
+
+    ASSERT(path != NULL, return -1;, "Argument path must not be NULL");
+    ASSERT(images != NULL, return -1;, "Argument images must not be NULL");
+
+    return_code = make_clip_name(prefix, sizeof(prefix), name);
+    ASSERT(return_code == 0, return -1;, "make_clip_name error name=[%s]", name);
+
+    header = fopen(path, "w");
+    ASSERT(header != NULL, return -1;, "fopen error path=[%s]", path);
+
+    fprintf(header, "#ifndef ATLAS_%s_H\n#define ATLAS_%s_H\n\n", prefix, prefix);
+    fprintf(header, "// Texture atlas: %s, generated by atlas_pack\n\n", atlas_path);
+    fprintf(header, "#include <SDL2/SDL.h>\n\n");
+    fprintf(header, "#define ATLAS_%s_WIDTH %d\n#define ATLAS_%s_HEIGHT %d\n\n", prefix, width, prefix, height);
+    for (image = 0; image < count; image++) {
+        fprintf(header, "// %s\n#define ATLAS_%s_%s ((SDL_Rect){.x = %d, .y = %d, .w = %d, .h = %d})\n",
+                images[image].path, prefix, images[image].name, images[image].rect.x, images[image].rect.y,
+                images[image].rect.w, images[image].rect.h);
+    }
+    fprintf(header, "\n#endif  // ATLAS_%s_H\n", prefix);
+
+    return_code = fclose(header);
+    ASSERT(return_code == 0, return -1;, "fclose error path=[%s]", path);
+
+    return 0;
+}
+
+int write_atlas_image(const char* path, struct atlas_image* images, const int count, const int width,
+                      const int height) {
+    SDL_Surface* atlas = NULL;
+    const char* extension = NULL;
+    int image = 0;
+    int return_code = 0;
+
+    ASSERT(path != NULL, return -1;, "Argument path must not be NULL");
+    ASSERT(images != NULL, return -1;, "Argument images must not be NULL");
+
+    // Zero-filled, so padding stays transparent
+    atlas = SDL_CreateRGBSurfaceWithFormat(0, width, height, 32, SDL_PIXELFORMAT_ARGB8888);
+    ASSERT(atlas != NULL, return -1;, "SDL_CreateRGBSurfaceWithFormat error=[%s]", SDL_GetError());
+
+    for (image = 0; image < count; image++) {
+        SDL_Rect destination = images[image].rect;
+
+        // Copy, do not blend, so the source alpha lands in the atlas unchanged
+        return_code = SDL_SetSurfaceBlendMode(images[image].surface, SDL_BLENDMODE_NONE);
+        ASSERT(return_code == 0, SDL_FreeSurface(atlas); return -1;
+               , "SDL_SetSurfaceBlendMode error=[%s]", SDL_GetError());
+
+        return_code = SDL_BlitSurface(images[image].surface, NULL, atlas, &destination);
+        ASSERT(return_code == 0, SDL_FreeSurface(atlas); return -1;, "SDL_BlitSurface error=[%s]", SDL_GetError());
+    }
+
+    extension = strrchr(path, '.');
+    if (extension != NULL && strcmp(extension, ".bmp") == 0) {
+        return_code = SDL_SaveBMP(atlas, path);
+        ASSERT(return_code == 0, SDL_FreeSurface(atlas); return -1;, "SDL_SaveBMP error=[%s]", SDL_GetError());
+    } else {
+        return_code = IMG_SavePNG(atlas, path);
+        ASSERT(return_code == 0, SDL_FreeSurface(atlas); return -1;, "IMG_SavePNG error=[%s]", IMG_GetError());
+    }
+
+    SDL_FreeSurface(atlas);
+    return 0;
+}
+
+int load_images(struct atlas_image* images, const int count, char** paths) {
+    int image = 0;
+    int return_code = 0;
+
+    ASSERT(images != NULL, return -1;, "Argument images must not be NULL");
+    ASSERT(paths != NULL, return -1;, "Argument paths must not be NULL");
+
+    for (image = 0; image < count; image++) {
+        images[image].path = paths[image];
+        return_code = make_clip_name(images[image].name, sizeof(images[image].name), images[image].path);
+        ASSERT(return_code == 0, free_images(images, image); return -1;, "make_clip_name error");
+
+        images[image].surface = IMG_Load(images[image].path);
+        ASSERT(images[image].surface != NULL, free_images(images, image); return -1;
+               , "IMG_Load error path=[%s] error=[%s]", images[image].path, IMG_GetError());
+
+        images[image].rect = (SDL_Rect){0, 0, images[image].surface->w, images[image].surface->h};
+        TRACE("Image path=[%s] name=[%s] width=[%d] height=[%d]", images[image].path, images[image].name,
+              images[image].rect.w, images[image].rect.h);
+    }
+
+    return 0;
+}
+
+void free_images(struct atlas_image* images, const int count) {
+    int image = 0;
+
+    ASSERT(images != NULL, return;, "Argument images must not be NULL");
+
+    for (image = 0; image < count; image++) {
+        if (images[image].surface != NULL) {
+            SDL_FreeSurface(images[image].surface);
+            images[image].surface = NULL;
+        }
+    }
+
+    return;
+}
+
+int used_width(const struct atlas_image* images, const int count) {
+    int image = 0;
+    int width = 0;
+
+    for (image = 0; image < count; image++) {
+        if (images[image].rect.x + images[image].rect.w > width) {
+            width = images[image].rect.x + images[image].rect.w;
+        }
+    }
+
+    return width;
+}
+
+int pack_atlas(struct atlas_image* images, const int count, int* width, int* height) {
+    struct atlas_image* order[ATLAS_MAX_IMAGES];
+    int image = 0;
+    int max_width = 0;
+    int candidate = 0;
+    int best_width = 0;
+    long best_area = 0;
+    int return_code = 0;
+
+    ASSERT(images != NULL, return -1;, "Argument images must not be NULL");
+    ASSERT(count > 0 && count <= ATLAS_MAX_IMAGES, return -1;, "Argument count=[%d] out of range", count);
+    ASSERT(width != NULL, return -1;, "Argument width must not be NULL");
+    ASSERT(height != NULL, return -1;, "Argument height must not be NULL");
+
+    for (image = 0; image < count; image++) {
+        order[image] = &images[image];
+        if (images[image].rect.w > max_width) {
+            max_width = images[image].rect.w;
+        }
+    }
+    qsort(order, (size_t)count, sizeof(order[0]), compare_image_height);
+
+    // Smallest area over the power-of-two widths that hold the widest image, measured on the width actually used
+    candidate = 1;
+    while (candidate < max_width + ATLAS_PADDING) {
+        candidate *= 2;
+    }
+    for (; candidate <= ATLAS_MAX_SIZE; candidate *= 2) {
+        int candidate_height = 0;
+
+        return_code = pack_images(order, count, candidate, &candidate_height);
+        ASSERT(return_code >= 0, return -1;, "pack_images error");
+        if (return_code == 0 && (best_width == 0 || (long)used_width(images, count) * candidate_height < best_area)) {
+            best_width = candidate;
+            best_area = (long)used_width(images, count) * candidate_height;
+        }
+    }
+    ASSERT(best_width > 0, return -1;, "Images do not fit a %dx%d atlas", ATLAS_MAX_SIZE, ATLAS_MAX_SIZE);
+
+    // Pack again at the winning width, the last attempt left the rects of another one
+    return_code = pack_images(order, count, best_width, height);
+    ASSERT(return_code == 0, return -1;, "pack_images error");
+    *width = used_width(images, count);
+
+    return 0;
+}
+
+int main(int argc, char** argv) {
+    struct atlas_image images[ATLAS_MAX_IMAGES];
+    const int img_flags = IMG_INIT_PNG;
+    int count = 0;
+    int width = 0;
+    int height = 0;
+    int return_code = 0;
+
+    if (argc < 5) {
+        fprintf(stderr, "Usage: %s <name> <atlas-image> <clip-header> <image>...\n", argv[0]);
+        return -1;
+    }
+    count = argc - 4;
+    ASSERT(count <= ATLAS_MAX_IMAGES, return -1;, "Too many images count=[%d] max=[%d]", count, ATLAS_MAX_IMAGES);
+
+    return_code = IMG_Init(img_flags);
+    ASSERT((return_code & img_flags) == img_flags, IMG_Quit(); return -1;, "IMG_Init error=[%s]", IMG_GetError());
+
+    memset(images, 0, sizeof(images));
+    return_code = load_images(images, count, &argv[4]);
+    ASSERT(return_code == 0, IMG_Quit(); return -1;, "load_images error");
+
+    return_code = pack_atlas(images, count, &width, &height);
+    ASSERT(return_code == 0, free_images(images, count); IMG_Quit(); return -1;, "pack_atlas error");
+    TRACE("Atlas name=[%s] width=[%d] height=[%d] images=[%d]", argv[1], width, height, count);
+
+    return_code = write_atlas_image(argv[2], images, count, width, height);
+    ASSERT(return_code == 0, free_images(images, count); IMG_Quit(); return -1;, "write_atlas_image error");
+
+    return_code = write_clip_header(argv[3], argv[1], argv[2], images, count, width, height);
+    ASSERT(return_code == 0, free_images(images, count); IMG_Quit(); return -1;, "write_clip_header error");
+
+    free_images(images, count);
+    IMG_Quit();
+    return 0;
+}
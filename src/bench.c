@@ -0,0 +1,168 @@
+#define _DEFAULT_SOURCE
+
+#include "bench.h"
+
+#include <SDL2/SDL.h>
+#include <errno.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include "assert.h"
+#include "trace.h"
+
+static const char* bench_name = "";
+static long bench_frames = 0;  // frames to run, 0 when benchmark mode is off
+static bool bench_headless = false;
+
+static int64_t bench_frame_ns[BENCH_MAX_FRAMES];
+static long bench_frame_count = 0;
+static int64_t bench_last_ns = 0;
+
+static int64_t get_monotonic_ns(void) {
+    struct timespec now;
+    int return_code = 0;
+    int error_num = 0;
+
+    return_code = clock_gettime(CLOCK_MONOTONIC, &now);
+    error_num = errno;
+    ASSERT(return_code == 0, return -1;, "clock_gettime error=[%s]", strerror(error_num));
+
+    return (int64_t)now.tv_sec * 1000000000LL + (int64_t)now.tv_nsec;
+}
+
+static int compare_int64(const void* left, const void* right) {
+    const int64_t a = *(const int64_t*)left;
+    const int64_t b = *(const int64_t*)right;
+    return (a > b) - (a < b);
+}
+
+int parse_bench_arguments(int argc, char** argv) {
+    int index = 0;
+
+    ASSERT(argc >= 1, return -1;, "Argument argc must be at least 1");
+    ASSERT(argv != NULL, return -1;, "Argument argv must not be NULL");
+
+    bench_name = (strrchr(argv[0], '/') != NULL) ? strrchr(argv[0], '/') + 1 : argv[0];
+    bench_frames = 0;
+    bench_headless = false;
+
+    for (index = 1; index < argc; index++) {
+        if (strcmp(argv[index], "--headless") == 0) {
+            bench_headless = true;
+        } else if (strcmp(argv[index], "--bench") == 0) {
+            char* end = NULL;
+
+            ASSERT(index + 1 < argc, return -1;, "Usage: %s --bench <frames> [--headless]", bench_name);
+            index++;
+            errno = 0;
+            bench_frames = strtol(argv[index], &end, 10);
+            ASSERT(errno == 0 && end != argv[index] && *end == '\0', return -1;
+                   , "Invalid frame count=[%s]", argv[index]);
+            ASSERT(bench_frames > 0 && bench_frames <= BENCH_MAX_FRAMES, return -1;
+                   , "Frame count=[%ld] must be between 1 and %d", bench_frames, BENCH_MAX_FRAMES);
+        }
+    }
+
+    ASSERT(bench_headless == false || bench_frames > 0, return -1;, "--headless requires --bench <frames>");
+
+    if (bench_frames > 0) {
+        TRACE("Benchmark mode frames=[%ld] headless=[%d]", bench_frames, (int)bench_headless);
+    }
+    return 0;
+}
+
+int set_bench_hints(void) {
+    SDL_bool hint_set = SDL_FALSE;
+
+    if (bench_frames == 0) {
+        return 0;
+    }
+
+    // Overrides SDL_RENDERER_PRESENTVSYNC for every renderer created afterwards
+    hint_set = SDL_SetHint(SDL_HINT_RENDER_VSYNC, "0");
+    ASSERT(hint_set == SDL_TRUE, return -1;, "SDL_SetHint(%s) error", SDL_HINT_RENDER_VSYNC);
+
+    if (bench_headless == true) {
+        TRACE("Selecting dummy video driver and software renderer");
+        hint_set = SDL_SetHint(SDL_HINT_VIDEODRIVER, "dummy");
+        ASSERT(hint_set == SDL_TRUE, return -1;, "SDL_SetHint(%s) error", SDL_HINT_VIDEODRIVER);
+
+        hint_set = SDL_SetHint(SDL_HINT_RENDER_DRIVER, "software");
+        ASSERT(hint_set == SDL_TRUE, return -1;, "SDL_SetHint(%s) error", SDL_HINT_RENDER_DRIVER);
+    }
+
+    return 0;
+}
+
+bool bench_enabled(void) {
+    return bench_frames > 0;
+}
+
+int start_bench(void) {
+    if (bench_frames == 0) {
+        return 0;
+    }
+
+    bench_frame_count = 0;
+    bench_last_ns = get_monotonic_ns();
+    ASSERT(bench_last_ns >= 0, return -1;, "get_monotonic_ns error");
+
+    return 0;
+}
+
+int record_bench_frame(bool* quit) {
+    int64_t now_ns = 0;
+
+    ASSERT(quit != NULL, return -1;, "Argument quit must not be NULL");
+
+    if (bench_frames == 0) {
+        return 0;
+    }
+    ASSERT(bench_frame_count < bench_frames, *quit = true; return -1;, "Frame recorded past the benchmark end");
+
+    now_ns = get_monotonic_ns();
+    ASSERT(now_ns >= 0, return -1;, "get_monotonic_ns error");
+
+    bench_frame_ns[bench_frame_count] = now_ns - bench_last_ns;
+    bench_frame_count++;
+    bench_last_ns = now_ns;
+
+    if (bench_frame_count == bench_frames) {
+        TRACE("Benchmark done frames=[%ld]", bench_frame_count);
+        *quit = true;
+    }
+    return 0;
+}
+
+int write_bench_report(void) {
+    int64_t total_ns = 0;
+    long index = 0;
+    long p50 = 0;
+    long p99 = 0;
+    size_t count = 0;
+
+    if (bench_frames == 0) {
+        return 0;
+    }
+    ASSERT(bench_frame_count > 0, return -1;, "No frames recorded");
+
+    count = (size_t)bench_frame_count;
+    for (index = 0; index < bench_frame_count; index++) {
+        total_ns += bench_frame_ns[index];
+    }
+    qsort(bench_frame_ns, count, sizeof(bench_frame_ns[0]), compare_int64);
+
+    // Nearest-rank percentiles
+    p50 = (bench_frame_count * 50 + 99) / 100 - 1;
+    p99 = (bench_frame_count * 99 + 99) / 100 - 1;
+
+    fprintf(stderr, "%s frames=[%ld] min=[%.3f ms] avg=[%.3f ms] p50=[%.3f ms] p99=[%.3f ms] max=[%.3f ms]\n",
+            bench_name, bench_frame_count, (double)bench_frame_ns[0] / 1000000.0,
+            (double)total_ns / (double)bench_frame_count / 1000000.0, (double)bench_frame_ns[p50] / 1000000.0,
+            (double)bench_frame_ns[p99] / 1000000.0, (double)bench_frame_ns[bench_frame_count - 1] / 1000000.0);
+    return 0;
+}
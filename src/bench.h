@@ -0,0 +1,40 @@
+#ifndef BENCH_H
+#define BENCH_H
+
+/*  BENCH subsystem
+
+    Headless benchmark mode shared by the tutorial programs. It turns any tutorial into a reproducible throughput
+    measurement that runs on a machine without a GPU or a display:
+
+        bin/15_rotation_and_flipping --bench 1000 --headless
+
+    --bench N runs main_loop for exactly N frames and then quits as if the window had been closed. Vsync is disabled
+    through SDL_HINT_RENDER_VSYNC, which overrides SDL_RENDERER_PRESENTVSYNC, and end_loop_frame() (frame_loop.h)
+    skips its pacing, so every frame runs back to back. --headless additionally selects the SDL dummy video
+    driver and the software renderer; it is only accepted together with --bench, since nothing could close the hidden
+    window otherwise.
+
+    parse_bench_arguments() must run before set_bench_hints(), and both before SDL_Init. The main loop calls
+    start_bench() once before its first frame and record_bench_frame() once at the end of every frame; a frame time is
+    the CLOCK_MONOTONIC interval between two consecutive calls. write_bench_report() prints min/avg/p50/p99/max frame
+    times to stderr, so TRACE output on stdout can be redirected away:
+
+        15_rotation_and_flipping frames=[1000] min=[0.412 ms] avg=[0.451 ms] p50=[0.447 ms] p99=[0.530 ms] ...
+
+    Frame times are kept in a static table of BENCH_MAX_FRAMES entries, nothing is allocated while the loop runs.
+    Arguments the module does not recognize are ignored and left to the program.
+*/
+
+#include <stdbool.h>
+
+#define BENCH_MAX_FRAMES 100000
+
+int parse_bench_arguments(int argc, char** argv);
+int set_bench_hints(void);
+bool bench_enabled(void);
+
+int start_bench(void);
+int record_bench_frame(bool* quit);
+int write_bench_report(void);
+
+#endif  // BENCH_H
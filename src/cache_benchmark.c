@@ -0,0 +1,364 @@
+#define _DEFAULT_SOURCE
+
+#include <SDL2/SDL.h>
+#include <errno.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include "asset_loader.h"
+#include "asset_pack.h"
+#include "assert.h"
+#include "embed/09_the_viewport.pack.h"
+#include "embed/10_color_keying.pack.h"
+#include "sdl_common.h"
+#include "texture_cache.h"
+#include "trace.h"
+
+/*  Texture cache benchmark
+
+    Loads three textures through texture_cache.h: earth_background.png.raw and space_shuttle_colorkey.png.raw
+    (pre-decoded, from the 10_color_keying pack) and viewport.png (decoded by SDL_image, from the 09_the_viewport
+    pack), and times:
+
+        acquire (cold)      every texture loaded again, a zero budget evicts it as soon as it is released
+        acquire (cached)    every texture found resident, what a scene transition costs with the cache
+
+    Before timing, the loader and the cache are checked step by step against the expected hits, misses, evictions and
+    resident bytes: the loader's miss, hit and insert race (the same asset queued twice before either upload), and
+    acquire, release, evict and re-acquire under a budget that holds two of the textures. Runs headless on the dummy
+    video driver with the software renderer; results go to stderr:
+
+        bin/cache_benchmark [iterations] > /dev/null
+*/
+
+#define DEFAULT_ITERATIONS 100L
+#define MAX_ITERATIONS 100000L
+#define CACHE_CAPACITY 4
+#define TEXTURE_COUNT 3
+
+struct cached_asset {
+    const char* name;
+    struct asset asset;
+    struct sdl_texture texture;
+};
+
+int get_elapsed_ns(const struct timespec* start, int64_t* elapsed_ns);
+int parse_cache_arguments(int argc, char** argv, long* iterations);
+int check_cache_counters(const struct texture_cache* cache, const char* step, const uint64_t hits,
+                         const uint64_t misses, const uint64_t evictions, const size_t bytes);
+int get_cached_bytes(const struct texture_cache* cache, const struct sdl_texture* texture, size_t* bytes);
+int acquire_asset(struct texture_cache* cache, struct cached_asset* asset);
+int check_loader(struct texture_cache* cache, SDL_Renderer* renderer, struct cached_asset* assets);
+int check_eviction(struct texture_cache* cache, struct cached_asset* assets);
+int benchmark_acquire(const char* name, SDL_Renderer* renderer, struct cached_asset* assets, const long iterations,
+                      const bool cached);
+int run_benchmarks(SDL_Renderer* renderer, struct cached_asset* assets, const long iterations);
+int main(int argc, char** argv);
+
+int get_elapsed_ns(const struct timespec* start, int64_t* elapsed_ns) {
+    struct timespec end;
+    int return_code = 0;
+
+    ASSERT(start != NULL && elapsed_ns != NULL, return -1;, "Arguments must not be NULL");
+
+    return_code = clock_gettime(CLOCK_MONOTONIC, &end);
+    ASSERT(return_code == 0, return -1;, "clock_gettime error=[%s]", strerror(errno));
+
+    *elapsed_ns = ((int64_t)end.tv_sec - (int64_t)start->tv_sec) * 1000000000LL +
+                  ((int64_t)end.tv_nsec - (int64_t)start->tv_nsec);
+    return 0;
+}
+
+int parse_cache_arguments(int argc, char** argv, long* iterations) {
+    char* end = NULL;
+
+    ASSERT(argv != NULL, return -1;, "Argument argv must not be NULL");
+    ASSERT(iterations != NULL, return -1;, "Argument iterations must not be NULL");
+
+    *iterations = DEFAULT_ITERATIONS;
+    if (argc > 1) {
+        errno = 0;
+        *iterations = strtol(argv[1], &end, 10);
+        ASSERT(errno == 0 && end != argv[1] && *end == '\0' && *iterations > 0 && *iterations <= MAX_ITERATIONS,
+               return -1;, "Usage: %s [iterations] > /dev/null  (1 <= iterations <= %ld)", argv[0], MAX_ITERATIONS);
+    }
+    return 0;
+}
+
+int check_cache_counters(const struct texture_cache* cache, const char* step, const uint64_t hits,
+                         const uint64_t misses, const uint64_t evictions, const size_t bytes) {
+    ASSERT(cache != NULL && step != NULL, return -1;, "Arguments must not be NULL");
+
+    ASSERT(cache->hits == hits && cache->misses == misses && cache->evictions == evictions && cache->bytes == bytes,
+           return -1;
+           , "Step %s hits=[%llu/%llu] misses=[%llu/%llu] evictions=[%llu/%llu] bytes=[%zu/%zu] (actual/expected)",
+           step, (unsigned long long)cache->hits, (unsigned long long)hits, (unsigned long long)cache->misses,
+           (unsigned long long)misses, (unsigned long long)cache->evictions, (unsigned long long)evictions,
+           cache->bytes, bytes);
+    return 0;
+}
+
+int get_cached_bytes(const struct texture_cache* cache, const struct sdl_texture* texture, size_t* bytes) {
+    int index = 0;
+
+    ASSERT(cache != NULL && texture != NULL && bytes != NULL, return -1;, "Arguments must not be NULL");
+
+    for (index = 0; index < cache->capacity; index++) {
+        if (texture->texture != NULL && cache->entries[index].texture.texture == texture->texture) {
+            break;
+        }
+    }
+    ASSERT(index < cache->capacity, return -1;, "Texture not in the cache");
+
+    *bytes = cache->entries[index].bytes;
+    return 0;
+}
+
+int acquire_asset(struct texture_cache* cache, struct cached_asset* asset) {
+    int return_code = 0;
+
+    ASSERT(cache != NULL && asset != NULL, return -1;, "Arguments must not be NULL");
+
+    // Same key as the loader uses, so both find each other's textures
+    return_code = acquire_texture(cache, &(asset->texture), asset->asset.data, asset->asset.size, NULL,
+                                  SDL_ScaleModeBest, SDL_BLENDMODE_BLEND);
+    ASSERT(return_code == 0, return -1;, "acquire_texture error name=[%s]", asset->name);
+    return 0;
+}
+
+// Earth is queued twice before either upload, both miss and the second upload finds the first one inserted
+int check_loader(struct texture_cache* cache, SDL_Renderer* renderer, struct cached_asset* assets) {
+    struct asset_loader loader;
+    struct sdl_texture earth_again = {0};
+    struct sdl_texture earth_third = {0};
+    size_t bytes = 0;
+    size_t earth_bytes = 0;
+    int return_code = 0;
+
+    ASSERT(cache != NULL && renderer != NULL && assets != NULL, return -1;, "Arguments must not be NULL");
+
+    return_code = create_asset_loader(&loader, 0);
+    ASSERT(return_code == 0, return -1;, "create_asset_loader error");
+    set_asset_loader_cache(&loader, cache);
+
+    return_code = queue_texture_raw(&loader, &(assets[0].texture), assets[0].asset.data, assets[0].asset.size);
+    if (return_code == 0) {
+        return_code = queue_texture_raw(&loader, &earth_again, assets[0].asset.data, assets[0].asset.size);
+    }
+    if (return_code == 0) {
+        return_code = queue_texture_embedded(&loader, &(assets[1].texture), assets[1].asset.data, assets[1].asset.size,
+                                             NULL);
+    }
+    if (return_code == 0) {
+        return_code = run_loading_screen(&loader, renderer);
+    }
+    destroy_asset_loader(&loader);
+    ASSERT(return_code == 0, return -1;, "Loading through the cache failed");
+
+    ASSERT(earth_again.texture == assets[0].texture.texture, return -1;, "Insert race kept two copies of a texture");
+    return_code = get_cached_bytes(cache, &(assets[0].texture), &earth_bytes);
+    ASSERT(return_code == 0, return -1;, "get_cached_bytes error");
+    return_code = get_cached_bytes(cache, &(assets[1].texture), &bytes);
+    ASSERT(return_code == 0, return -1;, "get_cached_bytes error");
+    bytes += earth_bytes;
+    return_code = check_cache_counters(cache, "loader miss", 1, 3, 0, bytes);
+    ASSERT(return_code == 0, return -1;, "check_cache_counters error");
+
+    // Loaded again, a hit queues nothing
+    return_code = create_asset_loader(&loader, 1);
+    ASSERT(return_code == 0, return -1;, "create_asset_loader error");
+    set_asset_loader_cache(&loader, cache);
+    return_code = queue_texture_raw(&loader, &earth_third, assets[0].asset.data, assets[0].asset.size);
+    if (return_code == 0) {
+        ASSERT(loader.job_count == 0, return_code = -1;, "Cache hit queued a job jobs=[%d]", loader.job_count);
+    }
+    destroy_asset_loader(&loader);
+    ASSERT(return_code == 0, return -1;, "Loading from the cache failed");
+    ASSERT(earth_third.texture == assets[0].texture.texture, return -1;, "Cache hit handed out another texture");
+    return_code = check_cache_counters(cache, "loader hit", 2, 3, 0, bytes);
+    ASSERT(return_code == 0, return -1;, "check_cache_counters error");
+
+    release_texture(cache, &earth_third);
+    release_texture(cache, &earth_again);
+    return 0;
+}
+
+// Continues from check_loader(), earth (0) and viewport (1) acquired; the budget holds just those two
+int check_eviction(struct texture_cache* cache, struct cached_asset* assets) {
+    size_t earth_bytes = 0;
+    size_t viewport_bytes = 0;
+    size_t shuttle_bytes = 0;
+    int return_code = 0;
+
+    ASSERT(cache != NULL && assets != NULL, return -1;, "Arguments must not be NULL");
+
+    return_code = get_cached_bytes(cache, &(assets[0].texture), &earth_bytes);
+    ASSERT(return_code == 0, return -1;, "get_cached_bytes error");
+    return_code = get_cached_bytes(cache, &(assets[1].texture), &viewport_bytes);
+    ASSERT(return_code == 0, return -1;, "get_cached_bytes error");
+    // budget is a plain field, tightened here to what is resident
+    cache->budget = earth_bytes + viewport_bytes;
+
+    // Released, both stay resident
+    release_texture(cache, &(assets[0].texture));
+    release_texture(cache, &(assets[1].texture));
+    return_code = check_cache_counters(cache, "release", 2, 3, 0, earth_bytes + viewport_bytes);
+    ASSERT(return_code == 0, return -1;, "check_cache_counters error");
+
+    // The shuttle needs room, earth was released first and goes
+    return_code = acquire_asset(cache, &(assets[2]));
+    ASSERT(return_code == 0, return -1;, "acquire_asset error");
+    return_code = get_cached_bytes(cache, &(assets[2].texture), &shuttle_bytes);
+    ASSERT(return_code == 0, return -1;, "get_cached_bytes error");
+    ASSERT(shuttle_bytes <= earth_bytes, return -1;, "Shuttle bytes=[%zu] larger than earth bytes=[%zu]", shuttle_bytes,
+           earth_bytes);
+    return_code = check_cache_counters(cache, "evict", 2, 4, 1, viewport_bytes + shuttle_bytes);
+    ASSERT(return_code == 0, return -1;, "check_cache_counters error");
+
+    // Viewport is still resident; earth is loaded again over budget, every other texture being referenced
+    return_code = acquire_asset(cache, &(assets[1]));
+    ASSERT(return_code == 0, return -1;, "acquire_asset error");
+    return_code = acquire_asset(cache, &(assets[0]));
+    ASSERT(return_code == 0, return -1;, "acquire_asset error");
+    return_code = check_cache_counters(cache, "re-acquire", 3, 5, 1, earth_bytes + viewport_bytes + shuttle_bytes);
+    ASSERT(return_code == 0, return -1;, "check_cache_counters error");
+
+    // Releasing the shuttle first puts the cache over budget until the shuttle is evicted, the other two stay
+    release_texture(cache, &(assets[2].texture));
+    release_texture(cache, &(assets[1].texture));
+    release_texture(cache, &(assets[0].texture));
+    return_code = check_cache_counters(cache, "back under budget", 3, 5, 2, earth_bytes + viewport_bytes);
+    ASSERT(return_code == 0, return -1;, "check_cache_counters error");
+
+    return 0;
+}
+
+int benchmark_acquire(const char* name, SDL_Renderer* renderer, struct cached_asset* assets, const long iterations,
+                      const bool cached) {
+    struct texture_cache cache = {0};
+    struct timespec start;
+    int64_t elapsed_ns = 0;
+    long counter = 0;
+    int index = 0;
+    int return_code = 0;
+
+    // A zero budget evicts every texture on release, so each acquire loads it again
+    return_code = create_texture_cache(&cache, renderer, CACHE_CAPACITY, (cached == true) ? SIZE_MAX : 0);
+    ASSERT(return_code == 0, return -1;, "create_texture_cache error");
+
+    // One untimed pass, so the cached run starts resident
+    for (index = 0; index < TEXTURE_COUNT && return_code == 0; index++) {
+        return_code = acquire_asset(&cache, &(assets[index]));
+        release_texture(&cache, &(assets[index].texture));
+    }
+    ASSERT(return_code == 0, destroy_texture_cache(&cache); return -1;, "acquire_asset error");
+
+    return_code = clock_gettime(CLOCK_MONOTONIC, &start);
+    ASSERT(return_code == 0, destroy_texture_cache(&cache); return -1;, "clock_gettime error=[%s]", strerror(errno));
+
+    for (counter = 0; counter < iterations && return_code == 0; counter++) {
+        for (index = 0; index < TEXTURE_COUNT && return_code == 0; index++) {
+            return_code = acquire_asset(&cache, &(assets[index]));
+            release_texture(&cache, &(assets[index].texture));
+        }
+    }
+
+    if (return_code == 0) {
+        return_code = get_elapsed_ns(&start, &elapsed_ns);
+    }
+    if (return_code == 0) {
+        fprintf(stderr, "%-24s iterations=[%ld] hits=[%llu] misses=[%llu] total=[%.3f ms] per_texture=[%.1f us]\n",
+                name, iterations, (unsigned long long)cache.hits, (unsigned long long)cache.misses,
+                (double)elapsed_ns / 1000000.0, (double)elapsed_ns / (double)(iterations * TEXTURE_COUNT) / 1000.0);
+    }
+    destroy_texture_cache(&cache);
+    ASSERT(return_code == 0, return -1;, "Benchmark failed");
+    return 0;
+}
+
+int run_benchmarks(SDL_Renderer* renderer, struct cached_asset* assets, const long iterations) {
+    struct texture_cache cache = {0};
+    int index = 0;
+    int level = 0;
+    int return_code = 0;
+
+    return_code = create_texture_cache(&cache, renderer, CACHE_CAPACITY, SIZE_MAX);
+    ASSERT(return_code == 0, return -1;, "create_texture_cache error");
+
+    return_code = check_loader(&cache, renderer, assets);
+    if (return_code == 0) {
+        return_code = check_eviction(&cache, assets);
+    }
+    for (index = 0; index < TEXTURE_COUNT; index++) {
+        if (assets[index].texture.texture != NULL) {
+            release_texture(&cache, &(assets[index].texture));
+        }
+    }
+    destroy_texture_cache(&cache);
+    ASSERT(return_code == 0, return -1;, "Texture cache check failed");
+    fprintf(stderr, "%-24s textures=[%d] ok\n", "check", TEXTURE_COUNT);
+
+    // The zero budget warns on every insert, only errors are traced while timing
+    level = trace_level;
+    return_code = set_trace_level(TRACE_LEVEL_ERROR);
+    ASSERT(return_code == 0, return -1;, "set_trace_level error");
+
+    return_code = benchmark_acquire("acquire (cold)", renderer, assets, iterations, false);
+    if (return_code == 0) {
+        return_code = benchmark_acquire("acquire (cached)", renderer, assets, iterations, true);
+    }
+    (void)set_trace_level(level);
+    ASSERT(return_code == 0, return -1;, "Benchmark failed");
+    return 0;
+}
+
+int main(int argc, char** argv) {
+    struct sdl_system system = {0};
+    struct asset_pack keying_pack = {0};
+    struct asset_pack viewport_pack = {0};
+    struct cached_asset assets[TEXTURE_COUNT] = {
+        {.name = "earth_background.png.raw"},
+        {.name = "viewport.png"},
+        {.name = "space_shuttle_colorkey.png.raw"},
+    };
+    long iterations = 0;
+    int return_code = 0;
+
+    return_code = parse_cache_arguments(argc, argv, &iterations);
+    ASSERT(return_code == 0, return -1;, "parse_cache_arguments error");
+
+    // The textures need a renderer, nothing is presented but the loading screen
+    SDL_SetHint(SDL_HINT_VIDEODRIVER, "dummy");
+    SDL_SetHint(SDL_HINT_RENDER_DRIVER, "software");
+    return_code = init_SDL(&system, "Texture cache benchmark", SDL_RENDERER_SOFTWARE);
+    ASSERT(return_code == 0, close_SDL(&system); return -1;, "init_SDL error");
+
+    return_code = load_asset_pack(&keying_pack, _embed_10_color_keying_pack_start, _embed_10_color_keying_pack_size);
+    if (return_code == 0) {
+        return_code =
+            load_asset_pack(&viewport_pack, _embed_09_the_viewport_pack_start, _embed_09_the_viewport_pack_size);
+    }
+    if (return_code == 0) {
+        return_code = find_asset(&keying_pack, assets[0].name, &(assets[0].asset));
+    }
+    if (return_code == 0) {
+        return_code = find_asset(&viewport_pack, assets[1].name, &(assets[1].asset));
+    }
+    if (return_code == 0) {
+        return_code = find_asset(&keying_pack, assets[2].name, &(assets[2].asset));
+    }
+    if (return_code == 0) {
+        return_code = run_benchmarks(system.renderer, assets, iterations);
+    }
+
+    close_asset_pack(&viewport_pack);
+    close_asset_pack(&keying_pack);
+    close_SDL(&system);
+    ASSERT(return_code == 0, return -1;, "Texture cache benchmark failed");
+
+    return 0;
+}
@@ -0,0 +1,204 @@
+#define _DEFAULT_SOURCE
+#define ZLIB_CONST
+
+#include "embed_rwops.h"
+
+#include <SDL2/SDL.h>
+#include <limits.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <zlib.h>
+
+#include "assert.h"
+#include "trace.h"
+
+// gzip member: 10 byte header, deflate data, CRC32 and ISIZE (uncompressed size modulo 2^32, little endian)
+#define GZIP_HEADER_SIZE 10
+#define GZIP_TRAILER_SIZE 8
+
+struct embed_stream {
+    z_stream zstream;
+    uint8_t* arena;   // decompressed asset, filled up to inflated
+    size_t length;    // decompressed size
+    size_t inflated;  // bytes of arena already valid
+    size_t position;  // read position
+    bool finished;    // inflate returned Z_STREAM_END
+};
+
+static bool is_gzip(const uint8_t* data, const size_t size) {
+    return size >= GZIP_HEADER_SIZE + GZIP_TRAILER_SIZE && data[0] == 0x1F && data[1] == 0x8B && data[2] == 0x08;
+}
+
+static int inflate_until(struct embed_stream* stream, const size_t target) {
+    int return_code = 0;
+
+    while (stream->inflated < target) {
+        // Small reads still inflate a whole chunk, so a header parser reading a few bytes at a time stays cheap
+        size_t chunk = (target - stream->inflated > EMBED_INFLATE_CHUNK) ? target - stream->inflated
+                                                                         : EMBED_INFLATE_CHUNK;
+
+        ASSERT(stream->finished == false, return -1;, "Compressed stream ended at inflated=[%zu] of length=[%zu]",
+               stream->inflated, stream->length);
+
+        if (chunk > stream->length - stream->inflated) {
+            chunk = stream->length - stream->inflated;
+        }
+        stream->zstream.next_out = stream->arena + stream->inflated;
+        stream->zstream.avail_out = (uInt)chunk;
+
+        return_code = inflate(&stream->zstream, Z_NO_FLUSH);
+        ASSERT(return_code == Z_OK || return_code == Z_STREAM_END, return -1;, "inflate error=[%d] msg=[%s]",
+               return_code, (stream->zstream.msg != NULL) ? stream->zstream.msg : "");
+
+        stream->inflated += chunk - stream->zstream.avail_out;
+        if (return_code == Z_STREAM_END) {
+            stream->finished = true;
+            ASSERT(stream->inflated == stream->length, return -1;, "Decompressed size=[%zu] expected=[%zu]",
+                   stream->inflated, stream->length);
+        }
+    }
+
+    return 0;
+}
+
+static Sint64 embed_stream_size(SDL_RWops* context) {
+    const struct embed_stream* stream = context->hidden.unknown.data1;
+
+    return (Sint64)stream->length;
+}
+
+static Sint64 embed_stream_seek(SDL_RWops* context, Sint64 offset, int whence) {
+    struct embed_stream* stream = context->hidden.unknown.data1;
+    Sint64 position = 0;
+
+    switch (whence) {
+        case RW_SEEK_SET: {
+            position = offset;
+            break;
+        }
+        case RW_SEEK_CUR: {
+            position = (Sint64)stream->position + offset;
+            break;
+        }
+        case RW_SEEK_END: {
+            position = (Sint64)stream->length + offset;
+            break;
+        }
+        default: {
+            return SDL_SetError("Unknown seek whence=[%d]", whence);
+        }
+    }
+    if (position < 0 || position > (Sint64)stream->length) {
+        return SDL_SetError("Seek position=[%lld] outside of stream length=[%zu]", (long long)position, stream->length);
+    }
+
+    // Nothing is inflated here, a read decides how far the data is actually needed
+    stream->position = (size_t)position;
+    return position;
+}
+
+static size_t embed_stream_read(SDL_RWops* context, void* ptr, size_t size, size_t maxnum) {
+    struct embed_stream* stream = context->hidden.unknown.data1;
+    size_t available = stream->length - stream->position;
+    size_t count = 0;
+    int return_code = 0;
+
+    if (size == 0) {
+        return 0;
+    }
+    count = (maxnum <= available / size) ? maxnum : available / size;
+    if (count == 0) {
+        return 0;
+    }
+
+    return_code = inflate_until(stream, stream->position + count * size);
+    if (return_code != 0) {
+        SDL_SetError("inflate_until error");
+        return 0;
+    }
+
+    memcpy(ptr, stream->arena + stream->position, count * size);
+    stream->position += count * size;
+    return count;
+}
+
+static size_t embed_stream_write(SDL_RWops* context, const void* ptr, size_t size, size_t num) {
+    (void)context;
+    (void)ptr;
+    (void)size;
+    (void)num;
+
+    SDL_SetError("Embedded assets are read-only");
+    return 0;
+}
+
+static int embed_stream_close(SDL_RWops* context) {
+    struct embed_stream* stream = NULL;
+
+    if (context == NULL) {
+        return 0;
+    }
+
+    stream = context->hidden.unknown.data1;
+    if (stream != NULL) {
+        TRACE_DEBUG("Closing compressed stream inflated=[%zu] length=[%zu]", stream->inflated, stream->length);
+        inflateEnd(&stream->zstream);
+        free(stream->arena);
+        free(stream);
+    }
+    SDL_FreeRW(context);
+
+    return 0;
+}
+
+SDL_RWops* open_embedded_rwops(const void* data, const size_t size) {
+    const uint8_t* bytes = data;
+    struct embed_stream* stream = NULL;
+    SDL_RWops* rwops = NULL;
+    size_t length = 0;
+    int return_code = 0;
+
+    ASSERT(data != NULL, return NULL;, "Argument data must not be NULL");
+    ASSERT(size > 0, return NULL;, "Argument size must be larger than 0");
+    ASSERT(size <= INT_MAX, return NULL;, "Argument size must not exceed maximum allowed");
+
+    if (is_gzip(bytes, size) == false) {
+        rwops = SDL_RWFromConstMem(data, (int)size);
+        ASSERT(rwops != NULL, return NULL;, "SDL_RWFromConstMem error=[%s]", SDL_GetError());
+        return rwops;
+    }
+
+    length = (size_t)bytes[size - 4] | ((size_t)bytes[size - 3] << 8) | ((size_t)bytes[size - 2] << 16) |
+             ((size_t)bytes[size - 1] << 24);
+    ASSERT(length > 0 && length <= INT_MAX, return NULL;, "Invalid gzip trailer size=[%zu]", length);
+    TRACE("Opening compressed stream compressed=[%zu] length=[%zu]", size, length);
+
+    stream = calloc(1, sizeof(*stream));
+    ASSERT(stream != NULL, return NULL;, "calloc error");
+
+    stream->arena = malloc(length);
+    ASSERT(stream->arena != NULL, free(stream); return NULL;, "malloc error length=[%zu]", length);
+    stream->length = length;
+
+    // 16 + MAX_WBITS: expect and check the gzip wrapper instead of a zlib one
+    stream->zstream.next_in = bytes;
+    stream->zstream.avail_in = (uInt)size;
+    return_code = inflateInit2(&stream->zstream, 16 + MAX_WBITS);
+    ASSERT(return_code == Z_OK, free(stream->arena); free(stream); return NULL;
+           , "inflateInit2 error=[%d]", return_code);
+
+    rwops = SDL_AllocRW();
+    ASSERT(rwops != NULL, inflateEnd(&stream->zstream); free(stream->arena); free(stream); return NULL;
+           , "SDL_AllocRW error=[%s]", SDL_GetError());
+
+    rwops->size = embed_stream_size;
+    rwops->seek = embed_stream_seek;
+    rwops->read = embed_stream_read;
+    rwops->write = embed_stream_write;
+    rwops->close = embed_stream_close;
+    rwops->type = SDL_RWOPS_UNKNOWN;
+    rwops->hidden.unknown.data1 = stream;
+    return rwops;
+}
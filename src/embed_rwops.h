@@ -0,0 +1,26 @@
+#ifndef EMBED_RWOPS_H
+#define EMBED_RWOPS_H
+
+/*  Embedded asset streams
+
+    open_embedded_rwops() opens an SDL_RWops over an asset linked in by embed.sh, whichever way it was stored. Plain
+    assets get SDL_RWFromConstMem(). Assets embedded with embed.sh --gzip are recognized by the gzip magic bytes and
+    get a read-only stream that inflates on the fly: the decompressed size comes from the gzip trailer, a scratch
+    buffer of that size is allocated when the stream opens, and reads inflate only up to the furthest byte asked for,
+    at least EMBED_INFLATE_CHUNK bytes at a time. Seeking backwards just moves the position inside what is already
+    inflated, so random access readers such as FreeType behave as with plain memory. The buffer is freed when the
+    stream is closed, by SDL_RWclose() or by the loader given freesrc=1.
+
+    The loaders (load_texture_embedded(), load_font_embedded(), the tutorials' load_*_embedded()) call it instead of
+    SDL_RWFromConstMem(), so their call sites do not change when an asset switches to compressed storage; only the
+    makefile decides, through EMBED_FLAGS. Programs pulling this module link zlib (-lz).
+*/
+
+#include <SDL2/SDL.h>
+#include <stddef.h>
+
+#define EMBED_INFLATE_CHUNK (64 * 1024)
+
+SDL_RWops* open_embedded_rwops(const void* data, const size_t size);
+
+#endif  // EMBED_RWOPS_H
@@ -0,0 +1,123 @@
+#define _DEFAULT_SOURCE
+
+#include "frame_loop.h"
+
+#include <errno.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <string.h>
+#include <time.h>
+
+#include "assert.h"
+#include "bench.h"
+#include "frame_pacer.h"
+#include "trace.h"
+
+static int64_t get_monotonic_ns(void) {
+    struct timespec now;
+    int return_code = 0;
+    int error_num = 0;
+
+    return_code = clock_gettime(CLOCK_MONOTONIC, &now);
+    error_num = errno;
+    ASSERT(return_code == 0, return -1;, "clock_gettime error=[%s]", strerror(error_num));
+
+    return (int64_t)now.tv_sec * 1000000000LL + (int64_t)now.tv_nsec;
+}
+
+int start_frame_loop(struct frame_loop* loop, const int update_rate) {
+    int return_code = 0;
+
+    ASSERT(loop != NULL, return -1;, "Argument loop must not be NULL");
+    ASSERT(update_rate > 0 && update_rate <= 1000, return -1;, "Argument update_rate=[%d] must be between 1 and 1000",
+           update_rate);
+
+    memset(loop, 0, sizeof(*loop));
+    loop->step_ns = 1000000000LL / update_rate;
+    loop->frame_start_ns = get_monotonic_ns();
+    ASSERT(loop->frame_start_ns >= 0, return -1;, "get_monotonic_ns error");
+
+    TRACE("Frame loop update_rate=[%d] step=[%.3f ms]", update_rate, (double)loop->step_ns / 1000000.0);
+
+    return_code = start_frame_pacer(&loop->pacer, update_rate);
+    ASSERT(return_code == 0, return -1;, "start_frame_pacer error");
+    return 0;
+}
+
+int begin_loop_frame(struct frame_loop* loop) {
+    int64_t max_accumulator_ns = 0;
+    int64_t now_ns = 0;
+    int64_t frame_ns = 0;
+
+    ASSERT(loop != NULL && loop->step_ns > 0, return -1;, "Argument loop must be started with start_frame_loop");
+
+    now_ns = get_monotonic_ns();
+    ASSERT(now_ns >= 0, return -1;, "get_monotonic_ns error");
+    frame_ns = now_ns - loop->frame_start_ns;
+    loop->frame_start_ns = now_ns;
+    loop->frames++;
+
+    // Benchmark runs simulate one step per frame, whatever the frame took
+    if (bench_enabled() == true) {
+        frame_ns = loop->step_ns;
+    } else if (frame_ns > FRAME_LOOP_MAX_FRAME_NS) {
+        TRACE_DEBUG("Frame clamped frame=[%.3f ms]", (double)frame_ns / 1000000.0);
+        frame_ns = FRAME_LOOP_MAX_FRAME_NS;
+        loop->clamped_frames++;
+    }
+
+    // Spiral of death guard, a frame never owes more than FRAME_LOOP_MAX_UPDATES updates
+    max_accumulator_ns = loop->step_ns * FRAME_LOOP_MAX_UPDATES;
+    loop->accumulator_ns += frame_ns;
+    if (loop->accumulator_ns > max_accumulator_ns) {
+        loop->dropped_ns += loop->accumulator_ns - max_accumulator_ns;
+        loop->accumulator_ns = max_accumulator_ns;
+    }
+    return 0;
+}
+
+bool next_loop_update(struct frame_loop* loop) {
+    ASSERT(loop != NULL, return false;, "Argument loop must not be NULL");
+
+    if (loop->step_ns <= 0 || loop->accumulator_ns < loop->step_ns) {
+        return false;
+    }
+
+    loop->accumulator_ns -= loop->step_ns;
+    loop->previous_time_ns = loop->time_ns;
+    loop->time_ns += loop->step_ns;
+    loop->updates++;
+    return true;
+}
+
+double get_loop_alpha(const struct frame_loop* loop) {
+    ASSERT(loop != NULL, return 0.0;, "Argument loop must not be NULL");
+
+    if (loop->step_ns <= 0) {
+        return 0.0;
+    }
+    return (double)loop->accumulator_ns / (double)loop->step_ns;
+}
+
+double get_loop_time(const struct frame_loop* loop) {
+    ASSERT(loop != NULL, return 0.0;, "Argument loop must not be NULL");
+
+    return ((double)loop->previous_time_ns +
+            get_loop_alpha(loop) * (double)(loop->time_ns - loop->previous_time_ns)) /
+           1000000000.0;
+}
+
+int end_loop_frame(struct frame_loop* loop) {
+    TRACE_SPAN("end_loop_frame");
+    int return_code = 0;
+
+    ASSERT(loop != NULL && loop->step_ns > 0, return -1;, "Argument loop must be started with start_frame_loop");
+
+    if (bench_enabled() == true) {
+        return 0;
+    }
+
+    return_code = pace_frame(&loop->pacer);
+    ASSERT(return_code == 0, return -1;, "pace_frame error");
+    return 0;
+}
@@ -0,0 +1,71 @@
+#ifndef FRAME_LOOP_H
+#define FRAME_LOOP_H
+
+/*  Frame loop
+
+    Fixed timestep driver for the tutorial main loops: the simulation advances in updates of one fixed step however
+    long frames take, and each frame is drawn between the last two updates. Part of build/libsdlcommon.a.
+
+        start_frame_loop(&loop, 60);
+        while (quit == false) {
+            begin_loop_frame(&loop);
+            while (next_loop_update(&loop) == true) {
+                previous = current;
+                ...                                     // advance current by loop.step_ns
+            }
+            ...                                         // draw previous + get_loop_alpha(&loop) * (current - previous)
+            end_loop_frame(&loop);                      // programs presenting without vsync
+        }
+
+    begin_loop_frame() adds the CLOCK_MONOTONIC time since the previous frame to an accumulator, clamped to
+    FRAME_LOOP_MAX_FRAME_NS so a breakpoint or a dragged window does not come back as seconds of catching up.
+    next_loop_update() then returns true once per whole step in the accumulator. The accumulator never holds more
+    than FRAME_LOOP_MAX_UPDATES steps, the rest is dropped and counted in dropped_ns: when updates cost more than the
+    time they simulate, each frame would otherwise owe more updates than the one before (the spiral of death), where
+    this way the simulation slows down instead.
+
+    get_loop_alpha() is the fraction of a step left in the accumulator. The tutorials keep their animation state per
+    update and draw their previous and current state blended by it; state that cannot be blended, like a sprite frame
+    index, draws the nearer of the two. get_loop_time() interpolates the same way between the simulated times of the
+    last two updates, in seconds. Drawing lags one update behind,
+    in exchange motion is smooth at any frame rate and the same updates run on every machine. Simulated time is kept
+    in integer nanoseconds, so it does not drift however long the program runs.
+
+    end_loop_frame() waits for the next frame deadline of pacer (frame_pacer.h), started at update_rate: a frame that
+    took 10 ms of a 16.7 ms step waits 6.7 ms, to within a fraction of a millisecond. start_frame_pacer(&loop.pacer,
+    rate) after start_frame_loop() draws at another rate, the updates keep their step. Programs presenting with vsync
+    are paced by the display and do not call it.
+
+    In benchmark mode (bench.h) every frame runs exactly one update and end_loop_frame() returns at once, so a run
+    draws the same frames whatever the frame rate.
+*/
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#include "frame_pacer.h"
+
+#define FRAME_LOOP_MAX_FRAME_NS 250000000LL
+#define FRAME_LOOP_MAX_UPDATES 8
+
+struct frame_loop {
+    int64_t step_ns;
+    int64_t accumulator_ns;
+    int64_t time_ns;           // simulated, a whole number of steps
+    int64_t previous_time_ns;  // before the last update
+    int64_t frame_start_ns;    // CLOCK_MONOTONIC
+    uint64_t frames;
+    uint64_t updates;
+    uint64_t clamped_frames;
+    int64_t dropped_ns;
+    struct frame_pacer pacer;
+};
+
+int start_frame_loop(struct frame_loop* loop, const int update_rate);
+int begin_loop_frame(struct frame_loop* loop);
+bool next_loop_update(struct frame_loop* loop);
+double get_loop_alpha(const struct frame_loop* loop);
+double get_loop_time(const struct frame_loop* loop);
+int end_loop_frame(struct frame_loop* loop);
+
+#endif  // FRAME_LOOP_H
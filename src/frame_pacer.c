@@ -0,0 +1,124 @@
+#define _DEFAULT_SOURCE
+
+#include "frame_pacer.h"
+
+#include <errno.h>
+#include <math.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include "assert.h"
+#include "trace.h"
+
+static int64_t get_monotonic_ns(void) {
+    struct timespec now;
+    int return_code = 0;
+    int error_num = 0;
+
+    return_code = clock_gettime(CLOCK_MONOTONIC, &now);
+    error_num = errno;
+    ASSERT(return_code == 0, return -1;, "clock_gettime error=[%s]", strerror(error_num));
+
+    return (int64_t)now.tv_sec * 1000000000LL + (int64_t)now.tv_nsec;
+}
+
+static int sleep_until_ns(const int64_t deadline_ns) {
+    struct timespec deadline;
+    int return_code = 0;
+
+    deadline.tv_sec = (time_t)(deadline_ns / 1000000000LL);
+    deadline.tv_nsec = (long)(deadline_ns % 1000000000LL);
+
+    // An absolute deadline stays the same when a signal interrupts the sleep, so it is simply slept on again
+    do {
+        return_code = clock_nanosleep(CLOCK_MONOTONIC, TIMER_ABSTIME, &deadline, NULL);
+    } while (return_code == EINTR);
+    ASSERT(return_code == 0, return -1;, "clock_nanosleep error=[%s]", strerror(return_code));
+
+    return 0;
+}
+
+int start_frame_pacer(struct frame_pacer* pacer, const int rate) {
+    ASSERT(pacer != NULL, return -1;, "Argument pacer must not be NULL");
+    ASSERT(rate > 0 && rate <= 1000, return -1;, "Argument rate=[%d] must be between 1 and 1000", rate);
+
+    memset(pacer, 0, sizeof(*pacer));
+    pacer->rate = rate;
+    pacer->period_ns = 1000000000LL / rate;
+    pacer->spin_ns = FRAME_PACER_MAX_SPIN_NS / 2;
+    pacer->deadline_ns = get_monotonic_ns();
+    ASSERT(pacer->deadline_ns >= 0, return -1;, "get_monotonic_ns error");
+
+    TRACE("Frame pacer rate=[%d] period=[%.3f ms]", rate, (double)pacer->period_ns / 1000000.0);
+    return 0;
+}
+
+int pace_frame(struct frame_pacer* pacer) {
+    TRACE_SPAN("pace_frame");
+    int64_t now_ns = 0;
+    int64_t sleep_ns = 0;
+    int64_t spin_start_ns = 0;
+    int64_t jitter_ns = 0;
+    int return_code = 0;
+
+    ASSERT(pacer != NULL && pacer->period_ns > 0, return -1;, "Argument pacer must be started with start_frame_pacer");
+
+    now_ns = get_monotonic_ns();
+    ASSERT(now_ns >= 0, return -1;, "get_monotonic_ns error");
+
+    pacer->deadline_ns += pacer->period_ns;
+    if (now_ns - pacer->deadline_ns >= pacer->period_ns) {
+        TRACE_DEBUG("Frame missed late=[%.3f ms]", (double)(now_ns - pacer->deadline_ns) / 1000000.0);
+        pacer->deadline_ns = now_ns;
+        pacer->missed_frames++;
+    }
+
+    // Sleep up to the spin tail, then learn how late the scheduler woke us
+    sleep_ns = pacer->deadline_ns - pacer->spin_ns;
+    if (now_ns < sleep_ns) {
+        return_code = sleep_until_ns(sleep_ns);
+        ASSERT(return_code == 0, return -1;, "sleep_until_ns error");
+        now_ns = get_monotonic_ns();
+        ASSERT(now_ns >= 0, return -1;, "get_monotonic_ns error");
+
+        pacer->spin_ns += (2 * (now_ns - sleep_ns) - pacer->spin_ns) / 8;
+        if (pacer->spin_ns < FRAME_PACER_MIN_SPIN_NS) pacer->spin_ns = FRAME_PACER_MIN_SPIN_NS;
+        if (pacer->spin_ns > FRAME_PACER_MAX_SPIN_NS) pacer->spin_ns = FRAME_PACER_MAX_SPIN_NS;
+    }
+
+    spin_start_ns = now_ns;
+    while (now_ns < pacer->deadline_ns) {
+        now_ns = get_monotonic_ns();
+        ASSERT(now_ns >= 0, return -1;, "get_monotonic_ns error");
+    }
+    pacer->spun_ns += now_ns - spin_start_ns;
+
+    if (pacer->frames > 0) {
+        jitter_ns = llabs((now_ns - pacer->wake_ns) - pacer->period_ns);
+        pacer->jitter_sum_squares += (double)jitter_ns * (double)jitter_ns;
+        if (jitter_ns > pacer->max_jitter_ns) pacer->max_jitter_ns = jitter_ns;
+    }
+    pacer->wake_ns = now_ns;
+    pacer->frames++;
+    return 0;
+}
+
+double get_frame_jitter_ms(const struct frame_pacer* pacer) {
+    ASSERT(pacer != NULL, return 0.0;, "Argument pacer must not be NULL");
+
+    // The first frame has no interval
+    if (pacer->frames < 2) {
+        return 0.0;
+    }
+    return sqrt(pacer->jitter_sum_squares / (double)(pacer->frames - 1)) / 1000000.0;
+}
+
+void trace_frame_pacer(const struct frame_pacer* pacer) {
+    ASSERT(pacer != NULL, return;, "Argument pacer must not be NULL");
+
+    TRACE("Frame pacing rate=[%d] frames=[%llu] missed=[%llu] jitter rms=[%.3f ms] max=[%.3f ms] spun=[%.3f ms]",
+          pacer->rate, (unsigned long long)pacer->frames, (unsigned long long)pacer->missed_frames,
+          get_frame_jitter_ms(pacer), (double)pacer->max_jitter_ns / 1000000.0, (double)pacer->spun_ns / 1000000.0);
+}
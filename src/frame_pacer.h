@@ -0,0 +1,51 @@
+#ifndef FRAME_PACER_H
+#define FRAME_PACER_H
+
+/*  Frame pacer
+
+    Holds a program to a target frame rate on absolute deadlines, so the time a frame takes to draw is not added on
+    top of the frame period. Part of build/libsdlcommon.a; end_loop_frame() (frame_loop.h) paces with it.
+
+        start_frame_pacer(&pacer, 60);
+        while (quit == false) {
+            ...                                         // draw and present
+            pace_frame(&pacer);                         // returns on the next 1/60 s boundary
+        }
+        trace_frame_pacer(&pacer);
+
+    Deadlines are start + n * period on CLOCK_MONOTONIC. pace_frame() sleeps with clock_nanosleep(TIMER_ABSTIME) up
+    to spin_ns before the deadline and busy-waits the rest: the scheduler wakes a sleeper late by its timer slack and
+    wakeup latency, typically tens of microseconds, the spin absorbs that for sub-millisecond accuracy. spin_ns
+    follows twice the oversleep measured on previous frames, between FRAME_PACER_MIN_SPIN_NS and
+    FRAME_PACER_MAX_SPIN_NS, so the CPU only spins as long as this machine needs. A frame that ends past its deadline
+    returns at once and the next one is still due on the original grid; one more than a whole period late is counted
+    in missed_frames and restarts the grid from now, rather than running frames back to back to catch up.
+
+    Every paced frame records its jitter, the interval since the previous return minus the period: trace_frame_pacer()
+    traces the RMS and the largest one, with the missed frames and the time spent spinning.
+*/
+
+#include <stdint.h>
+
+#define FRAME_PACER_MIN_SPIN_NS 50000LL
+#define FRAME_PACER_MAX_SPIN_NS 2000000LL
+
+struct frame_pacer {
+    int rate;
+    int64_t period_ns;
+    int64_t deadline_ns;  // CLOCK_MONOTONIC
+    int64_t spin_ns;
+    int64_t wake_ns;  // last return from pace_frame()
+    uint64_t frames;
+    uint64_t missed_frames;
+    double jitter_sum_squares;  // ns^2
+    int64_t max_jitter_ns;      // absolute
+    int64_t spun_ns;
+};
+
+int start_frame_pacer(struct frame_pacer* pacer, const int rate);
+int pace_frame(struct frame_pacer* pacer);
+double get_frame_jitter_ms(const struct frame_pacer* pacer);
+void trace_frame_pacer(const struct frame_pacer* pacer);
+
+#endif  // FRAME_PACER_H
@@ -0,0 +1,392 @@
+#define _DEFAULT_SOURCE
+
+#include "glyph_atlas.h"
+
+#include <SDL2/SDL.h>
+#include <SDL2/SDL_ttf.h>
+#include <limits.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "assert.h"
+#include "sdl_common.h"
+#include "sprite_batch.h"
+#include "trace.h"
+
+#define UTF8_REPLACEMENT_CHARACTER 0xFFFD
+
+static int find_slot(const struct glyph_atlas* atlas, const TTF_Font* font, const Uint32 codepoint) {
+    const uint64_t hash =
+        ((uint64_t)(uintptr_t)font ^ ((uint64_t)codepoint * 0x9E3779B97F4A7C15u)) * 0xFF51AFD7ED558CCDu;
+    const int mask = atlas->capacity - 1;
+    int slot = (int)((hash >> 32) & (uint64_t)mask);
+
+    // Never full, so probing ends on the glyph or on a free slot
+    while (atlas->glyphs[slot].font != NULL &&
+           (atlas->glyphs[slot].font != font || atlas->glyphs[slot].codepoint != codepoint)) {
+        slot = (slot + 1) & mask;
+    }
+    return slot;
+}
+
+static int rasterize_glyph(struct glyph_atlas* atlas, TTF_Font* font, const Uint32 codepoint, struct glyph* glyph) {
+    TRACE_SPAN("rasterize_glyph");
+    SDL_Surface* surface = NULL;
+    SDL_Surface* converted_surface = NULL;
+    int min_x = 0;
+    int max_x = 0;
+    int min_y = 0;
+    int max_y = 0;
+    int advance = 0;
+    int top = 0;
+    int bottom = 0;
+    int return_code = 0;
+
+    return_code = TTF_GlyphMetrics32(font, codepoint, &min_x, &max_x, &min_y, &max_y, &advance);
+    ASSERT(return_code == 0, return -1;, "TTF_GlyphMetrics32 error=[%s] codepoint=[U+%04X]", TTF_GetError(),
+           codepoint);
+
+    memset(glyph, 0, sizeof(*glyph));
+    glyph->font = font;
+    glyph->codepoint = codepoint;
+    glyph->advance = advance;
+    // SDL_ttf shifts a glyph reaching left of the pen into the surface
+    glyph->offset_x = (min_x < 0) ? min_x : 0;
+
+    // Blank glyphs, like the space, only advance the pen
+    if (max_x <= min_x || max_y <= min_y) {
+        return 0;
+    }
+
+    surface = TTF_RenderGlyph32_Blended(font, codepoint, (SDL_Color){0xFF, 0xFF, 0xFF, 0xFF});
+    ASSERT(surface != NULL, return -1;, "TTF_RenderGlyph32_Blended error=[%s] codepoint=[U+%04X]", TTF_GetError(),
+           codepoint);
+    if (surface->format->format != SDL_PIXELFORMAT_ARGB8888) {
+        converted_surface = SDL_ConvertSurfaceFormat(surface, SDL_PIXELFORMAT_ARGB8888, 0);
+        SDL_FreeSurface(surface);
+        ASSERT(converted_surface != NULL, return -1;, "SDL_ConvertSurfaceFormat error=[%s]", SDL_GetError());
+        surface = converted_surface;
+    }
+
+    // The surface is a whole line high, only the rows between the glyph's top and bottom go into the atlas
+    top = TTF_FontAscent(font) - max_y;
+    top = (top < 0) ? 0 : ((top > surface->h) ? surface->h : top);
+    bottom = TTF_FontAscent(font) - min_y;
+    bottom = (bottom < top) ? top : ((bottom > surface->h) ? surface->h : bottom);
+    if (bottom == top || surface->w == 0) {
+        SDL_FreeSurface(surface);
+        return 0;
+    }
+
+    return_code = pack_shelf(&(atlas->packer), surface->w, bottom - top, &(glyph->clip.x), &(glyph->clip.y));
+    ASSERT(return_code == 0, SDL_FreeSurface(surface); return -1;, "pack_shelf error codepoint=[U+%04X]", codepoint);
+    glyph->clip.w = surface->w;
+    glyph->clip.h = bottom - top;
+    glyph->offset_y = top;
+
+    return_code = SDL_UpdateTexture(atlas->texture.texture, &(glyph->clip),
+                                    (const Uint8*)surface->pixels + (size_t)top * (size_t)surface->pitch,
+                                    surface->pitch);
+    SDL_FreeSurface(surface);
+    ASSERT(return_code == 0, return -1;, "SDL_UpdateTexture error=[%s]", SDL_GetError());
+
+    return 0;
+}
+
+// Shared by drawing and measuring, batch NULL only measures
+static int walk_glyph_text(struct glyph_atlas* atlas, struct sprite_batch* batch, TTF_Font* font, const char* text,
+                           const size_t length, const int x, const int y, int* width, int* height) {
+    const char* end = text + length;
+    const struct glyph* glyph = NULL;
+    const int line_skip = TTF_FontLineSkip(font);
+    Uint32 codepoint = 0;
+    Uint32 previous = 0;
+    int pen_x = x;
+    int pen_y = y;
+    int right = x;
+    int return_code = 0;
+
+    while (text < end && (codepoint = next_utf8_codepoint(&text)) != 0) {
+        if (codepoint == '\n') {
+            pen_x = x;
+            pen_y += line_skip;
+            previous = 0;
+            continue;
+        }
+
+        return_code = find_glyph(atlas, font, codepoint, &glyph);
+        ASSERT(return_code == 0, return -1;, "find_glyph error codepoint=[U+%04X]", codepoint);
+
+        pen_x += glyph_kerning(font, previous, codepoint);
+        if (batch != NULL && glyph->clip.w > 0) {
+            return_code = add_sprite(batch, &(glyph->clip),
+                                     &(SDL_Rect){pen_x + glyph->offset_x, pen_y + glyph->offset_y, glyph->clip.w,
+                                                 glyph->clip.h},
+                                     0.0, NULL, SDL_FLIP_NONE);
+            ASSERT(return_code == 0, return -1;, "add_sprite error");
+        }
+        pen_x += glyph->advance;
+        right = (pen_x > right) ? pen_x : right;
+        previous = codepoint;
+    }
+
+    *width = right - x;
+    *height = pen_y - y + TTF_FontHeight(font);
+    return 0;
+}
+
+void init_shelf_packer(struct shelf_packer* packer, const int width, const int height) {
+    ASSERT(packer != NULL, return;, "Argument packer must not be NULL");
+
+    memset(packer, 0, sizeof(*packer));
+    packer->width = width;
+    packer->height = height;
+    return;
+}
+
+int pack_shelf(struct shelf_packer* packer, const int width, const int height, int* x, int* y) {
+    struct glyph_shelf* best = NULL;
+    const int padded_width = width + GLYPH_ATLAS_PADDING;
+    const int padded_height = height + GLYPH_ATLAS_PADDING;
+    int next_y = 0;
+    int index = 0;
+
+    ASSERT(packer != NULL, return -1;, "Argument packer must not be NULL");
+    ASSERT(x != NULL, return -1;, "Argument x must not be NULL");
+    ASSERT(y != NULL, return -1;, "Argument y must not be NULL");
+
+    // Best fit shelf, or a new one when none fits or the best one would waste more than half its rows
+    for (index = 0; index < packer->shelf_count; index++) {
+        struct glyph_shelf* shelf = &(packer->shelves[index]);
+
+        if (shelf->height >= padded_height && shelf->x + padded_width <= packer->width &&
+            (best == NULL || shelf->height < best->height)) {
+            best = shelf;
+        }
+    }
+
+    if (best == NULL || best->height - padded_height > best->height / 2) {
+        const int shelf_height = ((padded_height + GLYPH_ATLAS_SHELF_ROUNDING - 1) / GLYPH_ATLAS_SHELF_ROUNDING) *
+                                 GLYPH_ATLAS_SHELF_ROUNDING;
+
+        if (packer->shelf_count > 0) {
+            next_y = packer->shelves[packer->shelf_count - 1].y + packer->shelves[packer->shelf_count - 1].height;
+        }
+        if (packer->shelf_count < GLYPH_ATLAS_MAX_SHELVES && next_y + shelf_height <= packer->height &&
+            padded_width <= packer->width) {
+            best = &(packer->shelves[packer->shelf_count]);
+            best->y = next_y;
+            best->height = shelf_height;
+            best->x = 0;
+            packer->shelf_count++;
+            TRACE_DEBUG("Shelf=[%d] y=[%d] height=[%d]", packer->shelf_count, best->y, best->height);
+        }
+    }
+    ASSERT(best != NULL, return -1;, "Atlas full width=[%d] height=[%d] shelves=[%d]", width, height,
+           packer->shelf_count);
+
+    *x = best->x;
+    *y = best->y;
+    best->x += padded_width;
+    return 0;
+}
+
+int create_glyph_atlas(struct glyph_atlas* atlas, SDL_Renderer* renderer, const int width, const int height,
+                       const int capacity) {
+    SDL_Texture* loaded_texture = NULL;
+    void* blank_pixels = NULL;
+    int return_code = 0;
+
+    ASSERT(atlas != NULL, return -1;, "Argument atlas must not be NULL");
+    ASSERT(atlas->glyphs == NULL, return -1;, "Argument atlas->glyphs must be NULL before initialization");
+    ASSERT(renderer != NULL, return -1;, "Argument renderer must not be NULL");
+    ASSERT(width > 0 && height > 0, return -1;, "Arguments width=[%d] height=[%d] must be larger than 0", width,
+           height);
+    ASSERT(width <= INT_MAX / 4 / height, return -1;, "Arguments width=[%d] height=[%d] too large", width, height);
+    ASSERT(capacity > 0 && (capacity & (capacity - 1)) == 0, return -1;
+           , "Argument capacity=[%d] must be a power of two", capacity);
+
+    TRACE("Creating glyph atlas width=[%d] height=[%d] capacity=[%d]", width, height, capacity);
+    loaded_texture = SDL_CreateTexture(renderer, SDL_PIXELFORMAT_ARGB8888, SDL_TEXTUREACCESS_STATIC, width, height);
+    ASSERT(loaded_texture != NULL, return -1;, "SDL_CreateTexture error=[%s]", SDL_GetError());
+
+    return_code = SDL_SetTextureScaleMode(loaded_texture, SDL_ScaleModeBest);
+    ASSERT(return_code == 0, SDL_DestroyTexture(loaded_texture); return -1;
+           , "SDL_SetTextureScaleMode error=[%s]", SDL_GetError());
+    return_code = SDL_SetTextureBlendMode(loaded_texture, SDL_BLENDMODE_BLEND);
+    ASSERT(return_code == 0, SDL_DestroyTexture(loaded_texture); return -1;
+           , "SDL_SetTextureBlendMode error=[%s]", SDL_GetError());
+
+    // Static textures start undefined, the padding between glyphs must be transparent
+    blank_pixels = calloc((size_t)width * (size_t)height, 4);
+    ASSERT(blank_pixels != NULL, SDL_DestroyTexture(loaded_texture); return -1;, "calloc error");
+    return_code = SDL_UpdateTexture(loaded_texture, NULL, blank_pixels, width * 4);
+    free(blank_pixels);
+    ASSERT(return_code == 0, SDL_DestroyTexture(loaded_texture); return -1;
+           , "SDL_UpdateTexture error=[%s]", SDL_GetError());
+
+    atlas->glyphs = calloc((size_t)capacity, sizeof(*(atlas->glyphs)));
+    ASSERT(atlas->glyphs != NULL, SDL_DestroyTexture(loaded_texture); return -1;
+           , "calloc error capacity=[%d]", capacity);
+
+    atlas->renderer = renderer;
+    atlas->texture.texture = loaded_texture;
+    atlas->texture.width = width;
+    atlas->texture.height = height;
+    atlas->capacity = capacity;
+    atlas->count = 0;
+    init_shelf_packer(&(atlas->packer), width, height);
+    return 0;
+}
+
+void destroy_glyph_atlas(struct glyph_atlas* atlas) {
+    ASSERT(atlas != NULL, return;, "Argument atlas must not be NULL");
+
+    if (atlas->glyphs != NULL) {
+        TRACE("Destroying glyph atlas glyphs=[%d] shelves=[%d]", atlas->count, atlas->packer.shelf_count);
+        free(atlas->glyphs);
+    }
+    free_texture(&(atlas->texture));
+    memset(atlas, 0, sizeof(*atlas));
+
+    return;
+}
+
+int find_glyph(struct glyph_atlas* atlas, TTF_Font* font, const Uint32 codepoint, const struct glyph** glyph) {
+    struct glyph rasterized_glyph;
+    int slot = 0;
+    int return_code = 0;
+
+    ASSERT(atlas != NULL, return -1;, "Argument atlas must not be NULL");
+    ASSERT(atlas->glyphs != NULL, return -1;, "Argument atlas must be created with create_glyph_atlas");
+    ASSERT(font != NULL, return -1;, "Argument font must not be NULL");
+    ASSERT(glyph != NULL, return -1;, "Argument glyph must not be NULL");
+
+    slot = find_slot(atlas, font, codepoint);
+    if (atlas->glyphs[slot].font == NULL) {
+        ASSERT(atlas->count < atlas->capacity / 4 * 3, return -1;, "Glyph table full capacity=[%d]", atlas->capacity);
+
+        return_code = rasterize_glyph(atlas, font, codepoint, &rasterized_glyph);
+        ASSERT(return_code == 0, return -1;, "rasterize_glyph error");
+
+        atlas->glyphs[slot] = rasterized_glyph;
+        atlas->count++;
+    }
+
+    *glyph = &(atlas->glyphs[slot]);
+    return 0;
+}
+
+int measure_glyph_text(struct glyph_atlas* atlas, TTF_Font* font, const char* text, int* width, int* height) {
+    ASSERT(text != NULL, return -1;, "Argument text must not be NULL");
+
+    return measure_glyph_run(atlas, font, text, strlen(text), width, height);
+}
+
+int measure_glyph_run(struct glyph_atlas* atlas, TTF_Font* font, const char* text, const size_t length, int* width,
+                      int* height) {
+    int return_code = 0;
+
+    ASSERT(atlas != NULL, return -1;, "Argument atlas must not be NULL");
+    ASSERT(font != NULL, return -1;, "Argument font must not be NULL");
+    ASSERT(text != NULL, return -1;, "Argument text must not be NULL");
+    ASSERT(width != NULL, return -1;, "Argument width must not be NULL");
+    ASSERT(height != NULL, return -1;, "Argument height must not be NULL");
+
+    return_code = walk_glyph_text(atlas, NULL, font, text, length, 0, 0, width, height);
+    ASSERT(return_code == 0, return -1;, "walk_glyph_text error");
+
+    return 0;
+}
+
+int draw_glyph_text(struct glyph_atlas* atlas, struct sprite_batch* batch, TTF_Font* font, const char* text,
+                    const int x, const int y, const SDL_Color color) {
+    ASSERT(text != NULL, return -1;, "Argument text must not be NULL");
+
+    return draw_glyph_run(atlas, batch, font, text, strlen(text), x, y, color);
+}
+
+int draw_glyph_run(struct glyph_atlas* atlas, struct sprite_batch* batch, TTF_Font* font, const char* text,
+                   const size_t length, const int x, const int y, const SDL_Color color) {
+    TRACE_SPAN("draw_glyph_run");
+    SDL_Color previous_color;
+    int width = 0;
+    int height = 0;
+    int return_code = 0;
+
+    ASSERT(atlas != NULL, return -1;, "Argument atlas must not be NULL");
+    ASSERT(batch != NULL, return -1;, "Argument batch must not be NULL");
+    ASSERT(font != NULL, return -1;, "Argument font must not be NULL");
+    ASSERT(text != NULL, return -1;, "Argument text must not be NULL");
+
+    // Consecutive strings keep adding to the same batch
+    if (batch->texture != atlas->texture.texture) {
+        return_code = begin_sprite_batch(batch, atlas->renderer, atlas->texture);
+        ASSERT(return_code == 0, return -1;, "begin_sprite_batch error");
+    }
+
+    previous_color = batch->color;
+    set_sprite_batch_color(batch, color);
+    return_code = walk_glyph_text(atlas, batch, font, text, length, x, y, &width, &height);
+    set_sprite_batch_color(batch, previous_color);
+    ASSERT(return_code == 0, return -1;, "walk_glyph_text error");
+
+    return 0;
+}
+
+int glyph_kerning(TTF_Font* font, const Uint32 previous, const Uint32 codepoint) {
+    // The 16 bit lookup covers the Basic Multilingual Plane, pairs outside it are not kerned
+    if (font == NULL || previous == 0 || previous > 0xFFFF || codepoint > 0xFFFF) {
+        return 0;
+    }
+    return TTF_GetFontKerningSizeGlyphs(font, (Uint16)previous, (Uint16)codepoint);
+}
+
+Uint32 next_utf8_codepoint(const char** text) {
+    static const Uint32 minimum[5] = {0, 0, 0x80, 0x800, 0x10000};
+    const unsigned char* bytes = NULL;
+    Uint32 codepoint = 0;
+    int length = 0;
+    int index = 0;
+
+    ASSERT(text != NULL && *text != NULL, return 0;, "Argument text must not be NULL");
+
+    bytes = (const unsigned char*)*text;
+    if (bytes[0] < 0x80) {
+        // Stays on the terminator
+        if (bytes[0] != 0) {
+            (*text)++;
+        }
+        return bytes[0];
+    } else if ((bytes[0] & 0xE0) == 0xC0) {
+        codepoint = bytes[0] & 0x1Fu;
+        length = 2;
+    } else if ((bytes[0] & 0xF0) == 0xE0) {
+        codepoint = bytes[0] & 0x0Fu;
+        length = 3;
+    } else if ((bytes[0] & 0xF8) == 0xF0) {
+        codepoint = bytes[0] & 0x07u;
+        length = 4;
+    } else {
+        (*text)++;
+        return UTF8_REPLACEMENT_CHARACTER;
+    }
+
+    // A truncated sequence is replaced and decoding resumes on the byte that broke it, the terminator included
+    for (index = 1; index < length; index++) {
+        if ((bytes[index] & 0xC0) != 0x80) {
+            *text += index;
+            return UTF8_REPLACEMENT_CHARACTER;
+        }
+        codepoint = (codepoint << 6) | (bytes[index] & 0x3Fu);
+    }
+    *text += length;
+
+    // Overlong encodings, surrogates and values past Unicode
+    if (codepoint < minimum[length] || codepoint > 0x10FFFF || (codepoint >= 0xD800 && codepoint <= 0xDFFF)) {
+        return UTF8_REPLACEMENT_CHARACTER;
+    }
+    return codepoint;
+}
@@ -0,0 +1,100 @@
+#ifndef GLYPH_ATLAS_H
+#define GLYPH_ATLAS_H
+
+/*  Glyph atlas
+
+    Text drawn glyph by glyph from one shared texture, so text that changes every frame (counters, scores, debug
+    overlays) costs vertex generation instead of a TTF_RenderText_Blended() and a texture upload per change. Part of
+    build/libsdlcommon.a, in its own member next to sdl_font.h so only programs that render text link SDL_ttf.
+
+        create_glyph_atlas(&atlas, renderer, 1024, 1024, 512);
+        draw_glyph_text(&atlas, &batch, font, "Score 42", 16, 16, color);   // any number of times
+        flush_sprite_batch(&batch);
+        destroy_glyph_atlas(&atlas);
+
+    Each glyph is rasterized once per font, the first time it is drawn or measured, with TTF_RenderGlyph32_Blended()
+    in white, trimmed to the rows its metrics cover and uploaded into its place in the atlas texture with
+    SDL_UpdateTexture(). A TTF_Font is opened at one size, so the font is the (font, size) pair; fonts of any number of
+    sizes share one atlas. Glyphs are placed by a shelf packer, which sdf_font.h shares: pack_shelf() puts a rectangle
+    on the shelf whose height wastes the fewest rows, and opens a new shelf (its height rounded up to
+    GLYPH_ATLAS_SHELF_ROUNDING) at the bottom when none fits. Rectangles are kept GLYPH_ATLAS_PADDING pixels apart so
+    linear filtering never samples a neighbour. The atlas does not grow or evict: a glyph that finds no room, or a
+    table with capacity glyphs, fails.
+
+    draw_glyph_text() decodes UTF-8 text and adds one quad per visible glyph to a sprite batch (sprite_batch.h),
+    starting it on the atlas texture when it samples another one, so strings in any color and font share a draw call
+    until the batch is flushed. Pen advances come from the glyph metrics and kerning from
+    TTF_GetFontKerningSizeGlyphs(); '\n' starts a new line TTF_FontLineSkip() lower. x and y are the top left corner
+    of the first line. measure_glyph_text() returns the size draw_glyph_text() would cover. draw_glyph_run() and
+    measure_glyph_run() do the same for the first length bytes of text, a line of a longer text for example (see
+    text_layout.h). glyph_kerning() and next_utf8_codepoint(), the kerning and decoding steps, are shared with the
+    other text modules; the decoder replaces malformed sequences with U+FFFD and returns 0 at the terminator without
+    moving past it.
+
+    Glyphs are found through an open addressing hash table of (font, codepoint), capacity must be a power of two and
+    is filled up to three quarters.
+*/
+
+#include <SDL2/SDL.h>
+#include <SDL2/SDL_ttf.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#include "sdl_common.h"
+#include "sprite_batch.h"
+
+#define GLYPH_ATLAS_PADDING 1
+#define GLYPH_ATLAS_SHELF_ROUNDING 8
+#define GLYPH_ATLAS_MAX_SHELVES 256
+
+struct glyph {
+    TTF_Font* font;  // NULL marks a free slot
+    Uint32 codepoint;
+    SDL_Rect clip;  // in the atlas, empty for blank glyphs
+    int offset_x;   // from the pen position
+    int offset_y;   // from the top of the line
+    int advance;
+};
+
+struct glyph_shelf {
+    int y;
+    int height;
+    int x;  // first free column
+};
+
+struct shelf_packer {
+    int width;
+    int height;
+    struct glyph_shelf shelves[GLYPH_ATLAS_MAX_SHELVES];
+    int shelf_count;
+};
+
+struct glyph_atlas {
+    SDL_Renderer* renderer;
+    struct sdl_texture texture;
+    struct glyph* glyphs;
+    int capacity;
+    int count;
+    struct shelf_packer packer;
+};
+
+void init_shelf_packer(struct shelf_packer* packer, const int width, const int height);
+int pack_shelf(struct shelf_packer* packer, const int width, const int height, int* x, int* y);
+
+int create_glyph_atlas(struct glyph_atlas* atlas, SDL_Renderer* renderer, const int width, const int height,
+                       const int capacity);
+void destroy_glyph_atlas(struct glyph_atlas* atlas);
+
+int find_glyph(struct glyph_atlas* atlas, TTF_Font* font, const Uint32 codepoint, const struct glyph** glyph);
+int measure_glyph_text(struct glyph_atlas* atlas, TTF_Font* font, const char* text, int* width, int* height);
+int measure_glyph_run(struct glyph_atlas* atlas, TTF_Font* font, const char* text, const size_t length, int* width,
+                      int* height);
+int draw_glyph_text(struct glyph_atlas* atlas, struct sprite_batch* batch, TTF_Font* font, const char* text,
+                    const int x, const int y, const SDL_Color color);
+int draw_glyph_run(struct glyph_atlas* atlas, struct sprite_batch* batch, TTF_Font* font, const char* text,
+                   const size_t length, const int x, const int y, const SDL_Color color);
+
+int glyph_kerning(TTF_Font* font, const Uint32 previous, const Uint32 codepoint);
+Uint32 next_utf8_codepoint(const char** text);
+
+#endif  // GLYPH_ATLAS_H
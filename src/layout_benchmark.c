@@ -0,0 +1,341 @@
+#define _DEFAULT_SOURCE
+
+#include <SDL2/SDL.h>
+#include <SDL2/SDL_ttf.h>
+#include <errno.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include "asset_pack.h"
+#include "assert.h"
+#include "embed/16_true_type_fonts.pack.h"
+#include "embed/lorem-ipsum.txt.h"
+#include "glyph_atlas.h"
+#include "sdl_common.h"
+#include "sdl_font.h"
+#include "text_layout.h"
+#include "trace.h"
+
+/*  Text layout benchmark
+
+    Lays out the embedded lorem ipsum text (assets/lorem-ipsum.txt, four paragraphs) with text_layout.h and times:
+
+        full (cold)         every paragraph wrapped, run cache emptied first
+        full (cached)       every paragraph found in the run cache
+        edit (incremental)  one byte inserted or removed in the second paragraph, edit_text_layout()
+        edit (full)         the same edits followed by a cold layout_text(), what an edit costs without it
+
+    Before timing, a series of edits all over the text is checked line by line against a fresh layout. Glyphs are
+    rasterized into the atlas during that check, so the timings only cover wrapping. Runs headless on the dummy video
+    driver with the software renderer; results go to stderr:
+
+        bin/layout_benchmark [iterations] [width] > /dev/null
+*/
+
+#define DEFAULT_ITERATIONS 10000L
+#define MAX_ITERATIONS 10000000L
+#define DEFAULT_WIDTH 400
+#define FONT_PTSIZE 16
+#define CHECKED_EDITS 2000
+
+int get_elapsed_ns(const struct timespec* start, int64_t* elapsed_ns);
+int parse_layout_arguments(int argc, char** argv, long* iterations, int* width);
+int edit_text(char* text, size_t* length, const size_t offset, const bool insert);
+int check_layout(struct text_layout* layout, struct text_layout* reference, const char* text);
+int check_edits(struct text_layout* layout, struct text_layout* reference, char* text, size_t* length);
+int benchmark_full(const char* name, struct text_layout* layout, const char* text, const long iterations,
+                   const bool cached);
+int benchmark_edit(const char* name, struct text_layout* layout, char* text, size_t* length, const size_t offset,
+                   const long iterations, const bool incremental);
+int run_benchmarks(TTF_Font* font, struct glyph_atlas* atlas, const long iterations, const int width);
+int main(int argc, char** argv);
+
+int get_elapsed_ns(const struct timespec* start, int64_t* elapsed_ns) {
+    struct timespec end;
+    int return_code = 0;
+
+    ASSERT(start != NULL && elapsed_ns != NULL, return -1;, "Arguments must not be NULL");
+
+    return_code = clock_gettime(CLOCK_MONOTONIC, &end);
+    ASSERT(return_code == 0, return -1;, "clock_gettime error=[%s]", strerror(errno));
+
+    *elapsed_ns = ((int64_t)end.tv_sec - (int64_t)start->tv_sec) * 1000000000LL +
+                  ((int64_t)end.tv_nsec - (int64_t)start->tv_nsec);
+    return 0;
+}
+
+int parse_layout_arguments(int argc, char** argv, long* iterations, int* width) {
+    char* end = NULL;
+    long value = 0;
+
+    ASSERT(argv != NULL, return -1;, "Argument argv must not be NULL");
+    ASSERT(iterations != NULL && width != NULL, return -1;, "Arguments must not be NULL");
+
+    *iterations = DEFAULT_ITERATIONS;
+    *width = DEFAULT_WIDTH;
+    if (argc > 1) {
+        errno = 0;
+        *iterations = strtol(argv[1], &end, 10);
+        ASSERT(errno == 0 && end != argv[1] && *end == '\0' && *iterations > 0 && *iterations <= MAX_ITERATIONS,
+               return -1;, "Usage: %s [iterations] [width] > /dev/null  (1 <= iterations <= %ld)", argv[0],
+               MAX_ITERATIONS);
+    }
+    if (argc > 2) {
+        errno = 0;
+        value = strtol(argv[2], &end, 10);
+        ASSERT(errno == 0 && end != argv[2] && *end == '\0' && value > 0 && value <= 4096, return -1;
+               , "Usage: %s [iterations] [width] > /dev/null  (1 <= width <= 4096)", argv[0]);
+        *width = (int)value;
+    }
+    return 0;
+}
+
+// Inserts an 'x' at offset or removes the byte there, the buffer has room for one more byte
+int edit_text(char* text, size_t* length, const size_t offset, const bool insert) {
+    ASSERT(text != NULL && length != NULL, return -1;, "Arguments must not be NULL");
+    ASSERT(offset < *length, return -1;, "Argument offset=[%zu] past length=[%zu]", offset, *length);
+
+    if (insert == true) {
+        memmove(text + offset + 1, text + offset, *length - offset + 1);
+        text[offset] = 'x';
+        (*length)++;
+    } else {
+        memmove(text + offset, text + offset + 1, *length - offset);
+        (*length)--;
+    }
+    return 0;
+}
+
+int check_layout(struct text_layout* layout, struct text_layout* reference, const char* text) {
+    int index = 0;
+    int return_code = 0;
+
+    ASSERT(layout != NULL && reference != NULL && text != NULL, return -1;, "Arguments must not be NULL");
+
+    clear_text_runs(reference);
+    return_code = layout_text(reference, text);
+    ASSERT(return_code == 0, return -1;, "layout_text error");
+
+    ASSERT(layout->line_count == reference->line_count, return -1;, "Line count=[%d] expected=[%d]",
+           layout->line_count, reference->line_count);
+    for (index = 0; index < layout->line_count; index++) {
+        const struct text_line* line = &(layout->lines[index]);
+        const struct text_line* expected = &(reference->lines[index]);
+
+        ASSERT(line->start == expected->start && line->length == expected->length && line->next == expected->next &&
+                   line->width == expected->width && line->first == expected->first,
+               return -1;, "Line=[%d] start=[%zu] length=[%zu] next=[%zu] expected start=[%zu] length=[%zu] next=[%zu]",
+               index, line->start, line->length, line->next, expected->start, expected->length, expected->next);
+    }
+    return 0;
+}
+
+// Inserts and removes bytes at pseudo-random offsets, spaces and newlines included, checking every step
+int check_edits(struct text_layout* layout, struct text_layout* reference, char* text, size_t* length) {
+    uint32_t state = 0x12345678u;
+    int edit = 0;
+    int return_code = 0;
+
+    ASSERT(length != NULL, return -1;, "Argument length must not be NULL");
+
+    for (edit = 0; edit < CHECKED_EDITS; edit++) {
+        size_t offset = 0;
+
+        state = state * 1664525u + 1013904223u;
+        offset = (size_t)(state >> 8) % *length;
+        return_code = edit_text(text, length, offset, true);
+        ASSERT(return_code == 0, return -1;, "edit_text error");
+        return_code = edit_text_layout(layout, text, offset, 0, 1);
+        ASSERT(return_code == 0, return -1;, "edit_text_layout error");
+        return_code = check_layout(layout, reference, text);
+        ASSERT(return_code == 0, return -1;, "check_layout error edit=[%d] insert offset=[%zu]", edit, offset);
+
+        state = state * 1664525u + 1013904223u;
+        offset = (size_t)(state >> 8) % *length;
+        return_code = edit_text(text, length, offset, false);
+        ASSERT(return_code == 0, return -1;, "edit_text error");
+        return_code = edit_text_layout(layout, text, offset, 1, 0);
+        ASSERT(return_code == 0, return -1;, "edit_text_layout error");
+        return_code = check_layout(layout, reference, text);
+        ASSERT(return_code == 0, return -1;, "check_layout error edit=[%d] remove offset=[%zu]", edit, offset);
+    }
+    return 0;
+}
+
+int benchmark_full(const char* name, struct text_layout* layout, const char* text, const long iterations,
+                   const bool cached) {
+    struct timespec start;
+    int64_t elapsed_ns = 0;
+    long counter = 0;
+    int return_code = 0;
+
+    return_code = layout_text(layout, text);
+    ASSERT(return_code == 0, return -1;, "layout_text error");
+
+    return_code = clock_gettime(CLOCK_MONOTONIC, &start);
+    ASSERT(return_code == 0, return -1;, "clock_gettime error=[%s]", strerror(errno));
+
+    for (counter = 0; counter < iterations; counter++) {
+        if (cached == false) {
+            clear_text_runs(layout);
+        }
+        return_code = layout_text(layout, text);
+        ASSERT(return_code == 0, return -1;, "layout_text error");
+    }
+
+    return_code = get_elapsed_ns(&start, &elapsed_ns);
+    ASSERT(return_code == 0, return -1;, "get_elapsed_ns error");
+
+    fprintf(stderr, "%-24s iterations=[%ld] lines=[%d] total=[%.3f ms] per_iteration=[%.1f ns]\n", name, iterations,
+            layout->line_count, (double)elapsed_ns / 1000000.0, (double)elapsed_ns / (double)iterations);
+    return 0;
+}
+
+// Alternately inserts and removes a byte at offset, so the text is back where it started every other iteration
+int benchmark_edit(const char* name, struct text_layout* layout, char* text, size_t* length, const size_t offset,
+                   const long iterations, const bool incremental) {
+    struct timespec start;
+    int64_t elapsed_ns = 0;
+    const uint64_t relaid_lines = layout->relaid_lines;
+    long counter = 0;
+    int return_code = 0;
+
+    return_code = layout_text(layout, text);
+    ASSERT(return_code == 0, return -1;, "layout_text error");
+
+    return_code = clock_gettime(CLOCK_MONOTONIC, &start);
+    ASSERT(return_code == 0, return -1;, "clock_gettime error=[%s]", strerror(errno));
+
+    for (counter = 0; counter < iterations; counter++) {
+        const bool insert = (counter % 2 == 0);
+
+        return_code = edit_text(text, length, offset, insert);
+        ASSERT(return_code == 0, return -1;, "edit_text error");
+        if (incremental == true) {
+            return_code = edit_text_layout(layout, text, offset, (insert == true) ? 0 : 1, (insert == true) ? 1 : 0);
+            ASSERT(return_code == 0, return -1;, "edit_text_layout error");
+        } else {
+            clear_text_runs(layout);
+            return_code = layout_text(layout, text);
+            ASSERT(return_code == 0, return -1;, "layout_text error");
+        }
+    }
+
+    return_code = get_elapsed_ns(&start, &elapsed_ns);
+    ASSERT(return_code == 0, return -1;, "get_elapsed_ns error");
+
+    fprintf(stderr, "%-24s iterations=[%ld] relaid_lines=[%.1f] total=[%.3f ms] per_iteration=[%.1f ns]\n", name,
+            iterations, (double)(layout->relaid_lines - relaid_lines) / (double)iterations,
+            (double)elapsed_ns / 1000000.0, (double)elapsed_ns / (double)iterations);
+
+    // An odd count leaves the inserted byte in
+    if (iterations % 2 != 0) {
+        return_code = edit_text(text, length, offset, false);
+        ASSERT(return_code == 0, return -1;, "edit_text error");
+    }
+    return 0;
+}
+
+int run_benchmarks(TTF_Font* font, struct glyph_atlas* atlas, const long iterations, const int width) {
+    struct text_layout layout = {0};
+    struct text_layout reference = {0};
+    const size_t size = (size_t)_embed_lorem_ipsum_txt_size;
+    size_t length = size;
+    size_t offset = 0;
+    char* text = NULL;
+    int return_code = 0;
+
+    // A writable copy, terminated, with room for the byte the edits insert
+    text = malloc(size + 2);
+    ASSERT(text != NULL, return -1;, "malloc error size=[%zu]", size + 2);
+    memcpy(text, _embed_lorem_ipsum_txt_start, size);
+    text[size] = '\0';
+
+    return_code = create_text_layout(&layout, atlas, font, width);
+    ASSERT(return_code == 0, free(text); return -1;, "create_text_layout error");
+    return_code = create_text_layout(&reference, atlas, font, width);
+    ASSERT(return_code == 0, destroy_text_layout(&layout); free(text); return -1;, "create_text_layout error");
+
+    return_code = layout_text(&layout, text);
+    if (return_code == 0) {
+        return_code = check_edits(&layout, &reference, text, &length);
+    }
+    destroy_text_layout(&reference);
+    ASSERT(return_code == 0, destroy_text_layout(&layout); free(text); return -1;, "Incremental layout check failed");
+    fprintf(stderr, "%-24s edits=[%d] width=[%d] ok\n", "check", CHECKED_EDITS * 2, width);
+
+    // The checked edits scrambled the text
+    memcpy(text, _embed_lorem_ipsum_txt_start, size);
+    text[size] = '\0';
+    length = size;
+
+    // Halfway into the second paragraph
+    offset = strcspn(text, "\n") + 1;
+    offset += strcspn(text + offset, "\n") / 2;
+
+    return_code = benchmark_full("full (cold)", &layout, text, iterations, false);
+    if (return_code == 0) {
+        return_code = benchmark_full("full (cached)", &layout, text, iterations, true);
+    }
+    if (return_code == 0) {
+        return_code = benchmark_edit("edit (incremental)", &layout, text, &length, offset, iterations, true);
+    }
+    if (return_code == 0) {
+        return_code = benchmark_edit("edit (full)", &layout, text, &length, offset, iterations, false);
+    }
+
+    destroy_text_layout(&layout);
+    free(text);
+    ASSERT(return_code == 0, return -1;, "Benchmark failed");
+    return 0;
+}
+
+int main(int argc, char** argv) {
+    struct sdl_system system = {0};
+    struct glyph_atlas atlas = {0};
+    struct asset_pack pack = {0};
+    struct asset asset;
+    TTF_Font* font = NULL;
+    long iterations = 0;
+    int width = 0;
+    int return_code = 0;
+
+    return_code = parse_layout_arguments(argc, argv, &iterations, &width);
+    ASSERT(return_code == 0, return -1;, "parse_layout_arguments error");
+
+    // Only the atlas needs a renderer, nothing is presented
+    SDL_SetHint(SDL_HINT_VIDEODRIVER, "dummy");
+    SDL_SetHint(SDL_HINT_RENDER_DRIVER, "software");
+    return_code = init_SDL(&system, "Layout benchmark", SDL_RENDERER_SOFTWARE);
+    ASSERT(return_code == 0, close_SDL(&system); return -1;, "init_SDL error");
+    return_code = init_TTF();
+    ASSERT(return_code == 0, close_SDL(&system); return -1;, "init_TTF error");
+
+    return_code =
+        load_asset_pack(&pack, _embed_16_true_type_fonts_pack_start, _embed_16_true_type_fonts_pack_size);
+    if (return_code == 0) {
+        return_code = find_asset(&pack, "fonts/NotoSans-Regular.ttf", &asset);
+    }
+    if (return_code == 0) {
+        return_code = load_font_embedded(&font, FONT_PTSIZE, asset.data, asset.size);
+    }
+    if (return_code == 0) {
+        return_code = create_glyph_atlas(&atlas, system.renderer, 512, 512, 512);
+    }
+    if (return_code == 0) {
+        return_code = run_benchmarks(font, &atlas, iterations, width);
+    }
+
+    destroy_glyph_atlas(&atlas);
+    free_font(&font);
+    close_asset_pack(&pack);
+    close_TTF();
+    close_SDL(&system);
+    ASSERT(return_code == 0, return -1;, "Layout benchmark failed");
+
+    return 0;
+}
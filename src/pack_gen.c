@@ -0,0 +1,320 @@
+#define _DEFAULT_SOURCE
+
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "asset_pack.h"
+#include "assert.h"
+#include "trace.h"
+
+/*  pack_gen
+
+    Build-time asset packer. Writes the assets of one program into a single pack laid out as described in
+    asset_pack.h, which embed.sh then embeds as one object:
+
+        bin/pack_gen <pack-file> <asset>...
+
+    An asset is named after its path without the first directory, so assets/fonts/NotoSans-Regular.ttf is found as
+    "fonts/NotoSans-Regular.ttf" and pack/earth_background.png.raw as "earth_background.png.raw". A trailing .gz is
+    dropped as well: pack/hello_world.bmp.gz is "hello_world.bmp", inflated on read by open_embedded_rwops(). The
+    storage format is told from the first bytes of each file.
+
+    Assets are deduplicated by content: an asset whose bytes equal those of an earlier one (same asset_pack_hash(),
+    size and bytes) gets its own entry but points at the data already stored. The combined pack of the multi-call
+    binary (src/sdl_tutorials.c) relies on this to store each asset once however many tutorials use it.
+*/
+
+#define PACK_NAME_SIZE 256
+
+struct pack_item {
+    char name[PACK_NAME_SIZE];
+    uint8_t* data;
+    size_t size;
+    struct asset_pack_entry entry;
+};
+
+int make_asset_name(char* name, const size_t size, const char* path);
+enum asset_format detect_format(const uint8_t* data, const size_t size);
+int read_file(const char* path, uint8_t** data, size_t* size);
+int load_items(struct pack_item* items, const uint32_t count, char** paths);
+void free_items(struct pack_item* items, const uint32_t count);
+size_t align_up(const size_t value, const size_t alignment);
+int find_duplicate(const struct pack_item* items, const uint32_t count, const struct pack_item* item);
+int build_pack(struct pack_item* items, const uint32_t count, uint8_t** pack, size_t* size);
+int write_pack(const char* path, const uint8_t* pack, const size_t size);
+int main(int argc, char** argv);
+
+int make_asset_name(char* name, const size_t size, const char* path) {
+    const char* relative = NULL;
+    size_t length = 0;
+
+    ASSERT(name != NULL, return -1;, "Argument name must not be NULL");
+    ASSERT(path != NULL, return -1;, "Argument path must not be NULL");
+
+    relative = (strchr(path, '/') != NULL) ? strchr(path, '/') + 1 : path;
+    length = strlen(relative);
+    if (length > 3 && strcmp(relative + length - 3, ".gz") == 0) {
+        length -= 3;
+    }
+    ASSERT(length > 0 && length < size, return -1;, "Invalid asset name length=[%zu] path=[%s]", length, path);
+
+    memcpy(name, relative, length);
+    name[length] = '\0';
+    return 0;
+}
+
+enum asset_format detect_format(const uint8_t* data, const size_t size) {
+    size_t index = 0;
+
+    if (size >= 4 && memcmp(data, "RAWI", 4) == 0) {
+        return ASSET_FORMAT_RAW_IMAGE;
+    }
+    if (size >= 2 && data[0] == 0x1F && data[1] == 0x8B) {
+        return ASSET_FORMAT_GZIP;
+    }
+    if (size >= 2 && data[0] == 'B' && data[1] == 'M') {
+        return ASSET_FORMAT_BMP;
+    }
+    if (size >= 8 && memcmp(data, "\x89PNG\r\n\x1A\n", 8) == 0) {
+        return ASSET_FORMAT_PNG;
+    }
+    if (size >= 4 && (memcmp(data, "\x00\x01\x00\x00", 4) == 0 || memcmp(data, "OTTO", 4) == 0 ||
+                      memcmp(data, "true", 4) == 0)) {
+        return ASSET_FORMAT_TTF;
+    }
+
+    // Text: no control characters besides whitespace, UTF-8 sequences pass through
+    for (index = 0; index < size; index++) {
+        if ((data[index] < 0x20 && data[index] != '\t' && data[index] != '\n' && data[index] != '\r') ||
+            data[index] == 0x7F) {
+            return ASSET_FORMAT_BINARY;
+        }
+    }
+    return (size > 0) ? ASSET_FORMAT_TEXT : ASSET_FORMAT_BINARY;
+}
+
+int read_file(const char* path, uint8_t** data, size_t* size) {
+    FILE* input = NULL;
+    uint8_t* buffer = NULL;
+    long length = 0;
+    size_t read = 0;
+
+    ASSERT(path != NULL, return -1;, "Argument path must not be NULL");
+    ASSERT(data != NULL, return -1;, "Argument data must not be NULL");
+    ASSERT(size != NULL, return -1;, "Argument size must not be NULL");
+
+    input = fopen(path, "rb");
+    ASSERT(input != NULL, return -1;, "fopen error path=[%s]", path);
+
+    ASSERT(fseek(input, 0, SEEK_END) == 0, fclose(input); return -1;, "fseek error path=[%s]", path);
+    length = ftell(input);
+    ASSERT(length >= 0, fclose(input); return -1;, "ftell error path=[%s]", path);
+    rewind(input);
+
+    // One spare byte, malloc(0) may return NULL
+    buffer = malloc((size_t)length + 1);
+    ASSERT(buffer != NULL, fclose(input); return -1;, "malloc error size=[%ld]", length);
+
+    read = fread(buffer, 1, (size_t)length, input);
+    fclose(input);
+    ASSERT(read == (size_t)length, free(buffer); return -1;, "fread error path=[%s]", path);
+
+    *data = buffer;
+    *size = (size_t)length;
+    return 0;
+}
+
+int load_items(struct pack_item* items, const uint32_t count, char** paths) {
+    uint32_t item = 0;
+    int return_code = 0;
+
+    ASSERT(items != NULL, return -1;, "Argument items must not be NULL");
+    ASSERT(paths != NULL, return -1;, "Argument paths must not be NULL");
+
+    for (item = 0; item < count; item++) {
+        struct asset_pack_entry* entry = &(items[item].entry);
+        enum asset_format format = ASSET_FORMAT_BINARY;
+
+        return_code = make_asset_name(items[item].name, sizeof(items[item].name), paths[item]);
+        ASSERT(return_code == 0, free_items(items, item); return -1;, "make_asset_name error");
+
+        return_code = read_file(paths[item], &(items[item].data), &(items[item].size));
+        ASSERT(return_code == 0, free_items(items, item); return -1;, "read_file error");
+
+        entry->name_hash = asset_pack_hash(items[item].name, strlen(items[item].name));
+        entry->hash = asset_pack_hash(items[item].data, items[item].size);
+        entry->size = items[item].size;
+        format = detect_format(items[item].data, items[item].size);
+        entry->format = (uint32_t)format;
+        TRACE("Asset path=[%s] name=[%s] size=[%zu] format=[%u]", paths[item], items[item].name, items[item].size,
+              entry->format);
+    }
+
+    return 0;
+}
+
+void free_items(struct pack_item* items, const uint32_t count) {
+    uint32_t item = 0;
+
+    ASSERT(items != NULL, return;, "Argument items must not be NULL");
+
+    for (item = 0; item < count; item++) {
+        free(items[item].data);
+        items[item].data = NULL;
+    }
+
+    return;
+}
+
+size_t align_up(const size_t value, const size_t alignment) {
+    return (value + alignment - 1) / alignment * alignment;
+}
+
+int find_duplicate(const struct pack_item* items, const uint32_t count, const struct pack_item* item) {
+    uint32_t index = 0;
+
+    ASSERT(items != NULL, return -1;, "Argument items must not be NULL");
+    ASSERT(item != NULL, return -1;, "Argument item must not be NULL");
+
+    for (index = 0; index < count; index++) {
+        if (items[index].entry.hash == item->entry.hash && items[index].size == item->size &&
+            memcmp(items[index].data, item->data, item->size) == 0) {
+            return (int)index;
+        }
+    }
+
+    return -1;
+}
+
+int build_pack(struct pack_item* items, const uint32_t count, uint8_t** pack, size_t* size) {
+    struct asset_pack_header header;
+    uint32_t* slots = NULL;
+    size_t names_size = 0;
+    size_t shared_size = 0;
+    size_t offset = 0;
+    uint32_t item = 0;
+
+    ASSERT(items != NULL, return -1;, "Argument items must not be NULL");
+    ASSERT(pack != NULL, return -1;, "Argument pack must not be NULL");
+    ASSERT(size != NULL, return -1;, "Argument size must not be NULL");
+
+    memset(&header, 0, sizeof(header));
+    memcpy(header.magic, ASSET_PACK_MAGIC, sizeof(header.magic));
+    header.version = ASSET_PACK_VERSION;
+    header.entry_count = count;
+
+    // Load factor at most 1/2 keeps probe sequences short
+    header.slot_count = 1;
+    while (header.slot_count < 2 * count) {
+        header.slot_count *= 2;
+    }
+
+    // Layout: header, slots, entries, names, then data from the next page on
+    header.entries_offset = align_up(sizeof(header) + header.slot_count * sizeof(uint32_t), sizeof(uint64_t));
+    header.names_offset = header.entries_offset + count * sizeof(struct asset_pack_entry);
+    for (item = 0; item < count; item++) {
+        items[item].entry.name_offset = (uint32_t)names_size;
+        names_size += strlen(items[item].name) + 1;
+    }
+    header.data_offset = align_up(header.names_offset + names_size, ASSET_PACK_PAGE_SIZE);
+    offset = header.data_offset;
+    for (item = 0; item < count; item++) {
+        // Only earlier items have an offset yet, a duplicate reuses the data of the first copy
+        int duplicate = find_duplicate(items, item, &(items[item]));
+
+        if (duplicate >= 0) {
+            items[item].entry.offset = items[duplicate].entry.offset;
+            shared_size += items[item].size;
+            TRACE("Asset name=[%s] shares the data of name=[%s] size=[%zu]", items[item].name, items[duplicate].name,
+                  items[item].size);
+            continue;
+        }
+        items[item].entry.offset = offset;
+        offset = align_up(offset + items[item].size, ASSET_PACK_ALIGNMENT);
+    }
+    header.size = offset;
+
+    *pack = calloc(1, offset);
+    ASSERT(*pack != NULL, return -1;, "calloc error size=[%zu]", offset);
+    slots = calloc(header.slot_count, sizeof(*slots));
+    ASSERT(slots != NULL, free(*pack); *pack = NULL; return -1;, "calloc error slots=[%u]", header.slot_count);
+
+    for (item = 0; item < count; item++) {
+        uint32_t slot = (uint32_t)items[item].entry.name_hash & (header.slot_count - 1);
+
+        while (slots[slot] != 0) {
+            ASSERT(strcmp(items[slots[slot] - 1].name, items[item].name) != 0, free(slots); free(*pack); *pack = NULL;
+                   return -1;, "Duplicate asset name=[%s]", items[item].name);
+            slot = (slot + 1) & (header.slot_count - 1);
+        }
+        slots[slot] = item + 1;
+
+        memcpy(*pack + header.entries_offset + item * sizeof(struct asset_pack_entry), &(items[item].entry),
+               sizeof(struct asset_pack_entry));
+        memcpy(*pack + header.names_offset + items[item].entry.name_offset, items[item].name,
+               strlen(items[item].name) + 1);
+        memcpy(*pack + items[item].entry.offset, items[item].data, items[item].size);
+    }
+    memcpy(*pack, &header, sizeof(header));
+    memcpy(*pack + sizeof(header), slots, header.slot_count * sizeof(*slots));
+    free(slots);
+
+    TRACE("Pack entries=[%u] slots=[%u] data_offset=[%llu] size=[%zu] shared=[%zu]", count, header.slot_count,
+          (unsigned long long)header.data_offset, offset, shared_size);
+    *size = offset;
+    return 0;
+}
+
+int write_pack(const char* path, const uint8_t* pack, const size_t size) {
+    FILE* output = NULL;
+    size_t written = 0;
+    int return_code = 0;
+
+    ASSERT(path != NULL, return -1;, "Argument path must not be NULL");
+    ASSERT(pack != NULL, return -1;, "Argument pack must not be NULL");
+
+    output = fopen(path, "wb");
+    ASSERT(output != NULL, return -1;, "fopen error path=[%s]", path);
+
+    written = fwrite(pack, size, 1, output);
+    ASSERT(written == 1, fclose(output); return -1;, "fwrite error path=[%s]", path);
+
+    return_code = fclose(output);
+    ASSERT(return_code == 0, return -1;, "fclose error path=[%s]", path);
+    return 0;
+}
+
+int main(int argc, char** argv) {
+    struct pack_item* items = NULL;
+    uint8_t* pack = NULL;
+    size_t size = 0;
+    uint32_t count = 0;
+    int return_code = 0;
+
+    if (argc < 2) {
+        fprintf(stderr, "Usage: %s <pack-file> <asset>...\n", argv[0]);
+        return -1;
+    }
+    count = (uint32_t)(argc - 2);
+    ASSERT(count <= ASSET_PACK_MAX_ENTRIES, return -1;, "Too many assets count=[%u] max=[%d]", count,
+           ASSET_PACK_MAX_ENTRIES);
+
+    items = calloc(count + 1, sizeof(*items));
+    ASSERT(items != NULL, return -1;, "calloc error count=[%u]", count);
+
+    return_code = load_items(items, count, &argv[2]);
+    ASSERT(return_code == 0, free(items); return -1;, "load_items error");
+
+    return_code = build_pack(items, count, &pack, &size);
+    ASSERT(return_code == 0, free_items(items, count); free(items); return -1;, "build_pack error");
+
+    return_code = write_pack(argv[1], pack, size);
+    ASSERT(return_code == 0, free(pack); free_items(items, count); free(items); return -1;, "write_pack error");
+
+    free(pack);
+    free_items(items, count);
+    free(items);
+    return 0;
+}
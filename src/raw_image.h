@@ -0,0 +1,35 @@
+#ifndef RAW_IMAGE_H
+#define RAW_IMAGE_H
+
+/*  Raw image blob
+
+    Layout of the pre-decoded images written by raw_image_gen (embed.sh --raw) and read by load_texture_raw()
+    (sdl_common.h). A blob is a struct raw_image_header followed by height rows of pitch bytes, starting offset bytes
+    into the blob:
+
+        header | padding up to offset | row 0 | row 1 | ... | row height-1
+
+    Pixels are stored in format (an SDL_PixelFormatEnum, SDL_PIXELFORMAT_ARGB8888 as written by raw_image_gen), which
+    is what SDL_UpdateTexture expects, so a texture is filled with one copy and no decode. offset and pitch are
+    multiples of RAW_IMAGE_ALIGNMENT, so every row starts on a cache line when the blob itself is aligned, as embed.sh
+    and asset packs (asset_pack.h) place it. Fields are in host byte order, blobs are produced on the build machine
+    for the same machine.
+*/
+
+#include <stdint.h>
+
+#define RAW_IMAGE_MAGIC "RAWI"
+#define RAW_IMAGE_VERSION 1
+#define RAW_IMAGE_ALIGNMENT 64
+
+struct raw_image_header {
+    char magic[4];    // RAW_IMAGE_MAGIC, no terminator
+    uint32_t version;
+    uint32_t format;  // SDL_PixelFormatEnum
+    uint32_t width;
+    uint32_t height;
+    uint32_t pitch;   // bytes per row, padding included
+    uint32_t offset;  // bytes from the start of the blob to row 0
+};
+
+#endif  // RAW_IMAGE_H
@@ -0,0 +1,155 @@
+#define _DEFAULT_SOURCE
+
+#include <SDL2/SDL.h>
+#include <SDL2/SDL_image.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "assert.h"
+#include "raw_image.h"
+#include "trace.h"
+
+/*  raw_image_gen
+
+    Build-time image decoder behind embed.sh --raw. Decodes any image SDL_image reads into a raw ARGB8888 blob laid
+    out as described in raw_image.h, so the program uploads it with SDL_UpdateTexture instead of inflating a PNG at
+    every start:
+
+        bin/raw_image_gen <image> <raw-blob> [color-key]
+
+    color-key is an RRGGBB hex color. Matching pixels get alpha 0 and keep their color, the same result as
+    SDL_SetColorKey followed by SDL_CreateTextureFromSurface, so a keyed image needs no surface at run time either.
+*/
+
+int parse_color_key(const char* text, Uint32* color_key);
+int apply_color_key(SDL_Surface* surface, const Uint32 color_key);
+int write_raw_image(const char* path, const SDL_Surface* surface);
+int main(int argc, char** argv);
+
+int parse_color_key(const char* text, Uint32* color_key) {
+    char* end = NULL;
+    unsigned long value = 0;
+
+    ASSERT(text != NULL, return -1;, "Argument text must not be NULL");
+    ASSERT(color_key != NULL, return -1;, "Argument color_key must not be NULL");
+
+    value = strtoul(text, &end, 16);
+    ASSERT(strlen(text) == 6 && *end == '\0', return -1;, "Invalid color key=[%s], expected RRGGBB", text);
+
+    *color_key = (Uint32)value;
+    return 0;
+}
+
+int apply_color_key(SDL_Surface* surface, const Uint32 color_key) {
+    int row = 0;
+    int column = 0;
+    int keyed = 0;
+
+    ASSERT(surface != NULL, return -1;, "Argument surface must not be NULL");
+    ASSERT(surface->format->format == SDL_PIXELFORMAT_ARGB8888, return -1;, "Surface must be ARGB8888");
+
+    for (row = 0; row < surface->h; row++) {
+        Uint32* pixels = (Uint32*)(void*)((Uint8*)surface->pixels + (size_t)row * (size_t)surface->pitch);
+
+        for (column = 0; column < surface->w; column++) {
+            if ((pixels[column] & 0x00FFFFFFu) == color_key) {
+                pixels[column] &= 0x00FFFFFFu;
+                keyed++;
+            }
+        }
+    }
+
+    TRACE("Color key=[%06X] keyed=[%d] pixels", color_key, keyed);
+    return 0;
+}
+
+int write_raw_image(const char* path, const SDL_Surface* surface) {
+    static const uint8_t padding[RAW_IMAGE_ALIGNMENT] = {0};
+    struct raw_image_header header;
+    FILE* output = NULL;
+    size_t row_bytes = 0;
+    size_t written = 0;
+    int row = 0;
+    int return_code = 0;
+
+    ASSERT(path != NULL, return -1;, "Argument path must not be NULL");
+    ASSERT(surface != NULL, return -1;, "Argument surface must not be NULL");
+
+    row_bytes = (size_t)surface->w * 4;
+    memset(&header, 0, sizeof(header));
+    memcpy(header.magic, RAW_IMAGE_MAGIC, sizeof(header.magic));
+    header.version = RAW_IMAGE_VERSION;
+    header.format = SDL_PIXELFORMAT_ARGB8888;
+    header.width = (uint32_t)surface->w;
+    header.height = (uint32_t)surface->h;
+    header.pitch = (uint32_t)((row_bytes + RAW_IMAGE_ALIGNMENT - 1) / RAW_IMAGE_ALIGNMENT * RAW_IMAGE_ALIGNMENT);
+    header.offset = (uint32_t)((sizeof(header) + RAW_IMAGE_ALIGNMENT - 1) / RAW_IMAGE_ALIGNMENT * RAW_IMAGE_ALIGNMENT);
+
+    output = fopen(path, "wb");
+    ASSERT(output != NULL, return -1;, "fopen error path=[%s]", path);
+
+    written = fwrite(&header, sizeof(header), 1, output);
+    written += fwrite(padding, header.offset - sizeof(header), 1, output);
+    ASSERT(written == 2, fclose(output); return -1;, "fwrite error path=[%s]", path);
+
+    for (row = 0; row < surface->h; row++) {
+        const Uint8* pixels = (const Uint8*)surface->pixels + (size_t)row * (size_t)surface->pitch;
+
+        written = fwrite(pixels, row_bytes, 1, output);
+        if (header.pitch > row_bytes) {
+            written += fwrite(padding, header.pitch - row_bytes, 1, output);
+        } else {
+            written++;
+        }
+        ASSERT(written == 2, fclose(output); return -1;, "fwrite error path=[%s] row=[%d]", path, row);
+    }
+
+    return_code = fclose(output);
+    ASSERT(return_code == 0, return -1;, "fclose error path=[%s]", path);
+
+    TRACE("Raw image path=[%s] width=[%u] height=[%u] pitch=[%u] bytes=[%zu]", path, header.width, header.height,
+          header.pitch, (size_t)header.offset + (size_t)header.pitch * header.height);
+    return 0;
+}
+
+int main(int argc, char** argv) {
+    SDL_Surface* loaded_surface = NULL;
+    SDL_Surface* surface = NULL;
+    Uint32 color_key = 0;
+    const int img_flags = IMG_INIT_PNG;
+    int return_code = 0;
+
+    if (argc < 3 || argc > 4) {
+        fprintf(stderr, "Usage: %s <image> <raw-blob> [color-key]\n", argv[0]);
+        return -1;
+    }
+    if (argc == 4) {
+        return_code = parse_color_key(argv[3], &color_key);
+        ASSERT(return_code == 0, return -1;, "parse_color_key error");
+    }
+
+    return_code = IMG_Init(img_flags);
+    ASSERT((return_code & img_flags) == img_flags, IMG_Quit(); return -1;, "IMG_Init error=[%s]", IMG_GetError());
+
+    loaded_surface = IMG_Load(argv[1]);
+    ASSERT(loaded_surface != NULL, IMG_Quit(); return -1;, "IMG_Load error path=[%s] error=[%s]", argv[1],
+           IMG_GetError());
+
+    // Palette and RGB images are expanded here, once, instead of at every start
+    surface = SDL_ConvertSurfaceFormat(loaded_surface, SDL_PIXELFORMAT_ARGB8888, 0);
+    SDL_FreeSurface(loaded_surface);
+    ASSERT(surface != NULL, IMG_Quit(); return -1;, "SDL_ConvertSurfaceFormat error=[%s]", SDL_GetError());
+
+    if (argc == 4) {
+        return_code = apply_color_key(surface, color_key);
+        ASSERT(return_code == 0, SDL_FreeSurface(surface); IMG_Quit(); return -1;, "apply_color_key error");
+    }
+
+    return_code = write_raw_image(argv[2], surface);
+    ASSERT(return_code == 0, SDL_FreeSurface(surface); IMG_Quit(); return -1;, "write_raw_image error");
+
+    SDL_FreeSurface(surface);
+    IMG_Quit();
+    return 0;
+}
@@ -0,0 +1,445 @@
+#define _DEFAULT_SOURCE
+
+#include "sdf_font.h"
+
+#include <SDL2/SDL.h>
+#include <SDL2/SDL_ttf.h>
+#include <limits.h>
+#include <math.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "assert.h"
+#include "glyph_atlas.h"
+#include "sdl_common.h"
+#include "sprite_batch.h"
+#include "trace.h"
+
+#define SDF_FONT_INFINITY 1e20f
+#define SDF_FONT_OUTLINE 128
+
+static int compare_sdf_glyphs(const void* left, const void* right) {
+    const Uint32 left_codepoint = ((const struct sdf_glyph*)left)->codepoint;
+    const Uint32 right_codepoint = ((const struct sdf_glyph*)right)->codepoint;
+
+    return (left_codepoint > right_codepoint) - (left_codepoint < right_codepoint);
+}
+
+static const struct sdf_glyph* find_sdf_glyph(const struct sdf_font* sdf, const Uint32 codepoint) {
+    struct sdf_glyph key;
+
+    key.codepoint = codepoint;
+    return bsearch(&key, sdf->glyphs, (size_t)sdf->glyph_count, sizeof(*(sdf->glyphs)), compare_sdf_glyphs);
+}
+
+static int round_to_int(const float value) {
+    const float rounded = floorf(value + 0.5f);
+
+    return (int)rounded;
+}
+
+// Squared distance to the nearest zero along one row or column, lower envelope of parabolas
+static void distance_transform_1d(float* grid, const int offset, const int stride, const int length, float* f,
+                                  float* z, int* v) {
+    float s = 0.0f;
+    int k = 0;
+    int q = 0;
+    int r = 0;
+
+    v[0] = 0;
+    z[0] = -SDF_FONT_INFINITY;
+    z[1] = SDF_FONT_INFINITY;
+    f[0] = grid[offset];
+
+    for (q = 1; q < length; q++) {
+        f[q] = grid[offset + q * stride];
+        r = v[k];
+        s = (f[q] - f[r] + (float)(q * q - r * r)) / (float)(2 * (q - r));
+        while (s <= z[k]) {
+            k--;
+            r = v[k];
+            s = (f[q] - f[r] + (float)(q * q - r * r)) / (float)(2 * (q - r));
+        }
+        k++;
+        v[k] = q;
+        z[k] = s;
+        z[k + 1] = SDF_FONT_INFINITY;
+    }
+
+    k = 0;
+    for (q = 0; q < length; q++) {
+        while (z[k + 1] < (float)q) {
+            k++;
+        }
+        r = v[k];
+        grid[offset + q * stride] = f[r] + (float)((q - r) * (q - r));
+    }
+}
+
+static void distance_transform_2d(float* grid, const int width, const int height, float* f, float* z, int* v) {
+    int index = 0;
+
+    for (index = 0; index < width; index++) {
+        distance_transform_1d(grid, index, width, height, f, z, v);
+    }
+    for (index = 0; index < height; index++) {
+        distance_transform_1d(grid, index * width, 1, width, f, z, v);
+    }
+}
+
+// Distances of one glyph, coverage rows top to bottom of surface, into its box in the atlas
+static int write_glyph_distances(struct sdf_font* sdf, const SDL_Surface* surface, const int top, const int bottom,
+                                 const SDL_Rect* box) {
+    const int cells = box->w * box->h;
+    const int length = (box->w > box->h) ? box->w : box->h;
+    float* outer = NULL;  // squared distance to the nearest texel outside the glyph
+    float* inner = NULL;  // squared distance to the nearest texel inside it
+    float* f = NULL;
+    float* z = NULL;
+    int* v = NULL;
+    int x = 0;
+    int y = 0;
+
+    // One block for both grids and the transform's scratch
+    outer = malloc(sizeof(float) * ((size_t)cells * 2 + (size_t)length * 2 + 1));
+    ASSERT(outer != NULL, return -1;, "malloc error cells=[%d]", cells);
+    v = malloc(sizeof(int) * (size_t)length);
+    ASSERT(v != NULL, free(outer); return -1;, "malloc error length=[%d]", length);
+    inner = outer + cells;
+    f = inner + cells;
+    z = f + length;
+
+    // Outside the glyph's rows, in the spread margin, there is no coverage
+    for (y = 0; y < box->h; y++) {
+        for (x = 0; x < box->w; x++) {
+            const int surface_x = x - SDF_FONT_SPREAD;
+            const int surface_y = y - SDF_FONT_SPREAD + top;
+            float coverage = 0.0f;
+
+            if (surface_x >= 0 && surface_x < surface->w && surface_y >= top && surface_y < bottom) {
+                const Uint32* row = (const Uint32*)((const Uint8*)surface->pixels + surface_y * surface->pitch);
+
+                coverage = (float)(row[surface_x] >> 24) / 255.0f;
+            }
+
+            // Partial coverage puts the outline inside the texel
+            if (coverage >= 1.0f) {
+                outer[y * box->w + x] = SDF_FONT_INFINITY;
+                inner[y * box->w + x] = 0.0f;
+            } else if (coverage <= 0.0f) {
+                outer[y * box->w + x] = 0.0f;
+                inner[y * box->w + x] = SDF_FONT_INFINITY;
+            } else {
+                const float distance = 0.5f - coverage;
+
+                // Mostly covered texels are inside seeds with the outline distance to the outside, and conversely
+                outer[y * box->w + x] = (distance < 0.0f) ? distance * distance : 0.0f;
+                inner[y * box->w + x] = (distance > 0.0f) ? distance * distance : 0.0f;
+            }
+        }
+    }
+
+    distance_transform_2d(outer, box->w, box->h, f, z, v);
+    distance_transform_2d(inner, box->w, box->h, f, z, v);
+
+    for (y = 0; y < box->h; y++) {
+        Uint8* distances = &(sdf->distances[(size_t)(box->y + y) * (size_t)sdf->texture.width + (size_t)box->x]);
+
+        for (x = 0; x < box->w; x++) {
+            const float inside = sqrtf(outer[y * box->w + x]) - sqrtf(inner[y * box->w + x]);
+            const float value = (float)SDF_FONT_OUTLINE + inside * 127.0f / (float)SDF_FONT_SPREAD;
+
+            distances[x] = (Uint8)((value < 0.0f) ? 0.0f : ((value > 255.0f) ? 255.0f : value));
+        }
+    }
+
+    free(v);
+    free(outer);
+    return 0;
+}
+
+static int add_sdf_glyph(struct sdf_font* sdf, const Uint32 codepoint, struct sdf_glyph* glyph) {
+    SDL_Surface* surface = NULL;
+    SDL_Surface* converted_surface = NULL;
+    int min_x = 0;
+    int max_x = 0;
+    int min_y = 0;
+    int max_y = 0;
+    int advance = 0;
+    int top = 0;
+    int bottom = 0;
+    int return_code = 0;
+
+    return_code = TTF_GlyphMetrics32(sdf->font, codepoint, &min_x, &max_x, &min_y, &max_y, &advance);
+    ASSERT(return_code == 0, return -1;, "TTF_GlyphMetrics32 error=[%s] codepoint=[U+%04X]", TTF_GetError(),
+           codepoint);
+
+    memset(glyph, 0, sizeof(*glyph));
+    glyph->codepoint = codepoint;
+    glyph->advance = advance;
+    if (max_x <= min_x || max_y <= min_y) {
+        return 0;
+    }
+
+    surface = TTF_RenderGlyph32_Blended(sdf->font, codepoint, (SDL_Color){0xFF, 0xFF, 0xFF, 0xFF});
+    ASSERT(surface != NULL, return -1;, "TTF_RenderGlyph32_Blended error=[%s] codepoint=[U+%04X]", TTF_GetError(),
+           codepoint);
+    if (surface->format->format != SDL_PIXELFORMAT_ARGB8888) {
+        converted_surface = SDL_ConvertSurfaceFormat(surface, SDL_PIXELFORMAT_ARGB8888, 0);
+        SDL_FreeSurface(surface);
+        ASSERT(converted_surface != NULL, return -1;, "SDL_ConvertSurfaceFormat error=[%s]", SDL_GetError());
+        surface = converted_surface;
+    }
+
+    // Trimmed to the glyph's rows like glyph_atlas.c, then grown by the spread on every side
+    top = TTF_FontAscent(sdf->font) - max_y;
+    top = (top < 0) ? 0 : ((top > surface->h) ? surface->h : top);
+    bottom = TTF_FontAscent(sdf->font) - min_y;
+    bottom = (bottom < top) ? top : ((bottom > surface->h) ? surface->h : bottom);
+    if (bottom == top || surface->w == 0) {
+        SDL_FreeSurface(surface);
+        return 0;
+    }
+
+    glyph->clip.w = surface->w + 2 * SDF_FONT_SPREAD;
+    glyph->clip.h = bottom - top + 2 * SDF_FONT_SPREAD;
+    glyph->offset_x = ((min_x < 0) ? min_x : 0) - SDF_FONT_SPREAD;
+    glyph->offset_y = top - SDF_FONT_SPREAD;
+    return_code = pack_shelf(&(sdf->packer), glyph->clip.w, glyph->clip.h, &(glyph->clip.x), &(glyph->clip.y));
+    ASSERT(return_code == 0, SDL_FreeSurface(surface); return -1;, "pack_shelf error codepoint=[U+%04X]", codepoint);
+
+    return_code = write_glyph_distances(sdf, surface, top, bottom, &(glyph->clip));
+    SDL_FreeSurface(surface);
+    ASSERT(return_code == 0, return -1;, "write_glyph_distances error codepoint=[U+%04X]", codepoint);
+
+    return 0;
+}
+
+// Shared by drawing and measuring, batch NULL only measures
+static int walk_sdf_text(const struct sdf_font* sdf, struct sprite_batch* batch, const char* text, const float x,
+                         const float y, const float scale, const double angle, float* width, float* height) {
+    const struct sdf_glyph* glyph = NULL;
+    const int origin_x = round_to_int(x);
+    const int origin_y = round_to_int(y);
+    Uint32 codepoint = 0;
+    Uint32 previous = 0;
+    float pen_x = 0.0f;
+    float pen_y = 0.0f;
+    float right = 0.0f;
+    int kerning = 0;
+    int return_code = 0;
+
+    while ((codepoint = next_utf8_codepoint(&text)) != 0) {
+        if (codepoint == '\n') {
+            pen_x = 0.0f;
+            pen_y += (float)sdf->line_skip * scale;
+            previous = 0;
+            continue;
+        }
+
+        glyph = find_sdf_glyph(sdf, codepoint);
+        if (glyph == NULL) {
+            glyph = find_sdf_glyph(sdf, '?');
+        }
+        if (glyph == NULL) {
+            continue;
+        }
+
+        kerning = glyph_kerning(sdf->font, previous, glyph->codepoint);
+        pen_x += (float)kerning * scale;
+        if (batch != NULL && glyph->clip.w > 0) {
+            SDL_Rect destination;
+
+            destination.x = round_to_int(x + pen_x + (float)glyph->offset_x * scale);
+            destination.y = round_to_int(y + pen_y + (float)glyph->offset_y * scale);
+            destination.w = round_to_int((float)glyph->clip.w * scale);
+            destination.h = round_to_int((float)glyph->clip.h * scale);
+
+            // Every glyph turns around the string's origin, not its own middle
+            return_code = add_sprite(batch, &(glyph->clip), &destination, angle,
+                                     &(SDL_Point){origin_x - destination.x, origin_y - destination.y}, SDL_FLIP_NONE);
+            ASSERT(return_code == 0, return -1;, "add_sprite error");
+        }
+        pen_x += (float)glyph->advance * scale;
+        right = (pen_x > right) ? pen_x : right;
+        previous = glyph->codepoint;
+    }
+
+    *width = right;
+    *height = pen_y + (float)sdf->height * scale;
+    return 0;
+}
+
+int create_sdf_font(struct sdf_font* sdf, SDL_Renderer* renderer, TTF_Font* font, const char* charset,
+                    const int width, const int height) {
+    TRACE_SPAN("create_sdf_font");
+    SDL_Texture* loaded_texture = NULL;
+    const char* text = NULL;
+    Uint32 codepoint = 0;
+    int codepoint_count = 0;
+    int index = 0;
+    bool known = false;
+    int return_code = 0;
+
+    ASSERT(sdf != NULL, return -1;, "Argument sdf must not be NULL");
+    ASSERT(sdf->distances == NULL, return -1;, "Argument sdf->distances must be NULL before initialization");
+    ASSERT(renderer != NULL, return -1;, "Argument renderer must not be NULL");
+    ASSERT(font != NULL, return -1;, "Argument font must not be NULL");
+    ASSERT(width > 0 && height > 0, return -1;, "Arguments width=[%d] height=[%d] must be larger than 0", width,
+           height);
+    ASSERT(width <= INT_MAX / 4 / height, return -1;, "Arguments width=[%d] height=[%d] too large", width, height);
+
+    charset = (charset != NULL) ? charset : SDF_FONT_ASCII;
+    text = charset;
+    while (next_utf8_codepoint(&text) != 0) {
+        codepoint_count++;
+    }
+    ASSERT(codepoint_count > 0, return -1;, "Argument charset must not be empty");
+
+    memset(sdf, 0, sizeof(*sdf));
+    sdf->renderer = renderer;
+    sdf->font = font;
+    sdf->line_skip = TTF_FontLineSkip(font);
+    sdf->height = TTF_FontHeight(font);
+    sdf->texture.width = width;
+    sdf->texture.height = height;
+    init_shelf_packer(&(sdf->packer), width, height);
+
+    // Texels no glyph covers stay far outside
+    sdf->distances = calloc((size_t)width * (size_t)height, 1);
+    ASSERT(sdf->distances != NULL, return -1;, "calloc error width=[%d] height=[%d]", width, height);
+    sdf->glyphs = calloc((size_t)codepoint_count, sizeof(*(sdf->glyphs)));
+    ASSERT(sdf->glyphs != NULL, destroy_sdf_font(sdf); return -1;, "calloc error glyphs=[%d]", codepoint_count);
+
+    TRACE("Generating distance fields glyphs=[%d] width=[%d] height=[%d] spread=[%d]", codepoint_count, width, height,
+          SDF_FONT_SPREAD);
+    text = charset;
+    while ((codepoint = next_utf8_codepoint(&text)) != 0) {
+        known = false;
+        for (index = 0; index < sdf->glyph_count; index++) {
+            known = known || sdf->glyphs[index].codepoint == codepoint;
+        }
+        if (known == true) {
+            continue;
+        }
+
+        return_code = add_sdf_glyph(sdf, codepoint, &(sdf->glyphs[sdf->glyph_count]));
+        ASSERT(return_code == 0, destroy_sdf_font(sdf); return -1;, "add_sdf_glyph error");
+        sdf->glyph_count++;
+    }
+    qsort(sdf->glyphs, (size_t)sdf->glyph_count, sizeof(*(sdf->glyphs)), compare_sdf_glyphs);
+
+    loaded_texture = SDL_CreateTexture(renderer, SDL_PIXELFORMAT_ARGB8888, SDL_TEXTUREACCESS_STATIC, width, height);
+    ASSERT(loaded_texture != NULL, destroy_sdf_font(sdf); return -1;, "SDL_CreateTexture error=[%s]", SDL_GetError());
+    sdf->texture.texture = loaded_texture;
+
+    return_code = SDL_SetTextureScaleMode(loaded_texture, SDL_ScaleModeBest);
+    ASSERT(return_code == 0, destroy_sdf_font(sdf); return -1;, "SDL_SetTextureScaleMode error=[%s]", SDL_GetError());
+    return_code = SDL_SetTextureBlendMode(loaded_texture, SDL_BLENDMODE_BLEND);
+    ASSERT(return_code == 0, destroy_sdf_font(sdf); return -1;, "SDL_SetTextureBlendMode error=[%s]", SDL_GetError());
+
+    return_code = set_sdf_font_edge(sdf, 1.0f);
+    ASSERT(return_code == 0, destroy_sdf_font(sdf); return -1;, "set_sdf_font_edge error");
+
+    TRACE("Created distance field font glyphs=[%d] shelves=[%d]", sdf->glyph_count, sdf->packer.shelf_count);
+    return 0;
+}
+
+void destroy_sdf_font(struct sdf_font* sdf) {
+    ASSERT(sdf != NULL, return;, "Argument sdf must not be NULL");
+
+    if (sdf->distances != NULL) {
+        TRACE("Destroying distance field font glyphs=[%d]", sdf->glyph_count);
+        free(sdf->distances);
+    }
+    if (sdf->glyphs != NULL) {
+        free(sdf->glyphs);
+    }
+    free_texture(&(sdf->texture));
+    memset(sdf, 0, sizeof(*sdf));
+
+    return;
+}
+
+int set_sdf_font_edge(struct sdf_font* sdf, const float scale) {
+    TRACE_SPAN("set_sdf_font_edge");
+    Uint32 alpha[256];
+    Uint32* pixels = NULL;
+    size_t texel_count = 0;
+    size_t texel = 0;
+    int value = 0;
+    int return_code = 0;
+
+    ASSERT(sdf != NULL, return -1;, "Argument sdf must not be NULL");
+    ASSERT(sdf->texture.texture != NULL, return -1;, "Argument sdf must be created with create_sdf_font");
+    ASSERT(scale > 0.0f, return -1;, "Argument scale must be larger than 0");
+
+    // Signed distance in texels, times scale in screen pixels, outline at half coverage
+    for (value = 0; value < 256; value++) {
+        const float inside = (float)(value - SDF_FONT_OUTLINE) * (float)SDF_FONT_SPREAD / 127.0f;
+        const float coverage = 0.5f + inside * scale;
+        const float clamped = (coverage < 0.0f) ? 0.0f : ((coverage > 1.0f) ? 1.0f : coverage);
+        const float rounded = floorf(clamped * 255.0f + 0.5f);
+
+        alpha[value] = ((Uint32)rounded << 24) | 0x00FFFFFFu;
+    }
+
+    texel_count = (size_t)sdf->texture.width * (size_t)sdf->texture.height;
+    pixels = malloc(texel_count * sizeof(*pixels));
+    ASSERT(pixels != NULL, return -1;, "malloc error texels=[%zu]", texel_count);
+    for (texel = 0; texel < texel_count; texel++) {
+        pixels[texel] = alpha[sdf->distances[texel]];
+    }
+
+    return_code = SDL_UpdateTexture(sdf->texture.texture, NULL, pixels, sdf->texture.width * (int)sizeof(*pixels));
+    free(pixels);
+    ASSERT(return_code == 0, return -1;, "SDL_UpdateTexture error=[%s]", SDL_GetError());
+
+    TRACE_DEBUG("Distance field edge scale=[%f]", (double)scale);
+    sdf->edge_scale = scale;
+    return 0;
+}
+
+int measure_sdf_text(const struct sdf_font* sdf, const char* text, const float scale, float* width, float* height) {
+    int return_code = 0;
+
+    ASSERT(sdf != NULL, return -1;, "Argument sdf must not be NULL");
+    ASSERT(text != NULL, return -1;, "Argument text must not be NULL");
+    ASSERT(width != NULL, return -1;, "Argument width must not be NULL");
+    ASSERT(height != NULL, return -1;, "Argument height must not be NULL");
+
+    return_code = walk_sdf_text(sdf, NULL, text, 0.0f, 0.0f, scale, 0.0, width, height);
+    ASSERT(return_code == 0, return -1;, "walk_sdf_text error");
+
+    return 0;
+}
+
+int draw_sdf_text(const struct sdf_font* sdf, struct sprite_batch* batch, const char* text, const float x,
+                  const float y, const float scale, const double angle, const SDL_Color color) {
+    TRACE_SPAN("draw_sdf_text");
+    SDL_Color previous_color;
+    float width = 0.0f;
+    float height = 0.0f;
+    int return_code = 0;
+
+    ASSERT(sdf != NULL, return -1;, "Argument sdf must not be NULL");
+    ASSERT(sdf->texture.texture != NULL, return -1;, "Argument sdf must be created with create_sdf_font");
+    ASSERT(batch != NULL, return -1;, "Argument batch must not be NULL");
+    ASSERT(text != NULL, return -1;, "Argument text must not be NULL");
+
+    if (batch->texture != sdf->texture.texture) {
+        return_code = begin_sprite_batch(batch, sdf->renderer, sdf->texture);
+        ASSERT(return_code == 0, return -1;, "begin_sprite_batch error");
+    }
+
+    previous_color = batch->color;
+    set_sprite_batch_color(batch, color);
+    return_code = walk_sdf_text(sdf, batch, text, x, y, scale, angle, &width, &height);
+    set_sprite_batch_color(batch, previous_color);
+    ASSERT(return_code == 0, return -1;, "walk_sdf_text error");
+
+    return 0;
+}
@@ -0,0 +1,77 @@
+#ifndef SDF_FONT_H
+#define SDF_FONT_H
+
+/*  Signed distance field font
+
+    One distance-field atlas per font, from which text is drawn at any scale and rotation with no further rasterizing,
+    where glyph_atlas.h needs a TTF_Font and a set of glyphs per size. Part of build/libsdlcommon.a, next to
+    glyph_atlas.h.
+
+        create_sdf_font(&sdf, renderer, font, NULL, 1024, 512);         // font opened at 48 points, printable ASCII
+        set_sdf_font_edge(&sdf, 2.0f);                                  // crisp up to twice the base size
+        draw_sdf_text(&sdf, &batch, "Hello", 320.0f, 240.0f, 1.5f, 30.0, color);
+        flush_sprite_batch(&batch);
+        destroy_sdf_font(&sdf);
+
+    create_sdf_font() rasterizes every codepoint of charset (UTF-8, printable ASCII when NULL) once with
+    TTF_RenderGlyph32_Blended() at the size the font was opened at, and turns each glyph into a distance field with an
+    exact Euclidean distance transform (Felzenszwalb and Huttenlocher) of its anti-aliased coverage, run outward and
+    inward. Distances up to SDF_FONT_SPREAD texels on either side of the outline are stored, 128 on the outline, in
+    one byte per texel of an atlas packed with the shelf packer of glyph_atlas.h. The font is only used for kerning
+    afterwards, and must stay open as long as the sdf_font.
+
+    SDL_Renderer has no fragment shaders, so the threshold a shader would apply per pixel is applied to the atlas:
+    set_sdf_font_edge() maps every distance through a lookup table to the alpha of a white texel, with the outline
+    anti-aliased over one screen pixel at the given scale, and uploads the result. It touches neither FreeType nor the
+    distance field, and is only needed again when text is drawn much larger than before; smaller text stays smooth
+    through linear filtering. create_sdf_font() sets it up for scale 1.
+
+    draw_sdf_text() adds one quad per visible glyph to a sprite batch (sprite_batch.h), scale times the base size,
+    the whole string rotated angle degrees clockwise around x and y, the top left corner of its first line. Kerning,
+    advances and '\n' work as in glyph_atlas.h, scaled. Codepoints missing from the charset are drawn as '?' when the
+    charset has one. measure_sdf_text() returns the unrotated size draw_sdf_text() would cover.
+*/
+
+#include <SDL2/SDL.h>
+#include <SDL2/SDL_ttf.h>
+#include <stdint.h>
+
+#include "glyph_atlas.h"
+#include "sdl_common.h"
+#include "sprite_batch.h"
+
+#define SDF_FONT_SPREAD 8
+#define SDF_FONT_ASCII \
+    " !\"#$%&'()*+,-./0123456789:;<=>?@ABCDEFGHIJKLMNOPQRSTUVWXYZ[\\]^_`abcdefghijklmnopqrstuvwxyz{|}~"
+
+struct sdf_glyph {
+    Uint32 codepoint;
+    SDL_Rect clip;  // in the atlas, spread included, empty for blank glyphs
+    int offset_x;   // from the pen position, at the base size
+    int offset_y;   // from the top of the line, at the base size
+    int advance;
+};
+
+struct sdf_font {
+    SDL_Renderer* renderer;
+    TTF_Font* font;  // not owned, kerning only
+    int line_skip;
+    int height;
+    struct sdl_texture texture;
+    Uint8* distances;           // one per atlas texel, 128 on the outline
+    struct sdf_glyph* glyphs;   // sorted by codepoint
+    int glyph_count;
+    struct shelf_packer packer;
+    float edge_scale;
+};
+
+int create_sdf_font(struct sdf_font* sdf, SDL_Renderer* renderer, TTF_Font* font, const char* charset,
+                    const int width, const int height);
+void destroy_sdf_font(struct sdf_font* sdf);
+
+int set_sdf_font_edge(struct sdf_font* sdf, const float scale);
+int measure_sdf_text(const struct sdf_font* sdf, const char* text, const float scale, float* width, float* height);
+int draw_sdf_text(const struct sdf_font* sdf, struct sprite_batch* batch, const char* text, const float x,
+                  const float y, const float scale, const double angle, const SDL_Color color);
+
+#endif  // SDF_FONT_H
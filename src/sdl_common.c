@@ -0,0 +1,326 @@
+#define _DEFAULT_SOURCE
+
+#include "sdl_common.h"
+
+#include <SDL2/SDL.h>
+#include <SDL2/SDL_image.h>
+#include <limits.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include <string.h>
+
+#include "assert.h"
+#include "bench.h"
+#include "embed_rwops.h"
+#include "raw_image.h"
+#include "trace.h"
+
+// check_raw_image() reads one byte per page of pixel rows
+#define PREFAULT_STRIDE 4096
+
+int init_SDL(struct sdl_system* system, const char* title, const Uint32 renderer_flags) {
+    int return_code = 0;
+    const int SCREEN_WIDTH = 640;
+    const int SCREEN_HEIGHT = 480;
+    const int img_flags = IMG_INIT_PNG;
+
+    ASSERT(system != NULL, return -1;, "Argument system must not be NULL");
+    ASSERT(title != NULL, return -1;, "Argument title must not be NULL");
+    ASSERT(system->window == NULL, return -1;, "Argument system->window must be NULL before initialization");
+    ASSERT(system->renderer == NULL, return -1;, "Argument system->renderer must be NULL before initialization");
+
+    // Benchmark mode swaps drivers and vsync through hints, which must be set before SDL_Init
+    return_code = set_bench_hints();
+    ASSERT(return_code == 0, return -1;, "set_bench_hints error");
+
+    TRACE("Initializing SDL");
+    return_code = SDL_Init(SDL_INIT_VIDEO);
+    ASSERT(return_code == 0, return -1;, "SDL_Init error=[%s]", SDL_GetError());
+
+    TRACE("Initializing SDL_image");
+    return_code = IMG_Init(img_flags);
+    ASSERT((return_code & img_flags) == img_flags, IMG_Quit(); SDL_Quit(); return -1;
+           , "IMG_Init error=[%s]", IMG_GetError());
+
+    TRACE("Creating window");
+    system->window = SDL_CreateWindow(title, SDL_WINDOWPOS_UNDEFINED, SDL_WINDOWPOS_UNDEFINED, SCREEN_WIDTH,
+                                      SCREEN_HEIGHT, SDL_WINDOW_SHOWN);
+    ASSERT(system->window != NULL, IMG_Quit(); SDL_Quit(); return -1;, "SDL_CreateWindow error=[%s]", SDL_GetError());
+
+    TRACE("Creating renderer for window");
+    system->renderer = SDL_CreateRenderer(system->window, -1, renderer_flags);
+    ASSERT(system->renderer != NULL, close_SDL(system); return -1;, "SDL_CreateRenderer error=[%s]", SDL_GetError());
+
+    return 0;
+}
+
+void close_SDL(struct sdl_system* system) {
+    ASSERT(system != NULL, return;, "Argument system must not be NULL");
+
+    if (system->renderer != NULL) {
+        TRACE("Destroying renderer");
+        SDL_DestroyRenderer(system->renderer);
+        system->renderer = NULL;
+    }
+
+    if (system->window != NULL) {
+        TRACE("Destroying window");
+        SDL_DestroyWindow(system->window);
+        system->window = NULL;
+    }
+
+    TRACE("Quitting SDL_image");
+    IMG_Quit();
+
+    TRACE("Quitting SDL");
+    SDL_Quit();
+    return;
+}
+
+static int read_raw_header(struct raw_image_header* header, const void* raw_data, const size_t size) {
+    ASSERT(size >= sizeof(*header), return -1;, "Argument size=[%zu] smaller than the raw image header", size);
+
+    // The blob is not guaranteed to be aligned for the header fields
+    memcpy(header, raw_data, sizeof(*header));
+    ASSERT(memcmp(header->magic, RAW_IMAGE_MAGIC, sizeof(header->magic)) == 0, return -1;, "Not a raw image blob");
+    ASSERT(header->version == RAW_IMAGE_VERSION, return -1;, "Unsupported raw image version=[%u]", header->version);
+    ASSERT(header->width > 0 && header->width <= INT_MAX / 4 && header->height > 0 && header->height <= INT_MAX,
+           return -1;, "Invalid raw image width=[%u] height=[%u]", header->width, header->height);
+    ASSERT(header->pitch >= header->width * 4 && header->pitch <= INT_MAX, return -1;
+           , "Invalid raw image pitch=[%u] width=[%u]", header->pitch, header->width);
+    ASSERT(header->offset >= sizeof(*header) && header->offset <= size &&
+               (size - header->offset) / header->pitch >= header->height,
+           return -1;, "Raw image truncated size=[%zu] offset=[%u] pitch=[%u] height=[%u]", size, header->offset,
+           header->pitch, header->height);
+
+    return 0;
+}
+
+int decode_surface_embedded(SDL_Surface** surface, const void* img_data, const size_t size,
+                            const SDL_Color* color_key) {
+    TRACE_SPAN("decode_surface_embedded");
+    SDL_RWops* rwops = NULL;
+    SDL_Surface* loaded_surface = NULL;
+    int return_code = 0;
+
+    ASSERT(surface != NULL, return -1;, "Argument surface must not be NULL");
+    ASSERT(img_data != NULL, return -1;, "Argument img_data must not be NULL");
+    ASSERT(size > 0, return -1;, "Argument size must be larger than 0");
+    ASSERT(size <= INT_MAX, return -1;, "Argument size must not exceed maximum allowed");
+
+    TRACE("Opening stream to embedded image data");
+    rwops = open_embedded_rwops(img_data, size);
+    ASSERT(rwops != NULL, return -1;, "open_embedded_rwops error");
+
+    TRACE("Loading surface");
+    loaded_surface = IMG_Load_RW(rwops, 1);
+    ASSERT(loaded_surface != NULL, return -1;, "IMG_Load_RW error=[%s]", IMG_GetError());
+    TRACE("Image width=[%d] height=[%d]", loaded_surface->w, loaded_surface->h);
+
+    if (color_key != NULL) {
+        TRACE("Setting surface color_key=[%02X%02X%02X]", color_key->r, color_key->g, color_key->b);
+        return_code = SDL_SetColorKey(loaded_surface, SDL_TRUE,
+                                      SDL_MapRGB(loaded_surface->format, color_key->r, color_key->g, color_key->b));
+        ASSERT(return_code == 0, SDL_FreeSurface(loaded_surface); return -1;
+               , "SDL_SetColorKey error=[%s]", SDL_GetError());
+    }
+
+    *surface = loaded_surface;
+    return 0;
+}
+
+int check_raw_image(const void* raw_data, const size_t size) {
+    TRACE_SPAN("check_raw_image");
+    struct raw_image_header header;
+    const volatile Uint8* pixels = NULL;
+    size_t length = 0;
+    size_t offset = 0;
+    Uint8 sum = 0;
+    int return_code = 0;
+
+    ASSERT(raw_data != NULL, return -1;, "Argument raw_data must not be NULL");
+
+    return_code = read_raw_header(&header, raw_data, size);
+    ASSERT(return_code == 0, return -1;, "read_raw_header error");
+
+    // One read per page faults the rows in here instead of inside SDL_UpdateTexture on the render thread
+    pixels = (const volatile Uint8*)raw_data + header.offset;
+    length = (size_t)header.pitch * header.height;
+    for (offset = 0; offset < length; offset += PREFAULT_STRIDE) {
+        sum = (Uint8)(sum + pixels[offset]);
+    }
+    TRACE("Raw image width=[%u] height=[%u] pages=[%zu] sum=[%u]", header.width, header.height,
+          (length + PREFAULT_STRIDE - 1) / PREFAULT_STRIDE, sum);
+
+    return 0;
+}
+
+int create_texture_from_surface(struct sdl_texture* texture, SDL_Surface* surface, SDL_Renderer* renderer) {
+    TRACE_SPAN("create_texture_from_surface");
+    SDL_Texture* loaded_texture = NULL;
+    int return_code = 0;
+
+    ASSERT(texture != NULL, return -1;, "Argument texture must not be NULL");
+    ASSERT(surface != NULL, return -1;, "Argument surface must not be NULL");
+    ASSERT(renderer != NULL, return -1;, "Argument renderer must not be NULL");
+
+    TRACE("Creating texture from surface");
+    loaded_texture = SDL_CreateTextureFromSurface(renderer, surface);
+    ASSERT(loaded_texture != NULL, return -1;, "SDL_CreateTextureFromSurface error=[%s]", SDL_GetError());
+
+    return_code = SDL_SetTextureScaleMode(loaded_texture, SDL_ScaleModeBest);
+    ASSERT(return_code == 0, SDL_DestroyTexture(loaded_texture); return -1;
+           , "SDL_SetTextureScaleMode error=[%s]", SDL_GetError());
+
+    return_code = SDL_SetTextureBlendMode(loaded_texture, SDL_BLENDMODE_BLEND);
+    ASSERT(return_code == 0, SDL_DestroyTexture(loaded_texture); return -1;
+           , "SDL_SetTextureBlendMode error=[%s]", SDL_GetError());
+
+    // Fill return texture
+    if (texture->texture != NULL) {
+        free_texture(texture);
+    }
+    texture->texture = loaded_texture;
+    texture->width = surface->w;
+    texture->height = surface->h;
+    return 0;
+}
+
+int load_texture_embedded(struct sdl_texture* texture, const void* img_data, const size_t size, SDL_Renderer* renderer,
+                          const SDL_Color* color_key) {
+    TRACE_SPAN("load_texture_embedded");
+    SDL_Surface* loaded_surface = NULL;
+    int return_code = 0;
+
+    ASSERT(texture != NULL, return -1;, "Argument texture must not be NULL");
+    ASSERT(renderer != NULL, return -1;, "Argument renderer must not be NULL");
+
+    return_code = decode_surface_embedded(&loaded_surface, img_data, size, color_key);
+    ASSERT(return_code == 0, return -1;, "decode_surface_embedded error");
+
+    return_code = create_texture_from_surface(texture, loaded_surface, renderer);
+    SDL_FreeSurface(loaded_surface);
+    ASSERT(return_code == 0, return -1;, "create_texture_from_surface error");
+
+    return 0;
+}
+
+int load_texture_raw(struct sdl_texture* texture, const void* raw_data, const size_t size, SDL_Renderer* renderer) {
+    TRACE_SPAN("load_texture_raw");
+    struct raw_image_header header;
+    SDL_Texture* loaded_texture = NULL;
+    int return_code = 0;
+
+    ASSERT(texture != NULL, return -1;, "Argument texture must not be NULL");
+    ASSERT(raw_data != NULL, return -1;, "Argument raw_data must not be NULL");
+    ASSERT(renderer != NULL, return -1;, "Argument renderer must not be NULL");
+
+    return_code = read_raw_header(&header, raw_data, size);
+    ASSERT(return_code == 0, return -1;, "read_raw_header error");
+    TRACE("Raw image width=[%u] height=[%u] pitch=[%u] format=[%s]", header.width, header.height, header.pitch,
+          SDL_GetPixelFormatName(header.format));
+
+    // No decode and no intermediate surface, the rows go straight from the blob to the texture
+    TRACE("Creating texture from raw pixels");
+    loaded_texture =
+        SDL_CreateTexture(renderer, header.format, SDL_TEXTUREACCESS_STATIC, (int)header.width, (int)header.height);
+    ASSERT(loaded_texture != NULL, return -1;, "SDL_CreateTexture error=[%s]", SDL_GetError());
+
+    return_code = SDL_UpdateTexture(loaded_texture, NULL, (const Uint8*)raw_data + header.offset, (int)header.pitch);
+    ASSERT(return_code == 0, SDL_DestroyTexture(loaded_texture); return -1;
+           , "SDL_UpdateTexture error=[%s]", SDL_GetError());
+
+    return_code = SDL_SetTextureScaleMode(loaded_texture, SDL_ScaleModeBest);
+    ASSERT(return_code == 0, SDL_DestroyTexture(loaded_texture); return -1;
+           , "SDL_SetTextureScaleMode error=[%s]", SDL_GetError());
+
+    return_code = SDL_SetTextureBlendMode(loaded_texture, SDL_BLENDMODE_BLEND);
+    ASSERT(return_code == 0, SDL_DestroyTexture(loaded_texture); return -1;
+           , "SDL_SetTextureBlendMode error=[%s]", SDL_GetError());
+
+    // Fill return texture
+    if (texture->texture != NULL) {
+        free_texture(texture);
+    }
+    texture->texture = loaded_texture;
+    texture->width = (int)header.width;
+    texture->height = (int)header.height;
+    return 0;
+}
+
+void free_texture(struct sdl_texture* texture) {
+    ASSERT(texture != NULL, return;, "Argument texture must not be NULL");
+
+    if (texture->texture != NULL) {
+        TRACE("Destroying texture");
+        SDL_DestroyTexture(texture->texture);
+        texture->texture = NULL;
+    }
+    texture->width = 0;
+    texture->height = 0;
+
+    return;
+}
+
+int render_texture(const struct sdl_texture texture, SDL_Renderer* renderer, int x, int y, const SDL_Rect* clip,
+                   const double angle, const SDL_Point* center, const SDL_RendererFlip flip) {
+    TRACE_SPAN("render_texture");
+    int return_code = 0;
+    SDL_Rect destination_rect;
+
+    ASSERT(texture.texture != NULL, return -1;, "Argument texture.texture must not be NULL");
+    ASSERT(renderer != NULL, return -1;, "Argument renderer must not be NULL");
+
+    // A NULL source rect already means the whole texture, only the destination size depends on the clip
+    if (clip != NULL) {
+        destination_rect = (SDL_Rect){x, y, clip->w, clip->h};
+    } else {
+        destination_rect = (SDL_Rect){x, y, texture.width, texture.height};
+    }
+
+    // SDL_RenderCopyEx builds a rotated quad even for angle 0, the plain copy skips that work
+    if (flip == SDL_FLIP_NONE && (angle < 0.0 || angle > 0.0) == false) {
+        return_code = SDL_RenderCopy(renderer, texture.texture, clip, &destination_rect);
+        ASSERT(return_code == 0, return -1;, "SDL_RenderCopy error=[%s]", SDL_GetError());
+        return 0;
+    }
+
+    return_code = SDL_RenderCopyEx(renderer, texture.texture, clip, &destination_rect, angle, center, flip);
+    ASSERT(return_code == 0, return -1;, "SDL_RenderCopyEx error=[%s]", SDL_GetError());
+
+    return 0;
+}
+
+int handle_events(bool* quit, sdl_event_handler handler, void* context) {
+    TRACE_SPAN("handle_events");
+    SDL_Event event_buffer;
+    int return_code = 0;
+
+    ASSERT(quit != NULL, return -1;, "Argument quit must not be NULL");
+
+    do {
+        return_code = SDL_PollEvent(&event_buffer);
+        ASSERT(return_code >= 0, return -1;, "SDL_PollEvent error=[%s]", SDL_GetError());
+
+        if (return_code == 0) {
+            break;
+        }
+        switch (event_buffer.type) {
+            case SDL_QUIT: {
+                TRACE("Quit");
+                *quit = true;
+                break;
+            }
+            default: {
+                if (handler != NULL) {
+                    return_code = handler(&event_buffer, context);
+                    ASSERT(return_code == 0, return -1;, "Event handler error type=[%u]", event_buffer.type);
+                    return_code = 1;
+                }
+                break;
+            }
+        }
+    } while (return_code == 1);
+
+    return 0;
+}
@@ -0,0 +1,66 @@
+#ifndef SDL_COMMON_H
+#define SDL_COMMON_H
+
+/*  SDL common helpers
+
+    Window, renderer, texture and event helpers shared by the renderer-based tutorials. They are built once into
+    build/libsdlcommon.a together with the font helpers (sdl_font.h, glyph_atlas.h, sdf_font.h, text_layout.h), the
+    sprite batch (sprite_batch.h), the benchmark mode (bench.h), the fixed timestep loop and its pacer (frame_loop.h,
+    frame_pacer.h), the embedded asset streams (embed_rwops.h), the asynchronous asset loader (asset_loader.h) and the
+    texture cache (texture_cache.h); every tutorial links the archive, and the linker only pulls the members a program
+    actually uses, so a program without text does not depend on SDL_ttf.
+
+    init_SDL() initializes SDL and SDL_image (PNG), applies the benchmark hints (set_bench_hints()) and creates a
+    640x480 window titled title with a renderer created with renderer_flags. close_SDL() tears down what init_SDL()
+    created and is safe to call on a partially initialized system.
+
+    load_texture_embedded() decodes an embedded image into a texture, optionally color keyed, with SDL_ScaleModeBest
+    and SDL_BLENDMODE_BLEND; the image is read through open_embedded_rwops() (embed_rwops.h), so it may be stored
+    compressed. load_texture_raw() creates the same texture from a blob pre-decoded at build time by embed.sh --raw
+    (raw_image.h) and uploads it with SDL_UpdateTexture, no decode and no surface; a color key is applied when the
+    blob is made. render_texture() draws a texture, or the clip of it, with its top left corner at x, y; it goes
+    through SDL_RenderCopy unless a rotation or a flip is requested.
+
+    load_texture_embedded() is decode_surface_embedded(), which only needs SDL_image and may run on any thread, followed
+    by create_texture_from_surface(), which needs the renderer thread; the asynchronous loader (asset_loader.h) calls
+    them on different threads. check_raw_image() validates a raw blob and reads one byte per page of its rows, so the
+    pages are faulted in before load_texture_raw() copies them; it may run on any thread too.
+
+    handle_events() drains the event queue: SDL_QUIT sets *quit, every other event is passed to handler (may be NULL)
+    with context. A handler returns 0 on success, anything else stops the drain and fails handle_events().
+*/
+
+#include <SDL2/SDL.h>
+#include <stdbool.h>
+#include <stddef.h>
+
+struct sdl_texture {
+    SDL_Texture* texture;
+    int width;
+    int height;
+};
+
+struct sdl_system {
+    SDL_Window* window;
+    SDL_Renderer* renderer;
+};
+
+typedef int (*sdl_event_handler)(const SDL_Event* event, void* context);
+
+int init_SDL(struct sdl_system* system, const char* title, const Uint32 renderer_flags);
+void close_SDL(struct sdl_system* system);
+
+int load_texture_embedded(struct sdl_texture* texture, const void* img_data, const size_t size, SDL_Renderer* renderer,
+                          const SDL_Color* color_key);
+int decode_surface_embedded(SDL_Surface** surface, const void* img_data, const size_t size,
+                            const SDL_Color* color_key);
+int check_raw_image(const void* raw_data, const size_t size);
+int create_texture_from_surface(struct sdl_texture* texture, SDL_Surface* surface, SDL_Renderer* renderer);
+int load_texture_raw(struct sdl_texture* texture, const void* raw_data, const size_t size, SDL_Renderer* renderer);
+void free_texture(struct sdl_texture* texture);
+int render_texture(const struct sdl_texture texture, SDL_Renderer* renderer, int x, int y, const SDL_Rect* clip,
+                   const double angle, const SDL_Point* center, const SDL_RendererFlip flip);
+
+int handle_events(bool* quit, sdl_event_handler handler, void* context);
+
+#endif  // SDL_COMMON_H
@@ -0,0 +1,174 @@
+#define _DEFAULT_SOURCE
+
+#include "sdl_font.h"
+
+#include <SDL2/SDL.h>
+#include <SDL2/SDL_ttf.h>
+#include <limits.h>
+#include <stddef.h>
+#include <string.h>
+
+#include "asset_loader.h"
+#include "assert.h"
+#include "embed_rwops.h"
+#include "sdl_common.h"
+#include "trace.h"
+
+static int decode_font_embedded(struct asset_job* job) {
+    TTF_Font* loaded_font = NULL;
+    int return_code = 0;
+
+    return_code = load_font_embedded(&loaded_font, job->ptsize, job->data, job->size);
+    ASSERT(return_code == 0, return -1;, "load_font_embedded error");
+
+    job->result = loaded_font;
+    return 0;
+}
+
+static int upload_font_embedded(struct asset_job* job, SDL_Renderer* renderer) {
+    TTF_Font** font = job->target;
+
+    (void)renderer;
+
+    // Nothing to upload, the font only changes hands
+    if (*font != NULL) {
+        free_font(font);
+    }
+    *font = job->result;
+    job->result = NULL;
+    return 0;
+}
+
+static void release_font_embedded(struct asset_job* job) {
+    TTF_Font* font = job->result;
+
+    free_font(&font);
+}
+
+int init_TTF(void) {
+    int return_code = 0;
+
+    TRACE("Initializing SDL_ttf");
+    return_code = TTF_Init();
+    ASSERT(return_code == 0, return -1;, "TTF_Init error=[%s]", TTF_GetError());
+
+    return 0;
+}
+
+void close_TTF(void) {
+    TRACE("Quitting SDL_ttf");
+    TTF_Quit();
+    return;
+}
+
+int load_font_embedded(TTF_Font** font, const int ptsize, const void* ttf_data, const size_t size) {
+    SDL_RWops* rwops = NULL;
+    TTF_Font* loaded_font = NULL;
+
+    ASSERT(font != NULL, return -1;, "Argument font must not be NULL");
+    ASSERT(ptsize > 0, return -1;, "Argument ptsize must be larger than 0");
+    ASSERT(ttf_data != NULL, return -1;, "Argument ttf_data must not be NULL");
+    ASSERT(size > 0, return -1;, "Argument size must be larger than 0");
+    ASSERT(size <= INT_MAX, return -1;, "Argument size must not exceed maximum allowed");
+
+    TRACE("Opening stream to embedded font data");
+    rwops = open_embedded_rwops(ttf_data, size);
+    ASSERT(rwops != NULL, return -1;, "open_embedded_rwops error");
+
+    TRACE("Loading font");
+    loaded_font = TTF_OpenFontRW(rwops, 1, ptsize);
+    ASSERT(loaded_font != NULL, return -1;, "TTF_OpenFontRW error=[%s]", TTF_GetError());
+
+    // Fill return font
+    if (*font != NULL) {
+        free_font(font);
+    }
+    *font = loaded_font;
+
+    return 0;
+}
+
+int queue_font_embedded(struct asset_loader* loader, TTF_Font** font, const int ptsize, const void* ttf_data,
+                        const size_t size) {
+    struct asset_job job;
+    int return_code = 0;
+
+    ASSERT(font != NULL, return -1;, "Argument font must not be NULL");
+    ASSERT(ptsize > 0, return -1;, "Argument ptsize must be larger than 0");
+    ASSERT(ttf_data != NULL, return -1;, "Argument ttf_data must not be NULL");
+
+    // SDL_ttf opens every font through one shared FreeType library handle
+    memset(&job, 0, sizeof(job));
+    job.decode = decode_font_embedded;
+    job.upload = upload_font_embedded;
+    job.release = release_font_embedded;
+    job.data = ttf_data;
+    job.size = size;
+    job.target = font;
+    job.ptsize = ptsize;
+    job.exclusive = true;
+
+    return_code = queue_asset_job(loader, &job);
+    ASSERT(return_code == 0, return -1;, "queue_asset_job error");
+
+    return 0;
+}
+
+void free_font(TTF_Font** font) {
+    ASSERT(font != NULL, return;, "Argument font must not be NULL");
+
+    if (*font != NULL) {
+        TRACE("Destroying font");
+        TTF_CloseFont(*font);
+        *font = NULL;
+    }
+
+    return;
+}
+
+int create_text_texture(struct sdl_texture* texture, const char* text, TTF_Font* font, const SDL_Color color,
+                        SDL_Renderer* renderer) {
+    SDL_Surface* loaded_surface = NULL;
+    SDL_Texture* loaded_texture = NULL;
+    int width = 0;
+    int height = 0;
+    int return_code = 0;
+
+    ASSERT(texture != NULL, return -1;, "Argument texture must not be NULL");
+    ASSERT(text != NULL, return -1;, "Argument text must not be NULL");
+    ASSERT(font != NULL, return -1;, "Argument font must not be NULL");
+    ASSERT(renderer != NULL, return -1;, "Argument renderer must not be NULL");
+
+    TRACE("Loading surface");
+    loaded_surface = TTF_RenderText_Blended(font, text, color);
+    ASSERT(loaded_surface != NULL, return -1;, "TTF_RenderText_Blended error=[%s]", TTF_GetError());
+
+    width = loaded_surface->w;
+    height = loaded_surface->h;
+    TRACE("Image width=[%d] height=[%d]", width, height);
+
+    TRACE("Creating texture from surface");
+    loaded_texture = SDL_CreateTextureFromSurface(renderer, loaded_surface);
+    ASSERT(loaded_texture != NULL, SDL_FreeSurface(loaded_surface); return -1;
+           , "SDL_CreateTextureFromSurface error=[%s]", SDL_GetError());
+
+    SDL_FreeSurface(loaded_surface);
+
+    return_code = SDL_SetTextureScaleMode(loaded_texture, SDL_ScaleModeBest);
+    ASSERT(return_code == 0, SDL_DestroyTexture(loaded_texture); return -1;
+           , "SDL_SetTextureScaleMode error=[%s]", SDL_GetError());
+
+    return_code = SDL_SetTextureBlendMode(loaded_texture, SDL_BLENDMODE_BLEND);
+    ASSERT(return_code == 0, SDL_DestroyTexture(loaded_texture); return -1;
+           , "SDL_SetTextureBlendMode error=[%s]", SDL_GetError());
+
+    // Fill return texture
+    if (texture->texture != NULL) {
+        free_texture(texture);
+    }
+    texture->texture = loaded_texture;
+    texture->width = width;
+    texture->height = height;
+
+    return 0;
+}
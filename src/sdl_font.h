@@ -0,0 +1,33 @@
+#ifndef SDL_FONT_H
+#define SDL_FONT_H
+
+/*  SDL font helpers
+
+    SDL_ttf counterparts of the sdl_common.h helpers, kept in their own archive member so only programs that render
+    text link SDL_ttf. init_TTF() runs after init_SDL() and close_TTF() before close_SDL().
+
+    load_font_embedded() opens an embedded TrueType font at ptsize points. queue_font_embedded() does the same on a
+    worker of an asset loader (asset_loader.h), one font at a time, and hands the font over to *font on upload.
+    create_text_texture() renders text with TTF_RenderText_Blended into a new texture with SDL_ScaleModeBest and
+    SDL_BLENDMODE_BLEND.
+*/
+
+#include <SDL2/SDL.h>
+#include <SDL2/SDL_ttf.h>
+#include <stddef.h>
+
+#include "asset_loader.h"
+#include "sdl_common.h"
+
+int init_TTF(void);
+void close_TTF(void);
+
+int load_font_embedded(TTF_Font** font, const int ptsize, const void* ttf_data, const size_t size);
+int queue_font_embedded(struct asset_loader* loader, TTF_Font** font, const int ptsize, const void* ttf_data,
+                        const size_t size);
+void free_font(TTF_Font** font);
+
+int create_text_texture(struct sdl_texture* texture, const char* text, TTF_Font* font, const SDL_Color color,
+                        SDL_Renderer* renderer);
+
+#endif  // SDL_FONT_H
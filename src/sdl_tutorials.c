@@ -0,0 +1,125 @@
+#include <stdio.h>
+#include <string.h>
+
+/*  sdl_tutorials
+
+    Multi-call binary, busybox style: every tutorial linked into one executable that shares a single copy of the SDL
+    helpers (libsdlcommon.a), trace and assert, and of each asset through one combined, content-deduplicated asset pack
+    (pack/sdl_tutorials.pack, see pack_gen.c). The tutorial to run is picked by the name it is called as, or by the
+    first argument when called by its own name:
+
+        bin/multicall/15_rotation_and_flipping --racers 64      (a symlink to ../sdl_tutorials)
+        bin/sdl_tutorials 15_rotation_and_flipping --racers 64
+        bin/sdl_tutorials                                       (lists the tutorials)
+
+    The tutorial sources are not changed for this. The makefile copies each tutorial object into build/multicall/ with
+    objcopy, renaming main to tutorial_<name>_main and its _embed_<name>_pack_* symbols to those of the combined pack,
+    and making every other symbol it defines local, so the load_media()/init_SDL() of one tutorial never clashes with
+    those of another or of libsdlcommon.a. The tutorial then sees argv shifted so that argv[0] is its own name.
+*/
+
+#define MULTICALL_NAME "sdl_tutorials"
+
+struct tutorial {
+    const char* name;
+    int (*main)(int argc, char** argv);
+};
+
+int tutorial_01_hello_sdl_main(int argc, char** argv);
+int tutorial_02_image_on_screen_main(int argc, char** argv);
+int tutorial_03_event_driven_programming_main(int argc, char** argv);
+int tutorial_04_key_presses_main(int argc, char** argv);
+int tutorial_05_optimized_surface_and_soft_stretching_main(int argc, char** argv);
+int tutorial_06_extension_libraries_main(int argc, char** argv);
+int tutorial_07_texture_loading_and_rendering_main(int argc, char** argv);
+int tutorial_08_geometry_rendering_main(int argc, char** argv);
+int tutorial_09_the_viewport_main(int argc, char** argv);
+int tutorial_10_color_keying_main(int argc, char** argv);
+int tutorial_11_clip_rendering_main(int argc, char** argv);
+int tutorial_12_color_modulation_main(int argc, char** argv);
+int tutorial_13_alpha_blending_main(int argc, char** argv);
+int tutorial_14_animated_sprites_main(int argc, char** argv);
+int tutorial_15_rotation_and_flipping_main(int argc, char** argv);
+int tutorial_16_true_type_fonts_main(int argc, char** argv);
+
+const char* base_name(const char* path);
+const struct tutorial* find_tutorial(const char* name);
+void print_tutorials(FILE* output, const char* program);
+int main(int argc, char** argv);
+
+static const struct tutorial tutorials[] = {
+    {"01_hello_sdl", tutorial_01_hello_sdl_main},
+    {"02_image_on_screen", tutorial_02_image_on_screen_main},
+    {"03_event_driven_programming", tutorial_03_event_driven_programming_main},
+    {"04_key_presses", tutorial_04_key_presses_main},
+    {"05_optimized_surface_and_soft_stretching", tutorial_05_optimized_surface_and_soft_stretching_main},
+    {"06_extension_libraries", tutorial_06_extension_libraries_main},
+    {"07_texture_loading_and_rendering", tutorial_07_texture_loading_and_rendering_main},
+    {"08_geometry_rendering", tutorial_08_geometry_rendering_main},
+    {"09_the_viewport", tutorial_09_the_viewport_main},
+    {"10_color_keying", tutorial_10_color_keying_main},
+    {"11_clip_rendering", tutorial_11_clip_rendering_main},
+    {"12_color_modulation", tutorial_12_color_modulation_main},
+    {"13_alpha_blending", tutorial_13_alpha_blending_main},
+    {"14_animated_sprites", tutorial_14_animated_sprites_main},
+    {"15_rotation_and_flipping", tutorial_15_rotation_and_flipping_main},
+    {"16_true_type_fonts", tutorial_16_true_type_fonts_main},
+};
+
+const char* base_name(const char* path) {
+    return (strrchr(path, '/') != NULL) ? strrchr(path, '/') + 1 : path;
+}
+
+const struct tutorial* find_tutorial(const char* name) {
+    size_t index = 0;
+
+    for (index = 0; index < sizeof(tutorials) / sizeof(tutorials[0]); index++) {
+        if (strcmp(tutorials[index].name, name) == 0) {
+            return &(tutorials[index]);
+        }
+    }
+
+    return NULL;
+}
+
+void print_tutorials(FILE* output, const char* program) {
+    size_t index = 0;
+
+    fprintf(output, "Usage: %s <tutorial> [arguments]...\n", program);
+    fprintf(output, "   or: <tutorial> [arguments]...   (through a link named after the tutorial)\n\n");
+    fprintf(output, "Tutorials:\n");
+    for (index = 0; index < sizeof(tutorials) / sizeof(tutorials[0]); index++) {
+        fprintf(output, "    %s\n", tutorials[index].name);
+    }
+}
+
+int main(int argc, char** argv) {
+    const struct tutorial* tutorial = NULL;
+    const char* name = NULL;
+
+    if (argc < 1) {
+        fprintf(stderr, "%s:%d - %s - Missing argv[0]\n", __FILE__, __LINE__, __func__);
+        return -1;
+    }
+
+    // Called by its own name: the tutorial is the first argument and the one it sees as argv[0]
+    name = base_name(argv[0]);
+    if (strcmp(name, MULTICALL_NAME) == 0) {
+        if (argc < 2) {
+            print_tutorials(stderr, argv[0]);
+            return -1;
+        }
+        argc--;
+        argv++;
+        name = base_name(argv[0]);
+    }
+
+    tutorial = find_tutorial(name);
+    if (tutorial == NULL) {
+        fprintf(stderr, "%s:%d - %s - Unknown tutorial=[%s]\n\n", __FILE__, __LINE__, __func__, name);
+        print_tutorials(stderr, MULTICALL_NAME);
+        return -1;
+    }
+
+    return tutorial->main(argc, argv);
+}
@@ -0,0 +1,244 @@
+#define _DEFAULT_SOURCE
+
+#include <ctype.h>
+#include <limits.h>
+#include <stdio.h>
+#include <string.h>
+
+#include "assert.h"
+#include "trace.h"
+
+/*  sheet_gen
+
+    Build-time sprite-sheet compiler. Turns a descriptor of grid-laid frame sequences into a header of constant clip
+    tables, so a program gets its clips from .rodata instead of filling them in at startup:
+
+        bin/sheet_gen <sheet-descriptor> <clip-header>
+
+    The descriptor sits next to the image, one sequence per line, '#' starts a comment:
+
+        # name       origin_x origin_y cell_w cell_h stride_x stride_y per_row count
+        blue_falcon         1       18     48     32       49       33      13    13
+
+    Frame i of a sequence is the cell_w x cell_h rect at
+    (origin_x + (i % per_row) * stride_x, origin_y + (i / per_row) * stride_y). Symbols follow embed.sh, with the
+    descriptor file name stripped of its extension as prefix:
+
+        #define _sheet_SNES_F_Zero_Racers_blue_falcon_count 13
+        static _Alignas(64) const SDL_Rect _sheet_SNES_F_Zero_Racers_blue_falcon[13] = {...};
+
+    Each table starts on a cache line, so walking a sequence never touches a line shared with another one.
+*/
+
+#define SHEET_MAX_SEQUENCES 256
+#define SHEET_MAX_FRAMES 65536
+#define SHEET_NAME_SIZE 64
+#define SHEET_LINE_SIZE 512
+#define SHEET_ALIGNMENT 64
+
+struct sheet_sequence {
+    char name[SHEET_NAME_SIZE];
+    int origin_x;
+    int origin_y;
+    int cell_width;
+    int cell_height;
+    int stride_x;
+    int stride_y;
+    int per_row;
+    int count;
+};
+
+int make_symbol_prefix(char* prefix, const size_t size, const char* path);
+int parse_sequence(const char* line, struct sheet_sequence* sequence);
+int parse_sheet(const char* path, struct sheet_sequence* sequences, int* count);
+int write_sheet_header(const char* path, const char* descriptor_path, const struct sheet_sequence* sequences,
+                       const int count);
+int main(int argc, char** argv);
+
+int make_symbol_prefix(char* prefix, const size_t size, const char* path) {
+    const char* base = NULL;
+    const char* extension = NULL;
+    size_t length = 0;
+    size_t index = 0;
+
+    ASSERT(prefix != NULL, return -1;, "Argument prefix must not be NULL");
+    ASSERT(path != NULL, return -1;, "Argument path must not be NULL");
+
+    base = (strrchr(path, '/') != NULL) ? strrchr(path, '/') + 1 : path;
+    extension = strrchr(base, '.');
+    length = (extension != NULL) ? (size_t)(extension - base) : strlen(base);
+    ASSERT(length > 0 && length < size, return -1;, "Invalid prefix length=[%zu] path=[%s]", length, path);
+
+    // Same mapping as embed.sh, anything outside [A-Za-z0-9_] becomes '_'
+    for (index = 0; index < length; index++) {
+        const unsigned char character = (unsigned char)base[index];
+        prefix[index] = (isalnum(character) != 0) ? (char)character : '_';
+    }
+    prefix[length] = '\0';
+
+    return 0;
+}
+
+int parse_sequence(const char* line, struct sheet_sequence* sequence) {
+    int fields = 0;
+    int consumed = 0;
+    size_t index = 0;
+    long last_x = 0;
+    long last_y = 0;
+
+    ASSERT(line != NULL, return -1;, "Argument line must not be NULL");
+    ASSERT(sequence != NULL, return -1;, "Argument sequence must not be NULL");
+
+    fields = sscanf(line, "%63s %d %d %d %d %d %d %d %d %n", sequence->name, &sequence->origin_x, &sequence->origin_y,
+                    &sequence->cell_width, &sequence->cell_height, &sequence->stride_x, &sequence->stride_y,
+                    &sequence->per_row, &sequence->count, &consumed);
+    ASSERT(fields == 9 && line[consumed] == '\0', return -1;, "Expected 9 fields, got fields=[%d]", fields);
+
+    ASSERT(isalpha((unsigned char)sequence->name[0]) != 0 || sequence->name[0] == '_', return -1;
+           , "Invalid name=[%s]", sequence->name);
+    for (index = 0; sequence->name[index] != '\0'; index++) {
+        const unsigned char character = (unsigned char)sequence->name[index];
+        ASSERT(isalnum(character) != 0 || character == '_', return -1;, "Invalid name=[%s]", sequence->name);
+    }
+
+    ASSERT(sequence->origin_x >= 0 && sequence->origin_y >= 0, return -1;, "Negative origin name=[%s]", sequence->name);
+    ASSERT(sequence->cell_width > 0 && sequence->cell_height > 0, return -1;
+           , "Empty cell name=[%s]", sequence->name);
+    ASSERT(sequence->stride_x >= 0 && sequence->stride_y >= 0, return -1;, "Negative stride name=[%s]", sequence->name);
+    ASSERT(sequence->per_row > 0, return -1;, "per_row must be larger than 0 name=[%s]", sequence->name);
+    ASSERT(sequence->count > 0 && sequence->count <= SHEET_MAX_FRAMES, return -1;
+           , "count=[%d] out of range name=[%s]", sequence->count, sequence->name);
+
+    // The furthest cell must still be addressable by an SDL_Rect
+    last_x = (long)sequence->origin_x + (long)(sequence->per_row - 1) * sequence->stride_x + sequence->cell_width;
+    last_y = (long)sequence->origin_y + (long)((sequence->count - 1) / sequence->per_row) * sequence->stride_y +
+             sequence->cell_height;
+    ASSERT(last_x <= INT_MAX && last_y <= INT_MAX, return -1;, "Sequence overflows name=[%s]", sequence->name);
+
+    return 0;
+}
+
+int parse_sheet(const char* path, struct sheet_sequence* sequences, int* count) {
+    FILE* descriptor = NULL;
+    char line[SHEET_LINE_SIZE];
+    int line_number = 0;
+    int return_code = 0;
+
+    ASSERT(path != NULL, return -1;, "Argument path must not be NULL");
+    ASSERT(sequences != NULL, return -1;, "Argument sequences must not be NULL");
+    ASSERT(count != NULL, return -1;, "Argument count must not be NULL");
+
+    descriptor = fopen(path, "r");
+    ASSERT(descriptor != NULL, return -1;, "fopen error path=[%s]", path);
+
+    *count = 0;
+    while (fgets(line, sizeof(line), descriptor) != NULL) {
+        char* comment = strchr(line, '#');
+        char* text = line;
+        int sequence = 0;
+
+        line_number++;
+        ASSERT(strchr(line, '\n') != NULL || feof(descriptor) != 0, fclose(descriptor); return -1;
+               , "Line too long path=[%s] line=[%d]", path, line_number);
+
+        if (comment != NULL) {
+            *comment = '\0';
+        }
+        while (isspace((unsigned char)*text) != 0) {
+            text++;
+        }
+        if (*text == '\0') {
+            continue;
+        }
+
+        ASSERT(*count < SHEET_MAX_SEQUENCES, fclose(descriptor); return -1;
+               , "Too many sequences path=[%s] max=[%d]", path, SHEET_MAX_SEQUENCES);
+        return_code = parse_sequence(text, &sequences[*count]);
+        ASSERT(return_code == 0, fclose(descriptor); return -1;, "Parse error path=[%s] line=[%d]", path, line_number);
+
+        for (sequence = 0; sequence < *count; sequence++) {
+            ASSERT(strcmp(sequences[sequence].name, sequences[*count].name) != 0, fclose(descriptor); return -1;
+                   , "Duplicate name=[%s] path=[%s] line=[%d]", sequences[*count].name, path, line_number);
+        }
+        (*count)++;
+    }
+
+    ASSERT(ferror(descriptor) == 0, fclose(descriptor); return -1;, "fgets error path=[%s]", path);
+    fclose(descriptor);
+
+    ASSERT(*count > 0, return -1;, "No sequences in path=[%s]", path);
+    return 0;
+}
+
+int write_sheet_header(const char* path, const char* descriptor_path, const struct sheet_sequence* sequences,
+                       const int count) {
+    FILE* header = NULL;
+    char prefix[SHEET_NAME_SIZE];
+    char guard[SHEET_NAME_SIZE];
+    size_t index = 0;
+    int sequence = 0;
+    int frame = 0;
+    int return_code = 0;
+
+    ASSERT(path != NULL, return -1;, "Argument path must not be NULL");
+    ASSERT(descriptor_path != NULL, return -1;, "Argument descriptor_path must not be NULL");
+    ASSERT(sequences != NULL, return -1;, "Argument sequences must not be NULL");
+
+    return_code = make_symbol_prefix(prefix, sizeof(prefix), descriptor_path);
+    ASSERT(return_code == 0, return -1;, "make_symbol_prefix error");
+
+    for (index = 0; prefix[index] != '\0'; index++) {
+        guard[index] = (char)toupper((unsigned char)prefix[index]);
+    }
+    guard[index] = '\0';
+
+    header = fopen(path, "w");
+    ASSERT(header != NULL, return -1;, "fopen error path=[%s]", path);
+
+    fprintf(header, "#ifndef %s_SHEET_H\n#define %s_SHEET_H\n\n", guard, guard);
+    fprintf(header, "// Sprite sheet: %s, generated by sheet_gen\n\n", descriptor_path);
+    fprintf(header, "#include <SDL2/SDL.h>\n");
+    for (sequence = 0; sequence < count; sequence++) {
+        const struct sheet_sequence* current = &sequences[sequence];
+
+        fprintf(header, "\n// %s: origin %d,%d cell %dx%d stride %d,%d per_row %d\n", current->name, current->origin_x,
+                current->origin_y, current->cell_width, current->cell_height, current->stride_x, current->stride_y,
+                current->per_row);
+        fprintf(header, "#define _sheet_%s_%s_count %d\n", prefix, current->name, current->count);
+        fprintf(header, "static _Alignas(%d) const SDL_Rect _sheet_%s_%s[%d] = {\n", SHEET_ALIGNMENT, prefix,
+                current->name, current->count);
+        for (frame = 0; frame < current->count; frame++) {
+            fprintf(header, "    {.x = %d, .y = %d, .w = %d, .h = %d},\n",
+                    current->origin_x + (frame % current->per_row) * current->stride_x,
+                    current->origin_y + (frame / current->per_row) * current->stride_y, current->cell_width,
+                    current->cell_height);
+        }
+        fprintf(header, "};\n");
+    }
+    fprintf(header, "\n#endif  // %s_SHEET_H\n", guard);
+
+    return_code = fclose(header);
+    ASSERT(return_code == 0, return -1;, "fclose error path=[%s]", path);
+
+    return 0;
+}
+
+int main(int argc, char** argv) {
+    static struct sheet_sequence sequences[SHEET_MAX_SEQUENCES];
+    int count = 0;
+    int return_code = 0;
+
+    if (argc != 3) {
+        fprintf(stderr, "Usage: %s <sheet-descriptor> <clip-header>\n", argv[0]);
+        return -1;
+    }
+
+    return_code = parse_sheet(argv[1], sequences, &count);
+    ASSERT(return_code == 0, return -1;, "parse_sheet error");
+    TRACE("Sheet path=[%s] sequences=[%d]", argv[1], count);
+
+    return_code = write_sheet_header(argv[2], argv[1], sequences, count);
+    ASSERT(return_code == 0, return -1;, "write_sheet_header error");
+
+    return 0;
+}
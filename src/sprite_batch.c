@@ -0,0 +1,214 @@
+#define _DEFAULT_SOURCE
+
+#include "sprite_batch.h"
+
+#include <SDL2/SDL.h>
+#include <limits.h>
+#include <math.h>
+#include <stdlib.h>
+
+#include "assert.h"
+#include "sdl_common.h"
+#include "trace.h"
+
+#ifndef M_PI
+#define M_PI 3.14159265358979323846
+#endif
+
+int create_sprite_batch(struct sprite_batch* batch, const int capacity) {
+    int quad = 0;
+
+    ASSERT(batch != NULL, return -1;, "Argument batch must not be NULL");
+    ASSERT(batch->vertices == NULL, return -1;, "Argument batch->vertices must be NULL before initialization");
+    ASSERT(capacity > 0, return -1;, "Argument capacity must be larger than 0");
+    ASSERT(capacity <= INT_MAX / 6, return -1;, "Argument capacity=[%d] must not exceed maximum allowed", capacity);
+
+    TRACE("Allocating sprite batch capacity=[%d]", capacity);
+    batch->vertices = calloc((size_t)capacity * 4, sizeof(*batch->vertices));
+    ASSERT(batch->vertices != NULL, return -1;, "calloc error capacity=[%d]", capacity);
+
+    batch->indices = calloc((size_t)capacity * 6, sizeof(*batch->indices));
+    ASSERT(batch->indices != NULL, free(batch->vertices); batch->vertices = NULL; return -1;
+           , "calloc error capacity=[%d]", capacity);
+
+    // The index pattern never changes, only vertices are written per sprite
+    for (quad = 0; quad < capacity; quad++) {
+        const int vertex = quad * 4;
+        int* index = &batch->indices[quad * 6];
+
+        index[0] = vertex + 0;
+        index[1] = vertex + 1;
+        index[2] = vertex + 2;
+        index[3] = vertex + 2;
+        index[4] = vertex + 1;
+        index[5] = vertex + 3;
+    }
+
+    batch->renderer = NULL;
+    batch->texture = NULL;
+    batch->color = (SDL_Color){0xFF, 0xFF, 0xFF, 0xFF};
+    batch->capacity = capacity;
+    batch->count = 0;
+    return 0;
+}
+
+void destroy_sprite_batch(struct sprite_batch* batch) {
+    ASSERT(batch != NULL, return;, "Argument batch must not be NULL");
+
+    if (batch->vertices != NULL) {
+        TRACE("Freeing sprite batch");
+        free(batch->vertices);
+        batch->vertices = NULL;
+    }
+    if (batch->indices != NULL) {
+        free(batch->indices);
+        batch->indices = NULL;
+    }
+    batch->renderer = NULL;
+    batch->texture = NULL;
+    batch->capacity = 0;
+    batch->count = 0;
+
+    return;
+}
+
+int begin_sprite_batch(struct sprite_batch* batch, SDL_Renderer* renderer, const struct sdl_texture texture) {
+    int return_code = 0;
+
+    ASSERT(batch != NULL, return -1;, "Argument batch must not be NULL");
+    ASSERT(batch->vertices != NULL, return -1;, "Argument batch must be created with create_sprite_batch");
+    ASSERT(renderer != NULL, return -1;, "Argument renderer must not be NULL");
+    ASSERT(texture.texture != NULL, return -1;, "Argument texture.texture must not be NULL");
+    ASSERT(texture.width > 0, return -1;, "Argument texture.width must be greater than 0");
+    ASSERT(texture.height > 0, return -1;, "Argument texture.height must be greater than 0");
+
+    // Quads of the previous texture go out before the texture changes
+    return_code = flush_sprite_batch(batch);
+    ASSERT(return_code == 0, return -1;, "flush_sprite_batch error");
+
+    batch->renderer = renderer;
+    batch->texture = texture.texture;
+    batch->texture_width = (float)texture.width;
+    batch->texture_height = (float)texture.height;
+    return 0;
+}
+
+int add_sprite(struct sprite_batch* batch, const SDL_Rect* clip, const SDL_Rect* destination, const double angle,
+               const SDL_Point* center, const SDL_RendererFlip flip) {
+    int return_code = 0;
+    SDL_Vertex* quad = NULL;
+    float u0 = 0.0f;
+    float v0 = 0.0f;
+    float u1 = 1.0f;
+    float v1 = 1.0f;
+    float swap = 0.0f;
+    float pivot_x = 0.0f;
+    float pivot_y = 0.0f;
+    float origin_x = 0.0f;
+    float origin_y = 0.0f;
+    float left = 0.0f;
+    float top = 0.0f;
+    float right = 0.0f;
+    float bottom = 0.0f;
+
+    ASSERT(batch != NULL, return -1;, "Argument batch must not be NULL");
+    ASSERT(batch->texture != NULL, return -1;, "add_sprite called before begin_sprite_batch");
+    ASSERT(destination != NULL, return -1;, "Argument destination must not be NULL");
+
+    if (batch->count == batch->capacity) {
+        return_code = flush_sprite_batch(batch);
+        ASSERT(return_code == 0, return -1;, "flush_sprite_batch error");
+    }
+
+    // Texture coordinates are normalized, flipping swaps them instead of moving vertices
+    if (clip != NULL) {
+        u0 = (float)clip->x / batch->texture_width;
+        v0 = (float)clip->y / batch->texture_height;
+        u1 = (float)(clip->x + clip->w) / batch->texture_width;
+        v1 = (float)(clip->y + clip->h) / batch->texture_height;
+    }
+    if ((flip & SDL_FLIP_HORIZONTAL) != 0) {
+        swap = u0;
+        u0 = u1;
+        u1 = swap;
+    }
+    if ((flip & SDL_FLIP_VERTICAL) != 0) {
+        swap = v0;
+        v0 = v1;
+        v1 = swap;
+    }
+
+    // Corners relative to the rotation center, which SDL_RenderCopyEx defaults to the middle of the destination
+    if (center != NULL) {
+        pivot_x = (float)center->x;
+        pivot_y = (float)center->y;
+    } else {
+        pivot_x = (float)destination->w / 2.0f;
+        pivot_y = (float)destination->h / 2.0f;
+    }
+    origin_x = (float)destination->x + pivot_x;
+    origin_y = (float)destination->y + pivot_y;
+    left = -pivot_x;
+    top = -pivot_y;
+    right = (float)destination->w - pivot_x;
+    bottom = (float)destination->h - pivot_y;
+
+    quad = &batch->vertices[batch->count * 4];
+    if ((angle < 0.0 || angle > 0.0) == false) {
+        quad[0].position = (SDL_FPoint){origin_x + left, origin_y + top};
+        quad[1].position = (SDL_FPoint){origin_x + right, origin_y + top};
+        quad[2].position = (SDL_FPoint){origin_x + left, origin_y + bottom};
+        quad[3].position = (SDL_FPoint){origin_x + right, origin_y + bottom};
+    } else {
+        // Clockwise on screen, since Y+ goes down
+        const double radians = angle * (M_PI / 180.0);
+        const float cos_angle = (float)cos(radians);
+        const float sin_angle = (float)sin(radians);
+
+        quad[0].position = (SDL_FPoint){origin_x + left * cos_angle - top * sin_angle,
+                                        origin_y + left * sin_angle + top * cos_angle};
+        quad[1].position = (SDL_FPoint){origin_x + right * cos_angle - top * sin_angle,
+                                        origin_y + right * sin_angle + top * cos_angle};
+        quad[2].position = (SDL_FPoint){origin_x + left * cos_angle - bottom * sin_angle,
+                                        origin_y + left * sin_angle + bottom * cos_angle};
+        quad[3].position = (SDL_FPoint){origin_x + right * cos_angle - bottom * sin_angle,
+                                        origin_y + right * sin_angle + bottom * cos_angle};
+    }
+    quad[0].tex_coord = (SDL_FPoint){u0, v0};
+    quad[1].tex_coord = (SDL_FPoint){u1, v0};
+    quad[2].tex_coord = (SDL_FPoint){u0, v1};
+    quad[3].tex_coord = (SDL_FPoint){u1, v1};
+    quad[0].color = batch->color;
+    quad[1].color = batch->color;
+    quad[2].color = batch->color;
+    quad[3].color = batch->color;
+
+    batch->count++;
+    return 0;
+}
+
+int flush_sprite_batch(struct sprite_batch* batch) {
+    TRACE_SPAN("flush_sprite_batch");
+    int return_code = 0;
+
+    ASSERT(batch != NULL, return -1;, "Argument batch must not be NULL");
+
+    if (batch->count == 0) {
+        return 0;
+    }
+    ASSERT(batch->renderer != NULL, return -1;, "Argument batch->renderer must not be NULL");
+
+    return_code = SDL_RenderGeometry(batch->renderer, batch->texture, batch->vertices, batch->count * 4,
+                                     batch->indices, batch->count * 6);
+    ASSERT(return_code == 0, batch->count = 0; return -1;, "SDL_RenderGeometry error=[%s]", SDL_GetError());
+
+    batch->count = 0;
+    return 0;
+}
+
+void set_sprite_batch_color(struct sprite_batch* batch, const SDL_Color color) {
+    ASSERT(batch != NULL, return;, "Argument batch must not be NULL");
+
+    batch->color = color;
+    return;
+}
@@ -0,0 +1,48 @@
+#ifndef SPRITE_BATCH_H
+#define SPRITE_BATCH_H
+
+/*  Sprite batch
+
+    Collects textured quads that sample the same texture and submits them with a single SDL_RenderGeometry call,
+    instead of one SDL_RenderCopy/SDL_RenderCopyEx per sprite. The vertex and index arrays are allocated once by
+    create_sprite_batch() for capacity quads; the index pattern of every quad is constant and written there too, so a
+    frame only writes four vertices per sprite and allocates nothing.
+
+        begin_sprite_batch(&batch, renderer, texture);
+        add_sprite(&batch, &clip, &destination, angle, &center, flip);   // any number of times
+        flush_sprite_batch(&batch);
+
+    add_sprite() takes the same clip, angle, center and flip as render_texture() (sdl_common.h), with destination
+    giving position and size. The rotation is applied on the CPU, in degrees clockwise around center, which is
+    relative to the destination's top left corner (NULL rotates around the middle). begin_sprite_batch() flushes the
+    quads pending for the previous texture, and add_sprite() flushes by itself when the batch is full, so capacity
+    only bounds the number of quads per draw call. Quads take the color set by set_sprite_batch_color(), white (the
+    texture unmodulated) until changed; color is per vertex, so quads of different colors still share a draw call.
+*/
+
+#include <SDL2/SDL.h>
+
+#include "sdl_common.h"
+
+struct sprite_batch {
+    SDL_Renderer* renderer;
+    SDL_Texture* texture;
+    float texture_width;
+    float texture_height;
+    SDL_Color color;       // of the quads added next
+    SDL_Vertex* vertices;  // 4 per quad: top left, top right, bottom left, bottom right
+    int* indices;          // 6 per quad
+    int capacity;          // quads
+    int count;             // quads pending
+};
+
+int create_sprite_batch(struct sprite_batch* batch, const int capacity);
+void destroy_sprite_batch(struct sprite_batch* batch);
+
+int begin_sprite_batch(struct sprite_batch* batch, SDL_Renderer* renderer, const struct sdl_texture texture);
+int add_sprite(struct sprite_batch* batch, const SDL_Rect* clip, const SDL_Rect* destination, const double angle,
+               const SDL_Point* center, const SDL_RendererFlip flip);
+int flush_sprite_batch(struct sprite_batch* batch);
+void set_sprite_batch_color(struct sprite_batch* batch, const SDL_Color color);
+
+#endif  // SPRITE_BATCH_H
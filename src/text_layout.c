@@ -0,0 +1,391 @@
+#define _DEFAULT_SOURCE
+
+#include "text_layout.h"
+
+#include <SDL2/SDL.h>
+#include <SDL2/SDL_ttf.h>
+#include <limits.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "assert.h"
+#include "glyph_atlas.h"
+#include "sprite_batch.h"
+#include "trace.h"
+
+#define TEXT_LAYOUT_INITIAL_LINES 64
+
+static int reserve_lines(struct text_line** lines, int* capacity, const int count) {
+    struct text_line* grown_lines = NULL;
+    int grown_capacity = *capacity;
+
+    if (count <= *capacity) {
+        return 0;
+    }
+    while (grown_capacity < count) {
+        ASSERT(grown_capacity <= INT_MAX / 2, return -1;, "Too many lines count=[%d]", count);
+        grown_capacity *= 2;
+    }
+
+    grown_lines = realloc(*lines, (size_t)grown_capacity * sizeof(**lines));
+    ASSERT(grown_lines != NULL, return -1;, "realloc error capacity=[%d]", grown_capacity);
+    *lines = grown_lines;
+    *capacity = grown_capacity;
+    return 0;
+}
+
+// Wraps one line starting at start in the paragraph ending at end, on its '\n' or the terminator
+static int wrap_line(const struct text_layout* layout, const char* text, const size_t start, const size_t end,
+                     struct text_line* line) {
+    const struct glyph* glyph = NULL;
+    const char* cursor = text + start;
+    Uint32 codepoint = 0;
+    Uint32 previous = 0;
+    size_t break_length = 0;
+    size_t break_next = 0;
+    int break_width = 0;
+    bool has_break = false;
+    int width = 0;
+    int return_code = 0;
+
+    line->start = start;
+    line->first = (start == 0 || text[start - 1] == '\n');
+
+    while (cursor < text + end) {
+        const size_t offset = (size_t)(cursor - text);
+        int advanced_width = 0;
+
+        codepoint = next_utf8_codepoint(&cursor);
+        return_code = find_glyph(layout->atlas, layout->font, codepoint, &glyph);
+        ASSERT(return_code == 0, return -1;, "find_glyph error codepoint=[U+%04X]", codepoint);
+        advanced_width = width + glyph_kerning(layout->font, previous, codepoint) + glyph->advance;
+
+        if (codepoint == ' ') {
+            // Spaces never overflow, a run of them is left out of the line and of the next one
+            if (previous != ' ') {
+                break_length = offset - start;
+                break_width = width;
+            }
+            break_next = (size_t)(cursor - text);
+            has_break = true;
+        } else if (advanced_width > layout->width && offset > start) {
+            if (has_break == true) {
+                line->length = break_length;
+                line->next = break_next;
+                line->width = break_width;
+            } else {
+                // A word wider than the layout is broken before the codepoint that overflows
+                line->length = offset - start;
+                line->next = offset;
+                line->width = width;
+            }
+            return 0;
+        }
+
+        width = advanced_width;
+        previous = codepoint;
+    }
+
+    line->length = end - start;
+    line->next = (text[end] == '\n') ? end + 1 : end;
+    line->width = width;
+    return 0;
+}
+
+static const struct text_run* find_run(const struct text_layout* layout, const uint64_t hash, const size_t length) {
+    int index = 0;
+
+    for (index = 0; index < layout->run_count; index++) {
+        const struct text_run* run = &(layout->runs[index]);
+
+        if (run->hash == hash && run->length == length && run->font == layout->font && run->width == layout->width) {
+            return run;
+        }
+    }
+    return NULL;
+}
+
+// Keeps the lines of the paragraph starting at start, the last first_line..line_count lines of the layout
+static void store_run(struct text_layout* layout, const uint64_t hash, const size_t start, const size_t length,
+                      const int first_line) {
+    const int line_count = layout->line_count - first_line;
+    struct text_run* run = NULL;
+    int index = 0;
+
+    if (line_count > TEXT_LAYOUT_MAX_RUN_LINES) {
+        return;
+    }
+    if (layout->run_count == TEXT_LAYOUT_MAX_RUNS || layout->run_line_count + line_count > TEXT_LAYOUT_MAX_RUN_LINES) {
+        TRACE_DEBUG("Emptying run cache runs=[%d] lines=[%d]", layout->run_count, layout->run_line_count);
+        layout->run_count = 0;
+        layout->run_line_count = 0;
+    }
+
+    run = &(layout->runs[layout->run_count]);
+    run->hash = hash;
+    run->font = layout->font;
+    run->width = layout->width;
+    run->length = length;
+    run->first_line = layout->run_line_count;
+    run->line_count = line_count;
+    for (index = 0; index < line_count; index++) {
+        struct text_line* line = &(layout->run_lines[run->first_line + index]);
+
+        *line = layout->lines[first_line + index];
+        line->start -= start;
+        line->next -= start;
+    }
+    layout->run_count++;
+    layout->run_line_count += line_count;
+}
+
+// Appends the lines of the paragraph text[start..end), from the run cache or wrapped
+static int layout_paragraph(struct text_layout* layout, const char* text, const size_t start, const size_t end) {
+    const uint64_t hash = hash_text(text + start, end - start);
+    const struct text_run* run = find_run(layout, hash, end - start);
+    const int first_line = layout->line_count;
+    size_t line_start = start;
+    int index = 0;
+    int return_code = 0;
+
+    if (run != NULL) {
+        return_code = reserve_lines(&(layout->lines), &(layout->line_capacity), layout->line_count + run->line_count);
+        ASSERT(return_code == 0, return -1;, "reserve_lines error");
+
+        for (index = 0; index < run->line_count; index++) {
+            struct text_line* line = &(layout->lines[layout->line_count++]);
+
+            *line = layout->run_lines[run->first_line + index];
+            line->start += start;
+            line->next += start;
+        }
+        // The paragraph was cached in another place, last in the text or not
+        layout->lines[layout->line_count - 1].next = (text[end] == '\n') ? end + 1 : end;
+        layout->run_hits++;
+        return 0;
+    }
+
+    do {
+        return_code = reserve_lines(&(layout->lines), &(layout->line_capacity), layout->line_count + 1);
+        ASSERT(return_code == 0, return -1;, "reserve_lines error");
+        return_code = wrap_line(layout, text, line_start, end, &(layout->lines[layout->line_count]));
+        ASSERT(return_code == 0, return -1;, "wrap_line error");
+
+        line_start = layout->lines[layout->line_count].next;
+        layout->line_count++;
+    } while (line_start < end);
+
+    store_run(layout, hash, start, end - start, first_line);
+    layout->run_misses++;
+    return 0;
+}
+
+// Index of the line holding offset, the last one starting at or before it
+static int find_line(const struct text_layout* layout, const size_t offset) {
+    int low = 0;
+    int high = layout->line_count - 1;
+
+    while (low < high) {
+        const int middle = low + (high - low + 1) / 2;
+
+        if (layout->lines[middle].start <= offset) {
+            low = middle;
+        } else {
+            high = middle - 1;
+        }
+    }
+    return low;
+}
+
+int create_text_layout(struct text_layout* layout, struct glyph_atlas* atlas, TTF_Font* font, const int width) {
+    ASSERT(layout != NULL, return -1;, "Argument layout must not be NULL");
+    ASSERT(layout->lines == NULL, return -1;, "Argument layout->lines must be NULL before initialization");
+    ASSERT(atlas != NULL, return -1;, "Argument atlas must not be NULL");
+    ASSERT(font != NULL, return -1;, "Argument font must not be NULL");
+    ASSERT(width > 0, return -1;, "Argument width=[%d] must be larger than 0", width);
+
+    memset(layout, 0, sizeof(*layout));
+    layout->lines = malloc(TEXT_LAYOUT_INITIAL_LINES * sizeof(*(layout->lines)));
+    layout->relaid = malloc(TEXT_LAYOUT_INITIAL_LINES * sizeof(*(layout->relaid)));
+    layout->run_lines = malloc(TEXT_LAYOUT_MAX_RUN_LINES * sizeof(*(layout->run_lines)));
+    ASSERT(layout->lines != NULL && layout->relaid != NULL && layout->run_lines != NULL, destroy_text_layout(layout);
+           return -1;, "malloc error");
+
+    layout->atlas = atlas;
+    layout->font = font;
+    layout->width = width;
+    layout->line_skip = TTF_FontLineSkip(font);
+    layout->line_capacity = TEXT_LAYOUT_INITIAL_LINES;
+    layout->relaid_capacity = TEXT_LAYOUT_INITIAL_LINES;
+    return 0;
+}
+
+void destroy_text_layout(struct text_layout* layout) {
+    ASSERT(layout != NULL, return;, "Argument layout must not be NULL");
+
+    if (layout->lines != NULL) {
+        TRACE("Destroying text layout lines=[%d] run_hits=[%llu] run_misses=[%llu] relaid_lines=[%llu]",
+              layout->line_count, (unsigned long long)layout->run_hits, (unsigned long long)layout->run_misses,
+              (unsigned long long)layout->relaid_lines);
+    }
+    free(layout->lines);
+    free(layout->relaid);
+    free(layout->run_lines);
+    memset(layout, 0, sizeof(*layout));
+
+    return;
+}
+
+void clear_text_runs(struct text_layout* layout) {
+    ASSERT(layout != NULL, return;, "Argument layout must not be NULL");
+
+    layout->run_count = 0;
+    layout->run_line_count = 0;
+    return;
+}
+
+int layout_text(struct text_layout* layout, const char* text) {
+    TRACE_SPAN("layout_text");
+    size_t start = 0;
+    size_t end = 0;
+    int return_code = 0;
+
+    ASSERT(layout != NULL, return -1;, "Argument layout must not be NULL");
+    ASSERT(layout->lines != NULL, return -1;, "Argument layout must be created with create_text_layout");
+    ASSERT(text != NULL, return -1;, "Argument text must not be NULL");
+
+    layout->line_count = 0;
+    do {
+        end = start + strcspn(text + start, "\n");
+        return_code = layout_paragraph(layout, text, start, end);
+        ASSERT(return_code == 0, return -1;, "layout_paragraph error");
+        start = end + 1;
+    } while (text[end] == '\n');
+
+    return 0;
+}
+
+int edit_text_layout(struct text_layout* layout, const char* text, const size_t start, const size_t removed,
+                     const size_t inserted) {
+    TRACE_SPAN("edit_text_layout");
+    size_t line_start = 0;
+    size_t end = 0;
+    int first_line = 0;
+    int relaid_count = 0;
+    int kept_line = 0;
+    int kept_count = 0;
+    int index = 0;
+    int return_code = 0;
+
+    ASSERT(layout != NULL, return -1;, "Argument layout must not be NULL");
+    ASSERT(layout->lines != NULL && layout->line_count > 0, return -1;
+           , "Argument layout must be laid out with layout_text");
+    ASSERT(text != NULL, return -1;, "Argument text must not be NULL");
+    ASSERT(start + removed <= layout->lines[layout->line_count - 1].next, return -1;
+           , "Arguments start=[%zu] removed=[%zu] past the end of the text", start, removed);
+
+    // A line breaks on the first codepoint that overflows it, at the latest where the line after it ends: the line
+    // before the one holding start may now take its first word, and the one before that may have broken on a word
+    // that the edit lengthened or cut. Lines further up only depend on text before start.
+    first_line = find_line(layout, start);
+    first_line = (first_line > 2) ? first_line - 2 : 0;
+    line_start = layout->lines[first_line].start;
+    end = line_start + strcspn(text + line_start, "\n");
+    kept_line = first_line + 1;
+
+    while (true) {
+        struct text_line* line = NULL;
+
+        return_code = reserve_lines(&(layout->relaid), &(layout->relaid_capacity), relaid_count + 1);
+        ASSERT(return_code == 0, return -1;, "reserve_lines error");
+        line = &(layout->relaid[relaid_count]);
+        return_code = wrap_line(layout, text, line_start, end, line);
+        ASSERT(return_code == 0, return -1;, "wrap_line error");
+        relaid_count++;
+
+        if (line->next == end && text[end] == '\0') {
+            kept_line = layout->line_count;
+            break;
+        }
+
+        // Past the edit, an old line starting where this one ends is where both layouts agree again
+        line_start = line->next;
+        if (line_start >= start + inserted) {
+            const size_t old_start = line_start - inserted + removed;
+
+            while (kept_line < layout->line_count && layout->lines[kept_line].start < old_start) {
+                kept_line++;
+            }
+            if (kept_line < layout->line_count && layout->lines[kept_line].start == old_start) {
+                break;
+            }
+        }
+        if (line_start > end) {
+            end = line_start + strcspn(text + line_start, "\n");
+        }
+    }
+
+    kept_count = layout->line_count - kept_line;
+    return_code = reserve_lines(&(layout->lines), &(layout->line_capacity), first_line + relaid_count + kept_count);
+    ASSERT(return_code == 0, return -1;, "reserve_lines error");
+
+    memmove(&(layout->lines[first_line + relaid_count]), &(layout->lines[kept_line]),
+            (size_t)kept_count * sizeof(*(layout->lines)));
+    memcpy(&(layout->lines[first_line]), layout->relaid, (size_t)relaid_count * sizeof(*(layout->lines)));
+    layout->line_count = first_line + relaid_count + kept_count;
+
+    for (index = first_line + relaid_count; index < layout->line_count; index++) {
+        struct text_line* line = &(layout->lines[index]);
+
+        line->start = line->start - removed + inserted;
+        line->next = line->next - removed + inserted;
+    }
+    // Only the first kept line can follow an edited byte
+    if (kept_count > 0) {
+        struct text_line* line = &(layout->lines[first_line + relaid_count]);
+
+        line->first = (text[line->start - 1] == '\n');
+    }
+
+    layout->relaid_lines += (uint64_t)relaid_count;
+    return 0;
+}
+
+int draw_text_layout(const struct text_layout* layout, struct sprite_batch* batch, const char* text, const int x,
+                     const int y, const SDL_Color color) {
+    TRACE_SPAN("draw_text_layout");
+    int index = 0;
+    int return_code = 0;
+
+    ASSERT(layout != NULL, return -1;, "Argument layout must not be NULL");
+    ASSERT(layout->lines != NULL, return -1;, "Argument layout must be created with create_text_layout");
+    ASSERT(batch != NULL, return -1;, "Argument batch must not be NULL");
+    ASSERT(text != NULL, return -1;, "Argument text must not be NULL");
+
+    for (index = 0; index < layout->line_count; index++) {
+        const struct text_line* line = &(layout->lines[index]);
+
+        if (line->length == 0) {
+            continue;
+        }
+        return_code = draw_glyph_run(layout->atlas, batch, layout->font, text + line->start, line->length, x,
+                                     y + index * layout->line_skip, color);
+        ASSERT(return_code == 0, return -1;, "draw_glyph_run error line=[%d]", index);
+    }
+
+    return 0;
+}
+
+uint64_t hash_text(const char* text, const size_t length) {
+    uint64_t hash = 0xCBF29CE484222325u;
+    size_t index = 0;
+
+    for (index = 0; index < length; index++) {
+        hash ^= (unsigned char)text[index];
+        hash *= 0x100000001B3u;
+    }
+    return hash;
+}
@@ -0,0 +1,96 @@
+#ifndef TEXT_LAYOUT_H
+#define TEXT_LAYOUT_H
+
+/*  Text layout
+
+    Wraps UTF-8 text to a width in pixels and keeps the resulting lines, so drawing a paragraph costs the glyph quads
+    and an edit costs the lines it changes instead of re-measuring the whole text. Part of build/libsdlcommon.a, on top
+    of glyph_atlas.h, whose glyph advances and kerning it measures with.
+
+        create_text_layout(&layout, &atlas, font, 400);
+        layout_text(&layout, text);
+        draw_text_layout(&layout, &batch, text, 16, 16, color);     // any number of frames
+        ...                                                         // insert 1 byte at 120 into text
+        edit_text_layout(&layout, text, 120, 0, 1);
+        destroy_text_layout(&layout);
+
+    Lines are broken greedily: as many words as fit, a break at a space that is then left out of both lines, and
+    inside a word only when the word alone is wider than the layout. '\n' ends a paragraph. A line is a byte range of
+    the caller's text, which the layout does not copy, so the text passed to draw_text_layout() must be the one last
+    laid out or edited.
+
+    layout_text() lays out every paragraph, going through a cache of runs: the lines of a paragraph, keyed by the
+    (FNV-1a hash of its bytes, font, width) tuple, so paragraphs seen before, in this text or in the previous one,
+    cost a hash instead of a measurement. The cache holds TEXT_LAYOUT_MAX_RUNS runs of TEXT_LAYOUT_MAX_RUN_LINES lines
+    in total and is emptied when either is full. Runs know their font by address, so clear_text_runs() must be called
+    when a font the layout used is closed and another one opened.
+
+    edit_text_layout() takes the text after an edit that replaced removed bytes at start with inserted ones, and
+    wraps again from two lines before the one holding start: the first word of that line may now fit on the line
+    before, and a line only decides where to break on the codepoint that overflows it, which can be as far as the end
+    of the line after it. It stops as soon as a new line ends where an old line past the edit began: greedy wrapping
+    only depends on the text ahead, so from there on every old line holds, shifted by the size change. Lines are
+    counted in relaid_lines.
+*/
+
+#include <SDL2/SDL.h>
+#include <SDL2/SDL_ttf.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#include "glyph_atlas.h"
+#include "sprite_batch.h"
+
+#define TEXT_LAYOUT_MAX_RUNS 64
+#define TEXT_LAYOUT_MAX_RUN_LINES 1024
+
+struct text_line {
+    size_t start;   // byte offset in the text
+    size_t length;  // bytes drawn
+    size_t next;    // start of the following line
+    int width;      // pixels
+    bool first;     // first line of a paragraph
+};
+
+struct text_run {
+    uint64_t hash;
+    const TTF_Font* font;
+    int width;
+    size_t length;   // paragraph bytes
+    int first_line;  // in run_lines, offsets relative to the paragraph
+    int line_count;
+};
+
+struct text_layout {
+    struct glyph_atlas* atlas;
+    TTF_Font* font;
+    int width;
+    int line_skip;
+    struct text_line* lines;
+    int line_count;
+    int line_capacity;
+    struct text_line* relaid;  // scratch for edit_text_layout()
+    int relaid_capacity;
+    struct text_run runs[TEXT_LAYOUT_MAX_RUNS];
+    int run_count;
+    struct text_line* run_lines;  // TEXT_LAYOUT_MAX_RUN_LINES
+    int run_line_count;
+    uint64_t run_hits;
+    uint64_t run_misses;
+    uint64_t relaid_lines;
+};
+
+int create_text_layout(struct text_layout* layout, struct glyph_atlas* atlas, TTF_Font* font, const int width);
+void destroy_text_layout(struct text_layout* layout);
+
+void clear_text_runs(struct text_layout* layout);
+int layout_text(struct text_layout* layout, const char* text);
+int edit_text_layout(struct text_layout* layout, const char* text, const size_t start, const size_t removed,
+                     const size_t inserted);
+int draw_text_layout(const struct text_layout* layout, struct sprite_batch* batch, const char* text, const int x,
+                     const int y, const SDL_Color color);
+
+uint64_t hash_text(const char* text, const size_t length);
+
+#endif  // TEXT_LAYOUT_H
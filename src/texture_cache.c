@@ -0,0 +1,290 @@
+#define _DEFAULT_SOURCE
+
+#include "texture_cache.h"
+
+#include <SDL2/SDL.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "assert.h"
+#include "raw_image.h"
+#include "sdl_common.h"
+#include "trace.h"
+
+static bool same_key(const struct texture_key* left, const struct texture_key* right) {
+    return left->data == right->data && left->color_keyed == right->color_keyed &&
+           (left->color_keyed == false || (left->color_key.r == right->color_key.r &&
+                                           left->color_key.g == right->color_key.g &&
+                                           left->color_key.b == right->color_key.b)) &&
+           left->scale_mode == right->scale_mode && left->blend_mode == right->blend_mode;
+}
+
+static int find_entry(const struct texture_cache* cache, const struct texture_key* key) {
+    int index = 0;
+
+    for (index = 0; index < cache->capacity; index++) {
+        if (cache->entries[index].texture.texture != NULL && same_key(&(cache->entries[index].key), key) == true) {
+            return index;
+        }
+    }
+    return -1;
+}
+
+static int find_texture_entry(const struct texture_cache* cache, const SDL_Texture* texture) {
+    int index = 0;
+
+    for (index = 0; index < cache->capacity; index++) {
+        if (cache->entries[index].texture.texture == texture) {
+            return index;
+        }
+    }
+    return -1;
+}
+
+static void evict_entry(struct texture_cache* cache, struct texture_cache_entry* entry) {
+    TRACE_DEBUG("Evicting texture width=[%d] height=[%d] bytes=[%zu]", entry->texture.width, entry->texture.height,
+                entry->bytes);
+    free_texture(&(entry->texture));
+    cache->bytes -= entry->bytes;
+    cache->evictions++;
+    memset(entry, 0, sizeof(*entry));
+}
+
+// Evicts unreferenced entries, least recently used first, until bytes + incoming fits the budget; returns the number
+// of free entries left
+static int evict_to_budget(struct texture_cache* cache, const size_t incoming) {
+    struct texture_cache_entry* oldest = NULL;
+    int free_entries = 0;
+    int index = 0;
+
+    do {
+        oldest = NULL;
+        free_entries = 0;
+        for (index = 0; index < cache->capacity; index++) {
+            struct texture_cache_entry* entry = &(cache->entries[index]);
+
+            if (entry->texture.texture == NULL) {
+                free_entries++;
+            } else if (entry->references == 0 && (oldest == NULL || entry->last_use < oldest->last_use)) {
+                oldest = entry;
+            }
+        }
+        if (oldest == NULL || (cache->bytes + incoming <= cache->budget && free_entries > 0)) {
+            break;
+        }
+        evict_entry(cache, oldest);
+        free_entries++;
+    } while (cache->bytes + incoming > cache->budget);
+
+    return free_entries;
+}
+
+static int texture_bytes(const struct sdl_texture* texture, size_t* bytes) {
+    Uint32 format = 0;
+    int return_code = 0;
+
+    return_code = SDL_QueryTexture(texture->texture, &format, NULL, NULL, NULL);
+    ASSERT(return_code == 0, return -1;, "SDL_QueryTexture error=[%s]", SDL_GetError());
+
+    *bytes = (size_t)texture->width * (size_t)texture->height * SDL_BYTESPERPIXEL(format);
+    return 0;
+}
+
+int create_texture_cache(struct texture_cache* cache, SDL_Renderer* renderer, const int capacity, const size_t budget) {
+    ASSERT(cache != NULL, return -1;, "Argument cache must not be NULL");
+    ASSERT(renderer != NULL, return -1;, "Argument renderer must not be NULL");
+    ASSERT(capacity > 0, return -1;, "Argument capacity must be larger than 0");
+
+    memset(cache, 0, sizeof(*cache));
+    cache->entries = calloc((size_t)capacity, sizeof(*(cache->entries)));
+    ASSERT(cache->entries != NULL, return -1;, "calloc error capacity=[%d]", capacity);
+
+    cache->renderer = renderer;
+    cache->capacity = capacity;
+    cache->budget = budget;
+    TRACE("Created texture cache capacity=[%d] budget=[%zu]", capacity, budget);
+    return 0;
+}
+
+void destroy_texture_cache(struct texture_cache* cache) {
+    int index = 0;
+
+    ASSERT(cache != NULL, return;, "Argument cache must not be NULL");
+
+    if (cache->entries != NULL) {
+        TRACE("Destroying texture cache bytes=[%zu] hits=[%llu] misses=[%llu] evictions=[%llu]", cache->bytes,
+              (unsigned long long)cache->hits, (unsigned long long)cache->misses,
+              (unsigned long long)cache->evictions);
+        for (index = 0; index < cache->capacity; index++) {
+            struct texture_cache_entry* entry = &(cache->entries[index]);
+
+            ASSERT(entry->references == 0, NO_ACTION, "Texture still referenced references=[%d] width=[%d] height=[%d]",
+                   entry->references, entry->texture.width, entry->texture.height);
+            free_texture(&(entry->texture));
+        }
+        free(cache->entries);
+    }
+    memset(cache, 0, sizeof(*cache));
+
+    return;
+}
+
+void make_texture_key(struct texture_key* key, const void* data, const SDL_Color* color_key,
+                      const SDL_ScaleMode scale_mode, const SDL_BlendMode blend_mode) {
+    ASSERT(key != NULL, return;, "Argument key must not be NULL");
+
+    memset(key, 0, sizeof(*key));
+    key->data = data;
+    if (color_key != NULL) {
+        key->color_key = *color_key;
+        key->color_keyed = true;
+    }
+    key->scale_mode = scale_mode;
+    key->blend_mode = blend_mode;
+
+    return;
+}
+
+int find_cached_texture(struct texture_cache* cache, const struct texture_key* key, struct sdl_texture* texture) {
+    struct texture_cache_entry* entry = NULL;
+    int index = 0;
+
+    ASSERT(cache != NULL, return -1;, "Argument cache must not be NULL");
+    ASSERT(cache->entries != NULL, return -1;, "Argument cache must be created");
+    ASSERT(key != NULL, return -1;, "Argument key must not be NULL");
+    ASSERT(texture != NULL, return -1;, "Argument texture must not be NULL");
+    ASSERT(texture->texture == NULL, return -1;, "Argument texture must be empty");
+
+    index = find_entry(cache, key);
+    if (index < 0) {
+        cache->misses++;
+        return 0;
+    }
+
+    entry = &(cache->entries[index]);
+    entry->references++;
+    entry->last_use = ++(cache->clock);
+    cache->hits++;
+    *texture = entry->texture;
+    TRACE_DEBUG("Texture cache hit width=[%d] height=[%d] references=[%d]", entry->texture.width,
+                entry->texture.height, entry->references);
+    return 1;
+}
+
+int insert_cached_texture(struct texture_cache* cache, const struct texture_key* key, struct sdl_texture* texture) {
+    struct texture_cache_entry* entry = NULL;
+    size_t bytes = 0;
+    int free_entries = 0;
+    int index = 0;
+    int return_code = 0;
+
+    ASSERT(cache != NULL, return -1;, "Argument cache must not be NULL");
+    ASSERT(cache->entries != NULL, return -1;, "Argument cache must be created");
+    ASSERT(key != NULL, return -1;, "Argument key must not be NULL");
+    ASSERT(texture != NULL, return -1;, "Argument texture must not be NULL");
+    ASSERT(texture->texture != NULL, return -1;, "Argument texture->texture must not be NULL");
+
+    // Loaded twice before the first one got in, the cached copy wins
+    index = find_entry(cache, key);
+    if (index >= 0) {
+        free_texture(texture);
+        return_code = find_cached_texture(cache, key, texture);
+        ASSERT(return_code == 1, return -1;, "find_cached_texture error");
+        return 0;
+    }
+
+    return_code = SDL_SetTextureScaleMode(texture->texture, key->scale_mode);
+    ASSERT(return_code == 0, return -1;, "SDL_SetTextureScaleMode error=[%s]", SDL_GetError());
+    return_code = SDL_SetTextureBlendMode(texture->texture, key->blend_mode);
+    ASSERT(return_code == 0, return -1;, "SDL_SetTextureBlendMode error=[%s]", SDL_GetError());
+
+    return_code = texture_bytes(texture, &bytes);
+    ASSERT(return_code == 0, return -1;, "texture_bytes error");
+
+    free_entries = evict_to_budget(cache, bytes);
+    ASSERT(free_entries > 0, return -1;, "Texture cache full, every entry referenced capacity=[%d]", cache->capacity);
+    if (cache->bytes + bytes > cache->budget) {
+        TRACE_WARN("Texture cache over budget, referenced textures bytes=[%zu] incoming=[%zu] budget=[%zu]",
+                   cache->bytes, bytes, cache->budget);
+    }
+
+    index = find_texture_entry(cache, NULL);
+    entry = &(cache->entries[index]);
+    entry->key = *key;
+    entry->texture = *texture;
+    entry->bytes = bytes;
+    entry->references = 1;
+    entry->last_use = ++(cache->clock);
+    cache->bytes += bytes;
+    TRACE_DEBUG("Texture cache insert width=[%d] height=[%d] bytes=[%zu] resident=[%zu]", texture->width,
+                texture->height, bytes, cache->bytes);
+    return 0;
+}
+
+int acquire_texture(struct texture_cache* cache, struct sdl_texture* texture, const void* data, const size_t size,
+                    const SDL_Color* color_key, const SDL_ScaleMode scale_mode, const SDL_BlendMode blend_mode) {
+    TRACE_SPAN("acquire_texture");
+    struct texture_key key;
+    struct sdl_texture loaded_texture = {0};
+    int return_code = 0;
+
+    ASSERT(cache != NULL, return -1;, "Argument cache must not be NULL");
+    ASSERT(texture != NULL, return -1;, "Argument texture must not be NULL");
+    ASSERT(data != NULL, return -1;, "Argument data must not be NULL");
+
+    make_texture_key(&key, data, color_key, scale_mode, blend_mode);
+    return_code = find_cached_texture(cache, &key, texture);
+    ASSERT(return_code >= 0, return -1;, "find_cached_texture error");
+    if (return_code == 1) {
+        return 0;
+    }
+
+    // Raw blobs have their color key baked in at build time
+    if (size >= sizeof(struct raw_image_header) && memcmp(data, RAW_IMAGE_MAGIC, strlen(RAW_IMAGE_MAGIC)) == 0) {
+        return_code = load_texture_raw(&loaded_texture, data, size, cache->renderer);
+        ASSERT(return_code == 0, return -1;, "load_texture_raw error");
+    } else {
+        return_code = load_texture_embedded(&loaded_texture, data, size, cache->renderer, color_key);
+        ASSERT(return_code == 0, return -1;, "load_texture_embedded error");
+    }
+
+    return_code = insert_cached_texture(cache, &key, &loaded_texture);
+    ASSERT(return_code == 0, free_texture(&loaded_texture); return -1;, "insert_cached_texture error");
+
+    *texture = loaded_texture;
+    return 0;
+}
+
+void release_texture(struct texture_cache* cache, struct sdl_texture* texture) {
+    struct texture_cache_entry* entry = NULL;
+    int index = 0;
+
+    ASSERT(cache != NULL, return;, "Argument cache must not be NULL");
+    ASSERT(cache->entries != NULL, return;, "Argument cache must be created");
+    ASSERT(texture != NULL, return;, "Argument texture must not be NULL");
+
+    if (texture->texture == NULL) {
+        return;
+    }
+
+    index = find_texture_entry(cache, texture->texture);
+    ASSERT(index >= 0, return;, "Texture not in the cache width=[%d] height=[%d]", texture->width, texture->height);
+    entry = &(cache->entries[index]);
+    ASSERT(entry->references > 0, return;, "Texture released more often than acquired");
+
+    entry->references--;
+    entry->last_use = ++(cache->clock);
+    texture->texture = NULL;
+    texture->width = 0;
+    texture->height = 0;
+
+    // Stays resident unless the budget needs the room
+    if (entry->references == 0 && cache->bytes > cache->budget) {
+        evict_to_budget(cache, 0);
+    }
+
+    return;
+}
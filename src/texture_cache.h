@@ -0,0 +1,82 @@
+#ifndef TEXTURE_CACHE_H
+#define TEXTURE_CACHE_H
+
+/*  Texture cache
+
+    Shares textures between everything that loads the same asset the same way. An entry is keyed by the asset's data
+    pointer (embedded and packed assets never move while their pack is open), the color key and the scale and blend
+    modes, and counts its references. Part of build/libsdlcommon.a, used from the render thread only.
+
+        create_texture_cache(&cache, renderer, 64, 64 * 1024 * 1024);
+        acquire_texture(&cache, &texture, asset.data, asset.size, NULL, SDL_ScaleModeBest, SDL_BLENDMODE_BLEND);
+        ...
+        release_texture(&cache, &texture);      // instead of free_texture()
+        destroy_texture_cache(&cache);
+
+    acquire_texture() hands out the cached texture when the key is known, and otherwise loads it with
+    load_texture_raw() for a raw blob (raw_image.h, the color key is then already baked in) or load_texture_embedded()
+    for anything else, then sets the requested modes. release_texture() drops a reference and clears the struct
+    sdl_texture; the texture itself stays resident, so loading it again, after a scene transition for example, costs a
+    lookup. Resident bytes (width * height * bytes per pixel of the texture format, an estimate of what the driver
+    holds) are kept under budget by destroying unreferenced entries, least recently used first, whenever an entry is
+    inserted or released. Referenced textures are never evicted, so the budget can be exceeded while they are in use.
+
+    find_cached_texture() and insert_cached_texture() are the two halves of acquire_texture() for callers that create
+    the texture themselves, like the asynchronous loader (asset_loader.h) whose decode happens elsewhere:
+    find_cached_texture() returns 1 and takes a reference on a hit, 0 on a miss; insert_cached_texture() adopts a
+    texture created for a missed key, or, if the key was inserted in the meantime, destroys it and hands out the cached
+    one instead.
+
+    The entry table holds capacity entries allocated by create_texture_cache(), lookups scan it; a full table evicts
+    like an exhausted budget and fails when every entry is referenced. 14_animated_sprites and 15_rotation_and_flipping
+    load through it (set_asset_loader_cache()); bin/cache_benchmark checks eviction and times cold and cached loads.
+*/
+
+#include <SDL2/SDL.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#include "sdl_common.h"
+
+struct texture_key {
+    const void* data;
+    SDL_Color color_key;
+    bool color_keyed;
+    SDL_ScaleMode scale_mode;
+    SDL_BlendMode blend_mode;
+};
+
+struct texture_cache_entry {
+    struct texture_key key;
+    struct sdl_texture texture;  // texture.texture NULL marks a free entry
+    size_t bytes;
+    int references;
+    uint64_t last_use;
+};
+
+struct texture_cache {
+    SDL_Renderer* renderer;
+    struct texture_cache_entry* entries;
+    int capacity;
+    size_t budget;  // bytes
+    size_t bytes;   // resident
+    uint64_t clock;
+    uint64_t hits;
+    uint64_t misses;
+    uint64_t evictions;
+};
+
+int create_texture_cache(struct texture_cache* cache, SDL_Renderer* renderer, const int capacity, const size_t budget);
+void destroy_texture_cache(struct texture_cache* cache);
+
+void make_texture_key(struct texture_key* key, const void* data, const SDL_Color* color_key,
+                      const SDL_ScaleMode scale_mode, const SDL_BlendMode blend_mode);
+int find_cached_texture(struct texture_cache* cache, const struct texture_key* key, struct sdl_texture* texture);
+int insert_cached_texture(struct texture_cache* cache, const struct texture_key* key, struct sdl_texture* texture);
+
+int acquire_texture(struct texture_cache* cache, struct sdl_texture* texture, const void* data, const size_t size,
+                    const SDL_Color* color_key, const SDL_ScaleMode scale_mode, const SDL_BlendMode blend_mode);
+void release_texture(struct texture_cache* cache, struct sdl_texture* texture);
+
+#endif  // TEXTURE_CACHE_H
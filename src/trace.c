@@ -3,19 +3,327 @@
 #include "trace.h"
 
 #include <errno.h>
+#include <inttypes.h>
+#include <fcntl.h>
 #include <limits.h>
+#include <pthread.h>
+#include <sched.h>
 #include <stdarg.h>
+#include <stdatomic.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
 #include <stdio.h>
+#include <stdlib.h>
 #include <string.h>
+#include <sys/mman.h>
 #include <time.h>
+#include <unistd.h>
 
 #define TIMESTAMP_SIZE 36  // YYYY-MM-DDTHH:MM:SS,nnnnnnnnn+HH:MM
+#define LINE_SIZE 4096  // one output line including prefix and newline, longer messages are truncated
+#define CONVERSION_SIZE 64  // single printf conversion specification, e.g. %-*.*jd
+
+#define RING_SLOTS 1024  // must be a power of two
+#define RING_ARGUMENTS_SIZE 256  // packed argument bytes per entry
+#define RING_CLAIM_RETRIES 64  // bounded CAS retries before an entry is dropped
+
+#define BINARY_MAGIC "TRACEBIN"
+#define BINARY_VERSION 1
+#define BINARY_BYTE_ORDER 0x01020304u
+#define BINARY_SITES 4096  // interned call sites per file, must be a power of two
+#define BINARY_ARGUMENTS_SIZE 1024  // packed argument bytes per record in synchronous mode
+#define BINARY_RECORD_SIZE (BINARY_ARGUMENTS_SIZE + 64)
+
+#define SINK_WRITE_RETRIES 8  // bounded write() calls per line to finish partial writes or ride out EINTR
+
+#define SPAN_EVENTS 65536  // recorded spans kept in memory, about 18 minutes of 10 spans per frame at 60 fps
+
+#define MMAP_MAX_SEGMENTS 10000  // segment file suffixes .0000 to .9999
+#define MMAP_APPEND_RETRIES 4  // rotations a single line may wait for before it is dropped
+#define MMAP_DRAIN_RETRIES 1000000  // sched_yield() calls waiting for appends still copying into a retired segment
+#define MMAP_ORPHANS 8  // mappings left by stalled rotations, waiting to be unmapped
+
+int trace_level = TRACE_LEVEL_VERBOSE;
 
 static char trace_path[PATH_MAX] = "";
 static FILE *trace_file = NULL;
 
+// One mapped, preallocated segment of the memory-mapped log
+struct mmap_segment {
+    char *base;
+    size_t size;
+    int fd;
+    time_t deadline;  // CLOCK_MONOTONIC_COARSE second at which the segment is rotated, 0 for never
+    atomic_size_t offset;  // next free byte, bumped by every append and may run past size
+    atomic_size_t used;  // end of valid data, lowered by the append that did not fit
+    atomic_int writers;  // appends currently copying into base
+};
+
+static char mmap_path[PATH_MAX] = "";
+static size_t mmap_segment_size = 0;
+static int mmap_rotate_seconds = 0;
+static unsigned int mmap_segment_index = 0;
+static struct mmap_segment mmap_segments[2];  // current and the one being retired, used alternately
+static _Atomic(struct mmap_segment *) mmap_current = NULL;
+static pthread_mutex_t mmap_mutex = PTHREAD_MUTEX_INITIALIZER;
+
+// Mapping of a segment whose appends did not drain; its slot is reused, so it is unmapped once the slot's writers do
+struct mmap_orphan {
+    struct mmap_segment *segment;
+    char *base;  // NULL when the entry is free
+    size_t size;
+};
+
+static struct mmap_orphan mmap_orphans[MMAP_ORPHANS];  // guarded by mmap_mutex
+
+struct trace_sink {
+    trace_sink_function function;
+    void *context;
+};
+
+static struct trace_sink trace_sinks[TRACE_SINKS] = {{trace_stdout_sink, NULL}};
+static size_t trace_sink_count = 1;
+
+// Every line is built here once and handed to all sinks
+static _Thread_local char line_buffer[LINE_SIZE];
+
+#define TIMESTAMP_DATE_LENGTH 19  // YYYY-MM-DDTHH:MM:SS
+
+// Per-thread cache of the parts of the timestamp that only change once per second
+struct timestamp_cache {
+    bool valid;
+    time_t second;
+    char date[TIMESTAMP_DATE_LENGTH + 1];  // YYYY-MM-DDTHH:MM:SS
+    char timezone[7];  // +HH:MM
+};
+
+static _Thread_local struct timestamp_cache timestamp_cache = {0};
+
+// Class of the argument consumed by a printf conversion
+enum argument_kind {
+    ARGUMENT_NONE,
+    ARGUMENT_SIGNED,
+    ARGUMENT_UNSIGNED,
+    ARGUMENT_DOUBLE,
+    ARGUMENT_LONG_DOUBLE,
+    ARGUMENT_CHAR,
+    ARGUMENT_STRING,
+    ARGUMENT_POINTER
+};
+
+struct conversion {
+    size_t length;  // characters in the specification, including the leading '%'
+    bool width_star;
+    bool precision_star;
+    int precision;  // literal precision, -1 when omitted or given by '*'
+    char modifier[3];  // hh, h, l, ll, j, z, t or L
+    char specifier;
+    enum argument_kind kind;
+};
+
+// One captured TRACE call. Pointers refer to static call-site strings, arguments are packed by pack_arguments().
+struct ring_entry {
+    struct timespec timestamp;
+    const char *file;
+    const char *function;
+    const char *format;
+    int line;
+    bool preformatted;  // arguments holds the final message when the format could not be captured
+    size_t arguments_size;
+    unsigned char arguments[RING_ARGUMENTS_SIZE];
+};
+
+struct ring_slot {
+    atomic_size_t sequence;
+    struct ring_entry entry;
+};
+
+static struct ring_slot ring[RING_SLOTS];
+static atomic_size_t ring_head = 0;  // next position claimed by producers
+static size_t ring_tail = 0;  // next position consumed by the writer thread
+static atomic_uint_fast64_t ring_dropped = 0;
+
+enum binary_record_type {
+    BINARY_RECORD_SITE = 'S',
+    BINARY_RECORD_ENTRY = 'E',
+    BINARY_RECORD_MESSAGE = 'M'
+};
+
+// Start of a binary trace file, followed by a stream of records
+struct binary_header {
+    char magic[8];
+    uint32_t version;
+    uint32_t byte_order;
+    uint8_t pointer_size;
+    uint8_t long_double_size;
+    uint8_t reserved[6];
+    int64_t realtime_ns;  // CLOCK_REALTIME and CLOCK_MONOTONIC sampled together when the file was opened
+    int64_t monotonic_ns;
+};
+
+struct binary_site {
+    const char *file;
+    const char *function;
+    const char *format;
+    int line;
+    uint32_t id;  // 0 marks an empty slot
+};
+
+// Call-site table rebuilt by trace_binary_dump()
+struct dump_site {
+    char *strings;
+    const char *file;
+    const char *function;
+    const char *format;
+    int line;
+};
+
+static FILE *binary_file = NULL;
+static struct binary_site binary_sites[BINARY_SITES];
+static uint32_t binary_site_count = 0;
+static pthread_mutex_t binary_mutex = PTHREAD_MUTEX_INITIALIZER;
+
+// Completed span, name, thread and CLOCK_MONOTONIC nanoseconds
+struct span_event {
+    const char *name;
+    int64_t begin_ns;
+    int64_t end_ns;
+    uint32_t thread;
+};
+
+static struct span_event span_events[SPAN_EVENTS];
+static atomic_size_t span_count = 0;  // spans claimed, may run past SPAN_EVENTS
+static atomic_bool spans_enabled = false;
+static atomic_uint_fast32_t span_thread_count = 0;
+static _Thread_local uint32_t span_thread = 0;  // small per-thread id used as tid, assigned on the first span
+
+static pthread_t writer_thread;
+static atomic_bool async_running = false;
+static atomic_bool writer_stop = false;
+static atomic_uint ring_producers = 0;  // threads between checking async_running and publishing their entry
+static atomic_bool writer_waiting = false;  // raised by the writer before it parks, cleared by whoever wakes it
+static pthread_mutex_t writer_mutex = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t writer_wake = PTHREAD_COND_INITIALIZER;
+
+int set_trace_level(int level) {
+    if (level < TRACE_LEVEL_VERBOSE || level > TRACE_LEVEL_OFF) {
+        fprintf(stderr, "%s:%d - %s - Argument level=[%d] out of range\n", __FILE__, __LINE__, __func__, level);
+        return -1;
+    }
+    if (level < TRACE_MIN_LEVEL) {
+        fprintf(stderr, "%s:%d - %s - level=[%d] is below TRACE_MIN_LEVEL=[%d], those entries are compiled out\n",
+                __FILE__, __LINE__, __func__, level, TRACE_MIN_LEVEL);
+    }
+
+    trace_level = level;
+    return 0;
+}
+
+int trace_fd_sink(void *context, const char *line, size_t length) {
+    const int *fd = context;
+    size_t written = 0;
+    ssize_t return_size = 0;
+    int retries = 0;
+
+    if (fd == NULL || line == NULL) {
+        fprintf(stderr, "%s:%d - %s - Arguments context and line should not be NULL\n", __FILE__, __LINE__, __func__);
+        return -1;
+    }
+
+    // A single write() in the common case, the loop only finishes partial writes
+    for (retries = 0; retries < SINK_WRITE_RETRIES && written < length; retries++) {
+        return_size = write(*fd, line + written, length - written);
+        if (return_size < 0) {
+            int error_num = errno;
+            if (error_num == EINTR) {
+                continue;
+            }
+            fprintf(stderr, "%s:%d - %s - write error=[%s]\n", __FILE__, __LINE__, __func__, strerror(error_num));
+            return -1;
+        }
+        written += (size_t)return_size;
+    }
+    if (written < length) {
+        fprintf(stderr, "%s:%d - %s - Incomplete write, %zu of %zu bytes\n", __FILE__, __LINE__, __func__, written,
+                length);
+        return -1;
+    }
+
+    return 0;
+}
+
+int trace_stream_sink(void *context, const char *line, size_t length) {
+    FILE *stream = context;
+
+    if (stream == NULL || line == NULL) {
+        fprintf(stderr, "%s:%d - %s - Arguments context and line should not be NULL\n", __FILE__, __LINE__, __func__);
+        return -1;
+    }
+
+    if (fwrite(line, 1, length, stream) != length) {
+        int error_num = errno;
+        fprintf(stderr, "%s:%d - %s - fwrite error=[%s]\n", __FILE__, __LINE__, __func__, strerror(error_num));
+        return -1;
+    }
+
+    return 0;
+}
+
+int trace_stdout_sink(void *context, const char *line, size_t length) {
+    (void)context;
+    return trace_stream_sink(stdout, line, length);
+}
+
+int add_trace_sink(trace_sink_function function, void *context) {
+    size_t index = 0;
+
+    if (function == NULL) {
+        fprintf(stderr, "%s:%d - %s - Argument function should not be NULL\n", __FILE__, __LINE__, __func__);
+        return -1;
+    }
+
+    for (index = 0; index < trace_sink_count; index++) {
+        if (trace_sinks[index].function == function && trace_sinks[index].context == context) {
+            return 0;
+        }
+    }
+    if (trace_sink_count >= TRACE_SINKS) {
+        fprintf(stderr, "%s:%d - %s - Sink list is full, TRACE_SINKS=[%d]\n", __FILE__, __LINE__, __func__,
+                TRACE_SINKS);
+        return -1;
+    }
+
+    trace_sinks[trace_sink_count].function = function;
+    trace_sinks[trace_sink_count].context = context;
+    trace_sink_count++;
+    return 0;
+}
+
+int remove_trace_sink(trace_sink_function function, void *context) {
+    size_t index = 0;
+
+    for (index = 0; index < trace_sink_count; index++) {
+        if (trace_sinks[index].function == function && trace_sinks[index].context == context) {
+            break;
+        }
+    }
+    if (index == trace_sink_count) {
+        fprintf(stderr, "%s:%d - %s - Sink is not registered\n", __FILE__, __LINE__, __func__);
+        return -1;
+    }
+
+    // Keep the remaining sinks in registration order
+    for (; index + 1 < trace_sink_count; index++) {
+        trace_sinks[index] = trace_sinks[index + 1];
+    }
+    trace_sink_count--;
+    return 0;
+}
+
 int set_trace_file(const char *path) {
     size_t length = 0;
+    int return_code = 0;
 
     if (path == NULL) {
         fprintf(stderr, "%s:%d - %s - Argument path should not be NULL\n", __FILE__, __LINE__, __func__);
@@ -32,10 +340,7 @@ int set_trace_file(const char *path) {
     memcpy(trace_path, path, length + 1);
 
     // Close file if it is open
-    if (trace_file != NULL) {
-        fclose(trace_file);
-        trace_file = NULL;
-    }
+    close_trace_file();
 
     // Open file on new path
     trace_file = fopen(trace_path, "ab");
@@ -46,191 +351,1549 @@ int set_trace_file(const char *path) {
         return -1;
     }
 
+    return_code = add_trace_sink(trace_stream_sink, trace_file);
+    if (return_code < 0) {
+        fclose(trace_file);
+        trace_file = NULL;
+        return -1;
+    }
+
     return 0;
 }
 
 void close_trace_file(void) {
     if (trace_file != NULL) {
+        (void)remove_trace_sink(trace_stream_sink, trace_file);
         fclose(trace_file);
         trace_file = NULL;
     }
     return;
 }
 
-static int timestampISO8601(char *buffer, const size_t buffer_size, const struct timespec *timestamp) {
-    struct tm localtime;
-    struct tm *return_tm_pointer = NULL;
-    char date[32];      // YYYY-MM-DDTHH:MM:SS
-    char timezone1[6];  // +HHMM
-    char timezone2[7];  // +HH:MM
-    int return_code;
-    size_t return_size;
+// Creates the next unused <path>.NNNN, preallocates and maps it. Called with mmap_mutex held or before the sink is
+// registered.
+static int open_mmap_segment(struct mmap_segment *segment) {
+    char path[PATH_MAX];
+    struct timespec now;
+    void *base = NULL;
+    int fd = -1;
+    int return_code = 0;
 
-    // Parameter validation
-    if (buffer == NULL) {
-        fprintf(stderr, "%s:%d - %s - Argument buffer should not be NULL\n", __FILE__, __LINE__, __func__);
-        return -1;
+    for (; mmap_segment_index < MMAP_MAX_SEGMENTS; mmap_segment_index++) {
+        return_code = snprintf(path, sizeof(path), "%s.%04u", mmap_path, mmap_segment_index);
+        if (return_code < 0 || (size_t)return_code >= sizeof(path)) {
+            fprintf(stderr, "%s:%d - %s - Segment path exceeds PATH_MAX=[%zu]\n", __FILE__, __LINE__, __func__,
+                    sizeof(path));
+            return -1;
+        }
+        fd = open(path, O_RDWR | O_CREAT | O_EXCL | O_CLOEXEC, 0644);
+        if (fd >= 0 || errno != EEXIST) {
+            break;
+        }
     }
-    if (timestamp == NULL) {
-        fprintf(stderr, "%s:%d - %s - Argument timestamp should not be NULL\n", __FILE__, __LINE__, __func__);
+    if (fd < 0) {
+        int error_num = errno;
+        fprintf(stderr, "%s:%d - %s - Failed to create segment of \"%s\" index=[%u] error=[%s]\n", __FILE__,
+                __LINE__, __func__, mmap_path, mmap_segment_index, strerror(error_num));
         return -1;
     }
-    if (buffer_size < TIMESTAMP_SIZE) {
-        fprintf(stderr, "%s:%d - %s - Argument buffer_size=[%zu] should not be smaller than TIMESTAMP_SIZE=[%d]\n",
-                __FILE__, __LINE__, __func__, buffer_size, TIMESTAMP_SIZE);
+    mmap_segment_index++;
+
+    // Reserve the blocks up front so appends never extend the file
+    return_code = posix_fallocate(fd, 0, (off_t)mmap_segment_size);
+    if (return_code != 0) {
+        fprintf(stderr, "%s:%d - %s - posix_fallocate \"%s\" error=[%s]\n", __FILE__, __LINE__, __func__, path,
+                strerror(return_code));
+        close(fd);
         return -1;
     }
 
-    memset(buffer, 0, buffer_size);
-
-    // convert to local time
-    return_tm_pointer = localtime_r(&timestamp->tv_sec, &localtime);
-    if (return_tm_pointer == NULL) {
+    base = mmap(NULL, mmap_segment_size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, fd, 0);
+    if (base == MAP_FAILED) {
         int error_num = errno;
-        fprintf(stderr, "%s:%d - %s - localtime_r error=[%s]\n", __FILE__, __LINE__, __func__, strerror(error_num));
+        fprintf(stderr, "%s:%d - %s - mmap \"%s\" error=[%s]\n", __FILE__, __LINE__, __func__, path,
+                strerror(error_num));
+        close(fd);
         return -1;
     }
-    // YYYY-MM-DDTHH:MM:SS
-    return_size = strftime(date, sizeof(date), "%Y-%m-%dT%H:%M:%S", &localtime);
-    if (return_size <= 0) {
-        fprintf(stderr, "%s:%d - %s - Error generating timestamp in strftime\n", __FILE__, __LINE__, __func__);
-        return -1;
+
+    segment->deadline = 0;
+    if (mmap_rotate_seconds > 0) {
+        return_code = clock_gettime(CLOCK_MONOTONIC_COARSE, &now);
+        if (return_code == 0) {
+            segment->deadline = now.tv_sec + mmap_rotate_seconds;
+        }
     }
+    segment->base = base;
+    segment->size = mmap_segment_size;
+    segment->fd = fd;
+    atomic_store(&segment->offset, 0);
+    atomic_store(&segment->used, mmap_segment_size);
+    // writers is left alone: a drained segment is balanced, and a stale appender still holding this struct from
+    // before the rotation decrements what it incremented
+    return 0;
+}
 
-    // timezone as +HHMM, then make +HH:MM
-    strncpy(timezone2, "+00:00", sizeof(timezone2));
-    return_size = strftime(timezone1, sizeof(timezone1), "%z", &localtime);
-    if (return_size != 5) {
-        fprintf(stderr, "%s:%d - %s - Error generating timezone in strftime\n", __FILE__, __LINE__, __func__);
-        return -1;
+// Waits for appends still copying into a segment that is no longer current, then trims the file to the valid data
+static void close_mmap_segment(struct mmap_segment *segment) {
+    size_t used = 0;
+    size_t index = 0;
+    int retries = 0;
+
+    for (retries = 0; retries < MMAP_DRAIN_RETRIES && atomic_load(&segment->writers) != 0; retries++) {
+        sched_yield();
+    }
+    if (retries >= MMAP_DRAIN_RETRIES) {
+        // Leave it mapped rather than pull the memory from under a stalled writer, release_mmap_orphans() unmaps it
+        fprintf(stderr, "%s:%d - %s - Appends did not drain, segment left mapped\n", __FILE__, __LINE__, __func__);
+        while (index < MMAP_ORPHANS && mmap_orphans[index].base != NULL) {
+            index++;
+        }
+        if (index < MMAP_ORPHANS) {
+            mmap_orphans[index].segment = segment;
+            mmap_orphans[index].base = segment->base;
+            mmap_orphans[index].size = segment->size;
+        } else {
+            fprintf(stderr, "%s:%d - %s - No orphan slot left, mapping of size=[%zu] leaked\n", __FILE__, __LINE__,
+                    __func__, segment->size);
+        }
+        close(segment->fd);
+        segment->fd = -1;
+        return;
     }
-    timezone2[0] = timezone1[0];
-    timezone2[1] = timezone1[1];
-    timezone2[2] = timezone1[2];
-    timezone2[3] = ':';
-    timezone2[4] = timezone1[3];
-    timezone2[5] = timezone1[4];
-    timezone2[6] = '\0';
 
-    // output YYYY-MM-DDTHH:MM:SS,nnnnnnnnn+HH:MM
-    return_code = snprintf(buffer, buffer_size, "%s,%09ld%s", date, (long)timestamp->tv_nsec, timezone2);
-    if (return_code < 0) {
+    used = atomic_load(&segment->offset);
+    if (used > segment->size) {
+        used = atomic_load(&segment->used);
+    }
+
+    munmap(segment->base, segment->size);
+    if (ftruncate(segment->fd, (off_t)used) != 0) {
         int error_num = errno;
-        fprintf(stderr, "%s:%d - %s - snprintf error=[%s]\n", __FILE__, __LINE__, __func__, strerror(error_num));
-        memset(buffer, 0, buffer_size);
-        return -1;
+        fprintf(stderr, "%s:%d - %s - ftruncate error=[%s]\n", __FILE__, __LINE__, __func__, strerror(error_num));
     }
-    if ((size_t)return_code >= buffer_size) {
-        fprintf(stderr, "%s:%d - %s - return_code=[%i] should not be bigger than buffer_size=[%zu]\n", __FILE__,
-                __LINE__, __func__, return_code, buffer_size);
-        memset(buffer, 0, buffer_size);
-        return -1;
+    close(segment->fd);
+    segment->base = NULL;
+    segment->fd = -1;
+    return;
+}
+
+// Unmaps the mappings left by stalled rotations once no append is registered on their slot any more, which covers
+// the stalled one. With wait set, used on close when no new appends arrive, the slot is given the drain retries first.
+// Called with mmap_mutex held.
+static void release_mmap_orphans(bool wait) {
+    struct mmap_orphan *orphan = NULL;
+    size_t index = 0;
+    int retries = 0;
+
+    for (index = 0; index < MMAP_ORPHANS; index++) {
+        orphan = &mmap_orphans[index];
+        if (orphan->base == NULL) {
+            continue;
+        }
+        for (retries = 0; wait && retries < MMAP_DRAIN_RETRIES && atomic_load(&orphan->segment->writers) != 0;
+             retries++) {
+            sched_yield();
+        }
+        if (atomic_load(&orphan->segment->writers) != 0) {
+            continue;
+        }
+        munmap(orphan->base, orphan->size);
+        orphan->base = NULL;
     }
+    return;
+}
 
-    return 0;
+// Replaces full (or expired) with a fresh segment. Whoever gets the mutex first rotates, the others find a new current
+// segment and just retry their append.
+static int rotate_mmap_segment(struct mmap_segment *full) {
+    struct mmap_segment *next = (full == &mmap_segments[0]) ? &mmap_segments[1] : &mmap_segments[0];
+    int return_code = 0;
+
+    pthread_mutex_lock(&mmap_mutex);
+    if (atomic_load(&mmap_current) != full) {
+        pthread_mutex_unlock(&mmap_mutex);
+        return 0;
+    }
+
+    return_code = open_mmap_segment(next);
+    atomic_store(&mmap_current, (return_code < 0) ? NULL : next);
+    close_mmap_segment(full);
+    release_mmap_orphans(false);
+    pthread_mutex_unlock(&mmap_mutex);
+
+    return (return_code < 0) ? -1 : 0;
 }
 
-int _trace_va(const char *file, int line, const char *function, const char *format, va_list arguments) {
+// Lock-free append: register as a writer, claim [start, start + length) with one atomic add and memcpy the line.
+// Only the append that runs past the end of a segment (or past its deadline) takes the slow path and rotates.
+static int trace_mmap_sink(void *context, const char *line, size_t length) {
+    struct mmap_segment *segment = NULL;
+    struct timespec now;
+    size_t start = 0;
+    int retries = 0;
     int return_code = 0;
-    struct timespec timestamp;
-    char time_string[TIMESTAMP_SIZE];
 
-    // Validate arguments
-    if (file == NULL) {
-        fprintf(stderr, "%s:%d - %s - Argument file should not be NULL\n", __FILE__, __LINE__, __func__);
+    (void)context;
+
+    for (retries = 0; retries < MMAP_APPEND_RETRIES; retries++) {
+        segment = atomic_load(&mmap_current);
+        if (segment == NULL) {
+            return -1;
+        }
+
+        // The rotator swaps mmap_current before draining writers, so a writer that still sees the same segment after
+        // registering is guaranteed to be waited for
+        atomic_fetch_add(&segment->writers, 1);
+        if (atomic_load(&mmap_current) != segment) {
+            atomic_fetch_sub(&segment->writers, 1);
+            continue;
+        }
+
+        if (segment->deadline != 0 && clock_gettime(CLOCK_MONOTONIC_COARSE, &now) == 0 &&
+            now.tv_sec >= segment->deadline) {
+            atomic_fetch_sub(&segment->writers, 1);
+            return_code = rotate_mmap_segment(segment);
+            if (return_code < 0) {
+                return -1;
+            }
+            continue;
+        }
+
+        start = atomic_fetch_add_explicit(&segment->offset, length, memory_order_relaxed);
+        if (start + length <= segment->size) {
+            memcpy(segment->base + start, line, length);
+            atomic_fetch_sub_explicit(&segment->writers, 1, memory_order_release);
+            return 0;
+        }
+
+        // Exactly one append straddles the end, everything before it is valid
+        if (start < segment->size) {
+            atomic_store(&segment->used, start);
+        }
+        atomic_fetch_sub(&segment->writers, 1);
+        return_code = rotate_mmap_segment(segment);
+        if (return_code < 0) {
+            return -1;
+        }
+    }
+
+    fprintf(stderr, "%s:%d - %s - Line dropped after %d segment rotations\n", __FILE__, __LINE__, __func__, retries);
+    return -1;
+}
+
+int set_trace_mmap_file(const char *path, size_t segment_size, int rotate_seconds) {
+    size_t length = 0;
+    int return_code = 0;
+
+    if (path == NULL) {
+        fprintf(stderr, "%s:%d - %s - Argument path should not be NULL\n", __FILE__, __LINE__, __func__);
         return -1;
     }
-    if (function == NULL) {
-        fprintf(stderr, "%s:%d - %s - Argument function should not be NULL\n", __FILE__, __LINE__, __func__);
+    if (segment_size < LINE_SIZE) {
+        fprintf(stderr, "%s:%d - %s - Argument segment_size=[%zu] should not be smaller than LINE_SIZE=[%d]\n",
+                __FILE__, __LINE__, __func__, segment_size, LINE_SIZE);
         return -1;
     }
-    if (format == NULL) {
-        fprintf(stderr, "%s:%d - %s - Argument format should not be NULL\n", __FILE__, __LINE__, __func__);
+    if (rotate_seconds < 0) {
+        fprintf(stderr, "%s:%d - %s - Argument rotate_seconds=[%d] should not be negative\n", __FILE__, __LINE__,
+                __func__, rotate_seconds);
         return -1;
     }
 
-    // get current time
-    return_code = clock_gettime(CLOCK_REALTIME, &timestamp);
-    if (return_code != 0) {
-        int error_num = errno;
-        fprintf(stderr, "%s:%d - %s - clock_gettime error=[%s]\n", __FILE__, __LINE__, __func__, strerror(error_num));
+    length = strnlen(path, sizeof(mmap_path));
+    if (length >= sizeof(mmap_path)) {
+        fprintf(stderr, "%s:%d - %s - length of path exceeds PATH_MAX=[%zu]\n", __FILE__, __LINE__, __func__,
+                sizeof(mmap_path));
         return -1;
     }
 
-    return_code = timestampISO8601(time_string, sizeof(time_string), &timestamp);
+    close_trace_mmap_file();
+
+    memcpy(mmap_path, path, length + 1);
+    mmap_segment_size = segment_size;
+    mmap_rotate_seconds = rotate_seconds;
+    mmap_segment_index = 0;
+
+    return_code = open_mmap_segment(&mmap_segments[0]);
     if (return_code < 0) {
-        fprintf(stderr, "%s:%d - %s - timestampISO8601 error\n", __FILE__, __LINE__, __func__);
         return -1;
     }
+    atomic_store(&mmap_current, &mmap_segments[0]);
 
-    // output to trace file
-    if (trace_file != NULL) {
-        va_list arguments_file;
+    return_code = add_trace_sink(trace_mmap_sink, NULL);
+    if (return_code < 0) {
+        close_trace_mmap_file();
+        return -1;
+    }
 
-        // output YYYY-MM-DDTHH:MM:SS,nnnnnnnnn+HH:MM file:line - function -
-        return_code = fprintf(trace_file, "%s - %s:%d - %s - ", time_string, file, line, function);
-        if (return_code < 0) {
-            int error_num = errno;
-            fprintf(stderr, "%s:%d - %s - fprintf error=[%s]\n", __FILE__, __LINE__, __func__, strerror(error_num));
-            return -1;
-        }
+    return 0;
+}
 
-        // Copy va_list and output message to file
-        va_copy(arguments_file, arguments);
-        return_code = vfprintf(trace_file, format, arguments_file);
-        if (return_code < 0) {
-            int error_num = errno;
-            fprintf(stderr, "%s:%d - %s - vfprintf error=[%s]\n", __FILE__, __LINE__, __func__, strerror(error_num));
-            va_end(arguments_file);
-            return -1;
-        }
-        va_end(arguments_file);
+void close_trace_mmap_file(void) {
+    struct mmap_segment *segment = NULL;
 
-        return_code = fputc('\n', trace_file);
-        if (return_code == EOF) {
-            int error_num = errno;
-            fprintf(stderr, "%s:%d - %s - fputc error=[%s]\n", __FILE__, __LINE__, __func__, strerror(error_num));
-            return -1;
-        }
+    pthread_mutex_lock(&mmap_mutex);
+    segment = atomic_load(&mmap_current);
+    if (segment != NULL) {
+        (void)remove_trace_sink(trace_mmap_sink, NULL);
+        atomic_store(&mmap_current, NULL);
+        close_mmap_segment(segment);
     }
+    release_mmap_orphans(true);
+    pthread_mutex_unlock(&mmap_mutex);
+    return;
+}
 
-    // output to stdout
-    {
-        va_list arguments_stdout;
-
-        // output YYYY-MM-DDTHH:MM:SS,nnnnnnnnn+HH:MM file:line - function -
-        return_code = fprintf(stdout, "%s - %s:%d - %s - ", time_string, file, line, function);
-        if (return_code < 0) {
-            int error_num = errno;
-            fprintf(stderr, "%s:%d - %s - fprintf error=[%s]\n", __FILE__, __LINE__, __func__, strerror(error_num));
-            return -1;
-        }
+// Formats the per-second part of the timestamp, YYYY-MM-DDTHH:MM:SS and +HH:MM, into the thread-local cache
+static int format_timestamp_second(const time_t second) {
+    struct tm localtime;
+    struct tm *return_tm_pointer = NULL;
+    char timezone1[6];  // +HHMM
+    size_t return_size;
 
-        // Copy va_list and output message to stdout
-        va_copy(arguments_stdout, arguments);
-        return_code = vfprintf(stdout, format, arguments_stdout);
-        if (return_code < 0) {
-            int error_num = errno;
-            fprintf(stderr, "%s:%d - %s - vfprintf error=[%s]\n", __FILE__, __LINE__, __func__, strerror(error_num));
-            va_end(arguments_stdout);
-            return -1;
-        }
-        va_end(arguments_stdout);
+    // convert to local time
+    return_tm_pointer = localtime_r(&second, &localtime);
+    if (return_tm_pointer == NULL) {
+        int error_num = errno;
+        fprintf(stderr, "%s:%d - %s - localtime_r error=[%s]\n", __FILE__, __LINE__, __func__, strerror(error_num));
+        return -1;
+    }
+    // YYYY-MM-DDTHH:MM:SS
+    return_size = strftime(timestamp_cache.date, sizeof(timestamp_cache.date), "%Y-%m-%dT%H:%M:%S", &localtime);
+    if (return_size != TIMESTAMP_DATE_LENGTH) {
+        fprintf(stderr, "%s:%d - %s - Error generating timestamp in strftime\n", __FILE__, __LINE__, __func__);
+        return -1;
+    }
 
-        return_code = fputc('\n', stdout);
-        if (return_code == EOF) {
-            int error_num = errno;
-            fprintf(stderr, "%s:%d - %s - fputc error=[%s]\n", __FILE__, __LINE__, __func__, strerror(error_num));
-            return -1;
-        }
+    // timezone as +HHMM, then make +HH:MM
+    return_size = strftime(timezone1, sizeof(timezone1), "%z", &localtime);
+    if (return_size != 5) {
+        fprintf(stderr, "%s:%d - %s - Error generating timezone in strftime\n", __FILE__, __LINE__, __func__);
+        return -1;
     }
+    timestamp_cache.timezone[0] = timezone1[0];
+    timestamp_cache.timezone[1] = timezone1[1];
+    timestamp_cache.timezone[2] = timezone1[2];
+    timestamp_cache.timezone[3] = ':';
+    timestamp_cache.timezone[4] = timezone1[3];
+    timestamp_cache.timezone[5] = timezone1[4];
+    timestamp_cache.timezone[6] = '\0';
 
+    timestamp_cache.second = second;
+    timestamp_cache.valid = true;
     return 0;
 }
 
-int _trace(const char *file, int line, const char *function, const char *format, ...) {
-    int return_code = 0;
-    va_list arguments;
+static int timestampISO8601(char *buffer, const size_t buffer_size, const struct timespec *timestamp) {
+    long nanoseconds = 0;
+    int digit = 0;
+    int return_code;
+
+    // Parameter validation
+    if (buffer == NULL) {
+        fprintf(stderr, "%s:%d - %s - Argument buffer should not be NULL\n", __FILE__, __LINE__, __func__);
+        return -1;
+    }
+    if (timestamp == NULL) {
+        fprintf(stderr, "%s:%d - %s - Argument timestamp should not be NULL\n", __FILE__, __LINE__, __func__);
+        return -1;
+    }
+    if (buffer_size < TIMESTAMP_SIZE) {
+        fprintf(stderr, "%s:%d - %s - Argument buffer_size=[%zu] should not be smaller than TIMESTAMP_SIZE=[%d]\n",
+                __FILE__, __LINE__, __func__, buffer_size, TIMESTAMP_SIZE);
+        return -1;
+    }
+    if (timestamp->tv_nsec < 0 || timestamp->tv_nsec > 999999999) {
+        fprintf(stderr, "%s:%d - %s - Argument timestamp->tv_nsec=[%ld] out of range\n", __FILE__, __LINE__, __func__,
+                (long)timestamp->tv_nsec);
+        return -1;
+    }
+
+    // localtime_r and strftime only run when the second changes
+    if (!timestamp_cache.valid || timestamp_cache.second != timestamp->tv_sec) {
+        return_code = format_timestamp_second(timestamp->tv_sec);
+        if (return_code < 0) {
+            timestamp_cache.valid = false;
+            memset(buffer, 0, buffer_size);
+            return -1;
+        }
+    }
+
+    // output YYYY-MM-DDTHH:MM:SS,nnnnnnnnn+HH:MM
+    memcpy(buffer, timestamp_cache.date, TIMESTAMP_DATE_LENGTH);
+    buffer[TIMESTAMP_DATE_LENGTH] = ',';
+    nanoseconds = (long)timestamp->tv_nsec;
+    for (digit = 9; digit > 0; digit--) {
+        buffer[TIMESTAMP_DATE_LENGTH + (size_t)digit] = (char)('0' + (nanoseconds % 10));
+        nanoseconds /= 10;
+    }
+    memcpy(buffer + TIMESTAMP_DATE_LENGTH + 10, timestamp_cache.timezone, sizeof(timestamp_cache.timezone));
+
+    return 0;
+}
+
+// Copies up to buffer_size - 1 - length bytes of text at buffer + length and returns the new length
+static size_t append_text(char *buffer, size_t buffer_size, size_t length, const char *text, size_t text_length) {
+    if (text_length > buffer_size - 1 - length) {
+        text_length = buffer_size - 1 - length;
+    }
+    memcpy(buffer + length, text, text_length);
+    return length + text_length;
+}
+
+// Writes "YYYY-MM-DDTHH:MM:SS,nnnnnnnnn+HH:MM - file:line - function - " at the start of buffer and returns its length.
+// Built with memcpy and hand-written digits, the message is the only part that goes through printf.
+static int format_line_prefix(char *buffer, size_t buffer_size, const struct timespec *timestamp, const char *file,
+                              int line, const char *function) {
+    char digits[12];  // -2147483648
+    size_t digit_count = 0;
+    unsigned int value = 0;
+    size_t length = 0;
+    int return_code = 0;
+
+    return_code = timestampISO8601(buffer, buffer_size, timestamp);
+    if (return_code < 0) {
+        fprintf(stderr, "%s:%d - %s - timestampISO8601 error\n", __FILE__, __LINE__, __func__);
+        return -1;
+    }
+    length = TIMESTAMP_SIZE - 1;
+
+    length = append_text(buffer, buffer_size, length, " - ", 3);
+    length = append_text(buffer, buffer_size, length, file, strlen(file));
+    length = append_text(buffer, buffer_size, length, ":", 1);
+
+    // line number, digits are produced backwards
+    value = (line < 0) ? 0u - (unsigned int)line : (unsigned int)line;
+    do {
+        digits[sizeof(digits) - 1 - digit_count] = (char)('0' + value % 10);
+        digit_count++;
+        value /= 10;
+    } while (value != 0 && digit_count < sizeof(digits) - 1);
+    if (line < 0) {
+        digits[sizeof(digits) - 1 - digit_count] = '-';
+        digit_count++;
+    }
+    length = append_text(buffer, buffer_size, length, digits + sizeof(digits) - digit_count, digit_count);
+
+    length = append_text(buffer, buffer_size, length, " - ", 3);
+    length = append_text(buffer, buffer_size, length, function, strlen(function));
+    length = append_text(buffer, buffer_size, length, " - ", 3);
+
+    return (int)length;
+}
+
+// Terminates a line of length bytes with '\n', truncating it to buffer_size, and returns the final length
+static size_t finish_line(char *buffer, size_t buffer_size, size_t length) {
+    if (length > buffer_size - 1) {
+        length = buffer_size - 1;
+    }
+    buffer[length] = '\n';
+    return length + 1;
+}
+
+// Hands the same bytes to every sink, a failing sink does not stop the others
+static int emit_line(const char *buffer, size_t length) {
+    size_t index = 0;
+    int return_code = 0;
+    int result = 0;
+
+    for (index = 0; index < trace_sink_count; index++) {
+        return_code = trace_sinks[index].function(trace_sinks[index].context, buffer, length);
+        if (return_code < 0) {
+            result = -1;
+        }
+    }
+
+    return result;
+}
+
+static int parse_conversion(const char *specification, struct conversion *conversion) {
+    size_t index = 1;
+    size_t modifier_length = 0;
+
+    memset(conversion, 0, sizeof(*conversion));
+    conversion->precision = -1;
+
+    // flags
+    while (index < CONVERSION_SIZE && specification[index] != '\0' && strchr("-+ #0'", specification[index]) != NULL) {
+        index++;
+    }
+
+    // width
+    if (specification[index] == '*') {
+        conversion->width_star = true;
+        index++;
+    }
+    while (index < CONVERSION_SIZE && specification[index] >= '0' && specification[index] <= '9') {
+        index++;
+    }
+
+    // precision
+    if (specification[index] == '.') {
+        index++;
+        if (specification[index] == '*') {
+            conversion->precision_star = true;
+            index++;
+        } else {
+            conversion->precision = 0;
+        }
+        while (index < CONVERSION_SIZE && specification[index] >= '0' && specification[index] <= '9') {
+            if (conversion->precision < INT_MAX / 10) {
+                conversion->precision = conversion->precision * 10 + (specification[index] - '0');
+            }
+            index++;
+        }
+    }
+
+    // length modifier
+    while (index < CONVERSION_SIZE && modifier_length < 2 && specification[index] != '\0' &&
+           strchr("hljztL", specification[index]) != NULL) {
+        conversion->modifier[modifier_length] = specification[index];
+        modifier_length++;
+        index++;
+    }
+
+    if (index >= CONVERSION_SIZE - 1) {
+        return -1;
+    }
+
+    conversion->specifier = specification[index];
+    conversion->length = index + 1;
+
+    switch (conversion->specifier) {
+        case 'd':
+        case 'i':
+            conversion->kind = ARGUMENT_SIGNED;
+            break;
+        case 'o':
+        case 'u':
+        case 'x':
+        case 'X':
+            conversion->kind = ARGUMENT_UNSIGNED;
+            break;
+        case 'f':
+        case 'F':
+        case 'e':
+        case 'E':
+        case 'g':
+        case 'G':
+        case 'a':
+        case 'A':
+            conversion->kind = (conversion->modifier[0] == 'L') ? ARGUMENT_LONG_DOUBLE : ARGUMENT_DOUBLE;
+            break;
+        case 'c':
+            conversion->kind = ARGUMENT_CHAR;
+            break;
+        case 's':
+            conversion->kind = ARGUMENT_STRING;
+            break;
+        case 'p':
+            conversion->kind = ARGUMENT_POINTER;
+            break;
+        case '%':
+            conversion->kind = ARGUMENT_NONE;
+            return (conversion->length == 2) ? 0 : -1;
+        default:
+            // %n and unknown conversions cannot be captured
+            return -1;
+    }
+
+    // wide characters and strings are not captured
+    if (modifier_length > 0 && (conversion->kind == ARGUMENT_CHAR || conversion->kind == ARGUMENT_STRING)) {
+        return -1;
+    }
+
+    return 0;
+}
+
+static int pack_bytes(unsigned char *buffer, size_t buffer_size, size_t *offset, const void *value, size_t size) {
+    if (size > buffer_size - *offset) {
+        return -1;
+    }
+    memcpy(buffer + *offset, value, size);
+    *offset += size;
+    return 0;
+}
+
+static int unpack_bytes(const unsigned char *buffer, size_t buffer_size, size_t *offset, void *value, size_t size) {
+    if (size > buffer_size - *offset) {
+        return -1;
+    }
+    memcpy(value, buffer + *offset, size);
+    *offset += size;
+    return 0;
+}
+
+static intmax_t read_signed(const struct conversion *conversion, va_list arguments) {
+    const char *modifier = conversion->modifier;
+
+    if (strcmp(modifier, "hh") == 0) {
+        return (signed char)va_arg(arguments, int);
+    }
+    if (strcmp(modifier, "h") == 0) {
+        return (short)va_arg(arguments, int);
+    }
+    if (strcmp(modifier, "l") == 0) {
+        return va_arg(arguments, long);
+    }
+    if (strcmp(modifier, "ll") == 0) {
+        return va_arg(arguments, long long);
+    }
+    if (strcmp(modifier, "j") == 0) {
+        return va_arg(arguments, intmax_t);
+    }
+    if (strcmp(modifier, "z") == 0) {
+        return (intmax_t)va_arg(arguments, size_t);
+    }
+    if (strcmp(modifier, "t") == 0) {
+        return va_arg(arguments, ptrdiff_t);
+    }
+    return va_arg(arguments, int);
+}
+
+static uintmax_t read_unsigned(const struct conversion *conversion, va_list arguments) {
+    const char *modifier = conversion->modifier;
+
+    if (strcmp(modifier, "hh") == 0) {
+        return (unsigned char)va_arg(arguments, unsigned int);
+    }
+    if (strcmp(modifier, "h") == 0) {
+        return (unsigned short)va_arg(arguments, unsigned int);
+    }
+    if (strcmp(modifier, "l") == 0) {
+        return va_arg(arguments, unsigned long);
+    }
+    if (strcmp(modifier, "ll") == 0) {
+        return va_arg(arguments, unsigned long long);
+    }
+    if (strcmp(modifier, "j") == 0) {
+        return va_arg(arguments, uintmax_t);
+    }
+    if (strcmp(modifier, "z") == 0) {
+        return va_arg(arguments, size_t);
+    }
+    if (strcmp(modifier, "t") == 0) {
+        return (uintmax_t)va_arg(arguments, ptrdiff_t);
+    }
+    return va_arg(arguments, unsigned int);
+}
+
+// Walks the format string and copies every argument it consumes into buffer. Integers are widened to 64 bits, strings
+// are stored as a 16-bit length followed by their bytes, bounded by the precision like printf does, so a %.*s buffer
+// without a terminator is never read past its end, and truncated to the space left in buffer.
+static int pack_arguments(unsigned char *buffer, size_t buffer_size, size_t *packed_size, const char *format,
+                          va_list arguments) {
+    size_t offset = 0;
+    const char *cursor = format;
+    struct conversion conversion;
+    int return_code = 0;
+
+    while (*cursor != '\0') {
+        if (*cursor != '%') {
+            cursor++;
+            continue;
+        }
+
+        return_code = parse_conversion(cursor, &conversion);
+        if (return_code < 0) {
+            return -1;
+        }
+        cursor += conversion.length;
+
+        if (conversion.width_star) {
+            int width = va_arg(arguments, int);
+            if (pack_bytes(buffer, buffer_size, &offset, &width, sizeof(width)) < 0) {
+                return -1;
+            }
+        }
+        if (conversion.precision_star) {
+            int precision = va_arg(arguments, int);
+            if (pack_bytes(buffer, buffer_size, &offset, &precision, sizeof(precision)) < 0) {
+                return -1;
+            }
+            // A negative precision is taken as if the precision were omitted
+            conversion.precision = (precision < 0) ? -1 : precision;
+        }
+
+        switch (conversion.kind) {
+            case ARGUMENT_NONE: {
+                break;
+            }
+            case ARGUMENT_SIGNED: {
+                intmax_t value = read_signed(&conversion, arguments);
+                return_code = pack_bytes(buffer, buffer_size, &offset, &value, sizeof(value));
+                break;
+            }
+            case ARGUMENT_UNSIGNED: {
+                uintmax_t value = read_unsigned(&conversion, arguments);
+                return_code = pack_bytes(buffer, buffer_size, &offset, &value, sizeof(value));
+                break;
+            }
+            case ARGUMENT_DOUBLE: {
+                double value = va_arg(arguments, double);
+                return_code = pack_bytes(buffer, buffer_size, &offset, &value, sizeof(value));
+                break;
+            }
+            case ARGUMENT_LONG_DOUBLE: {
+                long double value = va_arg(arguments, long double);
+                return_code = pack_bytes(buffer, buffer_size, &offset, &value, sizeof(value));
+                break;
+            }
+            case ARGUMENT_CHAR: {
+                int value = va_arg(arguments, int);
+                return_code = pack_bytes(buffer, buffer_size, &offset, &value, sizeof(value));
+                break;
+            }
+            case ARGUMENT_STRING: {
+                const char *value = va_arg(arguments, const char *);
+                uint16_t length = 0;
+                size_t available = 0;
+
+                if (value == NULL) {
+                    value = "(null)";
+                }
+                if (buffer_size - offset < sizeof(length)) {
+                    return -1;
+                }
+                available = buffer_size - offset - sizeof(length);
+                if (available > UINT16_MAX) {
+                    available = UINT16_MAX;
+                }
+                if (conversion.precision >= 0 && (size_t)conversion.precision < available) {
+                    available = (size_t)conversion.precision;
+                }
+                length = (uint16_t)strnlen(value, available);
+                (void)pack_bytes(buffer, buffer_size, &offset, &length, sizeof(length));
+                return_code = pack_bytes(buffer, buffer_size, &offset, value, length);
+                break;
+            }
+            case ARGUMENT_POINTER: {
+                const void *value = va_arg(arguments, const void *);
+                return_code = pack_bytes(buffer, buffer_size, &offset, &value, sizeof(value));
+                break;
+            }
+            default: {
+                return -1;
+            }
+        }
+        if (return_code < 0) {
+            return -1;
+        }
+    }
+
+    *packed_size = offset;
+    return 0;
+}
+
+#pragma GCC diagnostic push
+#pragma GCC diagnostic ignored "-Wformat-nonliteral"
+
+// Formats a single conversion rebuilt from the format string. Stars are replaced by their captured values and integer
+// length modifiers by 'j' so the widened values stored by pack_arguments() are printed with the original semantics.
+static int unpack_conversion(char *output, size_t output_size, const char *specification,
+                             const struct conversion *conversion, const unsigned char *arguments,
+                             size_t arguments_size, size_t *offset) {
+    char rebuilt[CONVERSION_SIZE + 32];
+    size_t rebuilt_length = 0;
+    size_t index = 0;
+    int return_code = 0;
+
+    for (index = 0; index + 1 < conversion->length; index++) {
+        char character = specification[index];
+
+        if (character == '*') {
+            int star = 0;
+            if (unpack_bytes(arguments, arguments_size, offset, &star, sizeof(star)) < 0) {
+                return -1;
+            }
+            // A negative precision is taken as if the precision were omitted
+            if (index > 0 && specification[index - 1] == '.' && star < 0) {
+                rebuilt_length--;
+                continue;
+            }
+            return_code =
+                snprintf(rebuilt + rebuilt_length, sizeof(rebuilt) - rebuilt_length, "%d", star);
+            if (return_code < 0 || (size_t)return_code >= sizeof(rebuilt) - rebuilt_length) {
+                return -1;
+            }
+            rebuilt_length += (size_t)return_code;
+            continue;
+        }
+        if (strchr("hljztL", character) != NULL) {
+            continue;
+        }
+        rebuilt[rebuilt_length] = character;
+        rebuilt_length++;
+    }
+
+    if (conversion->kind == ARGUMENT_SIGNED || conversion->kind == ARGUMENT_UNSIGNED) {
+        rebuilt[rebuilt_length] = 'j';
+        rebuilt_length++;
+    } else if (conversion->kind == ARGUMENT_LONG_DOUBLE) {
+        rebuilt[rebuilt_length] = 'L';
+        rebuilt_length++;
+    }
+    rebuilt[rebuilt_length] = conversion->specifier;
+    rebuilt[rebuilt_length + 1] = '\0';
+
+    switch (conversion->kind) {
+        case ARGUMENT_SIGNED: {
+            intmax_t value = 0;
+            return_code = unpack_bytes(arguments, arguments_size, offset, &value, sizeof(value));
+            if (return_code == 0) {
+                return_code = snprintf(output, output_size, rebuilt, value);
+            }
+            break;
+        }
+        case ARGUMENT_UNSIGNED: {
+            uintmax_t value = 0;
+            return_code = unpack_bytes(arguments, arguments_size, offset, &value, sizeof(value));
+            if (return_code == 0) {
+                return_code = snprintf(output, output_size, rebuilt, value);
+            }
+            break;
+        }
+        case ARGUMENT_DOUBLE: {
+            double value = 0;
+            return_code = unpack_bytes(arguments, arguments_size, offset, &value, sizeof(value));
+            if (return_code == 0) {
+                return_code = snprintf(output, output_size, rebuilt, value);
+            }
+            break;
+        }
+        case ARGUMENT_LONG_DOUBLE: {
+            long double value = 0;
+            return_code = unpack_bytes(arguments, arguments_size, offset, &value, sizeof(value));
+            if (return_code == 0) {
+                return_code = snprintf(output, output_size, rebuilt, value);
+            }
+            break;
+        }
+        case ARGUMENT_CHAR: {
+            int value = 0;
+            return_code = unpack_bytes(arguments, arguments_size, offset, &value, sizeof(value));
+            if (return_code == 0) {
+                return_code = snprintf(output, output_size, rebuilt, value);
+            }
+            break;
+        }
+        case ARGUMENT_STRING: {
+            uint16_t length = 0;
+            char value[BINARY_ARGUMENTS_SIZE + 1];  // largest packed buffer, binary records in synchronous mode
+            return_code = unpack_bytes(arguments, arguments_size, offset, &length, sizeof(length));
+            if (return_code == 0 && length >= sizeof(value)) {
+                return_code = -1;
+            }
+            if (return_code == 0) {
+                return_code = unpack_bytes(arguments, arguments_size, offset, value, length);
+            }
+            if (return_code == 0) {
+                value[length] = '\0';
+                return_code = snprintf(output, output_size, rebuilt, value);
+            }
+            break;
+        }
+        case ARGUMENT_POINTER: {
+            const void *value = NULL;
+            return_code = unpack_bytes(arguments, arguments_size, offset, &value, sizeof(value));
+            if (return_code == 0) {
+                return_code = snprintf(output, output_size, rebuilt, value);
+            }
+            break;
+        }
+        case ARGUMENT_NONE:
+        default: {
+            return_code = -1;
+            break;
+        }
+    }
+
+    return return_code;
+}
+
+#pragma GCC diagnostic pop
+
+// Rebuilds the message text from a format string and the arguments captured by pack_arguments(). Output is truncated
+// to message_size.
+static int unpack_message(char *message, size_t message_size, const char *format, const unsigned char *arguments,
+                          size_t arguments_size) {
+    size_t length = 0;
+    size_t offset = 0;
+    const char *cursor = format;
+    struct conversion conversion;
+    int return_code = 0;
+
+    while (*cursor != '\0' && length + 1 < message_size) {
+        if (*cursor != '%') {
+            message[length] = *cursor;
+            length++;
+            cursor++;
+            continue;
+        }
+
+        return_code = parse_conversion(cursor, &conversion);
+        if (return_code < 0) {
+            message[length] = '\0';
+            return -1;
+        }
+
+        if (conversion.kind == ARGUMENT_NONE) {
+            message[length] = '%';
+            length++;
+        } else {
+            return_code = unpack_conversion(message + length, message_size - length, cursor, &conversion, arguments,
+                                            arguments_size, &offset);
+            if (return_code < 0) {
+                message[length] = '\0';
+                return -1;
+            }
+            length += (size_t)return_code;
+            if (length >= message_size) {
+                length = message_size - 1;
+            }
+        }
+        cursor += conversion.length;
+    }
+
+    message[length] = '\0';
+    return 0;
+}
+
+static int64_t timespec_to_ns(const struct timespec *timestamp) {
+    return (int64_t)timestamp->tv_sec * 1000000000LL + (int64_t)timestamp->tv_nsec;
+}
+
+static int write_binary_record(const unsigned char *record, size_t size) {
+    size_t written = fwrite(record, 1, size, binary_file);
+    if (written != size) {
+        int error_num = errno;
+        fprintf(stderr, "%s:%d - %s - fwrite error=[%s]\n", __FILE__, __LINE__, __func__, strerror(error_num));
+        return -1;
+    }
+    return 0;
+}
+
+// Returns the id of a call site, writing its definition record the first time it is seen in the current file.
+// Must be called with binary_mutex held.
+static int intern_binary_site(const char *file, int line, const char *function, const char *format, uint32_t *id) {
+    uintptr_t hash = (uintptr_t)file ^ ((uintptr_t)format * 31u) ^ ((uintptr_t)function * 17u) ^ (uintptr_t)line;
+    size_t index = 0;
+    size_t probe = 0;
+    struct binary_site *site = NULL;
+    unsigned char record[BINARY_RECORD_SIZE];
+    size_t offset = 0;
+    uint8_t type = BINARY_RECORD_SITE;
+    int32_t line32 = line;
+    uint16_t file_length = 0;
+    uint16_t function_length = 0;
+    uint16_t format_length = 0;
+
+    hash ^= hash >> 17;
+    for (probe = 0; probe < BINARY_SITES; probe++) {
+        index = (hash + probe) & (BINARY_SITES - 1);
+        site = &binary_sites[index];
+        if (site->id == 0) {
+            break;
+        }
+        if (site->file == file && site->line == line && site->function == function && site->format == format) {
+            *id = site->id;
+            return 0;
+        }
+    }
+    if (probe >= BINARY_SITES) {
+        fprintf(stderr, "%s:%d - %s - Call-site table full BINARY_SITES=[%d]\n", __FILE__, __LINE__, __func__,
+                BINARY_SITES);
+        return -1;
+    }
+
+    file_length = (uint16_t)strnlen(file, UINT16_MAX);
+    function_length = (uint16_t)strnlen(function, UINT16_MAX);
+    format_length = (uint16_t)strnlen(format, UINT16_MAX);
+
+    // S id:u32 line:i32 file_length:u16 function_length:u16 format_length:u16 file function format
+    binary_site_count++;
+    if (pack_bytes(record, sizeof(record), &offset, &type, sizeof(type)) < 0 ||
+        pack_bytes(record, sizeof(record), &offset, &binary_site_count, sizeof(binary_site_count)) < 0 ||
+        pack_bytes(record, sizeof(record), &offset, &line32, sizeof(line32)) < 0 ||
+        pack_bytes(record, sizeof(record), &offset, &file_length, sizeof(file_length)) < 0 ||
+        pack_bytes(record, sizeof(record), &offset, &function_length, sizeof(function_length)) < 0 ||
+        pack_bytes(record, sizeof(record), &offset, &format_length, sizeof(format_length)) < 0 ||
+        pack_bytes(record, sizeof(record), &offset, file, file_length) < 0 ||
+        pack_bytes(record, sizeof(record), &offset, function, function_length) < 0 ||
+        pack_bytes(record, sizeof(record), &offset, format, format_length) < 0) {
+        fprintf(stderr, "%s:%d - %s - Site strings exceed BINARY_RECORD_SIZE=[%d]\n", __FILE__, __LINE__, __func__,
+                BINARY_RECORD_SIZE);
+        binary_site_count--;
+        return -1;
+    }
+    if (write_binary_record(record, offset) < 0) {
+        binary_site_count--;
+        return -1;
+    }
+
+    site->file = file;
+    site->line = line;
+    site->function = function;
+    site->format = format;
+    site->id = binary_site_count;
+    *id = site->id;
+    return 0;
+}
+
+// E site:u32 timestamp_ns:i64 size:u16 packed-arguments
+// M site:u32 timestamp_ns:i64 size:u16 message-text (arguments that could not be captured)
+static int write_binary_entry(const struct timespec *timestamp, const char *file, int line, const char *function,
+                              const char *format, bool preformatted, const unsigned char *arguments,
+                              size_t arguments_size) {
+    unsigned char record[BINARY_RECORD_SIZE];
+    size_t offset = 0;
+    uint8_t type = preformatted ? BINARY_RECORD_MESSAGE : BINARY_RECORD_ENTRY;
+    uint32_t id = 0;
+    int64_t timestamp_ns = timespec_to_ns(timestamp);
+    uint16_t size16 = (uint16_t)arguments_size;
+    int return_code = 0;
+
+    if (arguments_size > BINARY_ARGUMENTS_SIZE) {
+        fprintf(stderr, "%s:%d - %s - arguments_size=[%zu] exceeds BINARY_ARGUMENTS_SIZE=[%d]\n", __FILE__, __LINE__,
+                __func__, arguments_size, BINARY_ARGUMENTS_SIZE);
+        return -1;
+    }
+
+    pthread_mutex_lock(&binary_mutex);
+    if (binary_file == NULL) {
+        pthread_mutex_unlock(&binary_mutex);
+        return 0;
+    }
+
+    return_code = intern_binary_site(file, line, function, format, &id);
+    if (return_code == 0) {
+        (void)pack_bytes(record, sizeof(record), &offset, &type, sizeof(type));
+        (void)pack_bytes(record, sizeof(record), &offset, &id, sizeof(id));
+        (void)pack_bytes(record, sizeof(record), &offset, &timestamp_ns, sizeof(timestamp_ns));
+        (void)pack_bytes(record, sizeof(record), &offset, &size16, sizeof(size16));
+        (void)pack_bytes(record, sizeof(record), &offset, arguments, arguments_size);
+        return_code = write_binary_record(record, offset);
+    }
+    pthread_mutex_unlock(&binary_mutex);
+
+    return return_code;
+}
+
+int set_trace_binary_file(const char *path) {
+    struct binary_header header;
+    struct timespec realtime;
+    struct timespec monotonic;
+    size_t written = 0;
+    int return_code = 0;
+
+    if (path == NULL) {
+        fprintf(stderr, "%s:%d - %s - Argument path should not be NULL\n", __FILE__, __LINE__, __func__);
+        return -1;
+    }
+
+    close_trace_binary_file();
+
+    // Anchor the monotonic timestamps of the records to wall-clock time
+    return_code = clock_gettime(CLOCK_REALTIME, &realtime);
+    if (return_code == 0) {
+        return_code = clock_gettime(CLOCK_MONOTONIC, &monotonic);
+    }
+    if (return_code != 0) {
+        int error_num = errno;
+        fprintf(stderr, "%s:%d - %s - clock_gettime error=[%s]\n", __FILE__, __LINE__, __func__, strerror(error_num));
+        return -1;
+    }
+
+    memset(&header, 0, sizeof(header));
+    memcpy(header.magic, BINARY_MAGIC, sizeof(header.magic));
+    header.version = BINARY_VERSION;
+    header.byte_order = BINARY_BYTE_ORDER;
+    header.pointer_size = (uint8_t)sizeof(void *);
+    header.long_double_size = (uint8_t)sizeof(long double);
+    header.realtime_ns = timespec_to_ns(&realtime);
+    header.monotonic_ns = timespec_to_ns(&monotonic);
+
+    pthread_mutex_lock(&binary_mutex);
+    binary_file = fopen(path, "wb");
+    if (binary_file == NULL) {
+        int error_num = errno;
+        pthread_mutex_unlock(&binary_mutex);
+        fprintf(stderr, "%s:%d - %s - Failed to open file \"%s\" error=[%s]\n", __FILE__, __LINE__, __func__, path,
+                strerror(error_num));
+        return -1;
+    }
+    memset(binary_sites, 0, sizeof(binary_sites));
+    binary_site_count = 0;
+
+    written = fwrite(&header, 1, sizeof(header), binary_file);
+    if (written != sizeof(header)) {
+        int error_num = errno;
+        fclose(binary_file);
+        binary_file = NULL;
+        pthread_mutex_unlock(&binary_mutex);
+        fprintf(stderr, "%s:%d - %s - fwrite error=[%s]\n", __FILE__, __LINE__, __func__, strerror(error_num));
+        return -1;
+    }
+    pthread_mutex_unlock(&binary_mutex);
+
+    return 0;
+}
+
+void close_trace_binary_file(void) {
+    pthread_mutex_lock(&binary_mutex);
+    if (binary_file != NULL) {
+        fclose(binary_file);
+        binary_file = NULL;
+    }
+    pthread_mutex_unlock(&binary_mutex);
+    return;
+}
+
+static int read_exact(FILE *input, void *value, size_t size) {
+    return (fread(value, 1, size, input) == size) ? 0 : -1;
+}
+
+int trace_binary_dump(FILE *input, FILE *output) {
+    struct binary_header header;
+    struct dump_site *sites = NULL;
+    size_t site_capacity = 0;
+    size_t index = 0;
+    uint8_t type = 0;
+    int return_code = 0;
+    char output_line[LINE_SIZE];
+    unsigned char arguments[BINARY_ARGUMENTS_SIZE + 1];
+
+    if (input == NULL || output == NULL) {
+        fprintf(stderr, "%s:%d - %s - Arguments input and output should not be NULL\n", __FILE__, __LINE__, __func__);
+        return -1;
+    }
+
+    return_code = read_exact(input, &header, sizeof(header));
+    if (return_code < 0 || memcmp(header.magic, BINARY_MAGIC, sizeof(header.magic)) != 0) {
+        fprintf(stderr, "%s:%d - %s - Input is not a binary trace file\n", __FILE__, __LINE__, __func__);
+        return -1;
+    }
+    if (header.version != BINARY_VERSION || header.byte_order != BINARY_BYTE_ORDER ||
+        header.pointer_size != sizeof(void *) || header.long_double_size != sizeof(long double)) {
+        fprintf(stderr, "%s:%d - %s - Unsupported trace file version=[%u] or recorded on a different ABI\n", __FILE__,
+                __LINE__, __func__, header.version);
+        return -1;
+    }
+
+    site_capacity = BINARY_SITES + 1;
+    sites = calloc(site_capacity, sizeof(*sites));
+    if (sites == NULL) {
+        fprintf(stderr, "%s:%d - %s - calloc error\n", __FILE__, __LINE__, __func__);
+        return -1;
+    }
+
+    while (read_exact(input, &type, sizeof(type)) == 0) {
+        if (type == BINARY_RECORD_SITE) {
+            uint32_t id = 0;
+            int32_t line = 0;
+            uint16_t lengths[3] = {0, 0, 0};
+            char *strings = NULL;
+            size_t total = 0;
+
+            if (read_exact(input, &id, sizeof(id)) < 0 || read_exact(input, &line, sizeof(line)) < 0 ||
+                read_exact(input, lengths, sizeof(lengths)) < 0 || id == 0 || id >= site_capacity) {
+                return_code = -1;
+                break;
+            }
+            total = (size_t)lengths[0] + lengths[1] + lengths[2];
+            strings = malloc(total + 3);
+            if (strings == NULL || read_exact(input, strings, total) < 0) {
+                free(strings);
+                return_code = -1;
+                break;
+            }
+            // Split into three NUL-terminated strings
+            memmove(strings + lengths[0] + lengths[1] + 2, strings + lengths[0] + lengths[1], lengths[2]);
+            memmove(strings + lengths[0] + 1, strings + lengths[0], lengths[1]);
+            strings[lengths[0]] = '\0';
+            strings[lengths[0] + lengths[1] + 1] = '\0';
+            strings[total + 2] = '\0';
+
+            free(sites[id].strings);
+            sites[id].strings = strings;
+            sites[id].file = strings;
+            sites[id].function = strings + lengths[0] + 1;
+            sites[id].format = strings + lengths[0] + lengths[1] + 2;
+            sites[id].line = line;
+        } else if (type == BINARY_RECORD_ENTRY || type == BINARY_RECORD_MESSAGE) {
+            uint32_t id = 0;
+            int64_t timestamp_ns = 0;
+            int64_t wall_ns = 0;
+            uint16_t size = 0;
+            struct timespec timestamp;
+            size_t length = 0;
+            int prefix_length = 0;
+
+            if (read_exact(input, &id, sizeof(id)) < 0 || read_exact(input, &timestamp_ns, sizeof(timestamp_ns)) < 0 ||
+                read_exact(input, &size, sizeof(size)) < 0 || size > BINARY_ARGUMENTS_SIZE ||
+                read_exact(input, arguments, size) < 0 || id == 0 || id >= site_capacity || sites[id].file == NULL) {
+                return_code = -1;
+                break;
+            }
+
+            wall_ns = header.realtime_ns + (timestamp_ns - header.monotonic_ns);
+            timestamp.tv_sec = (time_t)(wall_ns / 1000000000LL);
+            timestamp.tv_nsec = (long)(wall_ns % 1000000000LL);
+            prefix_length = format_line_prefix(output_line, sizeof(output_line), &timestamp, sites[id].file,
+                                               sites[id].line, sites[id].function);
+            if (prefix_length < 0) {
+                return_code = -1;
+                break;
+            }
+            length = (size_t)prefix_length;
+
+            if (type == BINARY_RECORD_MESSAGE) {
+                size = (size < sizeof(output_line) - 1 - length) ? size : (uint16_t)(sizeof(output_line) - 1 - length);
+                memcpy(output_line + length, arguments, size);
+                length += size;
+            } else {
+                return_code = unpack_message(output_line + length, sizeof(output_line) - length, sites[id].format,
+                                             arguments, size);
+                if (return_code < 0) {
+                    fprintf(stderr, "%s:%d - %s - unpack_message error format=[%s]\n", __FILE__, __LINE__, __func__,
+                            sites[id].format);
+                    return_code = 0;
+                }
+                length += strlen(output_line + length);
+            }
+            length = finish_line(output_line, sizeof(output_line), length);
+
+            if (fwrite(output_line, 1, length, output) != length) {
+                int error_num = errno;
+                fprintf(stderr, "%s:%d - %s - fwrite error=[%s]\n", __FILE__, __LINE__, __func__, strerror(error_num));
+                return_code = -1;
+                break;
+            }
+        } else {
+            fprintf(stderr, "%s:%d - %s - Unknown record type=[0x%02X]\n", __FILE__, __LINE__, __func__, type);
+            return_code = -1;
+            break;
+        }
+    }
+    if (return_code < 0) {
+        fprintf(stderr, "%s:%d - %s - Truncated or corrupt trace file\n", __FILE__, __LINE__, __func__);
+    }
+
+    for (index = 0; index < site_capacity; index++) {
+        free(sites[index].strings);
+    }
+    free(sites);
+
+    return return_code;
+}
+
+// Wakes the writer if it is parked on an empty ring. The fence orders the caller's publish (or writer_stop) before the
+// check, pairing with the fence in writer_main(), so either the writer sees the new state or we see it waiting.
+static void wake_writer(void) {
+    atomic_thread_fence(memory_order_seq_cst);
+    if (atomic_load_explicit(&writer_waiting, memory_order_relaxed) &&
+        atomic_exchange_explicit(&writer_waiting, false, memory_order_relaxed)) {
+        pthread_mutex_lock(&writer_mutex);
+        pthread_cond_signal(&writer_wake);
+        pthread_mutex_unlock(&writer_mutex);
+    }
+}
+
+static void *writer_main(void *unused) {
+    struct ring_entry *entry = NULL;
+    struct ring_slot *slot = NULL;
+    uint_fast64_t dropped_reported = 0;
+    uint_fast64_t dropped = 0;
+    size_t length = 0;
+    int prefix_length = 0;
+    int return_code = 0;
+
+    (void)unused;
+
+    while (true) {
+        slot = &ring[ring_tail & (RING_SLOTS - 1)];
+        if (atomic_load_explicit(&slot->sequence, memory_order_acquire) != ring_tail + 1) {
+            // Ring is empty: report drops, exit if asked to, otherwise wait for producers
+            dropped = atomic_load_explicit(&ring_dropped, memory_order_relaxed);
+            if (dropped != dropped_reported) {
+                fprintf(stderr, "%s:%d - %s - Ring buffer full, dropped %ju trace entries\n", __FILE__, __LINE__,
+                        __func__, (uintmax_t)(dropped - dropped_reported));
+                dropped_reported = dropped;
+            }
+            // Every claimed position is published once stop_trace_async() sets writer_stop, so empty means consumed
+            if (atomic_load_explicit(&writer_stop, memory_order_acquire) &&
+                ring_tail == atomic_load_explicit(&ring_head, memory_order_acquire)) {
+                break;
+            }
+            // Park until the next entry or stop; the flag is raised before the ring is checked again, so a producer
+            // publishing in between either is seen here or sees the flag and signals
+            atomic_store_explicit(&writer_waiting, true, memory_order_relaxed);
+            atomic_thread_fence(memory_order_seq_cst);
+            if (atomic_load_explicit(&slot->sequence, memory_order_acquire) == ring_tail + 1 ||
+                atomic_load_explicit(&writer_stop, memory_order_acquire)) {
+                atomic_store_explicit(&writer_waiting, false, memory_order_relaxed);
+                continue;
+            }
+            pthread_mutex_lock(&writer_mutex);
+            while (atomic_load_explicit(&writer_waiting, memory_order_relaxed)) {
+                pthread_cond_wait(&writer_wake, &writer_mutex);
+            }
+            pthread_mutex_unlock(&writer_mutex);
+            continue;
+        }
+
+        entry = &slot->entry;
+        if (binary_file != NULL) {
+            (void)write_binary_entry(&entry->timestamp, entry->file, entry->line, entry->function, entry->format,
+                                     entry->preformatted, entry->arguments, entry->arguments_size);
+            atomic_store_explicit(&slot->sequence, ring_tail + RING_SLOTS, memory_order_release);
+            ring_tail++;
+            continue;
+        }
+
+        prefix_length = format_line_prefix(line_buffer, sizeof(line_buffer), &entry->timestamp, entry->file,
+                                           entry->line, entry->function);
+        if (prefix_length >= 0) {
+            length = (size_t)prefix_length;
+            if (entry->preformatted) {
+                size_t size = sizeof(line_buffer) - 1 - length;
+                size = (entry->arguments_size < size) ? entry->arguments_size : size;
+                memcpy(line_buffer + length, entry->arguments, size);
+                length += size;
+            } else {
+                return_code = unpack_message(line_buffer + length, sizeof(line_buffer) - length, entry->format,
+                                             entry->arguments, entry->arguments_size);
+                if (return_code < 0) {
+                    fprintf(stderr, "%s:%d - %s - unpack_message error format=[%s]\n", __FILE__, __LINE__, __func__,
+                            entry->format);
+                }
+                length += strlen(line_buffer + length);
+            }
+            length = finish_line(line_buffer, sizeof(line_buffer), length);
+            (void)emit_line(line_buffer, length);
+        }
+
+        // Release the slot for the producer one lap ahead
+        atomic_store_explicit(&slot->sequence, ring_tail + RING_SLOTS, memory_order_release);
+        ring_tail++;
+    }
+
+    pthread_mutex_lock(&binary_mutex);
+    if (binary_file != NULL) {
+        fflush(binary_file);
+    }
+    pthread_mutex_unlock(&binary_mutex);
+    if (trace_file != NULL) {
+        fflush(trace_file);
+    }
+    fflush(stdout);
+    return NULL;
+}
+
+// Multi-producer enqueue on a bounded ring (Vyukov): a producer claims a position by advancing ring_head, fills the
+// slot and then publishes it by storing position + 1 in the slot sequence.
+static int ring_push(const struct timespec *timestamp, const char *file, int line, const char *function,
+                     const char *format, va_list arguments) {
+    struct ring_slot *slot = NULL;
+    struct ring_entry *entry = NULL;
+    size_t position = atomic_load_explicit(&ring_head, memory_order_relaxed);
+    size_t sequence = 0;
+    int retries = 0;
+    int return_code = 0;
+    va_list arguments_pack;
+
+    for (retries = 0; retries < RING_CLAIM_RETRIES; retries++) {
+        slot = &ring[position & (RING_SLOTS - 1)];
+        sequence = atomic_load_explicit(&slot->sequence, memory_order_acquire);
+        if (sequence == position) {
+            if (atomic_compare_exchange_weak_explicit(&ring_head, &position, position + 1, memory_order_relaxed,
+                                                      memory_order_relaxed)) {
+                break;
+            }
+        } else if ((ptrdiff_t)(sequence - position) < 0) {
+            // Slot still holds an entry from the previous lap: ring is full, drop is counted and reported by the writer
+            atomic_fetch_add_explicit(&ring_dropped, 1, memory_order_relaxed);
+            return 0;
+        } else {
+            position = atomic_load_explicit(&ring_head, memory_order_relaxed);
+        }
+    }
+    if (retries >= RING_CLAIM_RETRIES) {
+        atomic_fetch_add_explicit(&ring_dropped, 1, memory_order_relaxed);
+        return 0;
+    }
+
+    entry = &slot->entry;
+    entry->timestamp = *timestamp;
+    entry->file = file;
+    entry->line = line;
+    entry->function = function;
+    entry->format = format;
+    entry->preformatted = false;
+
+    va_copy(arguments_pack, arguments);
+    return_code = pack_arguments(entry->arguments, sizeof(entry->arguments), &entry->arguments_size, format,
+                                 arguments_pack);
+    va_end(arguments_pack);
+
+    if (return_code < 0) {
+        // Arguments do not fit or use an unsupported conversion: format on the caller thread instead
+        va_list arguments_format;
+        va_copy(arguments_format, arguments);
+        return_code = vsnprintf((char *)entry->arguments, sizeof(entry->arguments), format, arguments_format);
+        va_end(arguments_format);
+        entry->preformatted = true;
+        entry->arguments_size = strnlen((const char *)entry->arguments, sizeof(entry->arguments) - 1);
+        if (return_code < 0) {
+            entry->arguments_size = 0;
+        }
+    }
+
+    atomic_store_explicit(&slot->sequence, position + 1, memory_order_release);
+    wake_writer();
+    return 0;
+}
+
+int start_trace_async(void) {
+    size_t index = 0;
+    int return_code = 0;
+
+    if (atomic_load(&async_running)) {
+        fprintf(stderr, "%s:%d - %s - Async trace writer is already running\n", __FILE__, __LINE__, __func__);
+        return -1;
+    }
+
+    for (index = 0; index < RING_SLOTS; index++) {
+        atomic_init(&ring[index].sequence, index);
+    }
+    atomic_store(&ring_head, 0);
+    ring_tail = 0;
+    atomic_store(&ring_dropped, 0);
+    atomic_store(&writer_stop, false);
+    atomic_store(&writer_waiting, false);
+
+    return_code = pthread_create(&writer_thread, NULL, writer_main, NULL);
+    if (return_code != 0) {
+        fprintf(stderr, "%s:%d - %s - pthread_create error=[%s]\n", __FILE__, __LINE__, __func__,
+                strerror(return_code));
+        return -1;
+    }
+
+    atomic_store(&async_running, true);
+    return 0;
+}
+
+void stop_trace_async(void) {
+    int return_code = 0;
+
+    if (!atomic_load(&async_running)) {
+        return;
+    }
+
+    // New entries go through the synchronous path from here on; producers that already saw async_running finish
+    // publishing their entry before the writer is told to drain what is left and exit
+    atomic_store(&async_running, false);
+    while (atomic_load(&ring_producers) != 0) {
+        sched_yield();
+    }
+    atomic_store(&writer_stop, true);
+    wake_writer();
+
+    return_code = pthread_join(writer_thread, NULL);
+    if (return_code != 0) {
+        fprintf(stderr, "%s:%d - %s - pthread_join error=[%s]\n", __FILE__, __LINE__, __func__,
+                strerror(return_code));
+    }
+    return;
+}
+
+uint64_t get_trace_async_dropped(void) {
+    return (uint64_t)atomic_load_explicit(&ring_dropped, memory_order_relaxed);
+}
+
+int _trace_va(const char *file, int line, const char *function, const char *format, va_list arguments) {
+    int return_code = 0;
+    struct timespec timestamp;
+    size_t length = 0;
+
+    // Validate arguments
+    if (file == NULL) {
+        fprintf(stderr, "%s:%d - %s - Argument file should not be NULL\n", __FILE__, __LINE__, __func__);
+        return -1;
+    }
+    if (function == NULL) {
+        fprintf(stderr, "%s:%d - %s - Argument function should not be NULL\n", __FILE__, __LINE__, __func__);
+        return -1;
+    }
+    if (format == NULL) {
+        fprintf(stderr, "%s:%d - %s - Argument format should not be NULL\n", __FILE__, __LINE__, __func__);
+        return -1;
+    }
+
+    // get current time, the binary sink records the monotonic clock and anchors it in the file header
+    return_code = clock_gettime((binary_file != NULL) ? CLOCK_MONOTONIC : CLOCK_REALTIME, &timestamp);
+    if (return_code != 0) {
+        int error_num = errno;
+        fprintf(stderr, "%s:%d - %s - clock_gettime error=[%s]\n", __FILE__, __LINE__, __func__, strerror(error_num));
+        return -1;
+    }
+
+    // hand the entry over to the writer thread, formatting and I/O happen there; the producer is counted before
+    // async_running is checked again, so stop_trace_async() cannot miss it
+    if (atomic_load_explicit(&async_running, memory_order_relaxed)) {
+        atomic_fetch_add(&ring_producers, 1);
+        if (atomic_load(&async_running)) {
+            return_code = ring_push(&timestamp, file, line, function, format, arguments);
+            atomic_fetch_sub(&ring_producers, 1);
+            return return_code;
+        }
+        atomic_fetch_sub(&ring_producers, 1);
+    }
+
+    // binary output skips text formatting entirely
+    if (binary_file != NULL) {
+        unsigned char packed[BINARY_ARGUMENTS_SIZE];
+        size_t packed_size = 0;
+        bool preformatted = false;
+        va_list arguments_pack;
+
+        va_copy(arguments_pack, arguments);
+        return_code = pack_arguments(packed, sizeof(packed), &packed_size, format, arguments_pack);
+        va_end(arguments_pack);
+        if (return_code < 0) {
+            va_list arguments_format;
+            va_copy(arguments_format, arguments);
+            return_code = vsnprintf((char *)packed, sizeof(packed), format, arguments_format);
+            va_end(arguments_format);
+            preformatted = true;
+            packed_size = (return_code < 0) ? 0 : strnlen((const char *)packed, sizeof(packed) - 1);
+        }
+
+        return write_binary_entry(&timestamp, file, line, function, format, preformatted, packed, packed_size);
+    }
+
+    // format the line once, every sink gets the same bytes
+    return_code = format_line_prefix(line_buffer, sizeof(line_buffer), &timestamp, file, line, function);
+    if (return_code < 0) {
+        return -1;
+    }
+    length = (size_t)return_code;
+
+    return_code = vsnprintf(line_buffer + length, sizeof(line_buffer) - length, format, arguments);
+    if (return_code < 0) {
+        int error_num = errno;
+        fprintf(stderr, "%s:%d - %s - vsnprintf error=[%s]\n", __FILE__, __LINE__, __func__, strerror(error_num));
+        return -1;
+    }
+    length = finish_line(line_buffer, sizeof(line_buffer), length + (size_t)return_code);
+
+    return emit_line(line_buffer, length);
+}
+
+int _trace(const char *file, int line, const char *function, const char *format, ...) {
+    int return_code = 0;
+    va_list arguments;
 
     va_start(arguments, format);
     return_code = _trace_va(file, line, function, format, arguments);
@@ -242,3 +1905,253 @@ int _trace(const char *file, int line, const char *function, const char *format,
 
     return 0;
 }
+
+static int_fast64_t get_coarse_second(void) {
+    struct timespec now;
+
+    if (clock_gettime(CLOCK_MONOTONIC_COARSE, &now) != 0) {
+        return 0;
+    }
+    return (int_fast64_t)now.tv_sec;
+}
+
+// Logs the pending "Suppressed K messages" line of a call site, at most once per second
+static int report_suppressed(struct trace_limit *limit, int_fast64_t now, const char *file, int line,
+                             const char *function) {
+    int_fast64_t summary = atomic_load_explicit(&limit->summary, memory_order_relaxed);
+    uint_fast64_t suppressed = 0;
+
+    if (summary == now || atomic_load_explicit(&limit->suppressed, memory_order_relaxed) == 0) {
+        return 0;
+    }
+    // Only one thread wins the second, the others leave the count for the next summary
+    if (!atomic_compare_exchange_strong_explicit(&limit->summary, &summary, now, memory_order_relaxed,
+                                                 memory_order_relaxed)) {
+        return 0;
+    }
+
+    suppressed = atomic_exchange_explicit(&limit->suppressed, 0, memory_order_relaxed);
+    if (suppressed == 0) {
+        return 0;
+    }
+    return _trace(file, line, function, "Suppressed %ju messages", (uintmax_t)suppressed);
+}
+
+// Counts a skipped occurrence and flushes the count of earlier seconds, so a site that keeps skipping still reports
+static void count_suppressed(struct trace_limit *limit, int_fast64_t now, const char *file, int line,
+                             const char *function) {
+    // A new count is first reported in the next second rather than one occurrence at a time
+    if (atomic_fetch_add_explicit(&limit->suppressed, 1, memory_order_relaxed) == 0) {
+        atomic_store_explicit(&limit->summary, now, memory_order_relaxed);
+        return;
+    }
+    (void)report_suppressed(limit, now, file, line, function);
+}
+
+int _trace_limit_per_second(struct trace_limit *limit, unsigned int per_second, const char *file, int line,
+                            const char *function) {
+    int_fast64_t now = 0;
+    int_fast64_t window = 0;
+    uint_fast64_t count = 0;
+
+    if (limit == NULL || file == NULL || function == NULL) {
+        fprintf(stderr, "%s:%d - %s - Arguments limit, file and function should not be NULL\n", __FILE__, __LINE__,
+                __func__);
+        return 1;
+    }
+    if (per_second == 0) {
+        return 1;
+    }
+
+    // Fixed one-second windows; a racing reset only lets a few extra entries through
+    now = get_coarse_second();
+    window = atomic_load_explicit(&limit->window, memory_order_relaxed);
+    if (window != now && atomic_compare_exchange_strong_explicit(&limit->window, &window, now, memory_order_relaxed,
+                                                                 memory_order_relaxed)) {
+        atomic_store_explicit(&limit->count, 0, memory_order_relaxed);
+    }
+
+    count = atomic_fetch_add_explicit(&limit->count, 1, memory_order_relaxed);
+    if (count >= per_second) {
+        count_suppressed(limit, now, file, line, function);
+        return 0;
+    }
+
+    (void)report_suppressed(limit, now, file, line, function);
+    return 1;
+}
+
+int _trace_limit_every(struct trace_limit *limit, unsigned int every, const char *file, int line,
+                       const char *function) {
+    uint_fast64_t count = 0;
+
+    if (limit == NULL || file == NULL || function == NULL) {
+        fprintf(stderr, "%s:%d - %s - Arguments limit, file and function should not be NULL\n", __FILE__, __LINE__,
+                __func__);
+        return 1;
+    }
+    if (every <= 1) {
+        return 1;
+    }
+
+    count = atomic_fetch_add_explicit(&limit->count, 1, memory_order_relaxed);
+    if (count % every != 0) {
+        count_suppressed(limit, get_coarse_second(), file, line, function);
+        return 0;
+    }
+
+    (void)report_suppressed(limit, get_coarse_second(), file, line, function);
+    return 1;
+}
+
+int start_trace_spans(void) {
+    atomic_store(&span_count, 0);
+    atomic_store(&spans_enabled, true);
+    return 0;
+}
+
+void stop_trace_spans(void) {
+    atomic_store(&spans_enabled, false);
+    return;
+}
+
+uint64_t get_trace_spans_dropped(void) {
+    size_t count = atomic_load_explicit(&span_count, memory_order_relaxed);
+    return (count > SPAN_EVENTS) ? (uint64_t)(count - SPAN_EVENTS) : 0;
+}
+
+int64_t _trace_span_now(void) {
+    struct timespec now;
+
+    if (!atomic_load_explicit(&spans_enabled, memory_order_relaxed)) {
+        return 0;
+    }
+    if (clock_gettime(CLOCK_MONOTONIC, &now) != 0) {
+        return 0;
+    }
+    return timespec_to_ns(&now);
+}
+
+void _trace_span_begin(struct trace_span *span, const char *name) {
+    if (span == NULL) {
+        fprintf(stderr, "%s:%d - %s - Argument span should not be NULL\n", __FILE__, __LINE__, __func__);
+        return;
+    }
+    span->name = name;
+    span->begin_ns = _trace_span_now();
+    return;
+}
+
+void _trace_span_end(struct trace_span *span) {
+    struct span_event *event = NULL;
+    size_t index = 0;
+    int64_t end_ns = 0;
+
+    // Not recording when the span began, or stopped since
+    if (span == NULL || span->begin_ns == 0) {
+        return;
+    }
+    end_ns = _trace_span_now();
+    if (end_ns == 0) {
+        return;
+    }
+
+    index = atomic_fetch_add_explicit(&span_count, 1, memory_order_relaxed);
+    if (index >= SPAN_EVENTS) {
+        return;
+    }
+    if (span_thread == 0) {
+        span_thread = (uint32_t)atomic_fetch_add_explicit(&span_thread_count, 1, memory_order_relaxed) + 1;
+    }
+
+    event = &span_events[index];
+    event->name = (span->name != NULL) ? span->name : "(null)";
+    event->begin_ns = span->begin_ns;
+    event->end_ns = end_ns;
+    event->thread = span_thread;
+    return;
+}
+
+// Writes a JSON string body, escaping quotes, backslashes and control characters
+static int write_json_string(FILE *output, const char *text) {
+    const unsigned char *cursor = (const unsigned char *)text;
+    int return_code = 0;
+
+    for (; *cursor != '\0'; cursor++) {
+        if (*cursor == '"' || *cursor == '\\') {
+            return_code = fprintf(output, "\\%c", *cursor);
+        } else if (*cursor < 0x20) {
+            return_code = fprintf(output, "\\u%04x", *cursor);
+        } else {
+            return_code = fputc(*cursor, output);
+        }
+        if (return_code < 0) {
+            return -1;
+        }
+    }
+    return 0;
+}
+
+int write_trace_spans(const char *path) {
+    FILE *output = NULL;
+    const struct span_event *event = NULL;
+    size_t count = 0;
+    size_t index = 0;
+    int64_t duration_ns = 0;
+    int return_code = 0;
+    int process = (int)getpid();
+
+    if (path == NULL) {
+        fprintf(stderr, "%s:%d - %s - Argument path should not be NULL\n", __FILE__, __LINE__, __func__);
+        return -1;
+    }
+
+    output = fopen(path, "w");
+    if (output == NULL) {
+        int error_num = errno;
+        fprintf(stderr, "%s:%d - %s - Failed to open file \"%s\" error=[%s]\n", __FILE__, __LINE__, __func__, path,
+                strerror(error_num));
+        return -1;
+    }
+
+    count = atomic_load(&span_count);
+    if (count > SPAN_EVENTS) {
+        count = SPAN_EVENTS;
+    }
+
+    // ts and dur are microseconds, printed from integer nanoseconds to keep full precision
+    return_code = fprintf(output, "{\"displayTimeUnit\":\"ns\",\"traceEvents\":[");
+    for (index = 0; index < count && return_code >= 0; index++) {
+        event = &span_events[index];
+        duration_ns = event->end_ns - event->begin_ns;
+        return_code = fprintf(output, "%s\n{\"name\":\"", (index == 0) ? "" : ",");
+        if (return_code >= 0) {
+            return_code = write_json_string(output, event->name);
+        }
+        if (return_code >= 0) {
+            return_code = fprintf(output,
+                                  "\",\"cat\":\"span\",\"ph\":\"X\",\"pid\":%d,\"tid\":%" PRIu32
+                                  ",\"ts\":%" PRId64 ".%03" PRId64 ",\"dur\":%" PRId64 ".%03" PRId64 "}",
+                                  process, event->thread, event->begin_ns / 1000, event->begin_ns % 1000,
+                                  duration_ns / 1000, duration_ns % 1000);
+        }
+    }
+    if (return_code >= 0) {
+        return_code = fprintf(output, "\n]}\n");
+    }
+    if (return_code < 0) {
+        int error_num = errno;
+        fprintf(stderr, "%s:%d - %s - fprintf error=[%s]\n", __FILE__, __LINE__, __func__, strerror(error_num));
+        fclose(output);
+        return -1;
+    }
+
+    return_code = fclose(output);
+    if (return_code != 0) {
+        int error_num = errno;
+        fprintf(stderr, "%s:%d - %s - fclose error=[%s]\n", __FILE__, __LINE__, __func__, strerror(error_num));
+        return -1;
+    }
+
+    return 0;
+}
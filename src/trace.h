@@ -9,34 +9,246 @@
     __func__) together with a printf-style formatted message. Format strings are validated at compile time via the
    printf format attribute, and callers must not include a trailing newline, as TRACE always emits exactly one line.
 
-    Each trace entry is written to stdout and, if configured, duplicated to a log file set via set_trace_file(). Every
-    line begins with a local ISO-8601 timestamp including nanoseconds and a numeric timezone offset, followed by the
-    call-site information and the formatted message.
+    Each trace entry is formatted once into a thread-local line buffer (LINE_SIZE bytes in trace.c, longer messages are
+    truncated) and the same bytes are handed to every registered sink. By default the only sink is stdout; a log file
+    set via set_trace_file() is added as a second sink. Every line begins with a local ISO-8601 timestamp including
+    nanoseconds and a numeric timezone offset, followed by the call-site information and the formatted message.
 
     The output format is:
         YYYY-MM-DDTHH:MM:SS,nnnnnnnnn+HH:MM file:line - function - message
 
-    TRACE returns 0 on success and -1 on internal failure. When an internal error occurs, details are reported to
-    stderr. This behavior is intentional while the module is under development.
+    TRACE is a statement. The underlying _trace() returns 0 on success and -1 on internal failure. When an internal
+    error occurs, details are reported to stderr. This behavior is intentional while the module is under development.
 
     The trace module depends only on standard C/POSIX libraries and trace.h. Other modules may depend on trace, but
     trace itself remains fully standalone and must not affect application logic beyond producing diagnostic output.
 
+    Sinks:
+    A sink is a function receiving one complete line, newline included, and the context pointer it was registered
+    with. Up to TRACE_SINKS sinks are called in registration order; a failing sink does not stop the others.
+    trace_stream_sink() writes a line with a single fwrite() to the FILE * given as context and keeps stdio buffering;
+    stdout (trace_stdout_sink()) and the trace file use it. trace_fd_sink() writes a line with a single write() to the
+    file descriptor its context points to, unbuffered, so lines reach the file even if the process crashes and stay
+    whole on O_APPEND files shared by several processes. The sink list is not locked: change it before starting threads
+    or the async writer.
+
+    Memory-mapped log:
+    set_trace_mmap_file() adds a sink that appends to <path>.0000, <path>.0001, ... Each segment is preallocated with
+    posix_fallocate() to segment_size bytes and mapped; an append claims its range with one atomic add and copies the
+    line with memcpy, so no syscall happens per line and concurrent threads need no lock. When a line does not fit, or
+    rotate_seconds (0 disables it) have passed since the segment was opened, the next segment is created and the full
+    one is trimmed to its valid data. A segment that is still open (or left behind by a crash) is zero-filled after the
+    last line. Existing segment files are never overwritten, each new segment takes the next unused index.
+
+    Asynchronous mode:
+    start_trace_async() moves formatting and I/O off the calling thread. While it is active, TRACE only takes the
+    timestamp, stores the call-site pointers and copies the raw arguments described by the format string into a
+    fixed-size lock-free ring buffer; a background writer thread rebuilds the message and writes it to the same sinks.
+    An idle writer sleeps on a condition variable, the first entry pushed into the empty ring wakes it.
+    String arguments are copied (and truncated to the space left in the entry), so callers may pass stack buffers, but
+    the format string itself must remain valid until it is written, which holds for the literals used by TRACE.
+    Conversions that cannot be captured (%n, wide strings, arguments larger than an entry) are formatted on the caller
+    thread instead. When the ring is full the entry is dropped and counted, see get_trace_async_dropped().
+    set_trace_file() and the sink functions must not be called while the writer is running. stop_trace_async() waits for
+    entries being pushed, drains the ring, joins the writer and returns TRACE to synchronous output.
+
+    Binary output:
+    set_trace_binary_file() replaces text output with a compact binary stream: no timestamp or message formatting
+    happens, stdout and the text trace file receive nothing until close_trace_binary_file(). The file starts with a
+    header holding CLOCK_REALTIME and CLOCK_MONOTONIC sampled together, followed by records:
+        S  call-site definition: id, line, file, function and format, written the first time a site is used
+        E  entry: site id, CLOCK_MONOTONIC nanoseconds and the raw argument bytes (same packing as the async ring)
+        M  entry whose arguments could not be captured: site id, timestamp and the already formatted message
+    bin/tracedump (trace_binary_dump()) turns the file back into the text format above. Local time is computed with
+    the time zone of the decoding process, so set TZ to match the recording host. Files are only portable between
+    builds with the same byte order, pointer and long double sizes.
+
+    Levels:
+    TRACE_VERBOSE, TRACE_DEBUG, TRACE_INFO, TRACE_WARN and TRACE_ERROR record at the matching level; plain TRACE is
+    TRACE_INFO. Levels below TRACE_MIN_LEVEL (a build-time define, TRACE_LEVEL_VERBOSE by default) compile to nothing:
+    arguments are still type-checked but never evaluated and no call is emitted. Levels that survive the build are
+    filtered at runtime against trace_level (see set_trace_level()) with a single compare, taken before any argument is
+    evaluated. The level is not part of the output line.
+
+    Rate limiting:
+    TRACE_LIMIT(per_second, ...) logs at most per_second entries per second from its call site and TRACE_EVERY(n, ...)
+    logs the first of every n occurrences, 0 meaning no limit; both record at TRACE_LEVEL_INFO like TRACE. Each
+    expansion owns a static struct trace_limit, so limits are per call site and shared by all threads. Skipped
+    occurrences do not evaluate their arguments and are counted. The count is reported at most once per second, by
+    the first occurrence of that site in a later second than the count started, logged or skipped, as a line
+    "Suppressed K messages" carrying the same call-site context (ahead of the entry when one is logged). A flood that
+    keeps a TRACE_EVERY site skipping is thus still reported every second; only the occurrences skipped in the last
+    second a site is reached stay unreported, there is no timer to flush them. ASSERT uses the same state, see
+    assert.h.
+
+    Spans:
+    TRACE_SPAN(name) declares a scoped timer: it samples CLOCK_MONOTONIC where it is declared and records a span when
+    the enclosing block is left, return paths included (cleanup attribute). TRACE_SPAN_BEGIN(span, name) and
+    TRACE_SPAN_END(span) do the same for an explicitly declared struct trace_span around a few statements. Spans are
+    only recorded between start_trace_spans() and stop_trace_spans(); otherwise each costs one relaxed load. Recorded
+    spans go into a preallocated table (SPAN_EVENTS entries in trace.c), spans beyond it are dropped and counted, see
+    get_trace_spans_dropped(). write_trace_spans() saves the table as Chrome trace-event JSON ("X" complete events,
+    timestamps in microseconds of CLOCK_MONOTONIC) that chrome://tracing and ui.perfetto.dev open as a timeline. The
+    name must be a string that outlives the export, normally a literal. Call write_trace_spans() after
+    stop_trace_spans() once other threads have left their spans.
+
     TODO:
     Performance optimizations may be introduced later, such as reducing function calls or minimizing per-call overhead,
     once behavior and stability are fully validated.
 */
 
 #include <stdarg.h>
+#include <stdatomic.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <stdio.h>
+
+#define TRACE_LEVEL_VERBOSE 0
+#define TRACE_LEVEL_DEBUG 1
+#define TRACE_LEVEL_INFO 2
+#define TRACE_LEVEL_WARN 3
+#define TRACE_LEVEL_ERROR 4
+#define TRACE_LEVEL_OFF 5
+
+#ifndef TRACE_MIN_LEVEL
+    #define TRACE_MIN_LEVEL TRACE_LEVEL_VERBOSE
+#endif
+
+// Runtime threshold, entries below it are skipped. Set it through set_trace_level() before starting other threads.
+extern int trace_level;
+
+int set_trace_level(int level);
+
+#define TRACE_SINKS 8
+
+typedef int (*trace_sink_function)(void *context, const char *line, size_t length);
+
+int add_trace_sink(trace_sink_function function, void *context);
+int remove_trace_sink(trace_sink_function function, void *context);
+int trace_stream_sink(void *context, const char *line, size_t length);
+int trace_fd_sink(void *context, const char *line, size_t length);
+int trace_stdout_sink(void *context, const char *line, size_t length);
 
 int set_trace_file(const char *path);
 void close_trace_file(void);
 
+int set_trace_mmap_file(const char *path, size_t segment_size, int rotate_seconds);
+void close_trace_mmap_file(void);
+
+int set_trace_binary_file(const char *path);
+void close_trace_binary_file(void);
+int trace_binary_dump(FILE *input, FILE *output);
+
+int start_trace_async(void);
+void stop_trace_async(void);
+uint64_t get_trace_async_dropped(void);
+
+// Per-call-site limiter state, zero-initialized as a static at each rate-limited expansion
+struct trace_limit {
+    atomic_int_fast64_t window;  // CLOCK_MONOTONIC_COARSE second the count belongs to
+    atomic_uint_fast64_t count;  // occurrences in the window (per second) or since start (every n)
+    atomic_uint_fast64_t suppressed;  // occurrences skipped since the last summary
+    atomic_int_fast64_t summary;  // second of the last summary
+};
+
+int _trace_limit_per_second(struct trace_limit *limit, unsigned int per_second, const char *file, int line,
+                            const char *function);
+int _trace_limit_every(struct trace_limit *limit, unsigned int every, const char *file, int line,
+                       const char *function);
+
+// Open span, name and start in CLOCK_MONOTONIC nanoseconds, begin_ns is 0 when spans are not being recorded
+struct trace_span {
+    const char *name;
+    int64_t begin_ns;
+};
+
+int start_trace_spans(void);
+void stop_trace_spans(void);
+int write_trace_spans(const char *path);
+uint64_t get_trace_spans_dropped(void);
+
+int64_t _trace_span_now(void);
+void _trace_span_begin(struct trace_span *span, const char *name);
+void _trace_span_end(struct trace_span *span);
+
 int _trace_va(const char *file, int line, const char *function, const char *format, va_list arguments);
 
 int _trace(const char *file, int line, const char *function, const char *format, ...)
     __attribute__((format(printf, 4, 5)));
 
-#define TRACE(...) _trace(__FILE__, __LINE__, __func__, __VA_ARGS__)
+#define _TRACE_AT(level, ...)                                  \
+    do {                                                       \
+        if ((level) >= trace_level) {                          \
+            _trace(__FILE__, __LINE__, __func__, __VA_ARGS__); \
+        }                                                      \
+    } while (0)
+
+// Keeps the format check and the argument references of a compiled-out call without emitting any code
+#define _TRACE_DISCARD(...)                                    \
+    do {                                                       \
+        if (0) {                                               \
+            _trace(__FILE__, __LINE__, __func__, __VA_ARGS__); \
+        }                                                      \
+    } while (0)
+
+#if TRACE_MIN_LEVEL <= TRACE_LEVEL_VERBOSE
+    #define TRACE_VERBOSE(...) _TRACE_AT(TRACE_LEVEL_VERBOSE, __VA_ARGS__)
+#else
+    #define TRACE_VERBOSE(...) _TRACE_DISCARD(__VA_ARGS__)
+#endif
+
+#if TRACE_MIN_LEVEL <= TRACE_LEVEL_DEBUG
+    #define TRACE_DEBUG(...) _TRACE_AT(TRACE_LEVEL_DEBUG, __VA_ARGS__)
+#else
+    #define TRACE_DEBUG(...) _TRACE_DISCARD(__VA_ARGS__)
+#endif
+
+#if TRACE_MIN_LEVEL <= TRACE_LEVEL_INFO
+    #define TRACE_INFO(...) _TRACE_AT(TRACE_LEVEL_INFO, __VA_ARGS__)
+#else
+    #define TRACE_INFO(...) _TRACE_DISCARD(__VA_ARGS__)
+#endif
+
+#if TRACE_MIN_LEVEL <= TRACE_LEVEL_WARN
+    #define TRACE_WARN(...) _TRACE_AT(TRACE_LEVEL_WARN, __VA_ARGS__)
+#else
+    #define TRACE_WARN(...) _TRACE_DISCARD(__VA_ARGS__)
+#endif
+
+#if TRACE_MIN_LEVEL <= TRACE_LEVEL_ERROR
+    #define TRACE_ERROR(...) _TRACE_AT(TRACE_LEVEL_ERROR, __VA_ARGS__)
+#else
+    #define TRACE_ERROR(...) _TRACE_DISCARD(__VA_ARGS__)
+#endif
+
+#define TRACE(...) TRACE_INFO(__VA_ARGS__)
+
+#define _TRACE_LIMITED_AT(level, check, n, ...)                                 \
+    do {                                                                        \
+        if ((level) >= trace_level) {                                           \
+            static struct trace_limit _trace_limit;                             \
+            if (check(&_trace_limit, (n), __FILE__, __LINE__, __func__) != 0) { \
+                _trace(__FILE__, __LINE__, __func__, __VA_ARGS__);              \
+            }                                                                   \
+        }                                                                       \
+    } while (0)
+
+#define _TRACE_CONCATENATE(a, b) a##b
+#define _TRACE_UNIQUE(prefix, line) _TRACE_CONCATENATE(prefix, line)
+
+#define TRACE_SPAN(name)                                                                                \
+    struct trace_span _TRACE_UNIQUE(_trace_span_, __LINE__) __attribute__((cleanup(_trace_span_end))) = \
+        {(name), _trace_span_now()}
+#define TRACE_SPAN_BEGIN(span, name) _trace_span_begin(&(span), (name))
+#define TRACE_SPAN_END(span) _trace_span_end(&(span))
+
+#if TRACE_MIN_LEVEL <= TRACE_LEVEL_INFO
+    #define TRACE_LIMIT(per_second, ...) \
+        _TRACE_LIMITED_AT(TRACE_LEVEL_INFO, _trace_limit_per_second, per_second, __VA_ARGS__)
+    #define TRACE_EVERY(n, ...) _TRACE_LIMITED_AT(TRACE_LEVEL_INFO, _trace_limit_every, n, __VA_ARGS__)
+#else
+    #define TRACE_LIMIT(per_second, ...) _TRACE_DISCARD(__VA_ARGS__)
+    #define TRACE_EVERY(n, ...) _TRACE_DISCARD(__VA_ARGS__)
+#endif
 
 #endif /* TRACE_H */
@@ -0,0 +1,155 @@
+#define _DEFAULT_SOURCE
+
+#include <errno.h>
+#include <inttypes.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include "trace.h"
+
+/*  TRACE micro-benchmark
+
+    Measures the caller-side cost of a single TRACE line. Trace output goes to stdout and results go to stderr, so run
+    it with stdout redirected to keep the terminal out of the measurement:
+
+        bin/trace_benchmark [lines] > /dev/null
+*/
+
+#define DEFAULT_LINES 1000000L
+#define MAX_LINES 100000000L
+
+int get_elapsed_ns(const struct timespec* start, int64_t* elapsed_ns);
+int benchmark_trace(const char* name, const long lines);
+int benchmark_trace_filtered(const char* name, const long lines);
+int main(int argc, char** argv);
+
+int get_elapsed_ns(const struct timespec* start, int64_t* elapsed_ns) {
+    struct timespec end;
+    int return_code = 0;
+
+    if (start == NULL || elapsed_ns == NULL) {
+        fprintf(stderr, "%s:%d - %s - Arguments must not be NULL\n", __FILE__, __LINE__, __func__);
+        return -1;
+    }
+
+    return_code = clock_gettime(CLOCK_MONOTONIC, &end);
+    if (return_code != 0) {
+        int error_num = errno;
+        fprintf(stderr, "%s:%d - %s - clock_gettime error=[%s]\n", __FILE__, __LINE__, __func__, strerror(error_num));
+        return -1;
+    }
+
+    *elapsed_ns = ((int64_t)end.tv_sec - (int64_t)start->tv_sec) * 1000000000LL +
+                  ((int64_t)end.tv_nsec - (int64_t)start->tv_nsec);
+    return 0;
+}
+
+int benchmark_trace(const char* name, const long lines) {
+    struct timespec start;
+    int64_t elapsed_ns = 0;
+    long counter = 0;
+    int return_code = 0;
+
+    return_code = clock_gettime(CLOCK_MONOTONIC, &start);
+    if (return_code != 0) {
+        int error_num = errno;
+        fprintf(stderr, "%s:%d - %s - clock_gettime error=[%s]\n", __FILE__, __LINE__, __func__, strerror(error_num));
+        return -1;
+    }
+
+    for (counter = 0; counter < lines; counter++) {
+        TRACE("benchmark line=[%ld] value=[%d] name=[%s]", counter, (int)(counter & 0xFF), name);
+    }
+
+    return_code = get_elapsed_ns(&start, &elapsed_ns);
+    if (return_code != 0) {
+        return -1;
+    }
+
+    fprintf(stderr, "%-24s lines=[%ld] total=[%.3f ms] per_line=[%.1f ns]\n", name, lines,
+            (double)elapsed_ns / 1000000.0, (double)elapsed_ns / (double)lines);
+    return 0;
+}
+
+// Same loop as benchmark_trace() at a level that is filtered out at runtime
+int benchmark_trace_filtered(const char* name, const long lines) {
+    struct timespec start;
+    int64_t elapsed_ns = 0;
+    long counter = 0;
+    int return_code = 0;
+
+    return_code = clock_gettime(CLOCK_MONOTONIC, &start);
+    if (return_code != 0) {
+        int error_num = errno;
+        fprintf(stderr, "%s:%d - %s - clock_gettime error=[%s]\n", __FILE__, __LINE__, __func__, strerror(error_num));
+        return -1;
+    }
+
+    for (counter = 0; counter < lines; counter++) {
+        TRACE_VERBOSE("benchmark line=[%ld] value=[%d] name=[%s]", counter, (int)(counter & 0xFF), name);
+    }
+
+    return_code = get_elapsed_ns(&start, &elapsed_ns);
+    if (return_code != 0) {
+        return -1;
+    }
+
+    fprintf(stderr, "%-24s lines=[%ld] total=[%.3f ms] per_line=[%.1f ns]\n", name, lines,
+            (double)elapsed_ns / 1000000.0, (double)elapsed_ns / (double)lines);
+    return 0;
+}
+
+int main(int argc, char** argv) {
+    long lines = DEFAULT_LINES;
+    int return_code = 0;
+
+    if (argc > 1) {
+        char* end = NULL;
+        errno = 0;
+        lines = strtol(argv[1], &end, 10);
+        if (errno != 0 || end == argv[1] || *end != '\0' || lines <= 0 || lines > MAX_LINES) {
+            fprintf(stderr, "Usage: %s [lines] > /dev/null  (1 <= lines <= %ld)\n", argv[0], MAX_LINES);
+            return -1;
+        }
+    }
+
+    return_code = benchmark_trace("sync", lines);
+    if (return_code != 0) {
+        return -1;
+    }
+
+    return_code = start_trace_async();
+    if (return_code != 0) {
+        return -1;
+    }
+    return_code = benchmark_trace("async (caller side)", lines);
+    stop_trace_async();
+    if (return_code != 0) {
+        return -1;
+    }
+    fprintf(stderr, "%-24s dropped=[%" PRIu64 "]\n", "async", get_trace_async_dropped());
+
+    return_code = set_trace_binary_file("/dev/null");
+    if (return_code != 0) {
+        return -1;
+    }
+    return_code = benchmark_trace("binary (sync)", lines);
+    close_trace_binary_file();
+    if (return_code != 0) {
+        return -1;
+    }
+
+    return_code = set_trace_level(TRACE_LEVEL_INFO);
+    if (return_code != 0) {
+        return -1;
+    }
+    return_code = benchmark_trace_filtered("filtered (runtime)", lines);
+    if (return_code != 0) {
+        return -1;
+    }
+
+    return 0;
+}
@@ -0,0 +1,57 @@
+#include <errno.h>
+#include <stdio.h>
+#include <string.h>
+
+#include "trace.h"
+
+/*  tracedump
+
+    Decodes a binary trace file written through set_trace_binary_file() into the regular TRACE text format:
+
+        bin/tracedump <trace-file> [output-file]
+
+    Output goes to stdout when no output file is given.
+*/
+
+int main(int argc, char** argv) {
+    FILE* input = NULL;
+    FILE* output = stdout;
+    int return_code = 0;
+
+    if (argc < 2 || argc > 3) {
+        fprintf(stderr, "Usage: %s <trace-file> [output-file]\n", argv[0]);
+        return -1;
+    }
+
+    input = fopen(argv[1], "rb");
+    if (input == NULL) {
+        int error_num = errno;
+        fprintf(stderr, "%s:%d - %s - Failed to open file \"%s\" error=[%s]\n", __FILE__, __LINE__, __func__, argv[1],
+                strerror(error_num));
+        return -1;
+    }
+
+    if (argc == 3) {
+        output = fopen(argv[2], "wb");
+        if (output == NULL) {
+            int error_num = errno;
+            fprintf(stderr, "%s:%d - %s - Failed to open file \"%s\" error=[%s]\n", __FILE__, __LINE__, __func__,
+                    argv[2], strerror(error_num));
+            fclose(input);
+            return -1;
+        }
+    }
+
+    return_code = trace_binary_dump(input, output);
+
+    fclose(input);
+    if (output != stdout) {
+        fclose(output);
+    }
+
+    if (return_code < 0) {
+        fprintf(stderr, "%s:%d - %s - trace_binary_dump error\n", __FILE__, __LINE__, __func__);
+        return -1;
+    }
+    return 0;
+}